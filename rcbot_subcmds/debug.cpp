@@ -31,6 +31,7 @@
  *
  */
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 
@@ -38,8 +39,18 @@
 #include "bot_fortress.h"
 #include "bot_getprop.h"
 #include "bot_globals.h"
+#include "bot_navigator.h"
+#include "bot_waypoint_areas.h"
+#include "bot_waypoint_flow.h"
+#include "bot_waypoint_hierarchy.h"
+#include "bot_waypoint_landmarks.h"
+#include "bot_route_cache.h"
+#include "bot_path_budget.h"
+#include "bot_path_planner.h"
 #include "bot_schedule.h"
 #include "bot_task.h"
+#include "bot_trace_budget.h"
+#include "bot_visibility_cache.h"
 #include "bot_waypoint.h"
 #include "bot_weapons.h"
 
@@ -372,6 +383,152 @@ CBotCommandInline DebugProfilingCommand("profiling", CMD_ACCESS_DEBUG, [](CClien
 	return COMMAND_ACCESSED;
 }, "usage \"profiling 1 or 0, 1 on, 0 off\" : shows performance profiling");
 
+CBotCommandInline DebugPathStatsCommand("pathstats", CMD_ACCESS_DEBUG, [](CClient* pClient, const BotCommandArgs& args)
+{
+	edict_t* pEntity = pClient ? pClient->getPlayer() : nullptr;
+
+	if (args[0] && *args[0] && std::strcmp(args[0], "reset") == 0)
+	{
+		CWaypointNavigator::resetSearchStats();
+		CWaypointReplanner::resetStats();
+		CPathSearchBudget::resetStats();
+		CWaypointFlowFields::resetStats();
+		CWaypointHierarchies::resetStats();
+		CBotGlobals::botMessage(pEntity, 0, "path search stats reset");
+
+		return COMMAND_ACCESSED;
+	}
+
+	unsigned int iSearches;
+	unsigned int iExpanded;
+	double fMilliseconds;
+
+	CWaypointNavigator::getSearchStats(&iSearches, &iExpanded, &fMilliseconds);
+
+	CBotGlobals::botMessage(pEntity, 0, "searches completed: %u, nodes expanded: %u, search time: %0.2fms", iSearches, iExpanded, fMilliseconds);
+
+	if (fMilliseconds > 0.0)
+		CBotGlobals::botMessage(pEntity, 0, "nodes expanded per ms: %0.1f", static_cast<double>(iExpanded) / fMilliseconds);
+
+	CBotGlobals::botMessage(pEntity, 0, "search contexts: %u allocated, %u leased", static_cast<unsigned>(CAStarSearchPool::numContexts()), static_cast<unsigned>(CAStarSearchPool::numLeased()));
+	CBotGlobals::botMessage(pEntity, 0, "area clusters: %d, portals: %d", CWaypointAreaGraph::numClusters(), CWaypointAreaGraph::numPortals());
+	CBotGlobals::botMessage(pEntity, 0, "path planner thread: %u searches queued", static_cast<unsigned>(CPathPlanner::numQueued()));
+	CBotGlobals::botMessage(pEntity, 0, "routes repaired after failing: %u", CWaypointReplanner::numRepairs());
+	CBotGlobals::botMessage(pEntity, 0, "landmark waypoints: %d", CWaypointLandmarks::current()->numLandmarks());
+
+	unsigned int iGranted, iDeferred;
+	float fAverageWait, fMaxWait;
+
+	CPathSearchBudget::getStats(&iGranted, &iDeferred, &fAverageWait, &fMaxWait);
+
+	CBotGlobals::botMessage(pEntity, 0, "frame budget: %u slices given, %u deferred, %d bots waiting, wait %0.3fs average, %0.3fs max", iGranted, iDeferred, CPathSearchBudget::numWaiting(), fAverageWait, fMaxWait);
+
+	unsigned int iFlowRoutes, iFlowBuilt, iFlowExpanded;
+
+	CWaypointFlowFields::getStats(&iFlowRoutes, &iFlowBuilt, &iFlowExpanded);
+
+	CBotGlobals::botMessage(pEntity, 0, "flow fields: %d active, %u made, %u routes followed, %u nodes expanded", CWaypointFlowFields::numFields(), iFlowBuilt, iFlowRoutes, iFlowExpanded);
+
+	unsigned int iChRoutes, iChRejected, iChExpanded;
+
+	CWaypointHierarchies::getStats(&iChRoutes, &iChRejected, &iChExpanded);
+
+	CBotGlobals::botMessage(pEntity, 0, "contraction hierarchies: %d%s, %d shortcuts, %u routes found, %u rejected, %u nodes expanded", CWaypointHierarchies::numHierarchies(),
+		CWaypointHierarchies::numHierarchies() > 0 && CWaypointHierarchies::isStale() ? " (out of date)" : "", CWaypointHierarchies::numShortcuts(), iChRoutes, iChRejected, iChExpanded);
+
+	return COMMAND_ACCESSED;
+}, "usage \"pathstats [reset]\" : shows A* nodes expanded and time spent searching");
+
+CBotCommandInline DebugRouteCacheCommand("routecache", CMD_ACCESS_DEBUG, [](CClient* pClient, const BotCommandArgs& args)
+{
+	edict_t* pEntity = pClient ? pClient->getPlayer() : nullptr;
+
+	if (args[0] && *args[0] && std::strcmp(args[0], "reset") == 0)
+	{
+		CWaypointRouteCache::resetStats();
+		CBotGlobals::botMessage(pEntity, 0, "route cache stats reset");
+
+		return COMMAND_ACCESSED;
+	}
+
+	if (args[0] && *args[0] && std::strcmp(args[0], "clear") == 0)
+	{
+		CWaypointRouteCache::freeMemory();
+		CBotGlobals::botMessage(pEntity, 0, "route cache cleared");
+
+		return COMMAND_ACCESSED;
+	}
+
+	unsigned int iHits;
+	unsigned int iMisses;
+	unsigned int iStale;
+	unsigned int iRejected;
+	unsigned int iEntries;
+
+	CWaypointRouteCache::getStats(&iHits, &iMisses, &iStale, &iRejected, &iEntries);
+
+	CBotGlobals::botMessage(pEntity, 0, "cached routes: %u, hits: %u, misses: %u (stale: %u, rejected: %u)", iEntries, iHits, iMisses, iStale, iRejected);
+
+	if (iHits + iMisses > 0)
+		CBotGlobals::botMessage(pEntity, 0, "hit rate: %0.1f%%", 100.0 * iHits / (iHits + iMisses));
+
+	return COMMAND_ACCESSED;
+}, "usage \"routecache [reset|clear]\" : shows how often bots reuse routes found by team mates");
+
+CBotCommandInline DebugVisCacheCommand("viscache", CMD_ACCESS_DEBUG, [](CClient* pClient, const BotCommandArgs& args)
+{
+	edict_t* pEntity = pClient ? pClient->getPlayer() : nullptr;
+
+	if (args[0] && *args[0] && std::strcmp(args[0], "reset") == 0)
+	{
+		CVisibilityCache::resetStats();
+		CBotGlobals::botMessage(pEntity, 0, "visibility cache stats reset");
+
+		return COMMAND_ACCESSED;
+	}
+
+	unsigned int iTraces;
+	unsigned int iSaved;
+
+	CVisibilityCache::getStats(&iTraces, &iSaved);
+
+	CBotGlobals::botMessage(pEntity, 0, "visibility cache: %s, traces cast: %u, traces saved: %u", CVisibilityCache::isEnabled() ? "on" : "off", iTraces, iSaved);
+
+	if (iTraces + iSaved > 0)
+		CBotGlobals::botMessage(pEntity, 0, "saved: %0.1f%%", 100.0 * iSaved / (iTraces + iSaved));
+
+	return COMMAND_ACCESSED;
+}, "usage \"viscache [reset]\" : shows how many visibility traces bots shared in the same frame");
+
+CBotCommandInline DebugTraceStatsCommand("tracestats", CMD_ACCESS_DEBUG, [](CClient* pClient, const BotCommandArgs& args)
+{
+	edict_t* pEntity = pClient ? pClient->getPlayer() : nullptr;
+
+	if (args[0] && *args[0] && std::strcmp(args[0], "reset") == 0)
+	{
+		CTraceBudget::resetStats();
+		CBotGlobals::botMessage(pEntity, 0, "trace stats reset");
+
+		return COMMAND_ACCESSED;
+	}
+
+	if (CTraceBudget::isEnabled())
+		CBotGlobals::botMessage(pEntity, 0, "trace budget: %d rays a frame, %d left last frame", bot_trace_budget.GetInt(), std::max(CTraceBudget::getRemaining(), 0));
+	else
+		CBotGlobals::botMessage(pEntity, 0, "trace budget: off");
+
+	for (int i = 0; i < CTraceBudget::TRACE_MAX; i++)
+	{
+		unsigned int iRays, iDeferred, iOverdue, iCoalesced;
+
+		CTraceBudget::getStats(i, &iRays, &iDeferred, &iOverdue, &iCoalesced);
+
+		CBotGlobals::botMessage(pEntity, 0, "%s: %u cast, %u put off (%u cast late), %u coalesced", CTraceBudget::getCategoryName(i), iRays, iDeferred, iOverdue, iCoalesced);
+	}
+
+	return COMMAND_ACCESSED;
+}, "usage \"tracestats [reset]\" : shows tracelines cast by bots for each thing they were cast for");
+
 CBotCommandInline DebugEdictsCommand("edicts", CMD_ACCESS_DEBUG, [](CClient* pClient, const BotCommandArgs& args)
 {
 	if (!args[0] || !*args[0])
@@ -844,6 +1001,10 @@ CBotSubcommands DebugSubcommands("debug", CMD_ACCESS_DEBUG | CMD_ACCESS_DEDICATE
 	&DebugUsercmdCommand,
 	&DebugUtilCommand,
 	&DebugProfilingCommand,
+	&DebugPathStatsCommand,
+	&DebugRouteCacheCommand,
+	&DebugVisCacheCommand,
+	&DebugTraceStatsCommand,
 	&DebugEdictsCommand,
 	&PrintProps,
 	&GetProp,
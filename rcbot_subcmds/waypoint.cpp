@@ -31,6 +31,7 @@
  */
 
 #include "bot_waypoint.h"
+#include "bot_waypoint_hierarchy.h"
 
 CBotCommandInline WaypointOnCommand("on", CMD_ACCESS_WAYPOINT, [](CClient *pClient, const BotCommandArgs& args)
 {
@@ -790,6 +791,20 @@ CBotCommandInline WaypointReachableCommand("reachable", CMD_ACCESS_WAYPOINT, [](
 	return COMMAND_ACCESSED;
 });
 
+CBotCommandInline WaypointBuildHierarchyCommand("buildch", CMD_ACCESS_WAYPOINT, [](CClient *pClient, const BotCommandArgs& args)
+{
+	edict_t *pEntity = pClient ? pClient->getPlayer() : nullptr;
+
+	CBotGlobals::botMessage(pEntity, 0, "building contraction hierarchies for %d waypoints, this may take a while...", CWaypoints::numWaypoints());
+
+	if ( CWaypointHierarchies::build() )
+		CBotGlobals::botMessage(pEntity, 0, "contraction hierarchies saved (%d shortcuts)", CWaypointHierarchies::numShortcuts());
+	else
+		CBotGlobals::botMessage(pEntity, 0, "error: could not save contraction hierarchies");
+
+	return COMMAND_ACCESSED;
+}, "buildch : works out fast routes for these waypoints and saves them to the map's .rcch file, do it again after editing waypoints");
+
 CBotSubcommands WaypointSubcommands("waypoint", CMD_ACCESS_DEDICATED, {
 	&WaypointOnCommand,
 	&WaypointOffCommand,
@@ -817,5 +832,6 @@ CBotSubcommands WaypointSubcommands("waypoint", CMD_ACCESS_DEDICATED, {
 	&WaypointShowVisCommand,
 	&WaypointAutoWaypointCommand,
 	&WaypointAutoFix,
-	&WaypointReachableCommand
+	&WaypointReachableCommand,
+	&WaypointBuildHierarchyCommand
 });
@@ -63,6 +63,11 @@
 #include "bot_schedule.h"
 #include "bot_buttons.h"
 #include "bot_navigator.h"
+#include "bot_path_budget.h"
+#include "bot_team_belief.h"
+#include "bot_trace_budget.h"
+#include "bot_visibility_cache.h"
+#include "bot_waypoint_flow.h"
 //#include "bot_black_mesa.h"
 #include "bot_css_bot.h"
 #include "bot_coop.h"
@@ -454,13 +459,13 @@ bool CBot :: FVisible ( edict_t *pEdict, const bool bCheckHead )
 		const Vector vOrigin = pEdict->GetCollideable()->GetCollisionOrigin();
 		const Vector vHead = vOrigin + Vector(0, 0, pEdict->GetCollideable()->OBBMaxs().z);
 
-		if ( FVisible(vHead,pEdict) )
+		if ( FVisibleShared(vHead,pEdict,CVisibilityCache::VIS_HEAD) )
 		{
 			if ( m_pEnemy == pEdict )
 			{
 				updateCondition(CONDITION_SEE_ENEMY_HEAD);
 
-				if ( FVisible(vOrigin,pEdict) )
+				if ( FVisibleShared(vOrigin,pEdict,CVisibilityCache::VIS_GROUND) )
 					updateCondition(CONDITION_SEE_ENEMY_GROUND);
 				else
 					removeCondition(CONDITION_SEE_ENEMY_GROUND);
@@ -482,7 +487,7 @@ bool CBot :: FVisible ( edict_t *pEdict, const bool bCheckHead )
 #endif */
 		if ( m_pEnemy == pEdict )
 		{
-			if ( FVisible(vOrigin,pEdict) )
+			if ( FVisibleShared(vOrigin,pEdict,CVisibilityCache::VIS_GROUND) )
 			{
 				updateCondition(CONDITION_SEE_ENEMY_GROUND);
 				return true;
@@ -491,13 +496,42 @@ bool CBot :: FVisible ( edict_t *pEdict, const bool bCheckHead )
 			return false;
 		}
 
-		return FVisible(vOrigin,pEdict);
+		return FVisibleShared(vOrigin,pEdict,CVisibilityCache::VIS_GROUND);
 	}
 
+	const int iEye = ENTINDEX(m_pEdict);
+	const int iTarget = ENTINDEX(pEdict);
+	bool bVisible;
+
+	if ( CVisibilityCache::get(iEye,iTarget,CVisibilityCache::VIS_ENTITY,&bVisible) )
+		return bVisible;
+
 	eye = getEyePosition();
 
 	// use typical traceline for non players
-	return CBotGlobals::isVisible(m_pEdict,eye,pEdict);//CBotGlobals::entityOrigin(pEdict)+Vector(0,0,50.0f));
+	bVisible = CBotGlobals::isVisible(m_pEdict,eye,pEdict);//CBotGlobals::entityOrigin(pEdict)+Vector(0,0,50.0f));
+
+	CVisibilityCache::set(iEye,iTarget,CVisibilityCache::VIS_ENTITY,bVisible);
+
+	return bVisible;
+}
+
+// same as FVisible(vOrigin,pDest) but another bot's trace between the same
+// two entities this frame is used instead if there was one
+bool CBot :: FVisibleShared ( const Vector &vOrigin, edict_t *pDest, const int iClass ) const
+{
+	const int iEye = ENTINDEX(m_pEdict);
+	const int iTarget = ENTINDEX(pDest);
+	bool bVisible;
+
+	if ( CVisibilityCache::get(iEye,iTarget,iClass,&bVisible) )
+		return bVisible;
+
+	bVisible = FVisible(vOrigin,pDest);
+
+	CVisibilityCache::set(iEye,iTarget,iClass,bVisible);
+
+	return bVisible;
 }
 
 inline QAngle CBot :: eyeAngles () const
@@ -892,18 +926,26 @@ void CBot :: think ()
 	if ( rcbot_debug_iglev.GetInt() != 3 )
 	{
 #endif
-	m_pVisibles->updateVisibles();
+	{
+		CTraceCategory traceCategory(CTraceBudget::TRACE_VISIBLE);
+
+		m_pVisibles->updateVisibles();
+	}
 #ifdef _DEBUG
 	}
 
 	if ( rcbot_debug_iglev.GetInt() != 4 )
 	{
 #endif
+	{
+		CTraceCategory traceCategory(CTraceBudget::TRACE_MOVE);
+
 		if ( checkStuck() )
 		{
 			// look in the direction I'm going to see what I'm stuck on
 			setLookAtTask(LOOK_WAYPOINT,randomFloat(2.0f,4.0f));
 		}
+	}
 #ifdef _DEBUG
 	}
 #endif
@@ -966,6 +1008,8 @@ void CBot :: think ()
 
 	if ( m_pNavigator->hasNextPoint() )
 	{
+		CTraceCategory traceCategory(CTraceBudget::TRACE_MOVE);
+
 		m_pNavigator->updatePosition();
 	}
 	else
@@ -1342,6 +1386,12 @@ bool CBot::canGotoWaypoint(const Vector& vPrevWaypoint, CWaypoint* pWaypoint, CW
 	return true;
 }
 
+int CBot::getPathCheckFlags()
+{
+	// team flags share bits between mods, see CBotMod::checkWaypointForTeam
+	return CWaypointTypes::W_FL_NOBLU | CWaypointTypes::W_FL_NORED | CWaypointTypes::W_FL_OPENS_LATER | CWaypointTypes::W_FL_FALL;
+}
+
 void CBot::updatePosition() const
 {
 	m_pNavigator->rollBackPosition();
@@ -1934,7 +1984,6 @@ void CBot :: freeMapMemory ()
 	/////////////////////////////////
 	if ( m_pNavigator != nullptr)
 	{
-		m_pNavigator->beliefSave(true);
 		m_pNavigator->freeMapMemory();
 		delete m_pNavigator;
 		m_pNavigator = nullptr;
@@ -3451,6 +3500,21 @@ void CBots :: botThink ()
 
 	const bool bBotStop = bot_stop.GetInt() > 0;
 
+	// route searches this frame share one budget
+	CPathSearchBudget::startFrame();
+
+	// and one budget of tracelines
+	CTraceBudget::startFrame();
+
+	// visibility traces are shared between bots until the next frame
+	CVisibilityCache::startFrame();
+
+	// team routes to busy goals
+	CWaypointFlowFields::think();
+
+	// saves team belief now and then
+	CTeamBelief::think();
+
 	// NOTE: don't gate the whole AI on the entprop layer being ready. RCBot2
 	// runs the bot AI on Metamod's GameFrame hook and worked for years as a pure
 	// MM:S plugin; if RCBot2's SourceMod extension hasn't loaded (sm_gamehelpers
@@ -509,6 +509,8 @@ public:
 
 	bool FVisible (const Vector &vOrigin, edict_t *pDest = nullptr) const;
 
+	bool FVisibleShared ( const Vector &vOrigin, edict_t *pDest, int iClass ) const;
+
 	Vector getEyePosition () const;
 
 	void think ();
@@ -706,6 +708,11 @@ public:
 
 	virtual bool canGotoWaypoint (const Vector& vPrevWaypoint, CWaypoint* pWaypoint, CWaypoint* pPrev = nullptr);
 
+	// waypoint flags canGotoWaypoint looks at apart from W_FL_UNREACHABLE, so
+	// routes searched on the path planner thread only check paths into those
+	// waypoints here. -1 if every path needs checking
+	virtual int getPathCheckFlags ();
+
 // True while the bot is in the middle of placing a buildable (e.g. an engineer's sentry).
 // The navigator's stuck-recovery checks this so it won't jump/force-advance the bot off the
 // spot mid-placement (moving too far or leaving the ground can cancel the build). Named
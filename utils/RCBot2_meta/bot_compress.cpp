@@ -35,18 +35,34 @@
 
 #include "miniz.h"
 
+#if defined(_WIN64) || defined(_WIN32)
+// for MoveFileExA
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#endif
+
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 
-bool RCBot_CompressedSave(const char* filename, const void* pData, const std::size_t dataSize)
+// replaces filename with the finished temporary file
+static bool replaceFile(const char* tempname, const char* filename)
+{
+#if defined(_WIN64) || defined(_WIN32)
+	return MoveFileExA(tempname, filename, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return std::rename(tempname, filename) == 0;
+#endif
+}
+
+bool RCBot_CompressedWrite(const char* filename, const void* pData, const std::size_t dataSize, std::size_t* pCompressedSize, std::string* pError)
 {
 	mz_ulong compBound = mz_compressBound(dataSize);
 	unsigned char* pCompressed = static_cast<unsigned char*>(std::malloc(compBound));
 
 	if (!pCompressed)
 	{
-		logger->Log(LogLevel::ERROR, "RCBot_CompressedSave: malloc failed for '%s'", filename);
+		*pError = "malloc failed";
 		return false;
 	}
 
@@ -56,16 +72,19 @@ bool RCBot_CompressedSave(const char* filename, const void* pData, const std::si
 
 	if (status != MZ_OK)
 	{
-		logger->Log(LogLevel::ERROR, "RCBot_CompressedSave: compression failed (%d) for '%s'", status, filename);
+		*pError = "compression failed (" + std::to_string(status) + ")";
 		std::free(pCompressed);
 		return false;
 	}
 
-	FILE* fp = std::fopen(filename, "wb");
+	// readers never see half a file
+	const std::string tempname = std::string(filename) + ".tmp";
+
+	FILE* fp = std::fopen(tempname.c_str(), "wb");
 
 	if (!fp)
 	{
-		logger->Log(LogLevel::ERROR, "RCBot_CompressedSave: can't open '%s' for writing", filename);
+		*pError = "can't open for writing";
 		std::free(pCompressed);
 		return false;
 	}
@@ -74,14 +93,44 @@ bool RCBot_CompressedSave(const char* filename, const void* pData, const std::si
 	hdr.magic = RCBOT_COMPRESS_MAGIC;
 	hdr.uncompressed_size = static_cast<uint32_t>(dataSize);
 
-	std::fwrite(&hdr, sizeof(hdr), 1, fp);
-	std::fwrite(pCompressed, 1, compBound, fp);
-	std::fclose(fp);
+	const bool bWritten = std::fwrite(&hdr, sizeof(hdr), 1, fp) == 1 &&
+		std::fwrite(pCompressed, 1, compBound, fp) == compBound;
 
 	std::free(pCompressed);
 
+	if (std::fclose(fp) != 0 || !bWritten)
+	{
+		*pError = "write failed";
+		std::remove(tempname.c_str());
+		return false;
+	}
+
+	if (!replaceFile(tempname.c_str(), filename))
+	{
+		*pError = "can't replace the old file";
+		std::remove(tempname.c_str());
+		return false;
+	}
+
+	if (pCompressedSize != nullptr)
+		*pCompressedSize = static_cast<std::size_t>(compBound);
+
+	return true;
+}
+
+bool RCBot_CompressedSave(const char* filename, const void* pData, const std::size_t dataSize)
+{
+	std::size_t compressedSize = 0;
+	std::string error;
+
+	if (!RCBot_CompressedWrite(filename, pData, dataSize, &compressedSize, &error))
+	{
+		logger->Log(LogLevel::ERROR, "RCBot_CompressedSave: %s for '%s'", error.c_str(), filename);
+		return false;
+	}
+
 	logger->Log(LogLevel::INFO, "RCBot_CompressedSave: saved '%s' (%u -> %lu bytes)",
-		filename, static_cast<unsigned>(dataSize), static_cast<unsigned long>(compBound));
+		filename, static_cast<unsigned>(dataSize), static_cast<unsigned long>(compressedSize));
 
 	return true;
 }
@@ -195,3 +244,32 @@ bool RCBot_CompressedLoad(const char* filename, void* pOutData, const std::size_
 
 	return true;
 }
+
+bool RCBot_CompressedSize(const char* filename, std::size_t* pSize)
+{
+	FILE* fp = std::fopen(filename, "rb");
+
+	if (!fp)
+		return false;
+
+	std::fseek(fp, 0, SEEK_END);
+	const long fileSize = std::ftell(fp);
+	std::fseek(fp, 0, SEEK_SET);
+
+	if (fileSize < 0)
+	{
+		std::fclose(fp);
+		return false;
+	}
+
+	rcbot_compress_header_t hdr;
+
+	if (static_cast<std::size_t>(fileSize) >= sizeof(hdr) && std::fread(&hdr, sizeof(hdr), 1, fp) == 1 && hdr.magic == RCBOT_COMPRESS_MAGIC)
+		*pSize = hdr.uncompressed_size;
+	else
+		*pSize = static_cast<std::size_t>(fileSize); // uncompressed (legacy) file
+
+	std::fclose(fp);
+
+	return true;
+}
@@ -33,6 +33,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <string>
 
 // Compression magic number to identify compressed files: "RCz\x01"
 constexpr uint32_t RCBOT_COMPRESS_MAGIC = 0x017A4352;
@@ -47,12 +48,21 @@ struct rcbot_compress_header_t
 #pragma pack(pop)
 
 // Writes raw data to a file using miniz deflate compression.
+// The file is written beside the old one and renamed over it once complete.
 // Returns true on success.
 bool RCBot_CompressedSave(const char* filename, const void* pData, std::size_t dataSize);
 
+// Same as RCBot_CompressedSave without logging, for threads other than the game's.
+// pCompressedSize (may be NULL) gets the size written, on failure the reason is put in pError.
+bool RCBot_CompressedWrite(const char* filename, const void* pData, std::size_t dataSize, std::size_t* pCompressedSize, std::string* pError);
+
 // Reads a file that may be compressed (auto-detects via magic header).
 // Writes up to expectedSize bytes into pOutData.
 // Returns true on success.
 bool RCBot_CompressedLoad(const char* filename, void* pOutData, std::size_t expectedSize);
 
+// Size RCBot_CompressedLoad expects for a file whose size isn't known in advance.
+// Returns true on success.
+bool RCBot_CompressedSize(const char* filename, std::size_t* pSize);
+
 #endif
@@ -1141,4 +1141,9 @@ bool CCSSBot::canGotoWaypoint(const Vector& vPrevWaypoint, CWaypoint* pWaypoint,
 	}
 
 	return CBot::canGotoWaypoint(vPrevWaypoint, pWaypoint, pPrev);
+}
+
+int CCSSBot::getPathCheckFlags()
+{
+	return CBot::getPathCheckFlags() | CWaypointTypes::W_FL_NO_HOSTAGES | CWaypointTypes::W_FL_LADDER;
 }
\ No newline at end of file
@@ -73,6 +73,7 @@ public:
 	void freeMapMemory() override;
 	void touchedWpt(CWaypoint *pWaypoint, int iNextWaypoint = -1, int iPrevWaypoint = -1) override;
 	bool canGotoWaypoint(const Vector& vPrevWaypoint, CWaypoint* pWaypoint, CWaypoint* pPrev = nullptr) override;
+	int getPathCheckFlags() override;
 	bool setVisible(edict_t *pEntity, bool bVisible) override;
 	virtual void modThinkSlow();
 	unsigned maxEntityIndex() override { return gpGlobals->maxEntities; }
@@ -35,6 +35,15 @@ ConVar bot_visrevs_clients("rcbot_visrevs_clients", "3", 0, "how many revs the b
 ConVar bot_spyknifefov("rcbot_spyknifefov", "80", 0, "the FOV from the enemy that spies must backstab from");
 ConVar bot_visrevs("rcbot_visrevs", "6", 0, "how many revs the bot searches for visible monsters, lower to reduce cpu usage min:5");
 ConVar bot_pathrevs("rcbot_pathrevs", "30", 0, "how many revs the bot searches for a path each frame, lower to reduce cpu usage, but causes bots to stand still more");
+ConVar bot_path_hierarchical("rcbot_path_hierarchical", "1", 0, "if 1 long routes are planned between waypoint areas first, then searched one area at a time");
+ConVar bot_path_replan("rcbot_path_replan", "1", 0, "if 1 bots blocked on the way to the same goal repair their last route instead of searching again");
+ConVar bot_path_async("rcbot_path_async", "0", 0, "if 1 routes are searched on a separate thread instead of a few loops each frame");
+ConVar bot_route_cache("rcbot_route_cache", "1", 0, "if 1 bots reuse routes already found by their team mates");
+ConVar bot_route_cache_time("rcbot_route_cache_time", "30.0", 0, "seconds a shared route is kept before searching again");
+ConVar bot_flow_fields("rcbot_flow_fields", "1", 0, "if 1 a team keeps one shared route search to goals many of its bots go to, e.g. the cart or a control point");
+ConVar bot_path_budget("rcbot_path_budget", "600", 0, "most A* nodes searched by all bots together each frame, shared out by urgency, 0 to only limit each bot by rcbot_pathrevs");
+ConVar bot_path_landmarks("rcbot_path_landmarks", "8", 0, "number of landmark waypoints used to guide route searches, 0 to turn off");
+ConVar bot_path_ch("rcbot_path_ch", "1", 0, "if 1 bots take ordinary routes from the map's contraction hierarchy file (rcbot waypoint buildch) instead of searching");
 ConVar bot_command("rcbot_cmd", "", 0, "issues a command to all bots");
 ConVar bot_attack("rcbot_flipout", "0", 0, "Rcbots all attack");
 ConVar bot_scoutdj("rcbot_scoutdj", "0.5", 0, "time scout uses to double jump");
@@ -46,6 +55,9 @@ ConVar bot_rj("rcbot_rj", "0.01", 0, "time for soldier to fire rocket after jump
 ConVar bot_defrate("rcbot_defrate", "0.2", 0, "rate for bots to defend");
 ConVar bot_beliefmulti("rcbot_beliefmulti", "20.0", 0, "multiplier for increasing bot belief"); //Not referenced properly? [APG]RoboCop[CL]
 ConVar bot_belief_fade("rcbot_belief_fade", "0.75", 0, "the multiplayer rate bot belief decreases");
+ConVar bot_trace_budget("rcbot_trace_budget", "0", 0, "tracelines cast by all bots together each frame before entity sweeps and waypoint ground checks are put off, 0 for no limit");
+ConVar bot_visibility_cache("rcbot_visibility_cache", "1", 0, "if 1 bots looking at the same player in the same frame share one traceline");
+ConVar bot_belief_halflife("rcbot_belief_halflife", "0", 0, "seconds for bot belief to fade to half on its own, 0 never fades");
 ConVar bot_change_class("rcbot_change_classes", "0", 0, "bots change classes at random intervals");
 ConVar bot_use_vc_commands("rcbot_voice_cmds", "1", 0, "bots use voice commands e.g. medic/spy etc");
 ConVar bot_use_disp_dist("rcbot_disp_dist", "800.0", 0, "distance that bots will go back to use a dispenser");
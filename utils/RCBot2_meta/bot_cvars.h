@@ -18,6 +18,15 @@ extern ConVar bot_visrevs_clients;
 extern ConVar bot_spyknifefov;
 extern ConVar bot_visrevs;
 extern ConVar bot_pathrevs;
+extern ConVar bot_path_hierarchical;
+extern ConVar bot_path_replan;
+extern ConVar bot_path_async;
+extern ConVar bot_route_cache;
+extern ConVar bot_route_cache_time;
+extern ConVar bot_flow_fields;
+extern ConVar bot_path_budget;
+extern ConVar bot_path_landmarks;
+extern ConVar bot_path_ch;
 extern ConVar bot_command;
 extern ConVar bot_attack;
 extern ConVar bot_scoutdj;
@@ -28,6 +37,9 @@ extern ConVar bot_rj;
 extern ConVar bot_defrate;
 extern ConVar bot_beliefmulti;
 extern ConVar bot_belief_fade;
+extern ConVar bot_trace_budget;
+extern ConVar bot_visibility_cache;
+extern ConVar bot_belief_halflife;
 extern ConVar bot_change_class;
 extern ConVar bot_use_vc_commands;
 extern ConVar bot_use_disp_dist;
@@ -189,6 +189,11 @@ bool CDODBot::canGotoWaypoint(const Vector& vPrevWaypoint, CWaypoint* pWaypoint,
 	return false;
 }
 
+int CDODBot :: getPathCheckFlags ()
+{
+	return CBot::getPathCheckFlags() | CWaypointTypes::W_FL_BREAKABLE | CWaypointTypes::W_FL_BOMB_TO_OPEN;
+}
+
 #define UPDATE_VISIBLE_OBJECT(visobj,pent) if ( !(visobj).get() || (distanceFrom(pent)<distanceFrom(visobj)) ) { (visobj) = pent; }
 #define UPDATE_VISIBLE_OBJECT_CONDITION(visobj,pent,condition)  if ( !(visobj).get() || (distanceFrom(pent)<distanceFrom(visobj)) ) { if ( condition ) { (visobj) = pent; }  }
 #define NULLIFY_VISIBLE(visobj,pent,distance)  if ( (visobj) == (pent) ) { if ( !bValid || (distanceFrom(visobj)>(distance)) ) { (visobj) = NULL; } }
@@ -193,6 +193,8 @@ public:
 
 	bool canGotoWaypoint (const Vector& vPrevWaypoint, CWaypoint* pWaypoint, CWaypoint* pPrev = nullptr) override;
 
+	int getPathCheckFlags () override;
+
 	void defending () override;
 
 	bool handleAttack ( CBotWeapon *pWeapon, edict_t *pEnemy ) override;
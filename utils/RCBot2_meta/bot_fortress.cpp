@@ -2892,6 +2892,19 @@ bool CBotTF2 :: canGotoWaypoint (const Vector& vPrevWaypoint, CWaypoint* pWaypoi
 	return false;
 }
 
+int CBotTF2 :: getPathCheckFlags ()
+{
+	// any path may go through a sentry or a payload bomb
+	if ( (m_iClass == TF_CLASS_ENGINEER && m_pSentryGun.get() != nullptr) ||
+		(m_iClass == TF_CLASS_SPY && m_pNearestEnemySentry.get() != nullptr) ||
+		m_pRedPayloadBomb.get() != nullptr || m_pBluePayloadBomb.get() != nullptr )
+		return -1;
+
+	return CBotFortress::getPathCheckFlags() | CWaypointTypes::W_FL_OWNER_ONLY | CWaypointTypes::W_FL_AREAONLY |
+		CWaypointTypes::W_FL_ROCKET_JUMP | CWaypointTypes::W_FL_DOUBLEJUMP | CWaypointTypes::W_FL_WAIT_GROUND |
+		CWaypointTypes::W_FL_NO_FLAG | CWaypointTypes::W_FL_FLAGONLY;
+}
+
 void CBotTF2 :: callMedic ()
 {
 	addVoiceCommand(TF_VC_MEDIC);
@@ -932,6 +932,8 @@ public:
 	
 	bool canGotoWaypoint (const Vector& vPrevWaypoint, CWaypoint* pWaypoint, CWaypoint* pPrev = nullptr) override;
 
+	int getPathCheckFlags () override;
+
 	bool deployStickies ( eDemoTrapType type, const Vector& vStand, const Vector& vLocation, const Vector& vSpread, Vector *vPoint, int *iState, int *iStickyNum, bool *bFail, float *fTime, int wptindex );
 
 	void detonateStickies (bool isJumping = false);
@@ -35,6 +35,7 @@
 #include "bot_cvars.h"
 #include "bot_globals.h"
 #include "bot_strings.h"
+#include "bot_trace_budget.h"
 #include "bot_waypoint_locations.h"
 #include "bot_getprop.h"
 #include "bot_weapons.h"
@@ -487,6 +488,7 @@ void CBotGlobals :: traceLine (const Vector& vSrc, const Vector& vDest, const un
 	m_TraceResult = trace_t{};
 	ray.Init( vSrc, vDest );
 	enginetrace->TraceRay( ray, mask, pFilter, &m_TraceResult );
+	CTraceBudget::traced();
 }
 
 float CBotGlobals :: quickTraceline (edict_t *pIgnore, const Vector& vSrc, const Vector& vDest)
@@ -497,6 +499,7 @@ float CBotGlobals :: quickTraceline (edict_t *pIgnore, const Vector& vSrc, const
 	m_TraceResult = trace_t{};
 	ray.Init( vSrc, vDest );
 	enginetrace->TraceRay( ray, MASK_NPCSOLID_BRUSHONLY, &filter, &m_TraceResult );
+	CTraceBudget::traced();
 	return m_TraceResult.fraction;
 }
 
@@ -31,14 +31,17 @@
 #ifndef __RCBOT_NAVIGATOR_H__
 #define __RCBOT_NAVIGATOR_H__
 
+#include <memory>
 #include <vector>
 #include <queue>
 #include <stack>
 
 #include "bot.h"
 #include "bot_waypoint.h"
+#include "bot_waypoint_replan.h"
 
 #include "bot_belief.h"
+#include "bot_team_belief.h"
 
 class CNavMesh {
 public:
@@ -49,6 +52,9 @@ public:
 	}
 };
 class CWaypointVisibilityTable;
+class CPathRequest;
+class CPathNodeCosts;
+class CWaypointGraphSnapshot;
 
 constexpr float MAX_BELIEF = 200.0f;
 
@@ -110,6 +116,9 @@ public:
 
 	virtual bool routeFound () = 0;
 
+	// the route was only found part of the way, the bot can't reach its goal
+	virtual bool routeFailed () { return false; }
+
 	virtual void clear () = 0;
 
 	virtual void getFailedGoals (WaypointList **goals) = 0;
@@ -118,10 +127,6 @@ public:
 
 	virtual bool nextPointIsOnLadder () { return false; }
 
-	virtual bool beliefLoad ( ) { return false; }
-
-	virtual bool beliefSave ( bool bOverride = false ) { return false; }
-
 	virtual void belief (const Vector& origin, const Vector& vOther, float fBelief, float fStrength, BotBelief iType) = 0;
 
 	// nearest cover position to vOrigin only
@@ -145,8 +150,6 @@ public:
 	bool getDangerPoint ( Vector *vec ) const
 	{ *vec = m_bDangerPoint ? m_vDangerPoint : Vector(0,0,0); return m_bDangerPoint; }
 
-	bool wantToLoadBelief () const { return m_bLoadBelief; }
-	virtual bool wantToSaveBelief () { return false; }
 	float getGoalDistance () const { return m_fGoalDistance; }
 
 	static constexpr int MAX_PATH_TICKS = 200;
@@ -158,8 +161,6 @@ protected:
 	Vector m_vDangerPoint;
 	bool m_bDangerPoint = false;
 	int m_iBeliefTeam = 0;
-	bool m_bBeliefChanged = false;
-	bool m_bLoadBelief = false;
 };
 
 enum : std::uint8_t
@@ -217,113 +218,148 @@ public:
 	}
 	void setWaypoint (const int iWpt) { m_iWaypoint = iWpt; }
 	int getWaypoint () const { return m_iWaypoint; }
+	// position in the open list heap, only valid while open
+	void setHeapIndex (const int iIndex) { m_iHeapIndex = iIndex; }
+	int getHeapIndex () const { return m_iHeapIndex; }
 private:
 	float m_fCost;
 	float m_fHeuristic;
 	unsigned char m_iFlags;
 	int m_iParent;
 	int m_iWaypoint;
+	int m_iHeapIndex;
 };
-// Insertion sorted list
-class AStarListNode
-{
-public:
-	AStarListNode ( AStarNode *data )
-	{
-		m_Data = data;
-		m_Next = nullptr;
-	}
-	AStarNode *m_Data;
-	AStarListNode *m_Next;
-};
-
+// Indexed binary min-heap ordered on cost+heuristic. Each open node remembers
+// its slot in the heap so a node that is already open can be re-keyed in place
+// (decrease-key) instead of being queued twice. The storage is sized to the
+// waypoint capacity, a node can only be in the list once, so searching never
+// allocates.
 class AStarOpenList
 {
 public:
 	AStarOpenList()
 	{
-		m_Head = nullptr;
+		m_iSize = 0;
 	}
 
 	bool empty () const
 	{
-		return m_Head== nullptr;
+		return m_iSize == 0;
+	}
+
+	int size () const
+	{
+		return m_iSize;
 	}
 
 	AStarNode *top () const
 	{
-		if ( m_Head == nullptr)
+		if ( m_iSize == 0 )
 			return nullptr;
-		
-		return m_Head->m_Data;
+
+		return m_Heap[0];
 	}
 
 	void pop ()
 	{
-		if ( m_Head != nullptr)
+		if ( m_iSize > 0 )
 		{
-			const AStarListNode *t = m_Head;
-
-			m_Head = m_Head->m_Next;
+			m_iSize--;
 
-			delete t;
+			if ( m_iSize > 0 )
+			{
+				place(0, m_Heap[m_iSize]);
+				siftDown(0);
+			}
 		}
 	}
 
-
 	void add ( AStarNode *data )
 	{
-		AStarListNode *newNode = new AStarListNode(data);
+		if ( m_iSize >= static_cast<int>(m_Heap.size()) )
+			return;
 
-		if ( m_Head == nullptr)
-			m_Head = newNode;
-		else
-		{
-			if ( data->precedes(m_Head->m_Data) )
-			{
-				newNode->m_Next = m_Head;
-				m_Head = newNode;
-			}
-			else
-			{
-				AStarListNode* p = m_Head;
-				AStarListNode* t = m_Head->m_Next;
+		place(m_iSize, data);
+		siftUp(m_iSize++);
+	}
 
-				while ( t != nullptr)
-				{
-					if ( data->precedes(t->m_Data) )
-					{
-						p->m_Next = newNode;
-						newNode->m_Next = t;
-						break;
-					}
+	// cost or heuristic of a node already in the list has changed
+	void update ( const AStarNode *data )
+	{
+		const int iIndex = data->getHeapIndex();
 
-					p = t;
-					t = t->m_Next;
-				}
+		if ( iIndex < 0 || iIndex >= m_iSize || m_Heap[iIndex] != data )
+			return;
 
-				if ( t == nullptr)
-					p->m_Next = newNode;
+		siftUp(iIndex);
+		siftDown(iIndex);
+	}
 
-			}
+	void destroy()
+	{
+		for ( int i = 0; i < m_iSize; i ++ )
+			m_Heap[i]->unOpen();
+
+		m_iSize = 0;
+	}
+
+	// only while empty, nodes already in the heap would be lost
+	void resize ( const int iMaxNodes )
+	{
+		m_Heap.resize(static_cast<std::size_t>(iMaxNodes), nullptr);
+	}
+	
+private:
+	void place ( const int iIndex, AStarNode *data )
+	{
+		m_Heap[iIndex] = data;
+		data->setHeapIndex(iIndex);
+	}
+
+	void siftUp ( int iIndex )
+	{
+		AStarNode *data = m_Heap[iIndex];
+
+		while ( iIndex > 0 )
+		{
+			const int iParent = (iIndex - 1) / 2;
+
+			if ( !data->precedes(m_Heap[iParent]) )
+				break;
+
+			place(iIndex, m_Heap[iParent]);
+			iIndex = iParent;
 		}
+
+		place(iIndex, data);
 	}
 
-	void destroy()
+	void siftDown ( int iIndex )
 	{
-		while (m_Head != nullptr)
+		AStarNode *data = m_Heap[iIndex];
+
+		for (;;)
 		{
-			const AStarListNode* t = m_Head;
-			m_Head = m_Head->m_Next;
-			delete t;
-			t = nullptr;
+			int iChild = iIndex * 2 + 1;
+
+			if ( iChild >= m_iSize )
+				break;
+
+			if ( iChild + 1 < m_iSize && m_Heap[iChild + 1]->precedes(m_Heap[iChild]) )
+				iChild++;
+
+			if ( !m_Heap[iChild]->precedes(data) )
+				break;
+
+			place(iIndex, m_Heap[iChild]);
+			iIndex = iChild;
 		}
 
-		//m_Head = nullptr;
+		place(iIndex, data);
 	}
-	
-private:
-	AStarListNode *m_Head;
+
+	std::vector<AStarNode*> m_Heap;
+	int m_iSize;
 };
 
 /*
@@ -366,6 +402,55 @@ bool operator<( const AStarNode * A, const AStarNode * B )
 	return A->betterCost(B);
 }*/
 
+// Scratch space for one running A* search. Each node is stamped with the
+// generation of the search that last touched it, starting a new search only
+// bumps the generation so just the nodes it visits are ever reset.
+// Grows to the waypoint capacity when a search starts, never shrinks.
+class CAStarSearchContext
+{
+public:
+	CAStarSearchContext();
+
+	void reset ( int iMaxNodes );
+
+	AStarNode *getNode ( int iWaypoint );
+
+	int numNodes () const { return static_cast<int>(m_Nodes.size()); }
+
+	AStarOpenList *getOpenList () { return &m_theOpenList; }
+private:
+	std::vector<AStarNode> m_Nodes;
+	std::vector<unsigned int> m_iNodeGeneration;
+	unsigned int m_iGeneration;
+
+	AStarOpenList m_theOpenList;
+};
+
+// Search contexts shared by all bots, a navigator only holds one while its
+// search is running so memory depends on concurrent searches, not bot count
+class CAStarSearchPool
+{
+public:
+	static CAStarSearchContext *lease ();
+
+	static void release ( CAStarSearchContext *pContext );
+
+	static void freeMemory ();
+
+	static std::size_t numContexts () { return m_Contexts.size(); }
+	static std::size_t numLeased () { return m_Contexts.size() - m_FreeContexts.size(); }
+private:
+	static std::vector<CAStarSearchContext*> m_Contexts;
+	static std::vector<CAStarSearchContext*> m_FreeContexts;
+};
+
+enum : std::uint8_t
+{
+	ROUTE_SEARCHING = 0,
+	ROUTE_FOUND,
+	ROUTE_FAILED
+};
+
 enum : std::uint8_t
 {
 	WPT_SEARCH_AVOID_SENTRIES = 1,
@@ -391,11 +476,14 @@ public:
 		m_fNextClearFailedGoals = 0.0f;
 		m_bDangerPoint = false;
 		m_iBeliefTeam = -1;
-		m_bLoadBelief = true;
-		m_bBeliefChanged = false;
 		std::memset(&m_lastFailedPath, 0, sizeof(failedpath_t));
 	}
 
+	~CWaypointNavigator() override
+	{
+		releaseSearch();
+	}
+
 	void init () override;
 
 	CWaypoint *chooseBestFromBelief (const std::vector<CWaypoint*>& goals, bool bHighDanger = false, int iSearchFlags = 0, int iTeam = 0) const;
@@ -415,7 +503,7 @@ public:
 	void updatePosition () override;
 
 	float getBelief (const int index) override
-	{ if ( index >= 0 ) return m_fBelief[index]; return 0; }
+	{ if ( index >= 0 && index < m_pBelief->size() ) return m_pBelief->get(index); return 0; }
 
 	void failMove () override;
 
@@ -429,6 +517,8 @@ public:
 
 	bool routeFound () override;
 
+	bool routeFailed () override { return m_bRouteFailed; }
+
 	void rollBackPosition () override;
 
 	bool nextPointIsOnLadder () override;
@@ -445,6 +535,54 @@ public:
 
 	void clearOpenList ();
 
+	// give the search context back to the pool
+	void releaseSearch ();
+
+	void startSearch ( int iStart, int iGoal, const Vector& vGoal );
+
+	// hand the search to the path planner thread instead (rcbot_path_async)
+	void submitSearch ( int iStart, int iGoal, const Vector& vGoal );
+
+	bool isSearching () const { return m_pSearch != nullptr || m_pAsyncSearch != nullptr || m_bReplanning; }
+
+	// switch to the belief of the bot's team if it changed team
+	void useTeamBelief ();
+
+	float beliefAt ( const int iWpt ) const { return m_pBelief->get(iWpt); }
+
+	void getNodeCosts ( const CWaypointGraphSnapshot *pGraph, std::vector<float> *fNodeCost, std::vector<float> *fNodeHeuristic ) const;
+	void getNodeCostInputs ( CPathNodeCosts *pCosts ) const;
+
+	// blocked on the way to a goal : repair the last route instead of searching again
+	bool startReplan ();
+
+	int searchRoute ( bool bNoInterruptions );
+
+	// how urgently this bot needs its search, for the frame budget
+	int searchPriority () const;
+
+	bool buildRoute ( bool bAppend );
+
+	void refineRoute ();
+	void failRoute ();
+
+	// route shared by a team mate, see CWaypointRouteCache
+	bool useCachedRoute ();
+
+	void cacheRoute () const;
+
+	// route read from the team's flow field to this goal, see CWaypointFlowFields
+	bool useFlowField ();
+
+	// shortest route from the map's contraction hierarchies, see CWaypointHierarchies
+	bool useHierarchy ();
+
+	// route found by others, check this bot can take every path of it
+	bool canFollowRoute ( const WaypointList &route ) const;
+	// false and clears m_iAreaRoute if the bot can't use one of its portals
+	bool canUseAreaRoute ();
+	void followRoute ( const WaypointList &route, float fDistance );
+
 	float getCurrentBelief ( ) override;
 
 	//virtual void goBack();
@@ -466,12 +604,6 @@ public:
 
 	bool randomDangerPath (Vector *vec) override;
 
-	bool beliefLoad ( ) override;
-
-	bool beliefSave ( bool bOverride = false ) override;
-
-	bool wantToSaveBelief () override;
-
 	int getCurrentWaypointID () override
 	{
 		return m_iCurrentWaypoint;
@@ -490,7 +622,21 @@ public:
 	int getCurrentFlags () override;
 	int getPathFlags ( int iPath ) override;
 
+	// A* statistics shared by all bots, see "rcbot debug pathstats"
+	static void getSearchStats ( unsigned int *iSearches, unsigned int *iExpanded, double *fMilliseconds );
+	static void resetSearchStats ();
+
+	// remaining waypoints in the route when the next hierarchical segment is searched
+	static constexpr int REFINE_ROUTE_AHEAD = 8;
+
+	// most danger cost along a hierarchy route, as a fraction of its length, before searching instead
+	static constexpr float MAX_HIERARCHY_DANGER = 0.25f;
+
 private:
+	static unsigned int m_iSearchesCompleted;
+	static unsigned int m_iNodesExpanded;
+	static double m_fSearchMilliseconds;
+
 	CBot *m_pBot;
 
 	//CWaypointVisibilityTable *m_pDangerNodes;
@@ -509,16 +655,35 @@ private:
 
 	int m_iLastFailedWpt;
 
-	AStarNode paths[CWaypoints::MAX_WAYPOINTS];
+	CAStarSearchContext* m_pSearch = nullptr; // only while a search is running
+	std::shared_ptr<CPathRequest> m_pAsyncSearch; // or while the path planner thread has it
+
+	// kept between routes so it can be repaired, see CWaypointReplanner
+	std::unique_ptr<CWaypointReplanner> m_pReplanner;
+	bool m_bReplanning = false;
+	bool m_bMoveFailed = false;
+	int m_iSearchStart = -1;
+	int m_iSearchGoal = -1;
+	Vector m_vSearchGoal;
+	int m_iSearchConditions = 0;
+	int m_iSearchDangerId = -1;
+
+	// hierarchical route : goals of the segments still to search, see CWaypointAreaGraph
+	WaypointList m_iAreaRoute;
+	bool m_bRefiningRoute = false;
+	bool m_bRouteFailed = false;
+
+	// whole route built so far in order, to share when it is complete
+	WaypointList m_iBuiltRoute;
+	int m_iRouteStart = -1;
 	AStarNode* curr = nullptr;
 	AStarNode* succ = nullptr;
 
 	WaypointList m_iFailedGoals;
 	float m_fNextClearFailedGoals;
 
-	float m_fBelief [CWaypoints::MAX_WAYPOINTS];
-
-	AStarOpenList m_theOpenList;
+	// the team's, see CTeamBelief
+	CBeliefTable *m_pBelief;
 
 	Vector m_vOffset;
 	bool m_bOffsetApplied;
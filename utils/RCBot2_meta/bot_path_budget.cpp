@@ -0,0 +1,212 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include "bot.h"
+#include "bot_cvars.h"
+#include "bot_path_budget.h"
+
+#include <algorithm>
+
+CPathSearchBudget::path_budget_slot_t CPathSearchBudget::m_Slots[RCBOT_MAXPLAYERS];
+
+int CPathSearchBudget::m_iRemaining = 0;
+
+unsigned int CPathSearchBudget::m_iGranted = 0;
+unsigned int CPathSearchBudget::m_iDeferred = 0;
+unsigned int CPathSearchBudget::m_iWaits = 0;
+float CPathSearchBudget::m_fTotalWait = 0.0f;
+float CPathSearchBudget::m_fMaxWait = 0.0f;
+
+bool CPathSearchBudget :: isEnabled ()
+{
+	return bot_path_budget.GetInt() > 0;
+}
+
+void CPathSearchBudget :: startFrame ()
+{
+	if ( !isEnabled() )
+		return;
+
+	const float fTime = engine->Time();
+
+	m_iRemaining = bot_path_budget.GetInt();
+
+	int iOrder[RCBOT_MAXPLAYERS];
+	int iNumWaiting = 0;
+
+	for ( int i = 0; i < RCBOT_MAXPLAYERS; i ++ )
+	{
+		path_budget_slot_t &slot = m_Slots[i];
+
+		if ( !slot.bWaiting )
+			continue;
+
+		// stopped searching (new goal, died, left) without asking again
+		if ( slot.fLastAsked + WAIT_FORGET_TIME < fTime )
+		{
+			slot.bWaiting = false;
+			slot.iGranted = 0;
+		}
+		// still to be used, counts against this frame
+		else if ( slot.iGranted > 0 )
+			m_iRemaining -= slot.iGranted;
+		else
+			iOrder[iNumWaiting++] = i;
+	}
+
+	// most urgent first, waiting makes a search more urgent
+	std::sort(iOrder, iOrder + iNumWaiting, [fTime](const int a, const int b)
+	{
+		const float fUrgencyA = static_cast<float>(m_Slots[a].iPriority) + (fTime - m_Slots[a].fWaitStart) / WAIT_PER_PRIORITY;
+		const float fUrgencyB = static_cast<float>(m_Slots[b].iPriority) + (fTime - m_Slots[b].fWaitStart) / WAIT_PER_PRIORITY;
+
+		return fUrgencyA > fUrgencyB;
+	});
+
+	for ( int i = 0; i < iNumWaiting && m_iRemaining > 0; i ++ )
+	{
+		path_budget_slot_t &slot = m_Slots[iOrder[i]];
+
+		slot.iGranted = std::min(slot.iWanted, m_iRemaining);
+		m_iRemaining -= slot.iGranted;
+	}
+}
+
+int CPathSearchBudget :: requestLoops ( const int iSlot, const int iPriority, const int iWanted )
+{
+	if ( !isEnabled() || iSlot < 0 || iSlot >= RCBOT_MAXPLAYERS )
+		return iWanted;
+
+	path_budget_slot_t &slot = m_Slots[iSlot];
+
+	if ( slot.iGranted > 0 )
+	{
+		const int iLoops = slot.iGranted;
+
+		slot.iGranted = 0;
+		granted(slot);
+
+		return iLoops;
+	}
+
+	// nobody is waiting for what's left this frame
+	if ( !slot.bWaiting && m_iRemaining > 0 )
+	{
+		const int iLoops = std::min(iWanted, m_iRemaining);
+
+		m_iRemaining -= iLoops;
+		m_iGranted++;
+
+		return iLoops;
+	}
+
+	if ( !slot.bWaiting )
+	{
+		slot.bWaiting = true;
+		slot.fWaitStart = engine->Time();
+	}
+
+	slot.fLastAsked = engine->Time();
+	slot.iPriority = iPriority;
+	slot.iWanted = iWanted;
+
+	m_iDeferred++;
+
+	return 0;
+}
+
+void CPathSearchBudget :: granted ( path_budget_slot_t &slot )
+{
+	if ( slot.bWaiting )
+	{
+		const float fWait = engine->Time() - slot.fWaitStart;
+
+		m_iWaits++;
+		m_fTotalWait += fWait;
+		m_fMaxWait = std::max(m_fMaxWait, fWait);
+	}
+
+	slot.bWaiting = false;
+
+	m_iGranted++;
+}
+
+void CPathSearchBudget :: returnLoops ( const int iUnused )
+{
+	if ( isEnabled() && iUnused > 0 )
+		m_iRemaining += iUnused;
+}
+
+void CPathSearchBudget :: releaseSlot ( const int iSlot )
+{
+	if ( iSlot < 0 || iSlot >= RCBOT_MAXPLAYERS )
+		return;
+
+	path_budget_slot_t &slot = m_Slots[iSlot];
+
+	if ( isEnabled() && slot.iGranted > 0 )
+		m_iRemaining += slot.iGranted;
+
+	slot.bWaiting = false;
+	slot.iGranted = 0;
+}
+
+int CPathSearchBudget :: numWaiting ()
+{
+	int iNum = 0;
+
+	for ( const path_budget_slot_t &slot : m_Slots )
+	{
+		if ( slot.bWaiting )
+			iNum++;
+	}
+
+	return iNum;
+}
+
+void CPathSearchBudget :: getStats ( unsigned int *iGranted, unsigned int *iDeferred, float *fAverageWait, float *fMaxWait )
+{
+	*iGranted = m_iGranted;
+	*iDeferred = m_iDeferred;
+	*fAverageWait = m_iWaits > 0 ? m_fTotalWait / static_cast<float>(m_iWaits) : 0.0f;
+	*fMaxWait = m_fMaxWait;
+}
+
+void CPathSearchBudget :: resetStats ()
+{
+	m_iGranted = 0;
+	m_iDeferred = 0;
+	m_iWaits = 0;
+	m_fTotalWait = 0.0f;
+	m_fMaxWait = 0.0f;
+}
@@ -0,0 +1,105 @@
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef __RCBOT_PATH_BUDGET_H__
+#define __RCBOT_PATH_BUDGET_H__
+
+#include <cstdint>
+
+// Shares one budget of A* nodes each frame between all bots searching for
+// a route, so the cost of searching doesn't grow with the number of bots
+// (e.g. everyone respawning at once at the start of a round).
+//
+// A search asks for its usual rcbot_pathrevs loops. While the frame budget
+// lasts it gets them straight away, otherwise it waits in the queue. At the
+// start of each frame the budget first goes to the waiting searches, most
+// urgent first; a search gains priority the longer it waits so none wait
+// forever. Bots don't think every frame, so what they are given is kept for
+// them until they next think.
+class CPathSearchBudget
+{
+public:
+	enum : std::uint8_t
+	{
+		PRIORITY_SPAWN = 0,		// just spawned, nothing to do yet
+		PRIORITY_ROUTE,			// still has a route to follow meanwhile
+		PRIORITY_NO_ROUTE,		// standing still until the search finishes
+		PRIORITY_DANGER			// under attack
+	};
+
+	// called from CBots::botThink before any bot thinks
+	static void startFrame ();
+
+	// loops the bot in this slot may search this frame, 0 to wait
+	static int requestLoops ( int iSlot, int iPriority, int iWanted );
+
+	// give back loops not used because the search finished early
+	static void returnLoops ( int iUnused );
+
+	// the bot in this slot stopped searching, it isn't waiting any more and
+	// anything it was given goes back to the other bots
+	static void releaseSlot ( int iSlot );
+
+	static bool isEnabled ();
+
+	static int numWaiting ();
+
+	static void getStats ( unsigned int *iGranted, unsigned int *iDeferred, float *fAverageWait, float *fMaxWait );
+	static void resetStats ();
+
+	// seconds of waiting worth one priority level
+	static constexpr float WAIT_PER_PRIORITY = 0.25f;
+	// forget a waiting search not asked for again in this time
+	static constexpr float WAIT_FORGET_TIME = 0.5f;
+private:
+	typedef struct
+	{
+		bool bWaiting;
+		int iPriority;
+		int iWanted;
+		int iGranted;		// given at the start of a frame, until the bot thinks
+		float fWaitStart;
+		float fLastAsked;
+	}path_budget_slot_t;
+
+	static void granted ( path_budget_slot_t &slot );
+
+	static path_budget_slot_t m_Slots[RCBOT_MAXPLAYERS];
+
+	static int m_iRemaining;
+
+	static unsigned int m_iGranted;
+	static unsigned int m_iDeferred;
+	static unsigned int m_iWaits;
+	static float m_fTotalWait;
+	static float m_fMaxWait;
+};
+
+#endif
@@ -0,0 +1,332 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include "bot.h"
+#include "bot_navigator.h"
+#include "bot_path_planner.h"
+#include "bot_waypoint_locations.h"
+#include "bot_waypoint_visibility.h"
+
+#include <algorithm>
+#include <chrono>
+
+std::thread CPathPlanner::m_Thread;
+std::mutex CPathPlanner::m_Mutex;
+std::condition_variable CPathPlanner::m_Wake;
+std::deque<std::shared_ptr<CPathRequest>> CPathPlanner::m_Queue;
+bool CPathPlanner::m_bStopping = false;
+
+// same costs as CWaypointNavigator::getNodeCosts used to work out on the game thread
+void CPathNodeCosts :: compute ( const CWaypointGraphSnapshot *pGraph, std::vector<float> *fNodeCost, std::vector<float> *fNodeHeuristic ) const
+{
+	const std::uint64_t *pDangerRow = m_iDangerRow.empty() ? nullptr : m_iDangerRow.data();
+	const float fBeliefSensitivity = m_bCovert ? 2.0f : 1.5f;
+	const int iNumWaypoints = pGraph->numWaypoints();
+	const int iNumBelief = std::min(iNumWaypoints, m_Belief.size());
+
+	fNodeCost->assign(static_cast<std::size_t>(iNumWaypoints), 0.0f);
+	fNodeHeuristic->clear();
+
+	if ( m_bCovert )
+		fNodeHeuristic->assign(static_cast<std::size_t>(iNumWaypoints), 0.0f);
+
+	for ( int i = 0; i < iNumBelief; i ++ )
+	{
+		const float fBelief = m_Belief.getAt(i, m_fBeliefTime, m_fBeliefDecayRate);
+		float fCost;
+
+		if ( !m_bCovert )
+			fCost = fBelief*(fBeliefSensitivity-m_fBraveness);
+		else if ( m_bEnemyVisible )
+		{
+			fCost = 0.0f;
+
+			Vector vLOS = pGraph->getOrigin(i) - m_vEnemyOrigin;
+			vLOS = vLOS/vLOS.Length();
+
+			if ( DotProduct(vLOS,m_vEnemyForward) > 0.96f )
+				fCost += CWaypointLocations::REACHABLE_RANGE;
+
+			if ( pDangerRow != nullptr && CWaypointVisibilityTable::TestBit(pDangerRow,i) )
+				fCost += fBelief*fBeliefSensitivity*2;
+		}
+		else if ( m_bDanger )
+			fCost = pDangerRow != nullptr && CWaypointVisibilityTable::TestBit(pDangerRow,i) ? fBelief*fBeliefSensitivity*2 : 0.0f;
+		else
+			fCost = fBelief*fBeliefSensitivity;
+
+		(*fNodeCost)[i] = fCost;
+
+		if ( m_bCovert )
+			(*fNodeHeuristic)[i] = fBelief*2;
+	}
+}
+
+void CPathPlanner :: submit ( const std::shared_ptr<CPathRequest> &pRequest )
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if ( !m_Thread.joinable() )
+		{
+			m_bStopping = false;
+			m_Thread = std::thread(run);
+		}
+
+		m_Queue.emplace_back(pRequest);
+	}
+
+	m_Wake.notify_one();
+}
+
+std::size_t CPathPlanner :: numQueued ()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	return m_Queue.size();
+}
+
+void CPathPlanner :: freeMemory ()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if ( !m_Thread.joinable() )
+			return;
+
+		m_bStopping = true;
+	}
+
+	m_Wake.notify_one();
+	m_Thread.join();
+
+	// anything left will never be searched
+	for ( const std::shared_ptr<CPathRequest> &pRequest : m_Queue )
+		pRequest->m_iState.store(ROUTE_FAILED, std::memory_order_release);
+
+	m_Queue.clear();
+}
+
+void CPathPlanner :: run ()
+{
+	// the thread's own scratch space, not shared with the game thread's pool
+	const std::unique_ptr<CAStarSearchContext> pContext(new CAStarSearchContext());
+
+	for (;;)
+	{
+		std::shared_ptr<CPathRequest> pRequest;
+
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+
+			m_Wake.wait(lock, [] { return m_bStopping || !m_Queue.empty(); });
+
+			if ( m_bStopping )
+				return;
+
+			pRequest = m_Queue.front();
+			m_Queue.pop_front();
+		}
+
+		if ( pRequest->isCancelled() )
+			pRequest->m_iState.store(ROUTE_FAILED, std::memory_order_release);
+		else
+			search(pRequest.get(), pContext.get());
+	}
+}
+
+// same search as CWaypointNavigator::searchRoute, on the snapshot
+void CPathPlanner :: search ( CPathRequest *pRequest, CAStarSearchContext *pContext )
+{
+	const auto searchStart = std::chrono::high_resolution_clock::now();
+
+	const CWaypointGraphSnapshot *pGraph = pRequest->m_pGraph.get();
+	const CWaypointLandmarks *pLandmarks = pRequest->m_pLandmarks.get();
+	const int iNumWaypoints = pGraph->numWaypoints();
+	const int iGoal = pRequest->m_iGoal;
+	const int iFinalGoal = pRequest->m_iFinalGoal;
+
+	pRequest->m_Costs.compute(pGraph, &pRequest->m_fNodeCost, &pRequest->m_fNodeHeuristic);
+
+	const bool bHeuristicExtra = !pRequest->m_fNodeHeuristic.empty();
+
+	// paths the game thread found the bot can't take, and any into unreachable waypoints
+	std::vector<std::uint8_t> &bPathBlocked = pRequest->m_bPathBlocked;
+
+	bPathBlocked.assign(static_cast<std::size_t>(pGraph->numPaths()), 0);
+
+	for ( const int iPath : pRequest->m_iBlockedPaths )
+		bPathBlocked[static_cast<std::size_t>(iPath)] = 1;
+
+	pGraph->forEachWithSomeFlags(CWaypointTypes::W_FL_UNREACHABLE, [pGraph, &bPathBlocked] ( const int iWpt )
+	{
+		const int iFromEnd = pGraph->getPathsFromEnd(iWpt);
+
+		for ( int i = pGraph->getPathsFromBegin(iWpt); i < iFromEnd; i ++ )
+			bPathBlocked[static_cast<std::size_t>(pGraph->getPathFrom(i))] = 1;
+	});
+
+	AStarOpenList *pOpenList = pContext->getOpenList();
+
+	pContext->reset(iNumWaypoints);
+
+	AStarNode *pStart = pContext->getNode(pRequest->m_iStart);
+	pStart->setHeuristic((pRequest->m_vBotOrigin - pRequest->m_vGoal).Length());
+	pStart->open();
+	pOpenList->add(pStart);
+
+	bool bFoundGoal = false;
+	int iLastNode = -1;
+	unsigned int iExpanded = 0;
+
+	while ( !pOpenList->empty() )
+	{
+		// check now and then if the bot still wants this
+		if ( (iExpanded & 63) == 63 && pRequest->isCancelled() )
+			break;
+
+		AStarNode *curr = pOpenList->top();
+		pOpenList->pop();
+		curr->unOpen();
+
+		iExpanded++;
+
+		const int iCurrentNode = curr->getWaypoint();
+
+		if ( iCurrentNode == iGoal )
+		{
+			bFoundGoal = true;
+			break;
+		}
+
+		const int iPathsEnd = pGraph->getPathsEnd(iCurrentNode);
+
+		for ( int iPath = pGraph->getPathsBegin(iCurrentNode); iPath < iPathsEnd; iPath ++ )
+		{
+			const int iSucc = pGraph->getPathTarget(iPath);
+
+			if ( iSucc == iLastNode || iSucc == iCurrentNode )
+				continue;
+
+			if ( pRequest->m_FailedPath.bValid && pRequest->m_FailedPath.iFrom == iCurrentNode && pRequest->m_FailedPath.iTo == iSucc )
+			{
+				// failed this path last time
+				pRequest->m_bSkippedFailedPath = true;
+				continue;
+			}
+
+			if ( iSucc != iFinalGoal && bPathBlocked[static_cast<std::size_t>(iPath)] )
+				continue;
+
+			const Vector &vSucc = pGraph->getOrigin(iSucc);
+			const int iPathFlags = pGraph->getPathFlags(iPath);
+			float fCost;
+
+			if ( iPathFlags & CWaypointGraphSnapshot::PATH_FROM_TELEPORT )
+				fCost = curr->getCost();
+			else if ( iPathFlags & CWaypointGraphSnapshot::PATH_TO_TELEPORT )
+				fCost = pGraph->getPathLength(iPath);
+			else
+				fCost = curr->getCost() + pGraph->getPathLength(iPath);
+
+			AStarNode *succ = pContext->getNode(iSucc);
+
+			if ( succ->isOpen() || succ->isClosed() )
+			{
+				if ( succ->getParent() == -1 || fCost >= succ->getCost() )
+					continue; // ignore route
+			}
+
+			succ->unClose();
+			succ->setParent(iCurrentNode);
+			succ->setCost(fCost + pRequest->m_fNodeCost[static_cast<std::size_t>(iSucc)]);
+
+			if ( !succ->heuristicSet() )
+			{
+				float fGoalDistance = (vSucc - pRequest->m_vGoal).Length();
+
+				if ( pLandmarks != nullptr )
+					fGoalDistance = std::max(fGoalDistance, pLandmarks->heuristic(iSucc, pRequest->m_iGoal));
+
+				float fHeuristic = (pRequest->m_vBotOrigin - vSucc).Length() + fGoalDistance;
+
+				if ( bHeuristicExtra )
+					fHeuristic += pRequest->m_fNodeHeuristic[static_cast<std::size_t>(iSucc)];
+
+				succ->setHeuristic(fHeuristic);
+			}
+
+			if ( !succ->isOpen() )
+			{
+				succ->open();
+				pOpenList->add(succ);
+			}
+			else
+				pOpenList->update(succ);
+		}
+
+		curr->close();
+
+		iLastNode = iCurrentNode;
+	}
+
+	if ( bFoundGoal )
+	{
+		int iCurrentNode = iGoal;
+		int iLoops = 0;
+
+		while ( iCurrentNode != -1 && iCurrentNode != pRequest->m_iStart && iLoops <= iNumWaypoints )
+		{
+			iLoops++;
+
+			pRequest->m_iRoute.emplace_back(iCurrentNode);
+
+			const int iParent = pContext->getNode(iCurrentNode)->getParent();
+
+			if ( iParent != -1 )
+				pRequest->m_fDistance += (pGraph->getOrigin(iCurrentNode) - pGraph->getOrigin(iParent)).Length();
+
+			iCurrentNode = iParent;
+		}
+
+		// erh??
+		if ( iLoops > iNumWaypoints )
+			bFoundGoal = false;
+	}
+
+	pOpenList->destroy();
+
+	pRequest->m_iNodesExpanded = iExpanded;
+	pRequest->m_fMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - searchStart).count();
+	pRequest->m_iState.store(bFoundGoal ? ROUTE_FOUND : ROUTE_FAILED, std::memory_order_release);
+}
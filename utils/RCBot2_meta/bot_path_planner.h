@@ -0,0 +1,137 @@
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef __RCBOT_PATH_PLANNER_H__
+#define __RCBOT_PATH_PLANNER_H__
+
+#include "bot_navigator.h"
+#include "bot_waypoint_landmarks.h"
+#include "bot_waypoint_snapshot.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// What the belief and danger cost of each waypoint is worked out from. It is
+// copied on the game thread so the costs themselves can be worked out on the
+// path planner thread.
+class CPathNodeCosts
+{
+public:
+	// fNodeHeuristic is left empty unless the route is covert
+	void compute ( const CWaypointGraphSnapshot *pGraph, std::vector<float> *fNodeCost, std::vector<float> *fNodeHeuristic ) const;
+
+	CBeliefTable m_Belief;
+	float m_fBeliefTime = 0.0f;
+	float m_fBeliefDecayRate = 0.0f;
+	bool m_bCovert = false;
+	float m_fBraveness = 0.0f;
+	// avoiding one danger waypoint, and the waypoints it can see (empty if unknown)
+	bool m_bDanger = false;
+	std::vector<std::uint64_t> m_iDangerRow;
+	// covert route with an enemy player in sight : stay out of where they're looking
+	bool m_bEnemyVisible = false;
+	Vector m_vEnemyOrigin;
+	Vector m_vEnemyForward;
+};
+
+// One A* search for the path planner thread. Everything the search needs is
+// copied in on the game thread when it is submitted, anything that needs the
+// engine (e.g. paths that open later) is worked out then, so the thread only
+// reads the request and the graph snapshot.
+class CPathRequest
+{
+public:
+	CPathRequest() : m_iState(ROUTE_SEARCHING), m_bCancelled(false) {}
+
+	int getState () const { return m_iState.load(std::memory_order_acquire); }
+
+	// the bot doesn't want this route any more
+	void cancel () { m_bCancelled.store(true, std::memory_order_relaxed); }
+	bool isCancelled () const { return m_bCancelled.load(std::memory_order_relaxed); }
+
+	// input
+	std::shared_ptr<const CWaypointGraphSnapshot> m_pGraph;
+	std::shared_ptr<const CWaypointLandmarks> m_pLandmarks; // null if turned off
+	int m_iStart = -1;
+	int m_iGoal = -1; // end of this search, may be a portal on the way
+	int m_iFinalGoal = -1; // the bot's goal, the only waypoint it may enter when blocked
+	Vector m_vGoal;
+	Vector m_vBotOrigin;
+	failedpath_t m_FailedPath;
+	CPathNodeCosts m_Costs;
+	std::vector<int> m_iBlockedPaths; // snapshot paths the bot can't take, from CBot::getPathCheckFlags
+
+	// output, only read once the state isn't ROUTE_SEARCHING
+	WaypointList m_iRoute; // goal first, not including start
+	float m_fDistance = 0.0f;
+	bool m_bSkippedFailedPath = false;
+	unsigned int m_iNodesExpanded = 0;
+	double m_fMilliseconds = 0.0;
+private:
+	friend class CPathPlanner;
+
+	// worked out on the planner thread
+	std::vector<float> m_fNodeCost; // added to the cost of reaching each waypoint (belief, danger)
+	std::vector<float> m_fNodeHeuristic; // added to the heuristic of each waypoint, empty if none
+	std::vector<std::uint8_t> m_bPathBlocked; // one for each snapshot path, bot can't take it
+
+	std::atomic<int> m_iState;
+	std::atomic<bool> m_bCancelled;
+};
+
+// Background thread running A* searches for the navigators (rcbot_path_async)
+class CPathPlanner
+{
+public:
+	static void submit ( const std::shared_ptr<CPathRequest> &pRequest );
+
+	static std::size_t numQueued ();
+
+	// stops the thread, started again by the next request
+	static void freeMemory ();
+private:
+	static void run ();
+
+	static void search ( CPathRequest *pRequest, CAStarSearchContext *pContext );
+
+	static std::thread m_Thread;
+	static std::mutex m_Mutex;
+	static std::condition_variable m_Wake;
+	static std::deque<std::shared_ptr<CPathRequest>> m_Queue;
+	static bool m_bStopping;
+};
+
+#endif
@@ -53,10 +53,20 @@
 #include "bot_squads.h"
 #include "bot_accessclient.h"
 #include "bot_weapons.h"
+#include "bot_waypoint_areas.h"
+#include "bot_waypoint_flow.h"
+#include "bot_waypoint_hierarchy.h"
+#include "bot_waypoint_landmarks.h"
+#include "bot_route_cache.h"
+#include "bot_path_planner.h"
+#include "bot_save_queue.h"
+#include "bot_team_belief.h"
+#include "bot_visibility_cache.h"
 #include "bot_waypoint_visibility.h"
 #include "bot_kv.h"
 #include "bot_sigscan.h"
 #include "bot_mods.h"
+#include "bot_navigator.h"
 
 #include "tier0/icommandline.h"
 
@@ -682,6 +692,18 @@ bool RCBotPluginMeta::Unload(char *error, std::size_t maxlen)
 	//	return;
 	
 	CBots::freeAllMemory();
+	CAStarSearchPool::freeMemory();
+	CWaypointAreaGraph::freeMemory();
+	CWaypointRouteCache::freeMemory();
+	CWaypointFlowFields::freeMemory();
+	CPathPlanner::freeMemory();
+	CTeamBelief::save();
+	CTeamBelief::freeMemory();
+	CVisibilityCache::freeMemory();
+	CSaveQueue::freeMemory(); // writes anything still queued
+	CWaypointGraphSnapshot::freeMemory();
+	CWaypointLandmarks::freeMemory();
+	CWaypointHierarchies::freeMemory();
 	CStrings::freeAllMemory();
 	CBotMods::freeMemory();
 	CAccessClients::freeMemory();
@@ -1098,8 +1120,13 @@ void RCBotPluginMeta::Hook_LevelShutdown()
 
 	CClients::initall();
 	CWaypointDistances::save();
+	CTeamBelief::save();
 
 	CBots::freeMapMemory();	
+	CTeamBelief::freeMemory();
+	// fields and shared routes belong to this map's waypoints and clock
+	CWaypointFlowFields::freeMemory();
+	CWaypointRouteCache::freeMemory();
 	CWaypoints::init();
 
 	CBotGlobals::setMapRunning(false);
@@ -0,0 +1,235 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include "bot.h"
+#include "bot_cvars.h"
+#include "bot_route_cache.h"
+
+#include <cmath>
+#include <cstring>
+
+std::unordered_map<std::uint64_t,CWaypointRouteCache::cached_route_t> CWaypointRouteCache::m_Routes;
+
+unsigned int CWaypointRouteCache::m_iOpensLaterEpoch = 0;
+unsigned int CWaypointRouteCache::m_iBeliefEpoch[MAX_CACHED_TEAMS];
+unsigned int CWaypointRouteCache::m_iBeliefLoadEpoch[MAX_CACHED_TEAMS];
+std::vector<float> CWaypointRouteCache::m_fBelief[MAX_CACHED_TEAMS];
+std::vector<unsigned int> CWaypointRouteCache::m_iBeliefWptEpoch[MAX_CACHED_TEAMS];
+unsigned int CWaypointRouteCache::m_iBeliefRevision = 0;
+
+unsigned int CWaypointRouteCache::m_iHits = 0;
+unsigned int CWaypointRouteCache::m_iMisses = 0;
+unsigned int CWaypointRouteCache::m_iStale = 0;
+unsigned int CWaypointRouteCache::m_iRejected = 0;
+
+std::uint64_t CWaypointRouteCache :: makeKey ( const int iStart, const int iGoal, const int iTeam, const int iConditions, const int iDangerId )
+{
+	// only covert changes the route, other conditions are the same search
+	const std::uint64_t iFlags = (iConditions & CONDITION_COVERT) ? 1 : 0;
+
+	return static_cast<std::uint64_t>(static_cast<std::uint16_t>(iStart)) |
+		(static_cast<std::uint64_t>(static_cast<std::uint16_t>(iGoal)) << 16) |
+		(static_cast<std::uint64_t>(static_cast<std::uint16_t>(iDangerId + 1)) << 32) |
+		(static_cast<std::uint64_t>(static_cast<std::uint8_t>(iTeam)) << 48) |
+		(iFlags << 56);
+}
+
+bool CWaypointRouteCache :: isStale ( const cached_route_t &entry, const int iTeam )
+{
+	if ( entry.iGraphRevision != CWaypoints::getGraphRevision() )
+		return true;
+	if ( entry.iOpensLaterEpoch != m_iOpensLaterEpoch )
+		return true;
+
+	const int iCacheTeam = iTeam % MAX_CACHED_TEAMS;
+
+	if ( entry.iBeliefEpoch < m_iBeliefLoadEpoch[iCacheTeam] )
+		return true;
+
+	// belief changed somewhere, but only matters along the route
+	if ( entry.iBeliefEpoch != m_iBeliefEpoch[iCacheTeam] )
+	{
+		const std::vector<unsigned int> &iWptEpoch = m_iBeliefWptEpoch[iCacheTeam];
+
+		for ( const int iWpt : entry.route )
+		{
+			if ( iWpt >= 0 && iWpt < static_cast<int>(iWptEpoch.size()) && iWptEpoch[iWpt] > entry.iBeliefEpoch )
+				return true;
+		}
+	}
+
+	return entry.fTime + bot_route_cache_time.GetFloat() < engine->Time();
+}
+
+bool CWaypointRouteCache :: getRoute ( const int iStart, const int iGoal, const int iTeam, const int iConditions, const int iDangerId, WaypointList *route, float *fDistance )
+{
+	const auto it = m_Routes.find(makeKey(iStart,iGoal,iTeam,iConditions,iDangerId));
+
+	if ( it == m_Routes.end() )
+	{
+		m_iMisses++;
+		return false;
+	}
+
+	if ( isStale(it->second,iTeam) )
+	{
+		m_Routes.erase(it);
+		m_iMisses++;
+		m_iStale++;
+		return false;
+	}
+
+	*route = it->second.route;
+	*fDistance = it->second.fDistance;
+
+	return true;
+}
+
+void CWaypointRouteCache :: addRoute ( const int iStart, const int iGoal, const int iTeam, const int iConditions, const int iDangerId, const WaypointList &route, const float fDistance )
+{
+	if ( route.empty() || route.back() != iGoal )
+		return;
+
+	if ( m_Routes.size() >= MAX_CACHED_ROUTES )
+	{
+		removeStale();
+
+		// still full : start again
+		if ( m_Routes.size() >= MAX_CACHED_ROUTES )
+			m_Routes.clear();
+	}
+
+	cached_route_t &entry = m_Routes[makeKey(iStart,iGoal,iTeam,iConditions,iDangerId)];
+
+	entry.route = route;
+	entry.fDistance = fDistance;
+	entry.fTime = engine->Time();
+	entry.iGraphRevision = CWaypoints::getGraphRevision();
+	entry.iOpensLaterEpoch = m_iOpensLaterEpoch;
+	entry.iBeliefEpoch = m_iBeliefEpoch[iTeam % MAX_CACHED_TEAMS];
+}
+
+void CWaypointRouteCache :: beliefChanged ( const int iTeam, const int iWpt, const float fBelief )
+{
+	if ( iTeam < 0 || iWpt < 0 )
+		return;
+
+	// belief of other waypoints (or another map)
+	if ( m_iBeliefRevision != CWaypoints::getGraphRevision() )
+	{
+		m_iBeliefRevision = CWaypoints::getGraphRevision();
+
+		for ( int i = 0; i < MAX_CACHED_TEAMS; i ++ )
+		{
+			m_fBelief[i].clear();
+			m_iBeliefWptEpoch[i].clear();
+		}
+	}
+
+	const int iCacheTeam = iTeam % MAX_CACHED_TEAMS;
+	std::vector<float> &fTeamBelief = m_fBelief[iCacheTeam];
+
+	if ( iWpt >= static_cast<int>(fTeamBelief.size()) )
+	{
+		fTeamBelief.resize(static_cast<std::size_t>(CWaypoints::numWaypoints()), 0.0f);
+		m_iBeliefWptEpoch[iCacheTeam].resize(fTeamBelief.size(), 0);
+	}
+	if ( iWpt >= static_cast<int>(fTeamBelief.size()) )
+		return;
+
+	// hurts and sightings in a fight nudge belief all the time, routes only
+	// need searching again once it has moved far enough
+	if ( std::fabs(fTeamBelief[iWpt] - fBelief) < ROUTE_BELIEF_STEP )
+		return;
+
+	fTeamBelief[iWpt] = fBelief;
+	m_iBeliefWptEpoch[iCacheTeam][iWpt] = ++m_iBeliefEpoch[iCacheTeam];
+}
+
+void CWaypointRouteCache :: beliefLoaded ( const int iTeam, const float *fBelief, const int iNumWaypoints )
+{
+	if ( iTeam < 0 )
+		return;
+
+	const int iCacheTeam = iTeam % MAX_CACHED_TEAMS;
+
+	m_iBeliefRevision = CWaypoints::getGraphRevision();
+	m_fBelief[iCacheTeam].assign(fBelief, fBelief + iNumWaypoints);
+	m_iBeliefWptEpoch[iCacheTeam].assign(static_cast<std::size_t>(iNumWaypoints), 0);
+	m_iBeliefLoadEpoch[iCacheTeam] = ++m_iBeliefEpoch[iCacheTeam];
+}
+
+void CWaypointRouteCache :: removeStale ()
+{
+	for ( auto it = m_Routes.begin(); it != m_Routes.end(); )
+	{
+		const int iTeam = static_cast<int>((it->first >> 48) & 0xFF);
+
+		if ( isStale(it->second,iTeam) )
+			it = m_Routes.erase(it);
+		else
+			++it;
+	}
+}
+
+void CWaypointRouteCache :: getStats ( unsigned int *iHits, unsigned int *iMisses, unsigned int *iStale, unsigned int *iRejected, unsigned int *iEntries )
+{
+	*iHits = m_iHits;
+	*iMisses = m_iMisses;
+	*iStale = m_iStale;
+	*iRejected = m_iRejected;
+	*iEntries = static_cast<unsigned int>(m_Routes.size());
+}
+
+void CWaypointRouteCache :: resetStats ()
+{
+	m_iHits = 0;
+	m_iMisses = 0;
+	m_iStale = 0;
+	m_iRejected = 0;
+}
+
+void CWaypointRouteCache :: freeMemory ()
+{
+	std::unordered_map<std::uint64_t,cached_route_t>().swap(m_Routes);
+
+	m_iOpensLaterEpoch = 0;
+	std::memset(m_iBeliefEpoch, 0, sizeof(m_iBeliefEpoch));
+	std::memset(m_iBeliefLoadEpoch, 0, sizeof(m_iBeliefLoadEpoch));
+
+	for ( int i = 0; i < MAX_CACHED_TEAMS; i ++ )
+	{
+		std::vector<float>().swap(m_fBelief[i]);
+		std::vector<unsigned int>().swap(m_iBeliefWptEpoch[i]);
+	}
+}
@@ -0,0 +1,108 @@
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef __RCBOT_ROUTE_CACHE_H__
+#define __RCBOT_ROUTE_CACHE_H__
+
+#include "bot_waypoint.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Routes found by one bot, shared with its team mates.
+//
+// A route is stored per start, goal, team, danger waypoint and covert
+// condition. It goes stale when the waypoints change, when a path that opens
+// later changes state or when the team's belief of a waypoint along it has
+// moved far enough. Bots still check every path of a cached route against
+// their own class before using it.
+class CWaypointRouteCache
+{
+public:
+	// fills route with the waypoints after iStart, in order, ending with iGoal
+	static bool getRoute ( int iStart, int iGoal, int iTeam, int iConditions, int iDangerId, WaypointList *route, float *fDistance );
+
+	static void addRoute ( int iStart, int iGoal, int iTeam, int iConditions, int iDangerId, const WaypointList &route, float fDistance );
+
+	// a cached route was used / couldn't be used by the bot that looked it up
+	static void routeUsed () { m_iHits++; }
+	static void routeRejected () { m_iMisses++; m_iRejected++; }
+
+	// invalidate routes that might go another way now
+	static void beliefChanged ( int iTeam, int iWpt, float fBelief );
+	static void beliefLoaded ( int iTeam, const float *fBelief, int iNumWaypoints );
+	static void opensLaterChanged () { m_iOpensLaterEpoch++; }
+
+	static void getStats ( unsigned int *iHits, unsigned int *iMisses, unsigned int *iStale, unsigned int *iRejected, unsigned int *iEntries );
+	static void resetStats ();
+
+	static void freeMemory ();
+
+	static constexpr int MAX_CACHED_ROUTES = 1024;
+	static constexpr int MAX_CACHED_TEAMS = 8;
+	// belief of a waypoint must move this much before routes through it are searched again
+	static constexpr float ROUTE_BELIEF_STEP = 10.0f;
+private:
+	typedef struct
+	{
+		WaypointList route;
+		float fDistance;
+		float fTime;
+		unsigned int iGraphRevision;
+		unsigned int iOpensLaterEpoch;
+		unsigned int iBeliefEpoch;
+	}cached_route_t;
+
+	static std::uint64_t makeKey ( int iStart, int iGoal, int iTeam, int iConditions, int iDangerId );
+
+	static bool isStale ( const cached_route_t &entry, int iTeam );
+
+	static void removeStale ();
+
+	static std::unordered_map<std::uint64_t,cached_route_t> m_Routes;
+
+	static unsigned int m_iOpensLaterEpoch;
+	// counts belief changes big enough to matter, per team
+	static unsigned int m_iBeliefEpoch[MAX_CACHED_TEAMS];
+	// when all of the team's belief was last replaced
+	static unsigned int m_iBeliefLoadEpoch[MAX_CACHED_TEAMS];
+	// per waypoint : belief routes were last made stale at, and when
+	static std::vector<float> m_fBelief[MAX_CACHED_TEAMS];
+	static std::vector<unsigned int> m_iBeliefWptEpoch[MAX_CACHED_TEAMS];
+	static unsigned int m_iBeliefRevision;
+
+	static unsigned int m_iHits;
+	static unsigned int m_iMisses;
+	static unsigned int m_iStale;
+	static unsigned int m_iRejected;
+};
+
+#endif
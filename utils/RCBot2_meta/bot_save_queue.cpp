@@ -0,0 +1,184 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include "bot_compress.h"
+#include "bot_save_queue.h"
+
+#include "rcbot/logging.h"
+
+#include <utility>
+
+std::thread CSaveQueue::m_Thread;
+std::mutex CSaveQueue::m_Mutex;
+std::condition_variable CSaveQueue::m_Wake;
+std::condition_variable CSaveQueue::m_Written;
+std::deque<save_request_t> CSaveQueue::m_Queue;
+std::vector<save_result_t> CSaveQueue::m_Results;
+std::string CSaveQueue::m_Writing;
+bool CSaveQueue::m_bStopping = false;
+
+void CSaveQueue :: save ( const char *szFilename, std::vector<unsigned char> data )
+{
+	report();
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if ( !m_Thread.joinable() )
+		{
+			m_bStopping = false;
+			m_Thread = std::thread(run);
+		}
+
+		bool bReplaced = false;
+
+		// only the newest data for a file is worth writing
+		for ( save_request_t &request : m_Queue )
+		{
+			if ( request.filename == szFilename )
+			{
+				request.data = std::move(data);
+				bReplaced = true;
+				break;
+			}
+		}
+
+		if ( !bReplaced )
+			m_Queue.push_back(save_request_t{ szFilename, std::move(data) });
+	}
+
+	m_Wake.notify_one();
+}
+
+bool CSaveQueue :: isPending ( const std::string &filename )
+{
+	if ( m_Writing == filename )
+		return true;
+
+	for ( const save_request_t &request : m_Queue )
+	{
+		if ( request.filename == filename )
+			return true;
+	}
+
+	return false;
+}
+
+void CSaveQueue :: waitFor ( const char *szFilename )
+{
+	{
+		const std::string filename = szFilename;
+		std::unique_lock<std::mutex> lock(m_Mutex);
+
+		m_Written.wait(lock, [&filename] { return !isPending(filename); });
+	}
+
+	report();
+}
+
+void CSaveQueue :: freeMemory ()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if ( !m_Thread.joinable() )
+			return;
+
+		m_bStopping = true;
+	}
+
+	// the thread empties the queue before it stops
+	m_Wake.notify_one();
+	m_Thread.join();
+
+	report();
+}
+
+void CSaveQueue :: run ()
+{
+	for (;;)
+	{
+		save_request_t request;
+
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+
+			m_Wake.wait(lock, [] { return m_bStopping || !m_Queue.empty(); });
+
+			if ( m_Queue.empty() )
+				return; // stopping
+
+			request = std::move(m_Queue.front());
+			m_Queue.pop_front();
+			m_Writing = request.filename;
+		}
+
+		save_result_t result;
+
+		result.filename = request.filename;
+		result.iDataSize = request.data.size();
+		result.iCompressedSize = 0;
+
+		// sets the error if it fails
+		RCBot_CompressedWrite(request.filename.c_str(), request.data.data(), request.data.size(), &result.iCompressedSize, &result.error);
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+
+			m_Results.emplace_back(std::move(result));
+			m_Writing.clear();
+		}
+
+		m_Written.notify_all();
+	}
+}
+
+void CSaveQueue :: report ()
+{
+	std::vector<save_result_t> results;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		results.swap(m_Results);
+	}
+
+	for ( const save_result_t &result : results )
+	{
+		if ( result.error.empty() )
+			logger->Log(LogLevel::INFO, "Saved '%s' (%u -> %u bytes)", result.filename.c_str(),
+				static_cast<unsigned>(result.iDataSize), static_cast<unsigned>(result.iCompressedSize));
+		else
+			logger->Log(LogLevel::ERROR, "Can't save '%s': %s", result.filename.c_str(), result.error.c_str());
+	}
+}
@@ -0,0 +1,87 @@
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef __RCBOT_SAVE_QUEUE_H__
+#define __RCBOT_SAVE_QUEUE_H__
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef struct
+{
+	std::string filename;
+	std::vector<unsigned char> data;
+}save_request_t;
+
+typedef struct
+{
+	std::string filename;
+	std::size_t iDataSize;
+	std::size_t iCompressedSize;
+	std::string error; // empty if saved
+}save_result_t;
+
+// Background thread compressing and writing the auxiliary files (.rcd, .rcv, .rcb)
+// so deflating them doesn't hold up a frame or a map change. Files are renamed
+// into place once written, what happened is logged on the game thread later on.
+class CSaveQueue
+{
+public:
+	// takes the data, a save of the same file still waiting is replaced
+	static void save ( const char *szFilename, std::vector<unsigned char> data );
+
+	// waits for szFilename to be written, call before reading it back
+	static void waitFor ( const char *szFilename );
+
+	// writes everything queued and stops the thread, started again by the next save
+	static void freeMemory ();
+private:
+	static void run ();
+
+	// logs finished saves, game thread only
+	static void report ();
+
+	static bool isPending ( const std::string &filename );
+
+	static std::thread m_Thread;
+	static std::mutex m_Mutex;
+	static std::condition_variable m_Wake;
+	static std::condition_variable m_Written;
+	static std::deque<save_request_t> m_Queue;
+	static std::vector<save_result_t> m_Results;
+	static std::string m_Writing; // file the thread is writing, empty if none
+	static bool m_bStopping;
+};
+
+#endif
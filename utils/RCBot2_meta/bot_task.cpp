@@ -2189,7 +2189,12 @@ void CFindPathTask :: execute ( CBot *pBot, CBotSchedule *pSchedule )
 			//complete(); // ~fin~
 		//}
 
-		if ( !pBot->getNavigator()->hasNextPoint() )
+		if ( pBot->getNavigator()->routeFailed() )
+		{
+			pBot->debugMsg(BOT_DEBUG_NAV,"Rest of route not found");
+			fail();
+		}
+		else if ( !pBot->getNavigator()->hasNextPoint() )
 		{
 			pBot->debugMsg(BOT_DEBUG_NAV,"Nowhere to go");
 			complete(); // reached goal
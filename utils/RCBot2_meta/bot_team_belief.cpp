@@ -0,0 +1,299 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include "bot.h"
+#include "bot_cvars.h"
+#include "bot_globals.h"
+#include "bot_compress.h"
+#include "bot_navigator.h"
+#include "bot_route_cache.h"
+#include "bot_save_queue.h"
+#include "bot_team_belief.h"
+#include "bot_waypoint.h"
+#include "bot_waypoint_flow.h"
+
+#include "rcbot/logging.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+std::vector<float> CBeliefTable::m_fWork;
+float CBeliefTable::m_fTime = 0.0f;
+float CBeliefTable::m_fDecayRate = 0.0f;
+
+CTeamBelief::team_belief_t CTeamBelief::m_Teams[MAX_BELIEF_TEAMS];
+CBeliefTable CTeamBelief::m_NoTeam;
+int CTeamBelief::m_iMaxWaypoints = 0;
+float CTeamBelief::m_fNextSave = 0.0f;
+float CTeamBelief::m_fNextDecay = 0.0f;
+
+void CBeliefTable :: set ( const int iWpt, const float fBelief )
+{
+	m_fBelief[static_cast<std::size_t>(iWpt)] = fBelief;
+	m_fChanged[static_cast<std::size_t>(iWpt)] = m_fTime;
+}
+
+void CBeliefTable :: danger ( const int *iWpts, const float *fAmounts, const int iNum )
+{
+	m_fWork.resize(static_cast<std::size_t>(iNum));
+
+	float *fWork = m_fWork.data();
+
+	for ( int i = 0; i < iNum; i ++ )
+		fWork[i] = get(iWpts[i]);
+
+	// no branches or indexing, so the compiler can do several at once
+	for ( int i = 0; i < iNum; i ++ )
+		fWork[i] = std::min(fWork[i] + fAmounts[i], MAX_BELIEF);
+
+	for ( int i = 0; i < iNum; i ++ )
+		set(iWpts[i], fWork[i]);
+}
+
+void CBeliefTable :: fade ( const int *iWpts, const int iNum, const float fFactor )
+{
+	m_fWork.resize(static_cast<std::size_t>(iNum));
+
+	float *fWork = m_fWork.data();
+
+	for ( int i = 0; i < iNum; i ++ )
+		fWork[i] = get(iWpts[i]);
+
+	for ( int i = 0; i < iNum; i ++ )
+		fWork[i] = std::max(fWork[i] * fFactor, 0.0f);
+
+	for ( int i = 0; i < iNum; i ++ )
+		set(iWpts[i], fWork[i]);
+}
+
+void CBeliefTable :: resize ( const int iMaxWaypoints )
+{
+	m_fBelief.resize(static_cast<std::size_t>(iMaxWaypoints), 0.0f);
+	m_fChanged.resize(static_cast<std::size_t>(iMaxWaypoints), 0.0f);
+}
+
+void CBeliefTable :: clear ()
+{
+	m_fBelief.clear();
+	m_fChanged.clear();
+}
+
+void CBeliefTable :: setTime ( const float fTime, const float fHalfLife )
+{
+	m_fTime = fTime;
+	m_fDecayRate = fHalfLife > 0.0f ? 0.693147f / fHalfLife : 0.0f;
+}
+
+CBeliefTable &CTeamBelief :: get ( const int iTeam )
+{
+	if ( iTeam < 0 || iTeam >= MAX_BELIEF_TEAMS )
+	{
+		m_NoTeam.resize(m_iMaxWaypoints);
+
+		return m_NoTeam;
+	}
+
+	team_belief_t &team = m_Teams[iTeam];
+
+	if ( !team.bLoaded )
+		load(iTeam);
+
+	return team.belief;
+}
+
+void CTeamBelief :: changed ( const int iTeam )
+{
+	if ( iTeam >= 0 && iTeam < MAX_BELIEF_TEAMS )
+		m_Teams[iTeam].bChanged = true;
+}
+
+void CTeamBelief :: resize ( const int iMaxWaypoints )
+{
+	m_iMaxWaypoints = iMaxWaypoints;
+
+	// loaded tables only, the rest are sized when loaded
+	for ( team_belief_t &team : m_Teams )
+	{
+		if ( team.bLoaded )
+			team.belief.resize(iMaxWaypoints);
+	}
+
+	if ( m_NoTeam.size() > 0 )
+		m_NoTeam.resize(iMaxWaypoints);
+}
+
+void CTeamBelief :: load ( const int iTeam )
+{
+	team_belief_t &team = m_Teams[iTeam];
+
+	const std::size_t iNumWaypoints = static_cast<std::size_t>(CWaypoints::numWaypoints());
+
+	team.bLoaded = true;
+	team.bChanged = false;
+	team.belief.clear();
+	team.belief.resize(m_iMaxWaypoints);
+	team.iFileBelief.assign(iNumWaypoints, 0);
+
+	char filename[1024];
+	char mapname[512];
+
+	snprintf(mapname, sizeof(mapname), "%s%d", CBotGlobals::getMapName(), iTeam);
+
+	CBotGlobals::buildFileName(filename, mapname, BOT_AUXILERY_FOLDER, "rcb", true);
+
+	// may have been saved at the end of the last map if it was this one
+	CSaveQueue::waitFor(filename);
+
+	if ( !RCBot_CompressedLoad(filename, team.iFileBelief.data(), iNumWaypoints * sizeof(unsigned short)) )
+	{
+		logger->Log(LogLevel::ERROR, "Can't open Waypoint belief array for reading!");
+		team.iFileBelief.assign(iNumWaypoints, 0);
+		return;
+	}
+
+	const int iNum = static_cast<int>(std::min(iNumWaypoints, static_cast<std::size_t>(team.belief.size())));
+
+	// convert from short int to float
+	std::vector<float> fBelief(static_cast<std::size_t>(iNum));
+
+	for ( int i = 0; i < iNum; i ++ )
+	{
+		fBelief[i] = static_cast<float>(team.iFileBelief[i])/32767 * MAX_BELIEF;
+		team.belief.set(i, fBelief[i]);
+	}
+
+	CWaypointRouteCache::beliefLoaded(iTeam,fBelief.data(),iNum);
+	CWaypointFlowFields::beliefLoaded(iTeam,fBelief.data(),iNum);
+}
+
+void CTeamBelief :: save ( const int iTeam )
+{
+	team_belief_t &team = m_Teams[iTeam];
+
+	if ( !team.bLoaded || !team.bChanged )
+		return;
+
+	const std::size_t iNumWaypoints = static_cast<std::size_t>(CWaypoints::numWaypoints());
+
+	std::vector<unsigned short> filebelief(iNumWaypoints, 0);
+
+	// half what was loaded, half what was learnt this map, so a map
+	// played many times doesn't just keep the last game
+	for ( std::size_t i = 0; i < iNumWaypoints; i ++ )
+	{
+		const unsigned short iLoaded = i < team.iFileBelief.size() ? team.iFileBelief[i] : 0;
+		const float fBelief = static_cast<int>(i) < team.belief.size() ? team.belief.get(static_cast<int>(i)) : 0.0f;
+
+		filebelief[i] = iLoaded/2 + static_cast<unsigned short>(fBelief / MAX_BELIEF * 16383);
+	}
+
+	char filename[1024];
+	char mapname[512];
+
+	snprintf(mapname, sizeof(mapname), "%s%d", CBotGlobals::getMapName(), iTeam);
+
+	CBotGlobals::buildFileName(filename, mapname, BOT_AUXILERY_FOLDER, "rcb", true);
+	CBotGlobals::makeFolders(filename);
+
+	// compressed and written by the save thread
+	const std::size_t iDataSize = iNumWaypoints * sizeof(unsigned short);
+	std::vector<unsigned char> data(iDataSize);
+	std::memcpy(data.data(), filebelief.data(), iDataSize);
+
+	CSaveQueue::save(filename, std::move(data));
+
+	team.bChanged = false;
+}
+
+void CTeamBelief :: save ()
+{
+	for ( int i = 0; i < MAX_BELIEF_TEAMS; i ++ )
+		save(i);
+
+	m_fNextSave = engine->Time() + BELIEF_SAVE_TIME;
+}
+
+void CTeamBelief :: decayed ( const int iTeam )
+{
+	const CBeliefTable &belief = m_Teams[iTeam].belief;
+
+	const int iNum = std::min(belief.size(), CWaypoints::numWaypoints());
+
+	// both only act on values that moved far enough since last time
+	for ( int i = 0; i < iNum; i ++ )
+	{
+		const float fBelief = belief.get(i);
+
+		CWaypointRouteCache::beliefChanged(iTeam,i,fBelief);
+		CWaypointFlowFields::beliefChanged(iTeam,i,fBelief);
+	}
+}
+
+void CTeamBelief :: think ()
+{
+	const float fTime = engine->Time();
+
+	CBeliefTable::setTime(fTime, bot_belief_halflife.GetFloat());
+
+	if ( m_fNextSave == 0.0f )
+		m_fNextSave = fTime + BELIEF_SAVE_TIME;
+	else if ( m_fNextSave < fTime )
+		save();
+
+	if ( CBeliefTable::getDecayRate() > 0.0f && m_fNextDecay < fTime )
+	{
+		for ( int i = 0; i < MAX_BELIEF_TEAMS; i ++ )
+		{
+			if ( m_Teams[i].bLoaded )
+				decayed(i);
+		}
+
+		m_fNextDecay = fTime + BELIEF_DECAY_TIME;
+	}
+}
+
+void CTeamBelief :: freeMemory ()
+{
+	for ( team_belief_t &team : m_Teams )
+	{
+		team.belief.clear();
+		team.iFileBelief.clear();
+		team.bLoaded = false;
+		team.bChanged = false;
+	}
+
+	m_NoTeam.clear();
+	m_fNextSave = 0.0f;
+	m_fNextDecay = 0.0f;
+}
@@ -0,0 +1,146 @@
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef __RCBOT_TEAM_BELIEF_H__
+#define __RCBOT_TEAM_BELIEF_H__
+
+#include <cmath>
+#include <vector>
+
+// Danger belief at each waypoint for one team.
+//
+// Each value is kept with the time it was last changed and fades from then
+// on when it is read (rcbot_belief_halflife), so nothing has to go over the
+// table to fade it. Updates come in lists of waypoints, which are copied out
+// into one array, worked on in straight loops and copied back.
+class CBeliefTable
+{
+public:
+	float get ( const int iWpt ) const
+	{
+		return getAt(iWpt, m_fTime, m_fDecayRate);
+	}
+
+	// belief at fTime, to read a copy of the table away from the game thread
+	float getAt ( const int iWpt, const float fTime, const float fDecayRate ) const
+	{
+		const float fBelief = m_fBelief[static_cast<std::size_t>(iWpt)];
+
+		if ( fDecayRate <= 0.0f || fBelief <= 0.0f )
+			return fBelief;
+
+		return fBelief * std::exp(-fDecayRate * (fTime - m_fChanged[static_cast<std::size_t>(iWpt)]));
+	}
+
+	int size () const { return static_cast<int>(m_fBelief.size()); }
+
+	void set ( int iWpt, float fBelief );
+
+	// adds fAmounts[i] to iWpts[i], up to MAX_BELIEF
+	void danger ( const int *iWpts, const float *fAmounts, int iNum );
+	// multiplies the belief of each of iWpts by fFactor
+	void fade ( const int *iWpts, int iNum, float fFactor );
+
+	// keeps the belief of waypoints still there
+	void resize ( int iMaxWaypoints );
+	void clear ();
+
+	// once a frame, before any bot thinks
+	static void setTime ( float fTime, float fHalfLife );
+
+	static float getTime () { return m_fTime; }
+	static float getDecayRate () { return m_fDecayRate; }
+private:
+	std::vector<float> m_fBelief; // when last changed
+	std::vector<float> m_fChanged;
+
+	// for the update in progress, shared as there is one at a time
+	static std::vector<float> m_fWork;
+
+	static float m_fTime;
+	static float m_fDecayRate; // per second, 0 doesn't fade
+};
+
+// One belief table per team that every bot of the team reads and updates.
+//
+// A team's table is loaded from <map><team>.rcb the first time a bot of the
+// team needs it. Changed tables are handed to the save thread every
+// BELIEF_SAVE_TIME seconds and at the end of the map, averaged with what was
+// loaded as each bot used to do with its own copy.
+//
+// Flow fields and shared routes keep their own copy of belief. Belief fading
+// on its own doesn't tell them, so while rcbot_belief_halflife is on the
+// faded values are passed on every BELIEF_DECAY_TIME seconds.
+class CTeamBelief
+{
+public:
+	// iTeam's table, loaded from file the first time this map. Teams out of
+	// range share a table that is never loaded or saved
+	static CBeliefTable &get ( int iTeam );
+
+	// something in iTeam's table changed, save it next time
+	static void changed ( int iTeam );
+
+	// waypoint capacity changed, keeps the belief of waypoints still there
+	static void resize ( int iMaxWaypoints );
+
+	// called from CBots::botThink
+	static void think ();
+
+	// hands changed tables to the save thread
+	static void save ();
+
+	static void freeMemory ();
+
+	static constexpr int MAX_BELIEF_TEAMS = 8;
+	static constexpr float BELIEF_SAVE_TIME = 300.0f;
+	static constexpr float BELIEF_DECAY_TIME = 2.0f;
+private:
+	static void load ( int iTeam );
+	static void save ( int iTeam );
+	// passes faded belief on to flow fields and shared routes
+	static void decayed ( int iTeam );
+
+	typedef struct
+	{
+		CBeliefTable belief;
+		std::vector<unsigned short> iFileBelief; // as loaded, averaged in when saving
+		bool bLoaded;
+		bool bChanged;
+	}team_belief_t;
+
+	static team_belief_t m_Teams[MAX_BELIEF_TEAMS];
+	static CBeliefTable m_NoTeam;
+	static int m_iMaxWaypoints;
+	static float m_fNextSave;
+	static float m_fNextDecay;
+};
+
+#endif
@@ -0,0 +1,133 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include "bot.h"
+#include "bot_cvars.h"
+#include "bot_trace_budget.h"
+
+int CTraceBudget::m_iCategory = TRACE_OTHER;
+int CTraceBudget::m_iRemaining = 0;
+
+unsigned int CTraceBudget::m_iRays[TRACE_MAX];
+unsigned int CTraceBudget::m_iDeferred[TRACE_MAX];
+unsigned int CTraceBudget::m_iOverdue[TRACE_MAX];
+unsigned int CTraceBudget::m_iCoalesced[TRACE_MAX];
+
+bool CTraceBudget :: isEnabled ()
+{
+	return bot_trace_budget.GetInt() > 0;
+}
+
+void CTraceBudget :: startFrame ()
+{
+	m_iCategory = TRACE_OTHER;
+	m_iRemaining = bot_trace_budget.GetInt();
+}
+
+int CTraceBudget :: setCategory ( const int iCategory )
+{
+	const int iPrevious = m_iCategory;
+
+	if ( iCategory >= 0 && iCategory < TRACE_MAX )
+		m_iCategory = iCategory;
+
+	return iPrevious;
+}
+
+void CTraceBudget :: traced ()
+{
+	m_iRays[m_iCategory]++;
+	m_iRemaining--;
+}
+
+void CTraceBudget :: coalesced ()
+{
+	m_iCoalesced[m_iCategory]++;
+}
+
+bool CTraceBudget :: canWait ( const int iCategory )
+{
+	return iCategory == TRACE_SWEEP || iCategory == TRACE_GROUND || iCategory == TRACE_VIS_TABLE;
+}
+
+bool CTraceBudget :: request ( const int iCategory, const float fDeadline )
+{
+	if ( !isEnabled() || !canWait(iCategory) || m_iRemaining > 0 )
+		return true;
+
+	if ( fDeadline <= engine->Time() )
+	{
+		// waited long enough
+		m_iOverdue[iCategory]++;
+		return true;
+	}
+
+	m_iDeferred[iCategory]++;
+
+	return false;
+}
+
+const char *CTraceBudget :: getCategoryName ( const int iCategory )
+{
+	static const char *szNames[TRACE_MAX] = { "other", "visible", "sweep", "move", "ground", "waypoint", "vis table" };
+
+	if ( iCategory < 0 || iCategory >= TRACE_MAX )
+		return "unknown";
+
+	return szNames[iCategory];
+}
+
+void CTraceBudget :: getStats ( const int iCategory, unsigned int *iRays, unsigned int *iDeferred, unsigned int *iOverdue, unsigned int *iCoalesced )
+{
+	if ( iCategory < 0 || iCategory >= TRACE_MAX )
+	{
+		*iRays = *iDeferred = *iOverdue = *iCoalesced = 0;
+		return;
+	}
+
+	*iRays = m_iRays[iCategory];
+	*iDeferred = m_iDeferred[iCategory];
+	*iOverdue = m_iOverdue[iCategory];
+	*iCoalesced = m_iCoalesced[iCategory];
+}
+
+void CTraceBudget :: resetStats ()
+{
+	for ( int i = 0; i < TRACE_MAX; i++ )
+	{
+		m_iRays[i] = 0;
+		m_iDeferred[i] = 0;
+		m_iOverdue[i] = 0;
+		m_iCoalesced[i] = 0;
+	}
+}
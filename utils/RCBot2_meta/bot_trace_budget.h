@@ -0,0 +1,122 @@
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef __RCBOT_TRACE_BUDGET_H__
+#define __RCBOT_TRACE_BUDGET_H__
+
+#include <cstdint>
+
+// Counts the tracelines cast each frame by what they were cast for and
+// shares out a budget of them (rcbot_trace_budget) between all bots.
+//
+// Traces bots need straight away (seeing players, getting unstuck, aiming)
+// are always cast but use up the budget. Traces that can wait, like looking
+// for other entities or checking if a waypoint has ground under it, ask
+// first and are put off until a later frame once the budget has run out.
+// Each one has a deadline after which it is cast anyway, so nothing waits
+// forever on a busy server.
+class CTraceBudget
+{
+public:
+	enum : std::uint8_t
+	{
+		TRACE_OTHER = 0,	// anything not sorted below, e.g. tasks
+		TRACE_VISIBLE,		// players and entities they own
+		TRACE_SWEEP,		// other entities a bot might see (can wait)
+		TRACE_MOVE,			// getting stuck, following routes
+		TRACE_GROUND,		// waypoints that need ground under them (can wait)
+		TRACE_WAYPOINT,		// doors and lifts on paths
+		TRACE_VIS_TABLE,	// working out the waypoint visibility table (can wait)
+		TRACE_MAX
+	};
+
+	// called from CBots::botThink before any bot thinks
+	static void startFrame ();
+
+	// traces cast from here on are counted for this, returns the old one
+	static int setCategory ( int iCategory );
+
+	// called by CBotGlobals for every ray cast
+	static void traced ();
+	// a trace that wasn't cast as another one's answer was used instead
+	static void coalesced ();
+
+	// true if a trace of this category may be cast now, false to try again
+	// later. Once fDeadline has passed the answer is always true
+	static bool request ( int iCategory, float fDeadline );
+
+	static bool isEnabled ();
+
+	static bool canWait ( int iCategory );
+
+	static const char *getCategoryName ( int iCategory );
+
+	// rays left this frame, only counts down while the budget is on
+	static int getRemaining () { return m_iRemaining; }
+
+	static void getStats ( int iCategory, unsigned int *iRays, unsigned int *iDeferred, unsigned int *iOverdue, unsigned int *iCoalesced );
+	static void resetStats ();
+
+	// seconds a bot's entity sweep may be put off
+	static constexpr float SWEEP_DEADLINE = 0.5f;
+	// seconds a waypoint ground check may be put off
+	static constexpr float GROUND_DEADLINE = 1.0f;
+	// seconds the visibility table may stop being worked on
+	static constexpr float VIS_TABLE_DEADLINE = 1.0f;
+private:
+	static int m_iCategory;
+	static int m_iRemaining;
+
+	static unsigned int m_iRays[TRACE_MAX];
+	static unsigned int m_iDeferred[TRACE_MAX];
+	static unsigned int m_iOverdue[TRACE_MAX];
+	static unsigned int m_iCoalesced[TRACE_MAX];
+};
+
+// traces cast while this is in scope are counted for iCategory
+class CTraceCategory
+{
+public:
+	explicit CTraceCategory ( const int iCategory ) : m_iPrevious(CTraceBudget::setCategory(iCategory))
+	{
+	}
+
+	~CTraceCategory ()
+	{
+		CTraceBudget::setCategory(m_iPrevious);
+	}
+
+	CTraceCategory ( const CTraceCategory & ) = delete;
+	CTraceCategory &operator = ( const CTraceCategory & ) = delete;
+private:
+	int m_iPrevious;
+};
+
+#endif
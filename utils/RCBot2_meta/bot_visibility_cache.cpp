@@ -0,0 +1,106 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include "bot.h"
+#include "bot_cvars.h"
+#include "bot_globals.h"
+#include "bot_trace_budget.h"
+#include "bot_visibility_cache.h"
+
+#include <algorithm>
+
+std::unordered_map<std::uint32_t,bool> CVisibilityCache::m_Results;
+unsigned int CVisibilityCache::m_iTraces = 0;
+unsigned int CVisibilityCache::m_iSaved = 0;
+
+bool CVisibilityCache :: isEnabled ()
+{
+	return bot_visibility_cache.GetBool();
+}
+
+void CVisibilityCache :: startFrame ()
+{
+	// keeps its buckets so the next frame doesn't allocate again
+	m_Results.clear();
+}
+
+std::uint32_t CVisibilityCache :: getKey ( int iEye, int iTarget, const int iClass )
+{
+	// player to player head traces are the same both ways
+	if ( iClass == VIS_HEAD && iEye > iTarget && iEye <= CBotGlobals::maxClients() )
+		std::swap(iEye,iTarget);
+
+	return (static_cast<std::uint32_t>(iEye) * MAX_EDICTS + static_cast<std::uint32_t>(iTarget)) * 4 + static_cast<std::uint32_t>(iClass);
+}
+
+bool CVisibilityCache :: get ( const int iEye, const int iTarget, const int iClass, bool *bVisible )
+{
+	if ( !isEnabled() )
+		return false;
+
+	const auto it = m_Results.find(getKey(iEye,iTarget,iClass));
+
+	if ( it == m_Results.end() )
+		return false;
+
+	*bVisible = it->second;
+	m_iSaved++;
+	CTraceBudget::coalesced();
+
+	return true;
+}
+
+void CVisibilityCache :: set ( const int iEye, const int iTarget, const int iClass, const bool bVisible )
+{
+	m_iTraces++;
+
+	if ( isEnabled() )
+		m_Results[getKey(iEye,iTarget,iClass)] = bVisible;
+}
+
+void CVisibilityCache :: getStats ( unsigned int *iTraces, unsigned int *iSaved )
+{
+	*iTraces = m_iTraces;
+	*iSaved = m_iSaved;
+}
+
+void CVisibilityCache :: resetStats ()
+{
+	m_iTraces = 0;
+	m_iSaved = 0;
+}
+
+void CVisibilityCache :: freeMemory ()
+{
+	std::unordered_map<std::uint32_t,bool>().swap(m_Results);
+}
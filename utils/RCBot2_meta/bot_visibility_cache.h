@@ -0,0 +1,79 @@
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef __RCBOT_VISIBILITY_CACHE_H__
+#define __RCBOT_VISIBILITY_CACHE_H__
+
+#include <cstdint>
+#include <unordered_map>
+
+// Remembers the visibility traces bots make between two entities during one
+// frame, so when several bots look at the same player only the first one
+// pays for the traceline and the rest reuse its answer.
+//
+// A trace from one player's eye to another player's head sees the same
+// things as the trace back the other way, so those are shared both ways.
+// Traces to the ground or to other entities start from the eye of the bot
+// asking and are only reused for that bot. Everything is forgotten at the
+// start of each frame as things will have moved.
+class CVisibilityCache
+{
+public:
+	enum : std::uint8_t
+	{
+		VIS_HEAD = 0,	// eye to the top of the target
+		VIS_GROUND,		// eye to the origin of the target
+		VIS_ENTITY		// eye to a non player entity
+	};
+
+	// called from CBots::botThink before any bot thinks
+	static void startFrame ();
+
+	// true and the answer if this trace was already made this frame
+	static bool get ( int iEye, int iTarget, int iClass, bool *bVisible );
+
+	static void set ( int iEye, int iTarget, int iClass, bool bVisible );
+
+	static bool isEnabled ();
+
+	static void getStats ( unsigned int *iTraces, unsigned int *iSaved );
+	static void resetStats ();
+
+	static void freeMemory ();
+private:
+	static std::uint32_t getKey ( int iEye, int iTarget, int iClass );
+
+	static std::unordered_map<std::uint32_t,bool> m_Results;
+
+	static unsigned int m_iTraces;
+	static unsigned int m_iSaved;
+};
+
+#endif
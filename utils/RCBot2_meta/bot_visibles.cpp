@@ -40,6 +40,7 @@
 #include "bot_client.h"
 #include "bot_profiling.h"
 #include "bot_getprop.h"
+#include "bot_trace_budget.h"
 
 #include "ndebugoverlay.h"
 
@@ -141,6 +142,7 @@ void CBotVisibles::reset()
     m_VisibleSet.clear();
     m_iCurrentIndex = CBotGlobals::maxClients() + 1;
     m_iCurPlayer = 1;
+    m_fLastSweepTime = 0.0f;
 }
 
 void CBotVisibles::debugString(char* string)
@@ -350,6 +352,14 @@ void CBotVisibles::updateVisibles()
         }
     }
 
+    // other entities can wait for a later frame when tracelines are short
+    if (!CTraceBudget::request(CTraceBudget::TRACE_SWEEP, m_fLastSweepTime + CTraceBudget::SWEEP_DEADLINE))
+        iMaxTicks = 0;
+    else
+        m_fLastSweepTime = engine->Time();
+
+    CTraceCategory traceCategory(CTraceBudget::TRACE_SWEEP);
+
     while (iTicks < iMaxTicks)
     {
         bVisible = false;
@@ -125,6 +125,8 @@ private:
 	int m_iCurrentIndex;
 	// current player index we are checking -- updated more often
 	int m_iCurPlayer;
+	// last time other entities were checked, the traceline budget may put it off
+	float m_fLastSweepTime;
 	unsigned char *m_iIndicesVisible;//[NUM_BYTES];
 	std::size_t m_iMaxSize;
 	int m_iMaxIndex;
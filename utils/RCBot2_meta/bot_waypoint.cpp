@@ -49,9 +49,19 @@
 #include "bot_getprop.h"
 #include "bot_globals.h"
 #include "bot_navigator.h"
+#include "bot_path_budget.h"
+#include "bot_path_planner.h"
 #include "bot_profile.h"
+#include "bot_route_cache.h"
+#include "bot_save_queue.h"
 #include "bot_schedule.h"
+#include "bot_team_belief.h"
+#include "bot_trace_budget.h"
 #include "bot_waypoint.h"
+#include "bot_waypoint_areas.h"
+#include "bot_waypoint_flow.h"
+#include "bot_waypoint_hierarchy.h"
+#include "bot_waypoint_landmarks.h"
 #include "bot_waypoint_locations.h"
 #include "bot_waypoint_visibility.h"
 #include "bot_wpt_color.h"
@@ -62,8 +72,10 @@
 #include "rcbot/utils.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstring>
+#include <utility>
 #include <vector>    //bir3yk
 
  //caxanga334: SDK 2013 contains macros for std::min and std::max which causes errors when compiling
@@ -76,7 +88,8 @@
 //#endif
 
 int CWaypoints::m_iNumWaypoints = 0;
-CWaypoint CWaypoints::m_theWaypoints[MAX_WAYPOINTS];
+int CWaypoints::m_iMaxWaypoints = 0;
+std::vector<std::unique_ptr<CWaypoint[]>> CWaypoints::m_WaypointBlocks;
 float CWaypoints::m_fNextDrawWaypoints = 0.0f;
 int CWaypoints::m_iWaypointTexture = 0;
 CWaypointVisibilityTable * CWaypoints::m_pVisibilityTable = nullptr;
@@ -84,7 +97,13 @@ std::vector<CWaypointType*> CWaypointTypes::m_Types;
 char CWaypoints::m_szAuthor[32];
 char CWaypoints::m_szModifiedBy[32];
 char CWaypoints::m_szWelcomeMessage[128];
+unsigned int CWaypoints::m_iGraphRevision = 0;
 const WptColor WptColor::white = WptColor(255,255,255,255) ;
+unsigned int CWaypointNavigator::m_iSearchesCompleted = 0;
+unsigned int CWaypointNavigator::m_iNodesExpanded = 0;
+double CWaypointNavigator::m_fSearchMilliseconds = 0.0;
+std::vector<CAStarSearchContext*> CAStarSearchPool::m_Contexts;
+std::vector<CAStarSearchContext*> CAStarSearchPool::m_FreeContexts;
 
 extern IVDebugOverlay *debugoverlay;
 
@@ -108,104 +127,31 @@ void CWaypointNavigator::init()
 	m_iPrevWaypoint = -1;
 	m_bWorkingRoute = false;
 
-	std::memset(m_fBelief, 0, sizeof(float) * CWaypoints::MAX_WAYPOINTS);
+	m_iAreaRoute.clear();
+	m_bRefiningRoute = false;
+	m_bRouteFailed = false;
+	m_iBuiltRoute.clear();
+	m_iRouteStart = -1;
+	releaseSearch();
+	m_pReplanner.reset();
+	m_bMoveFailed = false;
 
-	m_iFailedGoals.clear();
-}
-
-bool CWaypointNavigator::beliefLoad()
-{
-	unsigned short int filebelief[CWaypoints::MAX_WAYPOINTS];
-
-	char filename[1024];
-
-	char mapname[512];
-
-	m_bLoadBelief = false;
-	m_iBeliefTeam = static_cast<short>(m_pBot->getTeam());
-
-	snprintf(mapname, sizeof(mapname), "%s%d", CBotGlobals::getMapName(), m_iBeliefTeam);
-
-	CBotGlobals::buildFileName(filename, mapname, BOT_AUXILERY_FOLDER, "rcb", true);
-
-	const std::size_t iDesiredSize = static_cast<std::size_t>(CWaypoints::numWaypoints()) * sizeof(unsigned short int);
-
-	std::memset(filebelief, 0, sizeof(unsigned short int) * CWaypoints::MAX_WAYPOINTS);
-
-	if (!RCBot_CompressedLoad(filename, filebelief, iDesiredSize))
-	{
-		logger->Log(LogLevel::ERROR, "Can't open Waypoint belief array for reading!");
-		return false;
-	}
+	// nobody's until the bot has a team
+	m_pBelief = &CTeamBelief::get(-1);
 
-	// convert from short int to float
-
-	const unsigned short int num = static_cast<unsigned short>(CWaypoints::numWaypoints());
-
-	// quick loop
-	for (unsigned short int i = 0; i < num; i++)
-	{
-	   m_fBelief[i] = static_cast<float>(filebelief[i])/32767 * MAX_BELIEF;
-	}
-
-	return true;
+	m_iFailedGoals.clear();
 }
 
-// update belief array with averaged belief for this team
-bool CWaypointNavigator::beliefSave(const bool bOverride)
+void CWaypointNavigator :: useTeamBelief ()
 {
-	unsigned short int filebelief[CWaypoints::MAX_WAYPOINTS];
-	char filename[1024];
-	char mapname[512];
-
-	if (m_pBot->getTeam() == m_iBeliefTeam && !bOverride)
-		return false;
-
-	std::memset(filebelief, 0, sizeof(unsigned short int) * CWaypoints::MAX_WAYPOINTS);
-
-	// m_iBeliefTeam is the team we've been using -- we might have changed team now
-	// so would need to change files if a different team
-	// stick to the current team we've been using
-	snprintf(mapname, sizeof(mapname), "%s%d", CBotGlobals::getMapName(), m_iBeliefTeam);
-	CBotGlobals::buildFileName(filename, mapname, BOT_AUXILERY_FOLDER, "rcb", true);
-
-	const std::size_t iDesiredSize = static_cast<std::size_t>(CWaypoints::numWaypoints()) * sizeof(unsigned short int);
-
-	// Try to load existing belief data to average with
-	RCBot_CompressedLoad(filename, filebelief, iDesiredSize);
-
-	// convert from short int to float
-
-	const unsigned short int num = static_cast<unsigned short>(CWaypoints::numWaypoints());
+	const int iTeam = m_pBot->getTeam();
 
-	// quick loop
-   for ( unsigned short int i = 0; i < num; i ++ )
-   {
-	   filebelief[i] = filebelief[i]/2 + static_cast<unsigned short>(m_fBelief[i] / MAX_BELIEF * 16383); 
-   }
-
-	CBotGlobals::makeFolders(filename);
-
-	if (!RCBot_CompressedSave(filename, filebelief, iDesiredSize))
-	{
-		m_bLoadBelief = true;
-		m_iBeliefTeam = m_pBot->getTeam();
-		logger->Log(LogLevel::ERROR, "Can't save Waypoint Belief array!");
-		return false;
-	}
-
-	// new team -- load belief 
-	m_iBeliefTeam = m_pBot->getTeam();
-	m_bLoadBelief = true;
-	m_bBeliefChanged = false; // saved
-
-	return true;
-}
+	if ( iTeam == m_iBeliefTeam )
+		return;
 
-bool CWaypointNavigator::wantToSaveBelief()
-{
-	// playing on this map for more than a normal load time
-	return m_bBeliefChanged && m_iBeliefTeam != m_pBot->getTeam();
+	// team mates share one table, loaded the first time one of them needs it
+	m_iBeliefTeam = iTeam;
+	m_pBelief = &CTeamBelief::get(iTeam);
 }
 
 int CWaypointNavigator :: numPaths ()
@@ -382,9 +328,9 @@ CWaypoint *CWaypointNavigator :: chooseBestFromBeliefBetweenAreas ( const std::v
 						fBelief += 131072.0f - node->getHeuristic();
 				}
 				else if ( bHighDanger )
-					fBelief += m_fBelief[node->getWaypoint()] + node->getHeuristic();
+					fBelief += beliefAt(node->getWaypoint()) + node->getHeuristic();
 				else
-					fBelief += MAX_BELIEF - m_fBelief[node->getWaypoint()] + (131072.0f - node->getHeuristic());
+					fBelief += MAX_BELIEF - beliefAt(node->getWaypoint()) + (131072.0f - node->getHeuristic());
 			}
 
 			const float fSelect = randomFloat(0, fBelief);
@@ -403,9 +349,9 @@ CWaypoint *CWaypointNavigator :: chooseBestFromBeliefBetweenAreas ( const std::v
 						fBelief += 131072.0f - node->getHeuristic();
 				}
 				else if ( bHighDanger )
-					fBelief += m_fBelief[node->getWaypoint()] + node->getHeuristic();
+					fBelief += beliefAt(node->getWaypoint()) + node->getHeuristic();
 				else
-					fBelief += MAX_BELIEF - m_fBelief[node->getWaypoint()] + (131072.0f - node->getHeuristic());
+					fBelief += MAX_BELIEF - beliefAt(node->getWaypoint()) + (131072.0f - node->getHeuristic());
 
 				if ( fSelect <= fBelief )
 				{
@@ -503,11 +449,11 @@ CWaypoint *CWaypointNavigator :: chooseBestFromBelief ( const std::vector<CWaypo
 
 				if ( bHighDanger )
 				{
-					fBelief += bBeliefFactor * (1.0f + m_fBelief[CWaypoints::getWaypointIndex(goal)]);	
+					fBelief += bBeliefFactor * (1.0f + beliefAt(CWaypoints::getWaypointIndex(goal)));	
 				}
 				else
 				{
-					fBelief += bBeliefFactor * (1.0f + (MAX_BELIEF - m_fBelief[CWaypoints::getWaypointIndex(goal)]));
+					fBelief += bBeliefFactor * (1.0f + (MAX_BELIEF - beliefAt(CWaypoints::getWaypointIndex(goal))));
 				}
 			}
 
@@ -571,11 +517,11 @@ CWaypoint *CWaypointNavigator :: chooseBestFromBelief ( const std::vector<CWaypo
 
 				if ( bHighDanger )
 				{
-					fBelief += bBeliefFactor * (1.0f + m_fBelief[CWaypoints::getWaypointIndex(goal)]);
+					fBelief += bBeliefFactor * (1.0f + beliefAt(CWaypoints::getWaypointIndex(goal)));
 				}
 				else
 				{
-					fBelief += bBeliefFactor * (1.0f + (MAX_BELIEF - m_fBelief[CWaypoints::getWaypointIndex(goal)]));
+					fBelief += bBeliefFactor * (1.0f + (MAX_BELIEF - beliefAt(CWaypoints::getWaypointIndex(goal))));
 				}
 
 				if ( fSelect <= fBelief )
@@ -608,22 +554,40 @@ bool CWaypointNavigator::getCoverPosition(const Vector& vCoverOrigin, Vector* vC
 	return true;
 }
 
+// shared routes and flow fields through this waypoint may go another way now
+static void teamBeliefChanged ( const int iTeam, const int iWpt, const float fBelief )
+{
+	CWaypointRouteCache::beliefChanged(iTeam,iWpt,fBelief);
+	CWaypointFlowFields::beliefChanged(iTeam,iWpt,fBelief);
+}
+
 void CWaypointNavigator :: beliefOne (const int iWptIndex, const BotBelief iBeliefType, const float fDist)
 {
+	useTeamBelief();
+
 	if ( iBeliefType == BELIEF_SAFETY )
-	{
-		if ( m_fBelief[iWptIndex] > 0)
-			m_fBelief[iWptIndex] *= bot_belief_fade.GetFloat();
-		m_fBelief[iWptIndex] = std::max<float>(m_fBelief[iWptIndex], 0);
-	}
+		m_pBelief->fade(&iWptIndex, 1, bot_belief_fade.GetFloat());
 	else // danger	
 	{
-		if ( m_fBelief[iWptIndex] < MAX_BELIEF )
-			m_fBelief[iWptIndex] += 2048.0f / fDist;
-		m_fBelief[iWptIndex] = std::min(m_fBelief[iWptIndex], MAX_BELIEF);
+		const float fAmount = 2048.0f / fDist;
+
+		m_pBelief->danger(&iWptIndex, &fAmount, 1);
 	}
 
-	m_bBeliefChanged = true;
+	teamBeliefChanged(m_iBeliefTeam,iWptIndex,beliefAt(iWptIndex));
+
+	CTeamBelief::changed(m_iBeliefTeam);
+}
+
+// fScale over the distance from vOrigin to each waypoint
+static void beliefAmounts ( const WaypointList &iWpts, const Vector &vOrigin, const float fScale, std::vector<float> *fAmounts )
+{
+	const CWaypointGraphSnapshot *pGraph = CWaypointGraphSnapshot::current();
+
+	fAmounts->resize(iWpts.size());
+
+	for ( std::size_t i = 0; i < iWpts.size(); i ++ )
+		(*fAmounts)[i] = fScale / (vOrigin - pGraph->getOrigin(iWpts[i])).Length();
 }
 
 // get belief nearest to current origin using waypoints to store belief
@@ -632,21 +596,47 @@ void CWaypointNavigator :: belief (const Vector& vOrigin, const Vector& vOther,
 {
 	static float factor; //Unused? [APG]RoboCop[CL]
 	static float fEDist;
-	static int iWptIndex;
-	CWaypoint *pWpt;
 	WaypointList m_iVisibles;
 	WaypointList m_iInvisibles;
 	static int iWptFrom;
 	static int iWptTo;
+	static std::vector<float> fAmounts;
 
 	// get nearest waypoint visible to others
-	iWptFrom = CWaypointLocations::NearestWaypoint(vOrigin,2048.0f,-1,true,true,false, nullptr,false,0,false,true,vOther);
-	iWptTo = CWaypointLocations::NearestWaypoint(vOther,2048.0f,-1,true,true,false, nullptr,false,0,false,true,vOrigin);
+	CNearestWaypointQuery queries[2] = { CNearestWaypointQuery(vOrigin,2048.0f), CNearestWaypointQuery(vOther,2048.0f) };
+
+	queries[0].m_bGetUnreachable = queries[1].m_bGetUnreachable = true;
+
+	CWaypointVisibilityTable *pTable = CWaypoints::getVisiblity();
+
+	if ( pTable != nullptr && pTable->UpdateVisibleLists() )
+	{
+		// nearest to each without traces, then what the other one's waypoint can see
+		queries[0].m_bGetVisible = queries[1].m_bGetVisible = false;
+
+		CWaypointLocations::NearestWaypoints(queries,2);
+
+		iWptFrom = CWaypointLocations::NearestVisibleFrom(vOrigin,2048.0f,queries[1].m_iNearest);
+		iWptTo = CWaypointLocations::NearestVisibleFrom(vOther,2048.0f,queries[0].m_iNearest);
+	}
+	else
+	{
+		queries[0].m_bGetVisibleFromOther = queries[1].m_bGetVisibleFromOther = true;
+		queries[0].m_vOther = vOther;
+		queries[1].m_vOther = vOrigin;
+
+		CWaypointLocations::NearestWaypoints(queries,2);
+
+		iWptFrom = queries[0].m_iNearest;
+		iWptTo = queries[1].m_iNearest;
+	}
 
 	// no waypoint information
 	if ( iWptFrom == -1 || iWptTo == -1 )
 		return;
 
+	useTeamBelief();
+
 	fEDist = (vOrigin-vOther).Length(); // range
 
 	m_iVisibles.emplace_back(iWptFrom);
@@ -656,55 +646,29 @@ void CWaypointNavigator :: belief (const Vector& vOrigin, const Vector& vOther,
 	CWaypointLocations::GetAllVisible(iWptFrom,iWptTo,vOrigin,vOther,fEDist,&m_iVisibles,&m_iInvisibles);
 	//CWaypointLocations::GetAllVisible(iWptFrom,iWptTo,vOther,vOrigin,fEDist,&m_iVisibles,&m_iInvisibles);
 
-	for (const int m_iVisible : m_iVisibles)
+	// each list is updated in one go
+	if ( iType == BELIEF_SAFETY )
 	{
-		pWpt = CWaypoints::getWaypoint(m_iVisible);
-		if (pWpt == nullptr)
-			continue;
-		iWptIndex = CWaypoints::getWaypointIndex(pWpt);
-
-		if ( iType == BELIEF_SAFETY )
-		{
-			if ( m_fBelief[iWptIndex] > 0)
-				m_fBelief[iWptIndex] *= bot_belief_fade.GetFloat();//(fStrength / (vOrigin-pWpt->getOrigin()).Length())*fBelief;
-			m_fBelief[iWptIndex] = std::max<float>(m_fBelief[iWptIndex], 0);
-
-			//debugoverlay->AddTextOverlayRGB(pWpt->getOrigin(),0,5.0f,0.0,150,0,200,"Safety");
-		}
-		else if ( iType == BELIEF_DANGER )
-		{
-			if ( m_fBelief[iWptIndex] < MAX_BELIEF )
-				m_fBelief[iWptIndex] += fStrength / (vOrigin-pWpt->getOrigin()).Length()*fBelief;
-			m_fBelief[iWptIndex] = std::min(m_fBelief[iWptIndex], MAX_BELIEF);
+		m_pBelief->fade(m_iVisibles.data(), static_cast<int>(m_iVisibles.size()), bot_belief_fade.GetFloat());
 
-			//debugoverlay->AddTextOverlayRGB(pWpt->getOrigin(),0,5.0f,255,0,0,200,"Danger %0.2f",m_fBelief[iWptIndex]);
-		}
+		// not seen from here : more danger
+		beliefAmounts(m_iInvisibles, vOrigin, fStrength*fBelief*0.5f, &fAmounts);
+		m_pBelief->danger(m_iInvisibles.data(), fAmounts.data(), static_cast<int>(m_iInvisibles.size()));
 	}
-
-	for (const int m_iInvisible : m_iInvisibles)
+	else if ( iType == BELIEF_DANGER )
 	{
-		pWpt = CWaypoints::getWaypoint(m_iInvisible);
-		if (pWpt == nullptr)
-			continue;
-		iWptIndex = CWaypoints::getWaypointIndex(pWpt);
+		beliefAmounts(m_iVisibles, vOrigin, fStrength*fBelief, &fAmounts);
+		m_pBelief->danger(m_iVisibles.data(), fAmounts.data(), static_cast<int>(m_iVisibles.size()));
 
 		// this waypoint is safer from this danger
-		if ( iType == BELIEF_DANGER )
-		{
-			if ( m_fBelief[iWptIndex] > 0)
-				m_fBelief[iWptIndex] *= 0.9f;//(fStrength / (vOrigin-pWpt->getOrigin()).Length())*fBelief;
+		m_pBelief->fade(m_iInvisibles.data(), static_cast<int>(m_iInvisibles.size()), 0.9f);
+	}
 
-			//debugoverlay->AddTextOverlayRGB(pWpt->getOrigin(),1,5.0f,0.0,150,0,200,"Safety INV");
-		}
-		else if ( iType == BELIEF_SAFETY )
-		{
-			if ( m_fBelief[iWptIndex] < MAX_BELIEF )
-				m_fBelief[iWptIndex] += fStrength / (vOrigin-pWpt->getOrigin()).Length()*fBelief*0.5f;
-			m_fBelief[iWptIndex] = std::min(m_fBelief[iWptIndex], MAX_BELIEF);
+	for (const int iWptIndex : m_iVisibles)
+		teamBeliefChanged(m_iBeliefTeam,iWptIndex,beliefAt(iWptIndex));
 
-			//debugoverlay->AddTextOverlayRGB(pWpt->getOrigin(),1,5.0f,255,0,0,200,"Danger INV %0.2f",m_fBelief[iWptIndex]);
-		}
-	}
+	for (const int iWptIndex : m_iInvisibles)
+		teamBeliefChanged(m_iBeliefTeam,iWptIndex,beliefAt(iWptIndex));
 	
 /*
 	i = m_oldRoute.size();
@@ -720,17 +684,17 @@ void CWaypointNavigator :: belief (const Vector& vOrigin, const Vector& vOther,
 		{
 			if ( iType == BELIEF_SAFETY )
 			{
-				if ( m_fBelief[iWptIndex] > 0)
-					m_fBelief[iWptIndex] *= bot_belief_fade.GetFloat()*factor;//(fStrength / (vOrigin-pWpt->getOrigin()).Length())*fBelief;
-				if ( m_fBelief[iWptIndex] < 0 )
-					m_fBelief[iWptIndex] = 0;
+				if ( beliefAt(iWptIndex) > 0)
+					beliefAt(iWptIndex) *= bot_belief_fade.GetFloat()*factor;//(fStrength / (vOrigin-pWpt->getOrigin()).Length())*fBelief;
+				if ( beliefAt(iWptIndex) < 0 )
+					beliefAt(iWptIndex) = 0;
 			}
 			else if ( iType == BELIEF_DANGER )
 			{
-				if ( m_fBelief[iWptIndex] < MAX_BELIEF )
-					m_fBelief[iWptIndex] += factor*fBelief;
-				if ( m_fBelief[iWptIndex] > MAX_BELIEF )
-					m_fBelief[iWptIndex] = MAX_BELIEF;
+				if ( beliefAt(iWptIndex) < MAX_BELIEF )
+					beliefAt(iWptIndex) += factor*fBelief;
+				if ( beliefAt(iWptIndex) > MAX_BELIEF )
+					beliefAt(iWptIndex) = MAX_BELIEF;
 			}
 		}
 
@@ -740,7 +704,7 @@ void CWaypointNavigator :: belief (const Vector& vOrigin, const Vector& vOther,
 	m_iVisibles.clear();
 	m_iInvisibles.clear();
 
-	m_bBeliefChanged = true;
+	CTeamBelief::changed(m_iBeliefTeam);
 }
 
 int CWaypointNavigator :: getCurrentFlags ()
@@ -759,7 +723,7 @@ float CWaypointNavigator :: getCurrentBelief ( )
 {
 	if ( m_iCurrentWaypoint >= 0 )
 	{
-		return m_fBelief[m_iCurrentWaypoint];
+		return beliefAt(m_iCurrentWaypoint);
 	}
 
 	return 0;
@@ -789,21 +753,105 @@ bool CWaypointNavigator :: getHideSpotPosition (const Vector& vCoverOrigin, Vect
 
 	return true;
 }
+CAStarSearchContext :: CAStarSearchContext ()
+{
+	m_iGeneration = 0;
+}
+
+// start a new search, nodes from the last one are reset when next touched
+void CAStarSearchContext :: reset ( const int iMaxNodes )
+{
+	m_theOpenList.destroy();
+
+	if ( iMaxNodes > numNodes() )
+	{
+		// new nodes get generation 0 so always look stale
+		m_Nodes.resize(static_cast<std::size_t>(iMaxNodes));
+		m_iNodeGeneration.resize(static_cast<std::size_t>(iMaxNodes), 0);
+		m_theOpenList.resize(iMaxNodes);
+	}
+
+	m_iGeneration++;
+
+	if ( m_iGeneration == 0 )
+	{
+		// wrapped around, old stamps could look current again
+		std::fill(m_iNodeGeneration.begin(), m_iNodeGeneration.end(), 0);
+		m_iGeneration = 1;
+	}
+}
+
+AStarNode *CAStarSearchContext :: getNode ( const int iWaypoint )
+{
+	AStarNode *pNode = &m_Nodes[iWaypoint];
+
+	if ( m_iNodeGeneration[iWaypoint] != m_iGeneration )
+	{
+		m_iNodeGeneration[iWaypoint] = m_iGeneration;
+		*pNode = AStarNode();
+		pNode->setWaypoint(iWaypoint);
+	}
+
+	return pNode;
+}
+
+CAStarSearchContext *CAStarSearchPool :: lease ()
+{
+	if ( m_FreeContexts.empty() )
+	{
+		CAStarSearchContext *pContext = new CAStarSearchContext();
+
+		m_Contexts.emplace_back(pContext);
+
+		return pContext;
+	}
+
+	CAStarSearchContext *pContext = m_FreeContexts.back();
+	m_FreeContexts.pop_back();
+
+	return pContext;
+}
+
+void CAStarSearchPool :: release ( CAStarSearchContext *pContext )
+{
+	if ( pContext != nullptr )
+		m_FreeContexts.emplace_back(pContext);
+}
+
+void CAStarSearchPool :: freeMemory ()
+{
+	for ( const CAStarSearchContext *pContext : m_Contexts )
+		delete pContext;
+
+	m_Contexts.clear();
+	m_FreeContexts.clear();
+}
+
 // AStar Algorithm : open a waypoint
 void CWaypointNavigator :: open ( AStarNode *pNode )
 { 
+	AStarOpenList *pOpenList = m_pSearch->getOpenList();
+
 	if ( !pNode->isOpen() )
 	{
 		pNode->open();
 		//m_theOpenList.emplace_back(pNode);
-		m_theOpenList.add(pNode);
+		pOpenList->add(pNode);
 	}
+	else // already in the open list, cost changed so re-position it
+		pOpenList->update(pNode);
 }
 // AStar Algorithm : get the waypoint with lowest cost
 AStarNode *CWaypointNavigator :: nextNode ()
 {
-	AStarNode* pNode = m_theOpenList.top();
-	m_theOpenList.pop();
+	AStarOpenList *pOpenList = m_pSearch->getOpenList();
+
+	AStarNode* pNode = pOpenList->top();
+	pOpenList->pop();
+
+	// no longer in the open list, may be re-opened if a cheaper path is found
+	if ( pNode != nullptr )
+		pNode->unOpen();
 		
 	return pNode;
 }
@@ -811,7 +859,8 @@ AStarNode *CWaypointNavigator :: nextNode ()
 // clears the AStar open list
 void CWaypointNavigator :: clearOpenList ()
 {
-	m_theOpenList.destroy();
+	if ( m_pSearch != nullptr )
+		m_pSearch->getOpenList()->destroy();
 	
 	//for ( unsigned i = 0; i < m_theOpenList.size(); i ++ )
 	//	m_theOpenList[i]->unOpen();
@@ -819,6 +868,42 @@ void CWaypointNavigator :: clearOpenList ()
 	//m_theOpenList.clear();
 }
 
+void CWaypointNavigator :: releaseSearch ()
+{
+	if ( m_pSearch != nullptr )
+	{
+		clearOpenList();
+		CAStarSearchPool::release(m_pSearch);
+		m_pSearch = nullptr;
+	}
+
+	if ( m_pAsyncSearch != nullptr )
+	{
+		m_pAsyncSearch->cancel();
+		m_pAsyncSearch.reset();
+	}
+
+	m_bReplanning = false;
+
+	// not waiting for any more of the frame's search budget
+	if ( m_pBot != nullptr && m_pBot->getEdict() != nullptr )
+		CPathSearchBudget::releaseSlot(CBots::slotOfEdict(m_pBot->getEdict()));
+}
+
+void CWaypointNavigator :: getSearchStats ( unsigned int *iSearches, unsigned int *iExpanded, double *fMilliseconds )
+{
+	*iSearches = m_iSearchesCompleted;
+	*iExpanded = m_iNodesExpanded;
+	*fMilliseconds = m_fSearchMilliseconds;
+}
+
+void CWaypointNavigator :: resetSearchStats ()
+{
+	m_iSearchesCompleted = 0;
+	m_iNodesExpanded = 0;
+	m_fSearchMilliseconds = 0.0;
+}
+
 void CWaypointNavigator :: failMove ()
 {
 	m_iLastFailedWpt = m_iCurrentWaypoint;
@@ -828,6 +913,8 @@ void CWaypointNavigator :: failMove ()
 	m_lastFailedPath.iTo = m_iCurrentWaypoint;
 	m_lastFailedPath.bSkipped = false;
 
+	m_bMoveFailed = true;
+
 	if ( std::find(m_iFailedGoals.begin(), m_iFailedGoals.end(), m_iGoalWaypoint) == m_iFailedGoals.end() )
 	{
 		m_iFailedGoals.emplace_back(m_iGoalWaypoint);
@@ -837,13 +924,24 @@ void CWaypointNavigator :: failMove ()
 
 float CWaypointNavigator :: distanceTo (const Vector& vOrigin)
 {
+	// the goal's nearest waypoint, and the bot's if it doesn't have one
+	CNearestWaypointQuery queries[2] = { CNearestWaypointQuery(vOrigin,CWaypointLocations::REACHABLE_RANGE),
+		CNearestWaypointQuery(m_pBot->getOrigin(),CWaypointLocations::REACHABLE_RANGE) };
+
+	for ( CNearestWaypointQuery &query : queries )
+	{
+		query.m_bIsBot = true;
+		query.m_iTeam = m_pBot->getTeam();
+	}
+
+	CWaypointLocations::NearestWaypoints(queries, m_iCurrentWaypoint == -1 ? 2 : 1);
+
 	if ( m_iCurrentWaypoint == -1 )
-		m_iCurrentWaypoint = CWaypointLocations::NearestWaypoint(m_pBot->getOrigin(),CWaypointLocations::REACHABLE_RANGE,-1,true,false,true, nullptr,false,m_pBot->getTeam());
+		m_iCurrentWaypoint = queries[1].m_iNearest;
 	
 	if ( m_iCurrentWaypoint != -1 )
 	{
-		const int iGoal = CWaypointLocations::NearestWaypoint(vOrigin, CWaypointLocations::REACHABLE_RANGE, -1, true, false, true,
-															  nullptr, false, m_pBot->getTeam());
+		const int iGoal = queries[0].m_iNearest;
 
 		if ( iGoal != -1 )
 			return CWaypointDistances::getDistance(m_iCurrentWaypoint,iGoal);
@@ -857,103 +955,150 @@ float CWaypointNavigator :: distanceTo ( CWaypoint *pWaypoint )
 	return distanceTo(pWaypoint->getOrigin());
 }
 
-// find route using A* algorithm
-bool CWaypointNavigator :: workRoute (const Vector& vFrom,
-									  const Vector& vTo, 
-									  bool *bFail,
-									  const bool bRestart,
-									  const bool bNoInterruptions,
-									  const int iGoalId,
-									  const int iConditions, const int iDangerId)
+// start a new A* search between two waypoints
+void CWaypointNavigator :: startSearch ( const int iStart, const int iGoal, const Vector& vGoal )
 {
-#ifdef RCBOT_VPROF_ENABLED
-	VPROF_BUDGET("CWaypointNavigator::workRoute", "RCBot2")
-#endif // RCBOT_VPROF_ENABLED
+	m_iSearchStart = iStart;
+	m_iSearchGoal = iGoal;
+	m_vSearchGoal = vGoal;
 
-	if ( bRestart )
+	if ( bot_path_async.GetBool() )
 	{
-		if ( wantToSaveBelief() )
-			beliefSave();
-		if ( wantToLoadBelief() )
-			beliefLoad();
+		releaseSearch();
+		submitSearch(iStart,iGoal,vGoal);
+		return;
+	}
 
-		*bFail = false;
+	if ( m_pAsyncSearch != nullptr )
+		releaseSearch();
 
-		m_bWorkingRoute = true;
+	if ( m_pSearch == nullptr )
+		m_pSearch = CAStarSearchPool::lease();
 
-		if ( iGoalId == -1 )
-			m_iGoalWaypoint = CWaypointLocations::NearestWaypoint(vTo,CWaypointLocations::REACHABLE_RANGE,m_iLastFailedWpt,true,false,true,&m_iFailedGoals,false,m_pBot->getTeam());
-		else
-			m_iGoalWaypoint = iGoalId;
+	m_pSearch->reset(CWaypoints::getMaxWaypoints());
 
-		const CWaypoint* pGoalWaypoint = CWaypoints::getWaypoint(m_iGoalWaypoint);
+	AStarNode* currentNode = m_pSearch->getNode(iStart);
+	currentNode->setHeuristic(m_pBot->distanceFrom(vGoal));
+	open(currentNode);
+}
 
-		if ( CClients::clientsDebugging(BOT_DEBUG_NAV) )
-		{
-			char str[64];
+// belief and danger cost of entering each waypoint, as worked out in searchRoute
+// and the extra heuristic for covert routes (left empty if not covert)
+void CWaypointNavigator :: getNodeCosts ( const CWaypointGraphSnapshot *pGraph, std::vector<float> *fNodeCost, std::vector<float> *fNodeHeuristic ) const
+{
+	CPathNodeCosts costs;
+	std::vector<float> fUnused;
 
-			snprintf(str, sizeof(str), "goal waypoint = %d", m_iGoalWaypoint);
+	getNodeCostInputs(&costs);
 
-			CClients::clientDebugMsg(BOT_DEBUG_NAV,str,m_pBot);
+	costs.compute(pGraph, fNodeCost, fNodeHeuristic != nullptr ? fNodeHeuristic : &fUnused);
+}
 
-		}
+// copies what the node costs are worked out from, see CPathNodeCosts
+void CWaypointNavigator :: getNodeCostInputs ( CPathNodeCosts *pCosts ) const
+{
+	edict_t *pEnemy = m_pBot->getEnemy();
+
+	pCosts->m_Belief = *m_pBelief;
+	pCosts->m_fBeliefTime = CBeliefTable::getTime();
+	pCosts->m_fBeliefDecayRate = CBeliefTable::getDecayRate();
+	pCosts->m_bCovert = (m_iSearchConditions & CONDITION_COVERT) != 0;
+	pCosts->m_fBraveness = m_pBot->getProfile()->m_fBraveness;
+	pCosts->m_bDanger = m_iSearchDangerId != -1;
+	pCosts->m_iDangerRow.clear();
+
+	// waypoints the danger can see
+	if ( pCosts->m_bDanger )
+	{
+		const CWaypointVisibilityTable *pVisTable = CWaypoints::getVisiblity();
 
-		if ( m_iGoalWaypoint == -1 || pGoalWaypoint == nullptr )
-		{
-			*bFail = true;
-			m_bWorkingRoute = false;
-			return true;
-		}
+		if ( const std::uint64_t *pDangerRow = pVisTable->GetRow(m_iSearchDangerId) )
+			pCosts->m_iDangerRow.assign(pDangerRow, pDangerRow + pVisTable->GetRowWords());
+	}
 
-		m_vPreviousPoint = vFrom;
-		// get closest waypoint -- ignore previous failed waypoint
-		Vector vIgnore;
-		float fIgnoreSize;
+	pCosts->m_bEnemyVisible = pCosts->m_bCovert && pEnemy != nullptr && CBotGlobals::isPlayer(pEnemy) && m_pBot->isVisible(pEnemy);
 
-		const bool bIgnore = m_pBot->getIgnoreBox(&vIgnore,&fIgnoreSize) && pGoalWaypoint->distanceFrom(vFrom) > fIgnoreSize*2;
+	if ( pCosts->m_bEnemyVisible )
+	{
+		IPlayerInfo *p = playerinfomanager->GetPlayerInfo(pEnemy);
 
-		m_iCurrentWaypoint = CWaypointLocations::NearestWaypoint(vFrom,CWaypointLocations::REACHABLE_RANGE,m_iLastFailedWpt,
-			true,false,true, nullptr,false,m_pBot->getTeam(),true,false,vIgnore,0, nullptr,bIgnore,fIgnoreSize);
+		pCosts->m_vEnemyOrigin = CBotGlobals::entityOrigin(pEnemy);
 
-		// no nearest waypoint -- find nearest waypoint
-		if ( m_iCurrentWaypoint == -1 )
+		if ( p != nullptr )
+			AngleVectors(p->GetAbsAngles(),&pCosts->m_vEnemyForward);
+		else // as CBotGlobals::DotProductFromOrigin, nowhere is in view
+			pCosts->m_vEnemyForward = Vector(0,0,0);
+	}
+}
+
+// copy everything the search needs for the path planner thread
+void CWaypointNavigator :: submitSearch ( const int iStart, const int iGoal, const Vector& vGoal )
+{
+	const std::shared_ptr<CPathRequest> pRequest = std::make_shared<CPathRequest>();
+
+	pRequest->m_pGraph = CWaypointGraphSnapshot::get();
+
+	if ( bot_path_landmarks.GetInt() > 0 )
+		pRequest->m_pLandmarks = CWaypointLandmarks::get();
+
+	pRequest->m_iStart = iStart;
+	pRequest->m_iGoal = iGoal;
+	pRequest->m_iFinalGoal = m_iGoalWaypoint;
+	pRequest->m_vGoal = vGoal;
+	pRequest->m_vBotOrigin = m_pBot->getOrigin();
+	pRequest->m_FailedPath = m_lastFailedPath;
+
+	const CWaypointGraphSnapshot *pGraph = pRequest->m_pGraph.get();
+	std::vector<int> &iBlockedPaths = pRequest->m_iBlockedPaths;
+
+	// only paths into waypoints with flags the bot's own checks look at, these
+	// may need traces or the game's state so are checked here. The planner
+	// thread does the rest from the snapshot's flags
+	pGraph->forEachWithSomeFlags(m_pBot->getPathCheckFlags(), [this, pGraph, &iBlockedPaths] ( const int iWpt )
+	{
+		CWaypoint *pWpt = CWaypoints::getWaypoint(iWpt);
+
+		// segment end portals are checked like any other waypoint
+		if ( pWpt == nullptr || iWpt == m_iGoalWaypoint )
+			return;
+
+		const int iFromEnd = pGraph->getPathsFromEnd(iWpt);
+
+		for ( int i = pGraph->getPathsFromBegin(iWpt); i < iFromEnd; i ++ )
 		{
-			// don't ignore this time
-			m_iCurrentWaypoint = CWaypointLocations::NearestWaypoint(vFrom,CWaypointLocations::REACHABLE_RANGE,-1,true,false,true, nullptr,false,m_pBot->getTeam(),false,false,Vector(0,0,0),0,m_pBot->getEdict());
+			const int iPath = pGraph->getPathFrom(i);
+			CWaypoint *pFrom = CWaypoints::getWaypoint(pGraph->getPathSource(iPath));
 
-			if ( m_iCurrentWaypoint == -1 )
-			{
-				*bFail = true;
-				m_bWorkingRoute = false;
-				return true;
-			}
+			if ( pFrom != nullptr && !m_pBot->canGotoWaypoint(pFrom->getOrigin(),pWpt,pFrom) )
+				iBlockedPaths.emplace_back(iPath);
 		}
+	});
 
-		// reset
-		m_iLastFailedWpt = -1;
+	getNodeCostInputs(&pRequest->m_Costs);
 
-		clearOpenList();
-		Q_memset(paths, 0, sizeof(AStarNode) * CWaypoints::MAX_WAYPOINTS);
+	m_pAsyncSearch = pRequest;
 
-		AStarNode* currentNode = &paths[m_iCurrentWaypoint];
-		currentNode->setWaypoint(m_iCurrentWaypoint);
-		currentNode->setHeuristic(m_pBot->distanceFrom(vTo));
-		open(currentNode);
-	}
-/////////////////////////////////
-	if ( m_iGoalWaypoint == -1 )
-	{
-		*bFail = true;
-		m_bWorkingRoute = false;
-		return true;
-	}
-	if ( m_iCurrentWaypoint == -1 )
+	CPathPlanner::submit(pRequest);
+}
+
+// run the current A* search for this frame
+int CWaypointNavigator :: searchRoute ( const bool bNoInterruptions )
+{
+	if ( m_pAsyncSearch != nullptr )
 	{
-		*bFail = true;
-		m_bWorkingRoute = false;
-		return true;
+		const int iState = m_pAsyncSearch->getState();
+
+		if ( iState == ROUTE_SEARCHING )
+			return ROUTE_SEARCHING;
+
+		m_iNodesExpanded += m_pAsyncSearch->m_iNodesExpanded;
+		m_fSearchMilliseconds += m_pAsyncSearch->m_fMilliseconds;
+
+		if ( m_pAsyncSearch->m_bSkippedFailedPath )
+			m_lastFailedPath.bSkipped = true;
+
+		return iState;
 	}
-///////////////////////////////
 
 	int iLoops = 0;
 	//int iMaxLoops = this->m_pBot->getProfile()->getPathTicks(); // bot_pathrevs.GetInt(); //IBotNavigator::MAX_PATH_TICKS; - DNA.styx
@@ -965,11 +1110,39 @@ bool CWaypointNavigator :: workRoute (const Vector& vFrom,
 	if ( bNoInterruptions )
 		iMaxLoops *= 2; // "less" interruptions, however dont want to hang, or use massive cpu
 
-	int iCurrentNode; // node selected
+	// share the frame's search budget with the other bots
+	iMaxLoops = CPathSearchBudget::requestLoops(CBots::slotOfEdict(m_pBot->getEdict()),searchPriority(),iMaxLoops);
+
+	if ( iMaxLoops == 0 )
+		return ROUTE_SEARCHING;
+
+	if ( m_bReplanning )
+	{
+		const unsigned int iExpandedBefore = m_pReplanner->getNodesExpanded();
+		const auto replanStart = std::chrono::high_resolution_clock::now();
+
+		const int iResult = m_pReplanner->compute(iMaxLoops);
+		const unsigned int iExpanded = m_pReplanner->getNodesExpanded() - iExpandedBefore;
+
+		CPathSearchBudget::returnLoops(iMaxLoops - static_cast<int>(iExpanded));
+
+		m_iNodesExpanded += iExpanded;
+		m_fSearchMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - replanStart).count();
+
+		if ( iResult == ROUTE_FAILED )
+		{
+			// no other way, forget the failed path like the full search does
+			m_lastFailedPath.bSkipped = true;
+			m_pReplanner->invalidate();
+		}
+
+		return iResult;
+	}
 
 	bool bFoundGoal = false;
 
 	const CWaypointVisibilityTable *pVisTable = CWaypoints::getVisiblity();
+	const CWaypointGraphSnapshot *pGraph = CWaypointGraphSnapshot::current();
 
 	float fCost;
 	float fOldCost;
@@ -978,10 +1151,14 @@ bool CWaypointNavigator :: workRoute (const Vector& vFrom,
 
 	float fBeliefSensitivity = 1.5f;
 
-	if ( iConditions & CONDITION_COVERT )
+	if ( m_iSearchConditions & CONDITION_COVERT )
 		fBeliefSensitivity = 2.0f;
 
-	while ( !bFoundGoal && !m_theOpenList.empty() && iLoops < iMaxLoops )
+	const CWaypointLandmarks *pLandmarks = bot_path_landmarks.GetInt() > 0 ? CWaypointLandmarks::current() : nullptr;
+
+	const auto searchStart = std::chrono::high_resolution_clock::now();
+
+	while ( !bFoundGoal && !m_pSearch->getOpenList()->empty() && iLoops < iMaxLoops )
 	{
 		iLoops ++;
 
@@ -990,9 +1167,11 @@ bool CWaypointNavigator :: workRoute (const Vector& vFrom,
 		if ( !curr )
 			break;
 
-		iCurrentNode = curr->getWaypoint();
+		m_iNodesExpanded++;
+
+		const int iCurrentNode = curr->getWaypoint();
 		
-		bFoundGoal = iCurrentNode == m_iGoalWaypoint;
+		bFoundGoal = iCurrentNode == m_iSearchGoal;
 
 		if ( bFoundGoal )
 			break;
@@ -1005,15 +1184,15 @@ bool CWaypointNavigator :: workRoute (const Vector& vFrom,
 		if (currWpt == nullptr)
 			continue;
 
-		const Vector vOrigin = currWpt->getOrigin();
+		const Vector& vOrigin = pGraph->getOrigin(iCurrentNode);
 
-		const int iMaxPaths = currWpt->numPaths();
+		const int iPathsEnd = pGraph->getPathsEnd(iCurrentNode);
 
 		succ = nullptr;
 
-		for ( int iPath = 0; iPath < iMaxPaths; iPath ++ )
+		for ( int iPath = pGraph->getPathsBegin(iCurrentNode); iPath < iPathsEnd; iPath ++ )
 		{
-			const int iSucc = currWpt->getPath(iPath);
+			const int iSucc = pGraph->getPathTarget(iPath);
 
 			if ( iSucc == iLastNode )
 				continue;
@@ -1032,11 +1211,13 @@ bool CWaypointNavigator :: workRoute (const Vector& vFrom,
 				}
 			}
 
-			succ = &paths[iSucc];
+			// added after the search started and the capacity grew
+			if ( iSucc >= m_pSearch->numNodes() )
+				continue;
+
 			CWaypoint* succWpt = CWaypoints::getWaypoint(iSucc);
 
-			if (succWpt == nullptr)
-				continue;
+			succ = m_pSearch->getNode(iSucc);
 #ifndef __linux__
 			if ( rcbot_debug_show_route.GetBool() )
 			{
@@ -1044,22 +1225,25 @@ bool CWaypointNavigator :: workRoute (const Vector& vFrom,
 
 				if ( !engine->IsDedicatedServer() && (pListenEdict = CClients::getListenServerClient())!= nullptr)
 				{
-					debugoverlay->AddLineOverlayAlpha(succWpt->getOrigin(),currWpt->getOrigin(),255,0,0,255,false,5.0f);
+					debugoverlay->AddLineOverlayAlpha(pGraph->getOrigin(iSucc),vOrigin,255,0,0,255,false,5.0f);
 				}
 			}
 #endif
+			// only the real goal, a segment's end portal must be usable too
 			if ( iSucc != m_iGoalWaypoint && !m_pBot->canGotoWaypoint(vOrigin,succWpt,currWpt) )
 				continue;
 
-			if ( currWpt->hasFlag(CWaypointTypes::W_FL_TELEPORT_CHEAT) )
+			const int iPathFlags = pGraph->getPathFlags(iPath);
+
+			if ( iPathFlags & CWaypointGraphSnapshot::PATH_FROM_TELEPORT )
 				fCost = curr->getCost();
-			else if ( succWpt->hasFlag(CWaypointTypes::W_FL_TELEPORT_CHEAT) )
-				fCost = succWpt->distanceFrom(vOrigin);
+			else if ( iPathFlags & CWaypointGraphSnapshot::PATH_TO_TELEPORT )
+				fCost = pGraph->getPathLength(iPath);
 			else 
-				fCost = curr->getCost()+succWpt->distanceFrom(vOrigin);
+				fCost = curr->getCost()+pGraph->getPathLength(iPath);
 
-			if ( !CWaypointDistances::isSet(m_iCurrentWaypoint,iSucc) || CWaypointDistances::getDistance(m_iCurrentWaypoint,iSucc) > fCost )
-				CWaypointDistances::setDistance(m_iCurrentWaypoint,iSucc,fCost);
+			if ( !CWaypointDistances::isSet(m_iSearchStart,iSucc) || CWaypointDistances::getDistance(m_iSearchStart,iSucc) > fCost )
+				CWaypointDistances::setDistance(m_iSearchStart,iSucc,fCost);
 
 			if ( succ->isOpen() || succ->isClosed() )
 			{
@@ -1082,104 +1266,116 @@ bool CWaypointNavigator :: workRoute (const Vector& vFrom,
 			{
 				if ( m_pBot->getEnemy() != nullptr && CBotGlobals::isPlayer(m_pBot->getEnemy()) && m_pBot->isVisible(m_pBot->getEnemy()) )
 				{
-					if ( CBotGlobals::DotProductFromOrigin(m_pBot->getEnemy(),succWpt->getOrigin()) > 0.96f )
+					if ( CBotGlobals::DotProductFromOrigin(m_pBot->getEnemy(),pGraph->getOrigin(iSucc)) > 0.96f )
 						succ->setCost(fCost+CWaypointLocations::REACHABLE_RANGE);
 					else
 						succ->setCost(fCost);
 
-					if ( iDangerId != -1 )
+					if ( m_iSearchDangerId != -1 )
 					{
-						if ( pVisTable->GetVisibilityFromTo(iDangerId,iSucc) )
-							succ->setCost(succ->getCost()+m_fBelief[iSucc]*fBeliefSensitivity*2);
+						if ( pVisTable->GetVisibilityFromTo(m_iSearchDangerId,iSucc) )
+							succ->setCost(succ->getCost()+beliefAt(iSucc)*fBeliefSensitivity*2);
 					}
 				}
-				else if ( iDangerId != -1 )
+				else if ( m_iSearchDangerId != -1 )
 				{
-					if ( !pVisTable->GetVisibilityFromTo(iDangerId,iSucc) )
+					if ( !pVisTable->GetVisibilityFromTo(m_iSearchDangerId,iSucc) )
 						succ->setCost(fCost);
 					else
-						succ->setCost(fCost+m_fBelief[iSucc]*fBeliefSensitivity*2);
+						succ->setCost(fCost+beliefAt(iSucc)*fBeliefSensitivity*2);
 				}
 				else
-					succ->setCost(fCost+m_fBelief[iSucc]*fBeliefSensitivity);
-				//succ->setCost(fCost-(MAX_BELIEF-m_fBelief[iSucc]));
-				//succ->setCost(fCost-((MAX_BELIEF*fBeliefSensitivity)-(m_fBelief[iSucc]*(fBeliefSensitivity-m_pBot->getProfile()->m_fBraveness))));	
+					succ->setCost(fCost+beliefAt(iSucc)*fBeliefSensitivity);
+				//succ->setCost(fCost-(MAX_BELIEF-beliefAt(iSucc)));
+				//succ->setCost(fCost-((MAX_BELIEF*fBeliefSensitivity)-(beliefAt(iSucc)*(fBeliefSensitivity-m_pBot->getProfile()->m_fBraveness))));	
 			}
 			else
-				succ->setCost(fCost+m_fBelief[iSucc]*(fBeliefSensitivity-m_pBot->getProfile()->m_fBraveness));	
-
-			succ->setWaypoint(iSucc);
+				succ->setCost(fCost+beliefAt(iSucc)*(fBeliefSensitivity-m_pBot->getProfile()->m_fBraveness));	
 
 			if ( !succ->heuristicSet() )		
 			{
+				// landmarks know about detours the straight line doesn't
+				float fGoalDistance = (pGraph->getOrigin(iSucc)-m_vSearchGoal).Length();
+
+				if ( pLandmarks != nullptr )
+					fGoalDistance = std::max(fGoalDistance,pLandmarks->heuristic(iSucc,m_iSearchGoal));
+
 				if ( fBeliefSensitivity > 1.6f )
-					succ->setHeuristic(m_pBot->distanceFrom(succWpt->getOrigin())+succWpt->distanceFrom(vTo)+m_fBelief[iSucc]*2);	
+					succ->setHeuristic(m_pBot->distanceFrom(pGraph->getOrigin(iSucc))+fGoalDistance+beliefAt(iSucc)*2);	
 				else 
-					succ->setHeuristic(m_pBot->distanceFrom(succWpt->getOrigin())+succWpt->distanceFrom(vTo));		
+					succ->setHeuristic(m_pBot->distanceFrom(pGraph->getOrigin(iSucc))+fGoalDistance);		
 			}
 
 			// Fix: do this AFTER setting heuristic and cost!!!!
-			if ( !succ->isOpen() )
-			{
-				open(succ);
-			}
-
+			open(succ);
 		}
 
 		curr->close(); // close chosen node
 
 		iLastNode = iCurrentNode;		
 	}
-	/////////
-	if ( iLoops == iMaxLoops )
-	{
-		//*bFail = true;
-		
-		return false; // not finished yet, wait for next iteration
-	}
 
-	m_bWorkingRoute = false;
-	
-	clearOpenList(); // finished
+	m_fSearchMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - searchStart).count();
 
-	if ( !bFoundGoal )
-	{
-		*bFail = true;
+	CPathSearchBudget::returnLoops(iMaxLoops - iLoops);
 
-		//no other path
-		if ( m_lastFailedPath.bSkipped )
-			m_lastFailedPath.bValid = false;
+	if ( bFoundGoal )
+		return ROUTE_FOUND;
 
-		if (std::find(m_iFailedGoals.begin(), m_iFailedGoals.end(), m_iGoalWaypoint) == m_iFailedGoals.end())
-		{
-			m_iFailedGoals.emplace_back(m_iGoalWaypoint);
-			m_fNextClearFailedGoals = engine->Time() + randomFloat(8.0f,30.0f);
-		}
+	if ( iLoops == iMaxLoops )
+		return ROUTE_SEARCHING; // not finished yet, wait for next iteration
 
-		return true; // waypoint not found but searching is complete
-	}
+	return ROUTE_FAILED;
+}
 
-	while ( !m_oldRoute.empty() )
-		m_oldRoute.pop();
+int CWaypointNavigator :: searchPriority () const
+{
+	if ( m_pBot->hasEnemy() || m_pBot->recentlyHurt(3.0f) )
+		return CPathSearchBudget::PRIORITY_DANGER;
 
-	iCurrentNode = m_iGoalWaypoint;
+	// nothing to do yet anyway
+	if ( m_pBot->recentlySpawned(3.0f) )
+		return CPathSearchBudget::PRIORITY_SPAWN;
 
-	while ( !m_currentRoute.empty() )
-		m_currentRoute.pop();
+	if ( m_currentRoute.empty() )
+		return CPathSearchBudget::PRIORITY_NO_ROUTE;
 
-	iLoops = 0;
+	return CPathSearchBudget::PRIORITY_ROUTE;
+}
+
+// follow the parents of the finished search back from its goal, either as
+// the whole route or added to the end of the route already being followed
+bool CWaypointNavigator :: buildRoute ( const bool bAppend )
+{
+	WaypointList segment;
+	int iCurrentNode = m_iSearchGoal;
+	int iLoops = 0;
 
 	const int iNumWaypoints = CWaypoints::numWaypoints();
 	float fDistance = 0.0f;
 
-	while ( iCurrentNode != -1 && iCurrentNode != m_iCurrentWaypoint && iLoops <= iNumWaypoints )
+	// path planner thread already followed the parents
+	if ( m_pAsyncSearch != nullptr )
+	{
+		segment = m_pAsyncSearch->m_iRoute;
+		fDistance = m_pAsyncSearch->m_fDistance;
+		iCurrentNode = -1;
+	}
+	else if ( m_bReplanning )
+	{
+		if ( !m_pReplanner->getRoute(&segment,&fDistance) )
+			return false;
+
+		iCurrentNode = -1;
+	}
+
+	while ( iCurrentNode != -1 && iCurrentNode != m_iSearchStart && iLoops <= iNumWaypoints )
 	{
 		iLoops++;
 
-		m_currentRoute.push(iCurrentNode);
-		m_oldRoute.push(iCurrentNode);
+		segment.emplace_back(iCurrentNode);
 
-		const int iParent = paths[iCurrentNode].getParent();
+		const int iParent = m_pSearch->getNode(iCurrentNode)->getParent();
 
 		CWaypoint *pCurrWpt = CWaypoints::getWaypoint(iCurrentNode);
 		CWaypoint *pParentWpt = CWaypoints::getWaypoint(iParent);
@@ -1201,11 +1397,208 @@ bool CWaypointNavigator :: workRoute (const Vector& vFrom,
 		iCurrentNode = iParent;
 	}
 
-	CWaypointDistances::setDistance(m_iCurrentWaypoint,m_iGoalWaypoint,fDistance);
-	m_fGoalDistance = fDistance;
-
 	// erh??
 	if ( iLoops > iNumWaypoints )
+		return false;
+
+	CWaypointDistances::setDistance(m_iSearchStart,m_iSearchGoal,fDistance);
+
+	// the route is a stack, so waypoints still to be followed go back on top
+	WaypointList remaining;
+
+	if ( bAppend )
+	{
+		while ( !m_currentRoute.empty() )
+		{
+			remaining.emplace_back(m_currentRoute.top());
+			m_currentRoute.pop();
+		}
+
+		m_fGoalDistance += fDistance;
+	}
+	else
+	{
+		while ( !m_oldRoute.empty() )
+			m_oldRoute.pop();
+
+		while ( !m_currentRoute.empty() )
+			m_currentRoute.pop();
+
+		m_fGoalDistance = fDistance;
+	}
+
+	for ( const int iWpt : segment )
+	{
+		m_currentRoute.push(iWpt);
+		m_oldRoute.push(iWpt);
+	}
+
+	for ( auto it = remaining.rbegin(); it != remaining.rend(); ++it )
+		m_currentRoute.push(*it);
+
+	if ( !bAppend )
+		m_iBuiltRoute.clear();
+
+	m_iBuiltRoute.insert(m_iBuiltRoute.end(),segment.rbegin(),segment.rend());
+
+	return true;
+}
+
+// find route using A* algorithm
+bool CWaypointNavigator :: workRoute (const Vector& vFrom,
+									  const Vector& vTo, 
+									  bool *bFail,
+									  const bool bRestart,
+									  const bool bNoInterruptions,
+									  const int iGoalId,
+									  const int iConditions, const int iDangerId)
+{
+#ifdef RCBOT_VPROF_ENABLED
+	VPROF_BUDGET("CWaypointNavigator::workRoute", "RCBot2")
+#endif // RCBOT_VPROF_ENABLED
+
+	if ( bRestart )
+	{
+		useTeamBelief();
+
+		*bFail = false;
+
+		m_bWorkingRoute = true;
+
+		if ( iGoalId == -1 )
+			m_iGoalWaypoint = CWaypointLocations::NearestWaypoint(vTo,CWaypointLocations::REACHABLE_RANGE,m_iLastFailedWpt,true,false,true,&m_iFailedGoals,false,m_pBot->getTeam());
+		else
+			m_iGoalWaypoint = iGoalId;
+
+		const CWaypoint* pGoalWaypoint = CWaypoints::getWaypoint(m_iGoalWaypoint);
+
+		if ( CClients::clientsDebugging(BOT_DEBUG_NAV) )
+		{
+			char str[64];
+
+			snprintf(str, sizeof(str), "goal waypoint = %d", m_iGoalWaypoint);
+
+			CClients::clientDebugMsg(BOT_DEBUG_NAV,str,m_pBot);
+
+		}
+
+		if ( m_iGoalWaypoint == -1 || pGoalWaypoint == nullptr )
+		{
+			*bFail = true;
+			m_bWorkingRoute = false;
+			releaseSearch();
+			return true;
+		}
+
+		m_vPreviousPoint = vFrom;
+		// get closest waypoint -- ignore previous failed waypoint
+		Vector vIgnore;
+		float fIgnoreSize;
+
+		const bool bIgnore = m_pBot->getIgnoreBox(&vIgnore,&fIgnoreSize) && pGoalWaypoint->distanceFrom(vFrom) > fIgnoreSize*2;
+
+		m_iCurrentWaypoint = CWaypointLocations::NearestWaypoint(vFrom,CWaypointLocations::REACHABLE_RANGE,m_iLastFailedWpt,
+			true,false,true, nullptr,false,m_pBot->getTeam(),true,false,vIgnore,0, nullptr,bIgnore,fIgnoreSize);
+
+		// no nearest waypoint -- find nearest waypoint
+		if ( m_iCurrentWaypoint == -1 )
+		{
+			// don't ignore this time
+			m_iCurrentWaypoint = CWaypointLocations::NearestWaypoint(vFrom,CWaypointLocations::REACHABLE_RANGE,-1,true,false,true, nullptr,false,m_pBot->getTeam(),false,false,Vector(0,0,0),0,m_pBot->getEdict());
+
+			if ( m_iCurrentWaypoint == -1 )
+			{
+				*bFail = true;
+				m_bWorkingRoute = false;
+				releaseSearch();
+				return true;
+			}
+		}
+
+		// reset
+		m_iLastFailedWpt = -1;
+
+		m_iSearchConditions = iConditions;
+		m_iSearchDangerId = iDangerId;
+		m_bRefiningRoute = false;
+		m_bRouteFailed = false;
+		m_iAreaRoute.clear();
+		m_iRouteStart = m_iCurrentWaypoint;
+
+		// blocked on the way here last time, repair that route instead
+		if ( !startReplan() )
+		{
+			// a team mate may have found this route already, the team
+			// keeps a flow field to this goal, or the map has a hierarchy
+			if ( useCachedRoute() || useFlowField() || useHierarchy() )
+			{
+				m_bWorkingRoute = false;
+				releaseSearch();
+				return true;
+			}
+
+			// plan long routes through areas first, then only search up to the next area.
+			// portals are picked by distance alone, so not for routes avoiding danger
+			const bool bAreaRoute = bot_path_hierarchical.GetBool() && m_iSearchDangerId == -1 && !(m_iSearchConditions & CONDITION_COVERT);
+
+			if ( bAreaRoute && CWaypointAreaGraph::findRoute(m_iCurrentWaypoint,m_iGoalWaypoint,m_pBot->getTeam(),&m_iAreaRoute) &&
+				canUseAreaRoute() )
+			{
+				const int iSegmentGoal = m_iAreaRoute.front();
+
+				m_iAreaRoute.erase(m_iAreaRoute.begin());
+
+				startSearch(m_iCurrentWaypoint,iSegmentGoal,CWaypoints::getWaypoint(iSegmentGoal)->getOrigin());
+			}
+			else
+				startSearch(m_iCurrentWaypoint,m_iGoalWaypoint,vTo);
+		}
+	}
+/////////////////////////////////
+	if ( m_iGoalWaypoint == -1 || m_iCurrentWaypoint == -1 || !isSearching() )
+	{
+		*bFail = true;
+		m_bWorkingRoute = false;
+		releaseSearch();
+		return true;
+	}
+///////////////////////////////
+
+	const int iResult = searchRoute(bNoInterruptions);
+
+	if ( iResult == ROUTE_SEARCHING )
+	{
+		//*bFail = true;
+		
+		return false; // not finished yet, wait for next iteration
+	}
+
+	m_bWorkingRoute = false;
+	m_iSearchesCompleted++;
+	
+	clearOpenList(); // finished
+
+	if ( iResult == ROUTE_FAILED )
+	{
+		*bFail = true;
+
+		//no other path
+		if ( m_lastFailedPath.bSkipped )
+			m_lastFailedPath.bValid = false;
+
+		if (std::find(m_iFailedGoals.begin(), m_iFailedGoals.end(), m_iGoalWaypoint) == m_iFailedGoals.end())
+		{
+			m_iFailedGoals.emplace_back(m_iGoalWaypoint);
+			m_fNextClearFailedGoals = engine->Time() + randomFloat(8.0f,30.0f);
+		}
+
+		m_iAreaRoute.clear();
+		releaseSearch();
+
+		return true; // waypoint not found but searching is complete
+	}
+
+	if ( !buildRoute(false) )
 	{
 		while ( !m_oldRoute.empty () )
 			m_oldRoute.pop();
@@ -1213,6 +1606,8 @@ bool CWaypointNavigator :: workRoute (const Vector& vFrom,
 		while ( !m_currentRoute.empty() )
 			m_currentRoute.pop();
 
+		m_iAreaRoute.clear();
+
 		*bFail = true;
 	}
 	else
@@ -1220,10 +1615,283 @@ bool CWaypointNavigator :: workRoute (const Vector& vFrom,
 		CWaypoint *pGoalWpt = CWaypoints::getWaypoint(m_iGoalWaypoint);
 		if (pGoalWpt != nullptr)
 			m_vGoal = pGoalWpt->getOrigin();
+
+		// rest of the route is searched while following this segment
+		m_bRefiningRoute = !m_iAreaRoute.empty();
+
+		if ( !m_bRefiningRoute )
+			cacheRoute();
 	}
 
+	releaseSearch();
+
 	return true; 
 }
+
+// hierarchical route : search the next segment while the bot follows the current one
+void CWaypointNavigator :: refineRoute ()
+{
+#ifdef RCBOT_VPROF_ENABLED
+	VPROF_BUDGET("CWaypointNavigator::refineRoute", "RCBot2")
+#endif // RCBOT_VPROF_ENABLED
+
+	if ( !isSearching() )
+	{
+		const int iSegmentStart = m_iSearchGoal;
+
+		if ( m_iAreaRoute.empty() )
+		{
+			m_bRefiningRoute = false;
+			return;
+		}
+
+		const int iSegmentGoal = m_iAreaRoute.front();
+
+		m_iAreaRoute.erase(m_iAreaRoute.begin());
+
+		startSearch(iSegmentStart,iSegmentGoal,CWaypoints::getWaypoint(iSegmentGoal)->getOrigin());
+	}
+
+	const int iResult = searchRoute(false);
+
+	if ( iResult == ROUTE_SEARCHING )
+		return;
+
+	m_iSearchesCompleted++;
+
+	if ( iResult == ROUTE_FOUND && buildRoute(true) )
+	{
+		releaseSearch();
+
+		m_bRefiningRoute = !m_iAreaRoute.empty();
+
+		if ( !m_bRefiningRoute && m_iSearchGoal == m_iGoalWaypoint )
+			cacheRoute();
+
+		return;
+	}
+
+	// couldn't get to the next area this way, search straight for the goal instead
+	const int iSegmentStart = m_iSearchStart;
+
+	releaseSearch();
+
+	if ( m_iSearchGoal == m_iGoalWaypoint )
+	{
+		// the end of this segment isn't the goal, don't let the bot think it got there
+		failRoute();
+		return;
+	}
+
+	m_iAreaRoute.clear();
+
+	startSearch(iSegmentStart,m_iGoalWaypoint,CWaypoints::getWaypoint(m_iGoalWaypoint)->getOrigin());
+}
+
+// the rest of a hierarchical route couldn't be found
+void CWaypointNavigator :: failRoute ()
+{
+	while ( !m_oldRoute.empty() )
+		m_oldRoute.pop();
+
+	while ( !m_currentRoute.empty() )
+		m_currentRoute.pop();
+
+	m_iAreaRoute.clear();
+	m_iBuiltRoute.clear();
+	m_bRefiningRoute = false;
+	m_bRouteFailed = true;
+
+	if (std::find(m_iFailedGoals.begin(), m_iFailedGoals.end(), m_iGoalWaypoint) == m_iFailedGoals.end())
+	{
+		m_iFailedGoals.emplace_back(m_iGoalWaypoint);
+		m_fNextClearFailedGoals = engine->Time() + randomFloat(8.0f,30.0f);
+	}
+}
+
+// follow a route a team mate already found to the same goal
+bool CWaypointNavigator :: useCachedRoute ()
+{
+	// avoiding a path this bot failed on, team mates didn't
+	if ( !bot_route_cache.GetBool() || m_lastFailedPath.bValid )
+		return false;
+
+	WaypointList route;
+	float fDistance;
+
+	if ( !CWaypointRouteCache::getRoute(m_iCurrentWaypoint,m_iGoalWaypoint,m_pBot->getTeam(),m_iSearchConditions,m_iSearchDangerId,&route,&fDistance) )
+		return false;
+
+	if ( !canFollowRoute(route) )
+	{
+		CWaypointRouteCache::routeRejected();
+		return false;
+	}
+
+	CWaypointRouteCache::routeUsed();
+
+	followRoute(route,fDistance);
+
+	return true;
+}
+
+bool CWaypointNavigator :: useFlowField ()
+{
+	// fields are for ordinary routes only
+	if ( !bot_flow_fields.GetBool() || m_lastFailedPath.bValid || m_iSearchDangerId != -1 || (m_iSearchConditions & CONDITION_COVERT) )
+		return false;
+
+	WaypointList route;
+	float fDistance;
+
+	if ( !CWaypointFlowFields::getRoute(m_pBot->getTeam(),m_iCurrentWaypoint,m_iGoalWaypoint,&route,&fDistance) )
+		return false;
+
+	if ( !canFollowRoute(route) )
+		return false;
+
+	followRoute(route,fDistance);
+
+	return true;
+}
+
+// shortest route from the map's contraction hierarchies, if danger doesn't change it much
+bool CWaypointNavigator :: useHierarchy ()
+{
+	if ( !bot_path_ch.GetBool() || m_lastFailedPath.bValid || m_iSearchDangerId != -1 || (m_iSearchConditions & CONDITION_COVERT) )
+		return false;
+
+	WaypointList route;
+	float fDistance;
+
+	if ( !CWaypointHierarchies::getRoute(m_pBot->getTeam(),m_iCurrentWaypoint,m_iGoalWaypoint,&route,&fDistance) )
+		return false;
+
+	// no route costs less than its distance, so if the danger along this
+	// one is small it is close to what the search would find
+	const float fBeliefSensitivity = 1.5f-m_pBot->getProfile()->m_fBraveness;
+	float fDanger = 0.0f;
+
+	for ( const int iWpt : route )
+		fDanger += beliefAt(iWpt)*fBeliefSensitivity;
+
+	if ( fDanger > fDistance*MAX_HIERARCHY_DANGER || !canFollowRoute(route) )
+	{
+		CWaypointHierarchies::routeRejected();
+		return false;
+	}
+
+	followRoute(route,fDistance);
+
+	return true;
+}
+
+// team mates may be able to use paths this bot can't (e.g. rocket jumps)
+// the area graph only knows about team flags, check the bot can stop at each
+// portal. Paths into a portal that opens later need a trace from the waypoint
+// before it, so routes through those are searched in full instead
+bool CWaypointNavigator :: canUseAreaRoute ()
+{
+	for ( const int iWpt : m_iAreaRoute )
+	{
+		if ( iWpt == m_iGoalWaypoint )
+			continue;
+
+		CWaypoint *pWpt = CWaypoints::getWaypoint(iWpt);
+
+		if ( pWpt == nullptr || pWpt->hasFlag(CWaypointTypes::W_FL_OPENS_LATER) ||
+			!m_pBot->canGotoWaypoint(pWpt->getOrigin(),pWpt) )
+		{
+			m_iAreaRoute.clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool CWaypointNavigator :: canFollowRoute ( const WaypointList &route ) const
+{
+	CWaypoint *pPrev = CWaypoints::getWaypoint(m_iCurrentWaypoint);
+
+	for ( const int iWpt : route )
+	{
+		CWaypoint *pWpt = CWaypoints::getWaypoint(iWpt);
+
+		if ( pPrev == nullptr || pWpt == nullptr || 
+			( iWpt != m_iGoalWaypoint && !m_pBot->canGotoWaypoint(pPrev->getOrigin(),pWpt,pPrev) ) )
+			return false;
+
+		pPrev = pWpt;
+	}
+
+	return true;
+}
+
+void CWaypointNavigator :: followRoute ( const WaypointList &route, const float fDistance )
+{
+	while ( !m_oldRoute.empty() )
+		m_oldRoute.pop();
+
+	while ( !m_currentRoute.empty() )
+		m_currentRoute.pop();
+
+	for ( auto it = route.rbegin(); it != route.rend(); ++it )
+	{
+		m_currentRoute.push(*it);
+		m_oldRoute.push(*it);
+	}
+
+	m_iBuiltRoute = route;
+	m_fGoalDistance = fDistance;
+	m_vGoal = CWaypoints::getWaypoint(m_iGoalWaypoint)->getOrigin();
+}
+
+// share the finished route with team mates
+void CWaypointNavigator :: cacheRoute () const
+{
+	// route avoids a path only this bot failed on
+	if ( !bot_route_cache.GetBool() || m_lastFailedPath.bValid )
+		return;
+
+	CWaypointRouteCache::addRoute(m_iRouteStart,m_iGoalWaypoint,m_pBot->getTeam(),m_iSearchConditions,m_iSearchDangerId,m_iBuiltRoute,m_fGoalDistance);
+}
+
+bool CWaypointNavigator :: startReplan ()
+{
+	const bool bMoveFailed = m_bMoveFailed;
+
+	m_bMoveFailed = false;
+
+	if ( !bot_path_replan.GetBool() || !bMoveFailed || !m_lastFailedPath.bValid )
+		return false;
+
+	releaseSearch();
+
+	if ( m_pReplanner == nullptr )
+		m_pReplanner = std::make_unique<CWaypointReplanner>(m_pBot);
+
+	std::vector<float> fNodeCost;
+
+	getNodeCosts(CWaypointGraphSnapshot::current(),&fNodeCost,nullptr);
+
+	// first time blocked on the way to this goal it is a full search
+	if ( m_pReplanner->canRepair(m_iGoalWaypoint,m_iSearchConditions,m_iSearchDangerId) )
+		m_pReplanner->setNodeCosts(fNodeCost);
+	else
+		m_pReplanner->reset(m_iGoalWaypoint,m_iSearchConditions,m_iSearchDangerId,fNodeCost);
+
+	m_pReplanner->blockPath(m_lastFailedPath.iFrom,m_lastFailedPath.iTo);
+	m_pReplanner->setStart(m_iCurrentWaypoint);
+
+	m_iSearchStart = m_iCurrentWaypoint;
+	m_iSearchGoal = m_iGoalWaypoint;
+	m_vSearchGoal = CWaypoints::getWaypoint(m_iGoalWaypoint)->getOrigin();
+
+	m_bReplanning = true;
+
+	return true;
+}
 // if bot has a current position to walk to return the boolean
 bool CWaypointNavigator :: hasNextPoint ()
 {
@@ -1327,6 +1995,11 @@ void CWaypointNavigator :: updatePosition ()
 	if ( !m_bWorkingRoute )
 	{
 		bool bTouched;
+
+		// search the next part of a hierarchical route before running out of this one
+		if ( m_bRefiningRoute && static_cast<int>(m_currentRoute.size()) <= REFINE_ROUTE_AHEAD )
+			refineRoute();
+
 		const bool movetype_ok = CClassInterface::isMoveType(m_pBot->getEdict(),MOVETYPE_LADDER)||CClassInterface::isMoveType(m_pBot->getEdict(),MOVETYPE_FLYGRAVITY);
 
 		//bTouched = false;
@@ -1387,7 +2060,8 @@ void CWaypointNavigator :: updatePosition ()
 			m_bOffsetApplied = false;
 			m_bDangerPoint = false;
 			
-			if ( m_currentRoute.empty() ) // reached goal!!
+			// at the end of a hierarchical segment wait here until the next is ready
+			if ( m_currentRoute.empty() && !m_bRefiningRoute && !m_bRouteFailed ) // reached goal!!
 			{
 				// fix: bots jumping at wrong positions
 				m_pBot->touchedWpt(pWaypoint,-1);
@@ -1400,7 +2074,7 @@ void CWaypointNavigator :: updatePosition ()
 					m_pBot->getSchedule()->isCurrentSchedule(SCHED_GOOD_HIDE_SPOT))
 					m_pBot->reachedCoverSpot(pWaypoint->getFlags());
 			}
-			else
+			else if ( !m_currentRoute.empty() )
 			{
 				const CWaypoint *pPrevWpt = CWaypoints::getWaypoint(m_iCurrentWaypoint);
 				const int iWaypointFlagsPrev = pPrevWpt != nullptr ? pPrevWpt->getFlags() : 0;
@@ -1465,11 +2139,16 @@ void CWaypointNavigator :: clear()
 		m_currentRoute.pop();
 	}
 	m_iFailedGoals.clear();
+
+	m_iAreaRoute.clear();
+	m_bRefiningRoute = false;
+	m_bRouteFailed = false;
+
+	releaseSearch();
 }
 // free up memory
 void CWaypointNavigator :: freeMapMemory ()
 {
-	beliefSave(true);
 	clear();
 }
 
@@ -1744,60 +2423,281 @@ void CWaypoint :: draw ( edict_t *pEdict, const bool bDrawPaths, const unsigned
 
 	}
 
-	/*
-( const Vector &Start, const Vector &End, int nModelIndex, 
-		int nHaloIndex, unsigned char frameStart, unsigned char frameRate,
-		float flLife, unsigned char width, unsigned char endWidth, unsigned char fadeLength, 
-		unsigned char noise, unsigned char red, unsigned char green,
-		unsigned char blue, unsigned char brightness, unsigned char speed) = 0;
-*/
+	/*
+( const Vector &Start, const Vector &End, int nModelIndex, 
+		int nHaloIndex, unsigned char frameStart, unsigned char frameRate,
+		float flLife, unsigned char width, unsigned char endWidth, unsigned char fadeLength, 
+		unsigned char noise, unsigned char red, unsigned char green,
+		unsigned char blue, unsigned char brightness, unsigned char speed) = 0;
+*/
+
+	if (bDrawPaths)
+		drawPaths(pEdict,iDrawType);
+}
+// clear the waypoints possible paths
+void CWaypoint :: clearPaths ()
+{
+	m_thePaths.clear();
+	CWaypoints::graphChanged();
+}
+
+void CWaypoint :: setArea ( const int area )
+{
+	m_iArea = area;
+	CWaypoints::graphChanged();
+}
+
+void CWaypoint :: addFlag ( const int iFlag )
+{
+	m_iFlags |= iFlag;
+	CWaypoints::graphChanged();
+}
+
+void CWaypoint :: removeFlag ( const int iFlag )
+{
+	m_iFlags &= ~iFlag;
+	CWaypoints::graphChanged();
+}
+
+void CWaypoint :: removeFlags ()
+{
+	m_iFlags = 0;
+	CWaypoints::graphChanged();
+}
+
+void CWaypoint :: move ( const Vector& origin )
+{
+	const int iIndex = CWaypoints::getWaypointIndex(this);
+	const float fOldOrigin[3] = { m_vOrigin.x, m_vOrigin.y, m_vOrigin.z };
+	const float fNewOrigin[3] = { origin.x, origin.y, origin.z };
+
+	// locations keep the origin too
+	CWaypointLocations::DeleteWptLocation(iIndex,fOldOrigin);
+
+	// move to new origin
+	m_vOrigin = origin;
+	CWaypoints::graphChanged();
+
+	CWaypointLocations::AddWptLocation(iIndex,fNewOrigin);
+}
+// get the distance from this waypoint from vector position vOrigin
+float CWaypoint :: distanceFrom (const Vector& vOrigin) const
+{
+	return (m_vOrigin - vOrigin).Length();
+}
+///////////////////////////////////////////////////
+void CWaypoints :: updateWaypointPairs (std::vector<edict_wpt_pair_t>* pPairs, const int iWptFlag, const char* szClassname)
+{
+	const int iSize = numWaypoints();
+	edict_wpt_pair_t pair;
+	CTraceFilterWorldAndPropsOnly filter;
+
+	const trace_t* trace_result = CBotGlobals::getTraceResult();
+
+	for ( int i = 0; i < iSize; i ++ )
+	{
+		CWaypoint* pWpt = waypointSlot(i);
+
+		if ( pWpt->isUsed() && pWpt->hasFlag(iWptFlag) )
+		{
+			pair.pWaypoint = pWpt;
+			pair.pEdict = CClassInterface::FindEntityByClassnameNearest(pWpt->getOrigin(),szClassname,300.0f);
+
+			if ( pair.pEdict != nullptr)
+			{
+				Vector vOrigin = CBotGlobals::entityOrigin(pair.pEdict);
+
+				CBotGlobals::traceLine(vOrigin,vOrigin-Vector(0,0,CWaypointLocations::REACHABLE_RANGE),MASK_SOLID_BRUSHONLY,&filter);
+				// updates trace_result
+
+				pair.v_ground = trace_result->endpos + Vector(0,0,48.0f);
+
+				pPairs->emplace_back(pair);
+			}
+		}
+	}
+}
+/////////////////////////////////////////////////////////////////////////////////////
+// version 6 waypoint block, each array follows the last :
+// origins (x y z), aim yaws, flags, areas, radii, path starts (one more than
+// the number of waypoints, paths of waypoint i are [start i, start i+1)),
+// path targets and the used flags last as they are bytes
+typedef struct
+{
+	float *pOrigins;
+	int *pAimYaws;
+	int *pFlags;
+	int *pAreas;
+	float *pRadii;
+	int *pPathStarts;
+	int *pPaths;
+	unsigned char *pUsed;
+}wpt_data_arrays_t;
+
+// size of the block, and where each array is if pData is not NULL
+static std::size_t mapWaypointData ( unsigned char *pData, const int iNumWaypoints, const int iNumPaths, wpt_data_arrays_t *pArrays )
+{
+	const std::size_t iWaypoints = static_cast<std::size_t>(iNumWaypoints);
+	std::size_t iOffset = 0;
+
+	const auto place = [pData, &iOffset](const std::size_t iBytes)
+	{
+		unsigned char *pArray = pData == nullptr ? nullptr : pData + iOffset;
+
+		iOffset += iBytes;
+
+		return pArray;
+	};
+
+	pArrays->pOrigins = reinterpret_cast<float*>(place(iWaypoints * 3 * sizeof(float)));
+	pArrays->pAimYaws = reinterpret_cast<int*>(place(iWaypoints * sizeof(int)));
+	pArrays->pFlags = reinterpret_cast<int*>(place(iWaypoints * sizeof(int)));
+	pArrays->pAreas = reinterpret_cast<int*>(place(iWaypoints * sizeof(int)));
+	pArrays->pRadii = reinterpret_cast<float*>(place(iWaypoints * sizeof(float)));
+	pArrays->pPathStarts = reinterpret_cast<int*>(place((iWaypoints + 1) * sizeof(int)));
+	pArrays->pPaths = reinterpret_cast<int*>(place(static_cast<std::size_t>(iNumPaths) * sizeof(int)));
+	pArrays->pUsed = place(iWaypoints);
+
+	return iOffset;
+}
+
+static unsigned int waypointDataChecksum ( const unsigned char *pData, const std::size_t iSize )
+{
+	// FNV-1a
+	unsigned int iHash = 2166136261u;
+
+	for ( std::size_t i = 0; i < iSize; i ++ )
+	{
+		iHash ^= pData[i];
+		iHash *= 16777619u;
+	}
+
+	return iHash;
+}
+
+void CWaypoints :: saveWaypointData ( std::fstream &bfp, const int iNumWaypoints )
+{
+	CWaypointDataHeader dataHeader;
+	wpt_data_arrays_t arrays;
+
+	dataHeader.iNumPaths = 0;
+
+	for (int i = 0; i < iNumWaypoints; i++)
+		dataHeader.iNumPaths += waypointSlot(i)->numPaths();
+
+	std::vector<unsigned char> data(mapWaypointData(nullptr, iNumWaypoints, dataHeader.iNumPaths, &arrays));
+
+	mapWaypointData(data.data(), iNumWaypoints, dataHeader.iNumPaths, &arrays);
+
+	int iPath = 0;
+
+	for (int i = 0; i < iNumWaypoints; i++)
+	{
+		CWaypoint *pWpt = waypointSlot(i);
+		const Vector vOrigin = pWpt->getOrigin();
+
+		arrays.pOrigins[i * 3] = vOrigin.x;
+		arrays.pOrigins[i * 3 + 1] = vOrigin.y;
+		arrays.pOrigins[i * 3 + 2] = vOrigin.z;
+		arrays.pAimYaws[i] = static_cast<int>(pWpt->getAimYaw());
+		arrays.pFlags[i] = pWpt->getFlags();
+		arrays.pAreas[i] = pWpt->getArea();
+		arrays.pRadii[i] = pWpt->getRadius();
+		arrays.pUsed[i] = pWpt->isUsed() ? 1 : 0;
+		arrays.pPathStarts[i] = iPath;
+
+		for (const int iTo : *pWpt)
+			arrays.pPaths[iPath++] = iTo;
+	}
+
+	arrays.pPathStarts[iNumWaypoints] = iPath;
+
+	dataHeader.iDataSize = static_cast<int>(data.size());
+	dataHeader.iChecksum = waypointDataChecksum(data.data(), data.size());
+
+	bfp.write(reinterpret_cast<char*>(&dataHeader), sizeof(CWaypointDataHeader));
+	bfp.write(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+}
+
+bool CWaypoints :: loadWaypointData ( std::fstream &bfp, const int iNumWaypoints )
+{
+	CWaypointDataHeader dataHeader;
+	wpt_data_arrays_t arrays;
+
+	bfp.read(reinterpret_cast<char*>(&dataHeader), sizeof(CWaypointDataHeader));
+
+	// paths are bounded by the block size so its expected size can't overflow
+	if (!bfp || dataHeader.iDataSize < 0 || dataHeader.iNumPaths < 0 ||
+		dataHeader.iNumPaths > dataHeader.iDataSize / static_cast<int>(sizeof(int)) ||
+		static_cast<std::size_t>(dataHeader.iDataSize) != mapWaypointData(nullptr, iNumWaypoints, dataHeader.iNumPaths, &arrays))
+	{
+		logger->Log(LogLevel::ERROR, "Error loading waypoints: Bad waypoint block header");
+		return false;
+	}
+
+	// the whole block in one read
+	std::vector<unsigned char> data(static_cast<std::size_t>(dataHeader.iDataSize));
+
+	bfp.read(reinterpret_cast<char*>(data.data()), dataHeader.iDataSize);
+
+	if (bfp.gcount() != dataHeader.iDataSize)
+	{
+		logger->Log(LogLevel::ERROR, "Error loading waypoints: File is truncated");
+		return false;
+	}
+
+	if (waypointDataChecksum(data.data(), data.size()) != dataHeader.iChecksum)
+	{
+		logger->Log(LogLevel::ERROR, "Error loading waypoints: Checksum mismatch");
+		return false;
+	}
 
-	if (bDrawPaths)
-		drawPaths(pEdict,iDrawType);
-}
-// clear the waypoints possible paths
-void CWaypoint :: clearPaths ()
-{
-	m_thePaths.clear();
-}
-// get the distance from this waypoint from vector position vOrigin
-float CWaypoint :: distanceFrom (const Vector& vOrigin) const
-{
-	return (m_vOrigin - vOrigin).Length();
-}
-///////////////////////////////////////////////////
-void CWaypoints :: updateWaypointPairs (std::vector<edict_wpt_pair_t>* pPairs, const int iWptFlag, const char* szClassname)
-{
-	const int iSize = numWaypoints();
-	edict_wpt_pair_t pair;
-	CTraceFilterWorldAndPropsOnly filter;
+	mapWaypointData(data.data(), iNumWaypoints, dataHeader.iNumPaths, &arrays);
 
-	CWaypoint* pWpt = m_theWaypoints;
-	const trace_t* trace_result = CBotGlobals::getTraceResult();
+	// check the paths before anything uses them
+	if (arrays.pPathStarts[0] != 0 || arrays.pPathStarts[iNumWaypoints] != dataHeader.iNumPaths)
+	{
+		logger->Log(LogLevel::ERROR, "Error loading waypoints: Bad path list");
+		return false;
+	}
 
-	for ( int i = 0; i < iSize; i ++ )
+	for (int i = 0; i < iNumWaypoints; i++)
 	{
-		if ( pWpt->isUsed() && pWpt->hasFlag(iWptFlag) )
+		if (arrays.pPathStarts[i + 1] < arrays.pPathStarts[i])
 		{
-			pair.pWaypoint = pWpt;
-			pair.pEdict = CClassInterface::FindEntityByClassnameNearest(pWpt->getOrigin(),szClassname,300.0f);
+			logger->Log(LogLevel::ERROR, "Error loading waypoints: Bad path list");
+			return false;
+		}
 
-			if ( pair.pEdict != nullptr)
+		for (int j = arrays.pPathStarts[i]; j < arrays.pPathStarts[i + 1]; j++)
+		{
+			if (arrays.pPaths[j] < 0 || arrays.pPaths[j] >= iNumWaypoints || arrays.pPaths[j] == i)
 			{
-				Vector vOrigin = CBotGlobals::entityOrigin(pair.pEdict);
-
-				CBotGlobals::traceLine(vOrigin,vOrigin-Vector(0,0,CWaypointLocations::REACHABLE_RANGE),MASK_SOLID_BRUSHONLY,&filter);
-				// updates trace_result
-
-				pair.v_ground = trace_result->endpos + Vector(0,0,48.0f);
-
-				pPairs->emplace_back(pair);
+				logger->Log(LogLevel::ERROR, "Error loading waypoints: Bad path from waypoint %d", i);
+				return false;
 			}
 		}
+	}
+
+	for (int i = 0; i < iNumWaypoints; i++)
+	{
+		const int iStart = arrays.pPathStarts[i];
+
+		waypointSlot(i)->load(Vector(arrays.pOrigins[i * 3], arrays.pOrigins[i * 3 + 1], arrays.pOrigins[i * 3 + 2]),
+			arrays.pAimYaws[i], arrays.pFlags[i], arrays.pAreas[i], arrays.pRadii[i], arrays.pUsed[i] != 0,
+			arrays.pPaths + iStart, arrays.pPathStarts[i + 1] - iStart);
+	}
 
-		pWpt++;
+	// paths to each waypoint, in the order addPathTo would have made them
+	for (int i = 0; i < iNumWaypoints; i++)
+	{
+		for (int j = arrays.pPathStarts[i]; j < arrays.pPathStarts[i + 1]; j++)
+			waypointSlot(arrays.pPaths[j])->addPathFrom(i);
 	}
+
+	return true;
 }
+
 /////////////////////////////////////////////////////////////////////////////////////
 // save waypoints (visibilitymade saves having to work out visibility again)
 // pPlayer is the person who called the command to save, NULL if automatic
@@ -1879,13 +2779,8 @@ bool CWaypoints :: save (const bool bVisiblityMade, const edict_t* pPlayer, cons
 	bfp.write(reinterpret_cast<char*>(&header), sizeof(CWaypointHeader));
 	bfp.write(reinterpret_cast<char*>(&authorinfo), sizeof(CWaypointAuthorInfo));
 
-	for (int i = 0; i < iSize; i++)
-	{
-		CWaypoint *pWpt = &m_theWaypoints[i];
-
-		// save individual waypoint and paths
-		pWpt->save(bfp);
-	}
+	// waypoints and paths
+	saveWaypointData(bfp, iSize);
 
 	bfp.close();
 
@@ -1970,10 +2865,16 @@ bool CWaypoints :: load (const char *szMapName)
 
 	const int iSize = header.iNumWaypoints;
 
+	if (iSize < 0 || iSize > MAX_WAYPOINTS)
+	{
+		logger->Log(LogLevel::ERROR, "Error loading waypoints: %d waypoints, the limit is %d", iSize, static_cast<int>(MAX_WAYPOINTS));
+		return false;
+	}
+
 	// ok lets read the waypoints
-	// initialize
+	// initialize, with room for this map's waypoints
 	
-	CWaypoints::init(authorinfo.szAuthor,authorinfo.szModifiedBy);
+	CWaypoints::init(authorinfo.szAuthor,authorinfo.szModifiedBy,iSize);
 
 	m_iNumWaypoints = iSize;
 
@@ -1983,11 +2884,24 @@ bool CWaypoints :: load (const char *szMapName)
 	if (szMapName == nullptr && header.iFlags & W_FILE_FL_VISIBILITY)
 		bWorkVisibility = !m_pVisibilityTable->ReadFromFile(iSize);
 
-	for (int i = 0; i < iSize; i++)
+	if (header.iVersion >= 6)
+	{
+		if (!loadWaypointData(bfp, iSize))
+		{
+			bfp.close();
+			CWaypoints::init();
+			return false;
+		}
+	}
+	else
 	{
-		CWaypoint *pWpt = &m_theWaypoints[i];		
+		for (int i = 0; i < iSize; i++)
+			waypointSlot(i)->load(bfp, header.iVersion);
+	}
 
-		pWpt->load(bfp, header.iVersion);
+	for (int i = 0; i < iSize; i++)
+	{
+		CWaypoint *pWpt = waypointSlot(i);
 
 		if (pWpt->isUsed()) // not a deleted waypoint
 		{
@@ -2007,6 +2921,17 @@ bool CWaypoints :: load (const char *szMapName)
 	if (szMapName == nullptr)
 		CWaypointDistances::load();
 
+	graphChanged();
+
+	// build the search snapshot now rather than on the first route
+	CWaypointGraphSnapshot::get();
+
+	if (szMapName == nullptr)
+	{
+		CWaypointLandmarks::load();
+		CWaypointHierarchies::load();
+	}
+
 	// script coupled to waypoints too
 	//CPoints::loadMapScript();
 
@@ -2031,35 +2956,6 @@ void CWaypoint :: init ()
 	m_fCheckReachableTime = 0.0f;
 }
 
-void CWaypoint :: save (std::fstream &bfp)
-{
-	bfp.write(reinterpret_cast<char*>(&m_vOrigin), sizeof(Vector));
-	// aim of vector (used with certain waypoint types)
-	bfp.write(reinterpret_cast<char*>(&m_iAimYaw), sizeof(int));
-	bfp.write(reinterpret_cast<char*>(&m_iFlags), sizeof(int));
-	// not deleted
-	bfp.write(reinterpret_cast<char*>(&m_bUsed), sizeof(bool));
-
-	int iPaths = numPaths();
-	bfp.write(reinterpret_cast<char*>(&iPaths), sizeof(int));
-
-	for (int n = 0; n < iPaths; n++)
-	{			
-		int iPath = getPath(n);
-		bfp.write(reinterpret_cast<char*>(&iPath), sizeof(int));
-	}
-
-	if (CWaypoints::WAYPOINT_VERSION >= 2)
-	{
-		bfp.write(reinterpret_cast<char*>(&m_iArea), sizeof(int));
-	}
-
-	if (CWaypoints::WAYPOINT_VERSION >= 3) 
-	{
-		bfp.write(reinterpret_cast<char*>(&m_fRadius), sizeof(float));
-	}
-}
-
 void CWaypoint :: load (std::fstream &bfp, const int iVersion )
 {
 	int iPaths;
@@ -2090,10 +2986,26 @@ void CWaypoint :: load (std::fstream &bfp, const int iVersion )
 	}
 }
 
+void CWaypoint :: load ( const Vector &vOrigin, const int iAimYaw, const int iFlags, const int iArea, const float fRadius, const bool bUsed, const int *pPaths, const int iNumPaths )
+{
+	m_vOrigin = vOrigin;
+	m_iAimYaw = iAimYaw;
+	m_iFlags = iFlags;
+	m_iArea = iArea;
+	m_fRadius = fRadius;
+	m_bUsed = bUsed;
+	m_thePaths.assign(pPaths, pPaths + iNumPaths);
+}
+
 bool CWaypoint :: checkGround ()
 {
-	if (m_fNextCheckGroundTime < engine->Time())
+	// every bot shares the last answer, which is kept a while longer when
+	// tracelines are short this frame
+	if (m_fNextCheckGroundTime < engine->Time() &&
+		CTraceBudget::request(CTraceBudget::TRACE_GROUND,m_fNextCheckGroundTime + CTraceBudget::GROUND_DEADLINE))
 	{
+		CTraceCategory traceCategory(CTraceBudget::TRACE_GROUND);
+
 		CBotGlobals::quickTraceline(nullptr,m_vOrigin,m_vOrigin-Vector(0,0,80.0f));
 		m_bHasGround = CBotGlobals::getTraceResult()->fraction < 1.0f;
 		m_fNextCheckGroundTime = engine->Time() + 1.0f;
@@ -2127,7 +3039,7 @@ void CWaypoints :: drawWaypoints( CClient *pClient )
 	}
 }
 
-void CWaypoints :: init (const char *pszAuthor, const char *pszModifiedBy)
+void CWaypoints :: init (const char *pszAuthor, const char *pszModifiedBy, const int iNumWaypoints)
 {
 	if (pszAuthor != nullptr)
 	{
@@ -2148,14 +3060,66 @@ void CWaypoints :: init (const char *pszAuthor, const char *pszModifiedBy)
 	m_iNumWaypoints = 0;
 	m_fNextDrawWaypoints = 0;
 
-	for (CWaypoint& m_theWaypoint : m_theWaypoints)
-		m_theWaypoint.init();
+	setMaxWaypoints(capacityFor(iNumWaypoints));
 
-	Q_memset(m_theWaypoints, 0, sizeof(CWaypoint) * MAX_WAYPOINTS);
+	for (std::size_t iBlock = 0; iBlock < m_WaypointBlocks.size(); iBlock++)
+	{
+		const std::unique_ptr<CWaypoint[]>& block = m_WaypointBlocks[iBlock];
+
+		for (int i = 0; i < WAYPOINT_BLOCK_SIZE; i++)
+		{
+			block[i] = CWaypoint();
+			block[i].setUsed(false);
+			block[i].m_iIndex = static_cast<int>(iBlock) * WAYPOINT_BLOCK_SIZE + i;
+		}
+	}
 
 	CWaypointLocations::Init();
 	CWaypointDistances::reset();
 	m_pVisibilityTable->ClearVisibilityTable();
+
+	graphChanged();
+}
+
+int CWaypoints :: capacityFor (const int iNumWaypoints)
+{
+	int iCapacity = MIN_WAYPOINTS;
+
+	while (iCapacity < iNumWaypoints + SPARE_WAYPOINTS && iCapacity < MAX_WAYPOINTS)
+		iCapacity *= 2;
+
+	return iCapacity;
+}
+
+void CWaypoints :: setMaxWaypoints (const int iMaxWaypoints)
+{
+	if (iMaxWaypoints == m_iMaxWaypoints)
+		return;
+
+	// blocks are only added : tasks and bots may still point at waypoints in them
+	while (static_cast<int>(m_WaypointBlocks.size()) * WAYPOINT_BLOCK_SIZE < iMaxWaypoints)
+	{
+		std::unique_ptr<CWaypoint[]> block(new CWaypoint[WAYPOINT_BLOCK_SIZE]);
+		const int iFirst = static_cast<int>(m_WaypointBlocks.size()) * WAYPOINT_BLOCK_SIZE;
+
+		for (int i = 0; i < WAYPOINT_BLOCK_SIZE; i++)
+		{
+			block[i].setUsed(false);
+			block[i].m_iIndex = iFirst + i;
+		}
+
+		m_WaypointBlocks.emplace_back(std::move(block));
+	}
+
+	m_iMaxWaypoints = iMaxWaypoints;
+
+	CWaypointLocations::ResizeFailedWaypoints(iMaxWaypoints);
+	CWaypointDistances::resize(iMaxWaypoints);
+
+	if (m_pVisibilityTable != nullptr)
+		m_pVisibilityTable->ResizeVisibilityTable(iMaxWaypoints);
+
+	CTeamBelief::resize(iMaxWaypoints);
 }
 
 void CWaypoints :: setupVisibility ()
@@ -2173,6 +3137,10 @@ void CWaypoints :: freeMemory ()
 		delete m_pVisibilityTable;
 	}
 	m_pVisibilityTable = nullptr;
+
+	m_WaypointBlocks.clear();
+	m_iMaxWaypoints = 0;
+	m_iNumWaypoints = 0;
 }
 
 void CWaypoints :: precacheWaypointTexture ()
@@ -2198,23 +3166,24 @@ CWaypoint *CWaypoints :: getNestWaypoint ( int iTeam, int iArea, bool bForceArea
 void CWaypoints :: deleteWaypoint (const int iIndex)
 {
 	// mark as not used
-	m_theWaypoints[iIndex].setUsed(false);
+	waypointSlot(iIndex)->setUsed(false);
+	graphChanged();
 	// clearPaths() only empties this waypoint's outgoing list; without
 	// notifying the destinations first, their m_PathsTo still references
 	// iIndex and the incoming-beam visualisation (and checkReachable())
 	// would see a stale entry. Notify peers, then clear.
 	{
-		const CWaypoint* pWpt = &m_theWaypoints[iIndex];
+		const CWaypoint* pWpt = waypointSlot(iIndex);
 		for (const int iDest : *pWpt)
 		{
 			if (CWaypoint* pOther = getWaypoint(iDest))
 				pOther->removePathFrom(iIndex);
 		}
 	}
-	m_theWaypoints[iIndex].clearPaths();
+	waypointSlot(iIndex)->clearPaths();
 
 	// remove from waypoint locations
-	const Vector vOrigin = m_theWaypoints[iIndex].getOrigin();
+	const Vector vOrigin = waypointSlot(iIndex)->getOrigin();
 	const float fOrigin[3] = { vOrigin.x, vOrigin.y, vOrigin.z };
 	CWaypointLocations::DeleteWptLocation(iIndex,fOrigin);
 
@@ -2226,7 +3195,7 @@ void CWaypoints :: shiftVisibleAreas ( edict_t *pPlayer, const int from, const i
 {
 	for (int i = 0; i < m_iNumWaypoints; i++)
 	{
-		CWaypoint *pWpt = &m_theWaypoints[i];
+		CWaypoint *pWpt = waypointSlot(i);
 
 		if (!pWpt->isUsed())
 			continue;
@@ -2245,7 +3214,7 @@ void CWaypoints :: shiftAreas (const int val)
 {
 	for (int i = 0; i < m_iNumWaypoints; i++)
 	{
-		CWaypoint *pWpt = &m_theWaypoints[i];
+		CWaypoint *pWpt = waypointSlot(i);
 
 		if (pWpt->getFlags() > 0)
 		{
@@ -2256,42 +3225,39 @@ void CWaypoints :: shiftAreas (const int val)
 
 int CWaypoints::getClosestFlagged(const int iFlags, const Vector& vOrigin, const int iTeam, float* fReturnDist, const unsigned char* failedwpts)
 {
-	const int iSize = numWaypoints();
-
 	float fDist = 8192.0f;
-	float distance;
 	int iwpt = -1;
 	const int iFrom = CWaypointLocations::NearestWaypoint(vOrigin, fDist, -1, true, false, true, nullptr, false, iTeam);
 
 	CBotMod* pCurrentMod = CBotGlobals::getCurrentMod();
-	for (int i = 0; i < static_cast<int>(iSize); i++)
-	{
-		CWaypoint* pWpt = &m_theWaypoints[i];
-		if (i == static_cast<int>(iFrom))
-			continue;
-		if (failedwpts[i] == 1)
-			continue;
-		if (pWpt->isUsed() && pWpt->forTeam(iTeam))
-		{
-			if (pWpt->hasFlag(iFlags))
-			{
-				// BUG FIX for DOD:S 
-				if (!pCurrentMod->isWaypointAreaValid(pWpt->getArea(), iFlags))
-					continue;
+	const CWaypointGraphSnapshot *pGraph = CWaypointGraphSnapshot::current();
 
-				if (iFrom == -1)
-					distance = (pWpt->getOrigin() - vOrigin).Length();
-				else
-					distance = CWaypointDistances::getDistance(iFrom, i);
+	// only used waypoints with every flag wanted
+	pGraph->forEachWithFlags(iFlags, [&](const int i)
+	{
+		if (i == iFrom)
+			return;
+		if (failedwpts != nullptr && failedwpts[i] == 1)
+			return;
+		// BUG FIX for DOD:S 
+		if (!pCurrentMod->isWaypointAreaValid(pGraph->getArea(i), iFlags))
+			return;
+		if (!waypointSlot(i)->forTeam(iTeam))
+			return;
+
+		float distance;
+
+		if (iFrom == -1)
+			distance = (pGraph->getOrigin(i) - vOrigin).Length();
+		else
+			distance = CWaypointDistances::getDistance(iFrom, i);
 
-				if (distance < fDist)
-				{
-					fDist = distance;
-					iwpt = i;
-				}
-			}
+		if (distance < fDist)
+		{
+			fDist = distance;
+			iwpt = i;
 		}
-	}
+	});
 
 	if (fReturnDist)
 		*fReturnDist = fDist;
@@ -2335,7 +3301,7 @@ void CWaypoints :: deletePathsTo (const int iWpt)
 	short int iNumWaypoints = (short int)numWaypoints();
 
 	for ( short int i = 0; i < iNumWaypoints; i ++ )
-		m_theWaypoints[i].removePathTo(iWpt);*/
+		waypointSlot(i)->removePathTo(iWpt);*/
 }
 
 // Fixed; 23/01
@@ -2344,7 +3310,7 @@ void CWaypoints :: deletePathsFrom (const int iWpt)
 	// notify each destination so its m_PathsTo loses the back-reference
 	// to iWpt, otherwise yellow incoming-path beams (and checkReachable())
 	// would still see iWpt as a source after clearPaths()
-	CWaypoint* pWpt = &m_theWaypoints[iWpt];
+	CWaypoint* pWpt = waypointSlot(iWpt);
 	for (const int iDest : *pWpt)
 	{
 		if (CWaypoint* pOther = getWaypoint(iDest))
@@ -2497,13 +3463,16 @@ int CWaypoints :: addWaypoint (edict_t *pPlayer, const Vector& vOrigin, const in
 		fRadius = rcbot_wpt_autoradius.GetFloat();
 
 	///////////////////////////////////////////////////
-	m_theWaypoints[iIndex] = CWaypoint(vOrigin,iFlags);	
-	m_theWaypoints[iIndex].setAim(iYaw);
-	m_theWaypoints[iIndex].setArea(iArea);
-	m_theWaypoints[iIndex].setRadius(fRadius);
+	*waypointSlot(iIndex) = CWaypoint(vOrigin,iFlags);	
+	waypointSlot(iIndex)->m_iIndex = iIndex;
+	waypointSlot(iIndex)->setAim(iYaw);
+	waypointSlot(iIndex)->setArea(iArea);
+	waypointSlot(iIndex)->setRadius(fRadius);
 	// increase max waypoints used
 	if (iIndex == m_iNumWaypoints)
 		m_iNumWaypoints++;	
+
+	graphChanged();
 	///////////////////////////////////////////////////
 
 	const float fOrigin[3] = {vOrigin.x,vOrigin.y,vOrigin.z};
@@ -2522,7 +3491,10 @@ int CWaypoints :: addWaypoint (edict_t *pPlayer, const Vector& vOrigin, const in
 void CWaypoints :: removeWaypoint (const int iIndex)
 {
 	if (iIndex >= 0)
-		m_theWaypoints[iIndex].setUsed(false);
+	{
+		waypointSlot(iIndex)->setUsed(false);
+		graphChanged();
+	}
 }
 
 int CWaypoints::numWaypoints()
@@ -2544,35 +3516,27 @@ int CWaypoints::nearestWaypointGoal(const int iFlags, const Vector& origin, floa
 	VPROF_BUDGET("CWaypoints::nearestWaypointGoal", "RCBot2")
 #endif // RCBOT_VPROF_ENABLED
 
-	static int size;
-
-	float distance;
 	int iWpt = -1;
 
-	size = numWaypoints();
-
 	CBotMod *pCurrentMod = CBotGlobals::getCurrentMod();
 
-	for ( int i = 0; i < size; i ++ )
+	const CWaypointGraphSnapshot *pGraph = CWaypointGraphSnapshot::current();
+
+	// only used waypoints with every flag wanted, all of them if iFlags is -1
+	pGraph->forEachWithFlags(iFlags == -1 ? 0 : iFlags, [&](const int i)
 	{
-		CWaypoint* pWpt = &m_theWaypoints[i];
+		float distance;
+
+		// FIX DODS bug
+		if (!pCurrentMod->isWaypointAreaValid(pGraph->getArea(i), iFlags)) // CTeamFortress2Mod::m_ObjectiveResource.isWaypointAreaValid(pWpt->getArea()))
+			return;
 
-		if ( pWpt->isUsed() && pWpt->forTeam(iTeam) )
+		if ( (distance = (pGraph->getOrigin(i) - origin).Length()) < fDist && waypointSlot(i)->forTeam(iTeam) )
 		{
-			if ( iFlags == -1 || pWpt->hasFlag(iFlags) )
-			{
-				// FIX DODS bug
-				if (pCurrentMod->isWaypointAreaValid(pWpt->getArea(), iFlags)) // CTeamFortress2Mod::m_ObjectiveResource.isWaypointAreaValid(pWpt->getArea()))
-				{
-					if ( (distance = pWpt->distanceFrom(origin)) < fDist)
-					{
-						fDist = distance;
-						iWpt = i;
-					}
-				}
-			}
+			fDist = distance;
+			iWpt = i;
 		}
-	}
+	});
 
 	return iWpt;
 }
@@ -2590,7 +3554,7 @@ CWaypoint *CWaypoints :: randomRouteWaypoint (const CBot *pBot, const Vector& vO
 
 	for ( int i = 0; i < size; i ++ )
 	{
-		CWaypoint *pWpt = &m_theWaypoints[i];
+		CWaypoint *pWpt = waypointSlot(i);
 
 		if ( pWpt->isUsed() && pWpt->forTeam(iTeam) )// && (pWpt->getArea() == iArea) )
 		{
@@ -2654,21 +3618,22 @@ CWaypoint *CWaypoints::getNextCoverPoint ( CBot *pBot, CWaypoint *pCurrent, CWay
 	float fMaxDist = 0.0f;
 	float fDist = 0.0f;
 
-	for ( int i = 0; i < pCurrent->numPaths(); i ++ )
+	const CWaypointGraphSnapshot *pGraph = CWaypointGraphSnapshot::current();
+	const int iCurrent = getWaypointIndex(pCurrent);
+	const Vector vBlocking = pBlocking->getOrigin();
+
+	for ( int iPath = pGraph->getPathsBegin(iCurrent); iPath < pGraph->getPathsEnd(iCurrent); iPath ++ )
 	{
-		const int iNext = pCurrent->getPath(i);
+		const int iNext = pGraph->getPathTarget(iPath);
 		CWaypoint* pNext = CWaypoints::getWaypoint(iNext);
 
-		if ( pNext == nullptr )
-			continue;
-
 		if ( pNext == pBlocking )
 			continue;
 
-		if ( !pBot->canGotoWaypoint(pCurrent->getOrigin(),pNext,pCurrent) )
+		if ( !pBot->canGotoWaypoint(pGraph->getOrigin(iCurrent),pNext,pCurrent) )
 			continue;
 
-		if ( iMaxDist == -1 || (fDist=pNext->distanceFrom(pBlocking->getOrigin())) > fMaxDist )
+		if ( iMaxDist == -1 || (fDist=(pGraph->getOrigin(iNext) - vBlocking).Length()) > fMaxDist )
 		{
 			fMaxDist = fDist;
 			iMaxDist = iNext;
@@ -2696,54 +3661,61 @@ CWaypoint *CWaypoints :: nearestPipeWaypoint (const Vector& vTarget, const Vecto
 		return nullptr;
 
 	const CWaypointVisibilityTable *pTable = CWaypoints::getVisiblity();
+	const std::uint64_t *pTargetRow = pTable->GetRow(iTarget);
 
-	const short numwaypoints = static_cast<short>(numWaypoints());
+	if ( pTargetRow == nullptr )
+		return nullptr;
+
+	const int numwaypoints = numWaypoints();
+	const int iRowWords = pTable->GetRowWords();
+
+	// waypoints i can see that the target can't
+	std::vector<std::uint64_t> hidden(static_cast<std::size_t>(iRowWords));
 
 	float finearestdist = 9999.0f;
 	float fjnearestdist = 9999.0f;
-	float fidist;
-	float fjdist;
 
-	for (short int i = 0; i < numwaypoints; i ++ )
+	// i : waypoints the target can see
+	CWaypointVisibilityTable::ForEachBit(pTargetRow, numwaypoints, [&](const int i)
 	{
 		if ( iTarget == i )
-			continue;
+			return;
 
-		CWaypoint* pTempi = CWaypoints::getWaypoint(i);
+		const CWaypoint* pTempi = CWaypoints::getWaypoint(i);
 
 		if ( pTempi == nullptr )
-			continue;
+			return;
 
-		if ( (fidist=pTarget->distanceFrom(pTempi->getOrigin())) > finearestdist )
-			continue;
+		const float fidist = pTarget->distanceFrom(pTempi->getOrigin());
+
+		if ( fidist > finearestdist )
+			return;
+
+		std::copy_n(pTable->GetRow(i), iRowWords, hidden.begin());
+		CWaypointVisibilityTable::AndNotRow(hidden.data(), pTargetRow, iRowWords);
 
-		if ( pTable->GetVisibilityFromTo(iTarget,i) )
+		// j : waypoints i can see that the target can't
+		CWaypointVisibilityTable::ForEachBit(hidden.data(), numwaypoints, [&](const int j)
 		{
-			for (short int j = 0; j < numwaypoints; j ++ )
-			{
-				if ( j == i )
-					continue;
-				if ( j == iTarget )
-					continue;
+			if ( j == i || j == iTarget )
+				return;
 
-				const CWaypoint* pTempj = CWaypoints::getWaypoint(j);
+			const CWaypoint* pTempj = CWaypoints::getWaypoint(j);
 
-				if ( pTempj == nullptr )
-					continue;
+			if ( pTempj == nullptr )
+				return;
 
-				if ( (fjdist=pTempj->distanceFrom(vOrigin)) > fjnearestdist )
-					continue;
+			const float fjdist = pTempj->distanceFrom(vOrigin);
 
-				if ( pTable->GetVisibilityFromTo(i,j) && !pTable->GetVisibilityFromTo(iTarget,j) )
-				{					
-					finearestdist = fidist;
-					fjnearestdist = fjdist;
-					inearest = j;
-					*iAiming = i;
-				}
-			}
-		}
-	}
+			if ( fjdist > fjnearestdist )
+				return;
+
+			finearestdist = fidist;
+			fjnearestdist = fjdist;
+			inearest = j;
+			*iAiming = i;
+		});
+	});
 
 	return CWaypoints::getWaypoint(inearest);
 
@@ -2760,19 +3732,19 @@ void CWaypoints :: autoFix (const bool bAutoFixNonArea)
 
 	for ( int i = 0; i < numWaypoints(); i ++ )
 	{
-		if ( m_theWaypoints[i].isUsed() && m_theWaypoints[i].getFlags() > 0 )
+		if ( waypointSlot(i)->isUsed() && waypointSlot(i)->getFlags() > 0 )
 		{
-			if (m_theWaypoints[i].getArea() > iNumCps ||
+			if (waypointSlot(i)->getArea() > iNumCps ||
 				(bAutoFixNonArea &&
-					m_theWaypoints[i].getArea() == 0 &&
-					m_theWaypoints[i].hasSomeFlags(CWaypointTypes::W_FL_SENTRY |
+					waypointSlot(i)->getArea() == 0 &&
+					waypointSlot(i)->hasSomeFlags(CWaypointTypes::W_FL_SENTRY |
 						CWaypointTypes::W_FL_DEFEND |
 						CWaypointTypes::W_FL_SNIPER |
 						CWaypointTypes::W_FL_CAPPOINT |
 						CWaypointTypes::W_FL_TELE_EXIT)))
 			{
-				m_theWaypoints[i].setArea(CTeamFortress2Mod::m_ObjectiveResource.NearestArea(m_theWaypoints[i].getOrigin()));
-				CBotGlobals::botMessage(nullptr,0,"Changed Waypoint id %d area to (area = %d)",i,m_theWaypoints[i].getArea());
+				waypointSlot(i)->setArea(CTeamFortress2Mod::m_ObjectiveResource.NearestArea(waypointSlot(i)->getOrigin()));
+				CBotGlobals::botMessage(nullptr,0,"Changed Waypoint id %d area to (area = %d)",i,waypointSlot(i)->getArea());
 			}
 		}
 	}
@@ -2789,11 +3761,11 @@ void CWaypoints :: checkAreas ( edict_t *pActivator )
 
 	for ( int i = 0; i < numWaypoints(); i ++ )
 	{
-		if ( m_theWaypoints[i].isUsed() && m_theWaypoints[i].getFlags() > 0 )
+		if ( waypointSlot(i)->isUsed() && waypointSlot(i)->getFlags() > 0 )
 		{
-			if ( m_theWaypoints[i].getArea() > iNumCps )
+			if ( waypointSlot(i)->getArea() > iNumCps )
 			{
-				CBotGlobals::botMessage(pActivator,0,"Invalid Waypoint id %d (area = %d)",i,m_theWaypoints[i].getArea());
+				CBotGlobals::botMessage(pActivator,0,"Invalid Waypoint id %d (area = %d)",i,waypointSlot(i)->getArea());
 			}
 		}
 	}
@@ -2807,12 +3779,8 @@ CWaypoint* CWaypoints::randomWaypointGoalNearestArea(const int iFlags, const int
 	VPROF_BUDGET("CWaypoints::randomWaypointGoalNearestArea", "RCBot2")
 #endif // RCBOT_VPROF_ENABLED
 
-	static int size; 
 	CWaypoint *pWpt;
 	AStarNode *node;
-	float fDist;
-	
-	size = numWaypoints();
 
 	// TODO: inline AStarNode entries
 	std::vector<AStarNode*> goals;
@@ -2822,44 +3790,44 @@ CWaypoint* CWaypoints::randomWaypointGoalNearestArea(const int iFlags, const int
 	if ( iWpt1 == -1 )
 	   iWpt1 = CWaypointLocations::NearestWaypoint(*origin,200.0f,-1);
 
-	for ( int i = 0; i < size; i ++ )
+	const CWaypointGraphSnapshot *pGraph = CWaypointGraphSnapshot::current();
+
+	// only used waypoints with some of the flags wanted
+	pGraph->forEachWithSomeFlags(iFlags, [&](const int i)
 	{
-		if ( i == iIgnore )
-			continue;
+		float fDist;
 
-		pWpt = &m_theWaypoints[i];
+		if ( i == iIgnore )
+			return;
 
-		if ( pWpt->isUsed() && pWpt->forTeam(iTeam) )// && (pWpt->getArea() == iArea) )
-		{
-			if ( iFlags == -1 || pWpt->hasSomeFlags(iFlags) )
-			{
-				//DOD:S Bug
-				if (!bForceArea && !pCurrentMod->isWaypointAreaValid(pWpt->getArea(), iFlags))
-					continue;
-				if ( bForceArea && pWpt->getArea() != iArea )
-					continue;
+		//DOD:S Bug
+		if (!bForceArea && !pCurrentMod->isWaypointAreaValid(pGraph->getArea(i), iFlags))
+			return;
+		if ( bForceArea && pGraph->getArea(i) != iArea )
+			return;
 
-				node = new AStarNode();
+		if ( !waypointSlot(i)->forTeam(iTeam) )
+			return;
 
-				if ( iWpt1 != -1 )
-				{
-					fDist = CWaypointDistances::getDistance(iWpt1,i);					
-				}
-				else 
-				{
-					fDist = pWpt->distanceFrom(*origin);
-				}
-				
-				if ( fDist <= 0.0f )
-					fDist = 0.1f;
+		node = new AStarNode();
 
-				node->setWaypoint(i);
-				node->setHeuristic(131072.0f/(fDist*fDist));
-			
-				goals.emplace_back(node);
-			}
+		if ( iWpt1 != -1 )
+		{
+			fDist = CWaypointDistances::getDistance(iWpt1,i);					
 		}
-	}
+		else 
+		{
+			fDist = (pGraph->getOrigin(i) - *origin).Length();
+		}
+		
+		if ( fDist <= 0.0f )
+			fDist = 0.1f;
+
+		node->setWaypoint(i);
+		node->setHeuristic(131072.0f/(fDist*fDist));
+	
+		goals.emplace_back(node);
+	});
 
 	pWpt = nullptr;
 
@@ -2896,7 +3864,6 @@ CWaypoint* CWaypoints::randomWaypointGoalBetweenArea(const int iFlags, const int
 	VPROF_BUDGET("CWaypoints::randomWaypointGoalBetweenArea", "RCBot2")
 #endif // RCBOT_VPROF_ENABLED
 
-	static int size; 
 	CWaypoint *pWpt;
 	AStarNode *node;
 
@@ -2905,47 +3872,42 @@ CWaypoint* CWaypoints::randomWaypointGoalBetweenArea(const int iFlags, const int
 	if ( iWpt2 == -1 )
 		iWpt2 = CWaypointLocations::NearestWaypoint(*org2,200.0f,-1);
 
-	size = numWaypoints();
-
 	// TODO: inline AStarNode instead of doing manual `new`s
 	std::vector<AStarNode*> goals;
 
-	for ( int i = 0; i < size; i ++ )
-	{
-		pWpt = &m_theWaypoints[i];
+	const CWaypointGraphSnapshot *pGraph = CWaypointGraphSnapshot::current();
 
-		if ( pWpt->isUsed() && pWpt->forTeam(iTeam) )// && (pWpt->getArea() == iArea) )
-		{
-			if ( iFlags == -1 || pWpt->hasSomeFlags(iFlags) )
-			{
+	// only used waypoints with some of the flags wanted
+	pGraph->forEachWithSomeFlags(iFlags, [&](const int i)
+	{
+		if ( !bForceArea && !CTeamFortress2Mod::m_ObjectiveResource.isWaypointAreaValid(pGraph->getArea(i)) )
+			return;
+		if ( bForceArea && pGraph->getArea(i) != iArea )
+			return;
 
-				if ( !bForceArea && !CTeamFortress2Mod::m_ObjectiveResource.isWaypointAreaValid(pWpt->getArea()) )
-					continue;
-				if ( bForceArea && pWpt->getArea() != iArea )
-					continue;
+		if ( !waypointSlot(i)->forTeam(iTeam) )
+			return;
 
-				float fCost;
+		float fCost;
 
-				node = new AStarNode();
+		node = new AStarNode();
 
-				node->setWaypoint(i);
+		node->setWaypoint(i);
 
-				if ( iWpt1 != -1 )
-					fCost = 131072.0f/CWaypointDistances::getDistance(iWpt1,i);
-				else
-					fCost = 131072.0f/pWpt->distanceFrom(*org1);
+		if ( iWpt1 != -1 )
+			fCost = 131072.0f/CWaypointDistances::getDistance(iWpt1,i);
+		else
+			fCost = 131072.0f/(pGraph->getOrigin(i) - *org1).Length();
 
-				if ( iWpt2 != -1 )
-					fCost +=  131072.0f/CWaypointDistances::getDistance(iWpt2,i);
-				else
-					fCost += 131072.0f/pWpt->distanceFrom(*org2);
+		if ( iWpt2 != -1 )
+			fCost +=  131072.0f/CWaypointDistances::getDistance(iWpt2,i);
+		else
+			fCost += 131072.0f/(pGraph->getOrigin(i) - *org2).Length();
 
-				node->setHeuristic(fCost);
-			
-				goals.emplace_back(node);
-			}
-		}
-	}
+		node->setHeuristic(fCost);
+	
+		goals.emplace_back(node);
+	});
 
 	pWpt = nullptr;
 
@@ -2981,35 +3943,33 @@ CWaypoint* CWaypoints::randomWaypointGoal(const int iFlags, const int iTeam, con
 	VPROF_BUDGET("CWaypoints::randomWaypointGoal", "RCBot2")
 #endif // RCBOT_VPROF_ENABLED
 
-	static int size; 
 	CWaypoint *pWpt;
 
-	size = numWaypoints();
+	// kept between calls so the list isn't reallocated every time
+	static std::vector<CWaypoint*> goals;
 
-	std::vector<CWaypoint*> goals;
+	goals.clear();
 
 	CBotMod *pCurrentMod = CBotGlobals::getCurrentMod();
 
-	for ( int i = 0; i < size; i ++ )
+	const CWaypointGraphSnapshot *pGraph = CWaypointGraphSnapshot::current();
+
+	// only used waypoints with some of the flags wanted
+	pGraph->forEachWithSomeFlags(iFlags, [&](const int i)
 	{
 		if ( iIgnore == i )
-			continue;
+			return;
 
-		pWpt = &m_theWaypoints[i];
+		if (!bForceArea && !pCurrentMod->isWaypointAreaValid(pGraph->getArea(i), iFlags))
+			return;
+		if ( bForceArea && pGraph->getArea(i) != iArea )
+			return;
 
-		if ( pWpt->isUsed() && pWpt->forTeam(iTeam) )// && (pWpt->getArea() == iArea) )
-		{
-			if ( iFlags == -1 || pWpt->hasSomeFlags(iFlags) )
-			{
-				if (!bForceArea && !pCurrentMod->isWaypointAreaValid(pWpt->getArea(), iFlags))
-					continue;
-				if ( bForceArea && pWpt->getArea() != iArea )
-					continue;
+		CWaypoint *pGoal = waypointSlot(i);
 
-				goals.emplace_back(pWpt);
-			}
-		}
-	}
+		if ( pGoal->forTeam(iTeam) )
+			goals.emplace_back(pGoal);
+	});
 
 	pWpt = nullptr;
 
@@ -3040,12 +4000,22 @@ int CWaypoints :: randomFlaggedWaypoint (const int iTeam)
 // get the next free slot to save a waypoint to
 int CWaypoints :: freeWaypointIndex ()
 {
-	for ( int i = 0; i < MAX_WAYPOINTS; i ++ )
+	for ( int i = 0; i < m_iMaxWaypoints; i ++ )
 	{
-		if ( !m_theWaypoints[i].isUsed() )
+		if ( !waypointSlot(i)->isUsed() )
 			return i;
 	}
 
+	// full : make more room
+	if ( m_iMaxWaypoints > 0 && m_iMaxWaypoints < MAX_WAYPOINTS )
+	{
+		const int iIndex = m_iMaxWaypoints;
+
+		setMaxWaypoints(std::min(m_iMaxWaypoints * 2, static_cast<int>(MAX_WAYPOINTS)));
+
+		return iIndex;
+	}
+
 	return -1;
 }
 
@@ -3108,7 +4078,18 @@ bool CWaypoint :: isPathOpened (const Vector& vPath)
 		{
 			if ( info.fNextCheck < engine->Time() )
 			{
-				info.bVisibleLastCheck = CBotGlobals::checkOpensLater(m_vOrigin,vPath);
+				CTraceCategory traceCategory(CTraceBudget::TRACE_WAYPOINT);
+
+				const bool bVisible = CBotGlobals::checkOpensLater(m_vOrigin,vPath);
+
+				// door or lift changed, shared routes may be wrong now
+				if ( bVisible != info.bVisibleLastCheck )
+				{
+					CWaypointRouteCache::opensLaterChanged();
+					CWaypointFlowFields::opensLaterChanged();
+				}
+
+				info.bVisibleLastCheck = bVisible;
 				info.fNextCheck = engine->Time() + 2.0f;
 			}
 
@@ -3164,6 +4145,8 @@ bool CWaypoint :: addPathTo ( int iWaypointIndex )
 	m_thePaths.emplace_back(iWaypointIndex);
 	pTo->addPathFrom(CWaypoints::getWaypointIndex(this));
 
+	CWaypoints::graphChanged();
+
 	return true;
 }
 
@@ -3183,6 +4166,8 @@ void CWaypoint :: removePathTo (const int iWaypointIndex)
 	{
 		m_thePaths.erase(std::remove(m_thePaths.begin(), m_thePaths.end(), iWaypointIndex), m_thePaths.end());
 		pOther->removePathFrom(CWaypoints::getWaypointIndex(this));
+
+		CWaypoints::graphChanged();
 	}
 }
 
@@ -3465,7 +4450,7 @@ void CWaypointTest :: go ( edict_t *pPlayer )
 
 		IBotNavigator* pNav = pBot->getNavigator();
 
-		for (int i = 0; i < CWaypoints::MAX_WAYPOINTS; i++)
+		for (int i = 0; i < CWaypoints::numWaypoints(); i++)
 		{
 			CWaypoint* pWpt1 = CWaypoints::getWaypoint(i);
 
@@ -3489,7 +4474,7 @@ void CWaypointTest :: go ( edict_t *pPlayer )
 			
 			if (iCheck != 0)
 			{
-				for (int j = 0; j < CWaypoints::MAX_WAYPOINTS; j++)
+				for (int j = 0; j < CWaypoints::numWaypoints(); j++)
 				{
 
 					if (i == j)
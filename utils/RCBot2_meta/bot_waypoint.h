@@ -32,6 +32,7 @@
 #define __RCBOT_WAYPOINT_H__
 
 #include <cstdio>
+#include <memory>
 
 // this must be before bot_client.h to avoid unknown override / missing type warnings
 #include <vector>
@@ -65,6 +66,16 @@ public:
 	int iFlags;
 };
 
+// version 6 : after the author info the waypoints are one block read at once,
+// each waypoint field in its own array and all paths in one list
+class CWaypointDataHeader
+{
+public:
+	unsigned int iChecksum; // FNV-1a of the block
+	int iNumPaths;
+	int iDataSize; // bytes in the block
+};
+
 struct edict_wpt_pair_t
 {
 	MyEHandle pEdict; // MyEHandle fixes problems with reused edict slots
@@ -287,21 +298,12 @@ public:
 
 	void init();
 
-	void addFlag(const int iFlag)
-	{
-		m_iFlags |= iFlag;
-	}
+	void addFlag(int iFlag);
 
-	void removeFlag(const int iFlag)
-	{
-		m_iFlags &= ~iFlag;
-	}
+	void removeFlag(int iFlag);
 
 	// removes all waypoint flags
-	void removeFlags()
-	{
-		m_iFlags = 0;
-	}
+	void removeFlags();
 
 	bool hasFlag(const int iFlag) const
 	{
@@ -313,11 +315,7 @@ public:
 		return (m_iFlags & iFlag) > 0;
 	}
 
-	void move(const Vector& origin)
-	{
-		// move to new origin
-		m_vOrigin = origin;
-	}
+	void move(const Vector& origin);
 
 	void checkAreas(edict_t *pActivator); // TODO: Needs implemented properly [APG]RoboCop[CL]
 
@@ -355,7 +353,7 @@ public:
 	}
 
 	int getArea() const { return m_iArea; }
-	void setArea(const int area) { m_iArea = area; }
+	void setArea(int area);
 
 	void drawPaths(edict_t* pEdict, unsigned short int iDrawType) const;
 
@@ -382,9 +380,10 @@ public:
 	WaypointList::const_iterator begin() const { return m_thePaths.begin(); }
 	WaypointList::const_iterator end() const { return m_thePaths.end(); }
 
+	// versions 1 to 5
 	void load(std::fstream& bfp, int iVersion);
-
-	void save(std::fstream& bfp);
+	// version 6, paths to this waypoint are added by the caller
+	void load(const Vector& vOrigin, int iAimYaw, int iFlags, int iArea, float fRadius, bool bUsed, const int* pPaths, int iNumPaths);
 
 	int getFlags() const { return m_iFlags; }
 
@@ -399,6 +398,10 @@ public:
 	bool isAiming() const;
 
 private:
+	friend class CWaypoints;
+
+	// slot in CWaypoints, set again whenever the slot is assigned to
+	int m_iIndex = -1;
 	Vector m_vOrigin;
 	// aim of vector (used with certain waypoint types)
 	int m_iAimYaw;
@@ -423,27 +426,32 @@ private:
 class CWaypoints
 {
 public:
-	static constexpr int MAX_WAYPOINTS = 2048;
-	static constexpr int WAYPOINT_VERSION = 5; // waypoint version 5 add author information
+	// Room for waypoints is picked when they are loaded (the next power of two
+	// with some left over for editing) and doubled if editing fills it, every
+	// table indexed by waypoint is sized to getMaxWaypoints()
+	static constexpr int MIN_WAYPOINTS = 512;
+	static constexpr int MAX_WAYPOINTS = 16384;
+	static constexpr int SPARE_WAYPOINTS = 128;
+
+	static constexpr int WAYPOINT_VERSION = 6; // waypoint version 5 add author information, 6 one block of arrays
 
 	static constexpr int W_FILE_FL_VISIBILITY = 1;
 
-	static void init (const char *pszAuthor = nullptr, const char *pszModifiedBy = nullptr);
+	// iNumWaypoints : number about to be loaded, to make room for
+	static void init (const char *pszAuthor = nullptr, const char *pszModifiedBy = nullptr, int iNumWaypoints = 0);
+
+	static int getMaxWaypoints () { return m_iMaxWaypoints; }
+
+	// resize every table indexed by waypoint
+	static void setMaxWaypoints ( int iMaxWaypoints );
 
 	static int getWaypointIndex(CWaypoint* pWpt)
 	{
 		if (pWpt == nullptr)
 			return -1;
-		/**
-		* This should be nuked. RCBot2 should be upgraded to store waypoints on an unordered_map, the index becomes the key.
-		* Also just store the waypoint index on the waypoint itself. Valve navmesh doesn't need to look up the area id, each area know it's own ID.
-		* Better than dealing with this pointer math crap
-		*/
-
-		// return ((int)pWpt - (int)m_theWaypoints)/sizeof(CWaypoint);
 
-		// This will probably not work -caxanga334
-		return static_cast<int>((reinterpret_cast<std::intptr_t>(pWpt) - reinterpret_cast<std::intptr_t>(m_theWaypoints)) / sizeof(CWaypoint));
+		// waypoints are kept in blocks that never move so the index stays valid
+		return pWpt->m_iIndex;
 	}
 
 	static void autoFix(bool bAutoFixNonArea);
@@ -478,7 +486,7 @@ public:
 		if (!validWaypointIndex(iIndex))
 			return nullptr;
 
-		return &m_theWaypoints[iIndex];
+		return &m_WaypointBlocks[iIndex / WAYPOINT_BLOCK_SIZE][iIndex % WAYPOINT_BLOCK_SIZE];
 	}
 
 	static CWaypoint* getNextCoverPoint(CBot* pBot, CWaypoint* pCurrent, CWaypoint* pBlocking);
@@ -520,8 +528,26 @@ public:
 	static const char* getModifier() { return m_szModifiedBy; }
 	static const char* getWelcomeMessage() { return m_szWelcomeMessage; }
 
+	// anything built from the waypoint graph (paths, areas, origins) compares
+	// this against the revision it was built from to know when to rebuild
+	static void graphChanged() { m_iGraphRevision++; }
+	static unsigned int getGraphRevision() { return m_iGraphRevision; }
+
 private:
-	static CWaypoint m_theWaypoints[MAX_WAYPOINTS];
+	// room for the number of waypoints to be loaded
+	static int capacityFor ( int iNumWaypoints );
+
+	// version 6 waypoint block after the author info
+	static bool loadWaypointData ( std::fstream &bfp, int iNumWaypoints );
+	static void saveWaypointData ( std::fstream &bfp, int iNumWaypoints );
+
+	// same as getWaypoint, up to getMaxWaypoints
+	static CWaypoint *waypointSlot ( const int iIndex ) { return &m_WaypointBlocks[iIndex / WAYPOINT_BLOCK_SIZE][iIndex % WAYPOINT_BLOCK_SIZE]; }
+
+	static constexpr int WAYPOINT_BLOCK_SIZE = 256;
+
+	static std::vector<std::unique_ptr<CWaypoint[]>> m_WaypointBlocks;
+	static int m_iMaxWaypoints;
 	static int m_iNumWaypoints;
 	static float m_fNextDrawWaypoints;
 	static int m_iWaypointTexture;
@@ -529,6 +555,7 @@ private:
 	static char m_szAuthor[32];
 	static char m_szModifiedBy[32];
 	static char m_szWelcomeMessage[128];
+	static unsigned int m_iGraphRevision;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,400 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include "bot.h"
+#include "bot_waypoint.h"
+#include "bot_waypoint_areas.h"
+#include "bot_waypoint_snapshot.h"
+
+#include <functional>
+#include <queue>
+#include <utility>
+
+#ifdef RCBOT_VPROF_ENABLED
+#include <tier0/vprof.h>
+#endif // RCBOT_VPROF_ENABLED
+
+unsigned int CWaypointAreaGraph::m_iBuiltRevision = 0;
+bool CWaypointAreaGraph::m_bBuilt = false;
+int CWaypointAreaGraph::m_iNumClusters = 0;
+std::vector<int> CWaypointAreaGraph::m_Cluster;
+std::vector<int> CWaypointAreaGraph::m_PortalIndex;
+std::vector<int> CWaypointAreaGraph::m_Portals;
+std::vector<WaypointList> CWaypointAreaGraph::m_ClusterPortals;
+std::vector<std::vector<CWaypointAreaGraph::area_edge_t>> CWaypointAreaGraph::m_InterEdges;
+std::vector<std::vector<CWaypointAreaGraph::area_edge_t>> CWaypointAreaGraph::m_IntraEdges;
+std::vector<bool> CWaypointAreaGraph::m_IntraEdgesSet;
+
+using AreaQueueItem = std::pair<float, int>;
+using AreaQueue = std::priority_queue<AreaQueueItem, std::vector<AreaQueueItem>, std::greater<>>;
+
+// cost of taking a path of the snapshot
+static float areaPathCost ( const CWaypointGraphSnapshot *pGraph, const int iPath )
+{
+	if ( pGraph->getPathFlags(iPath) & CWaypointGraphSnapshot::PATH_FROM_TELEPORT )
+		return 0.0f;
+
+	return pGraph->getPathLength(iPath);
+}
+
+int CWaypointAreaGraph :: getCluster ( const int iWpt )
+{
+	checkBuilt();
+
+	if ( iWpt < 0 || iWpt >= static_cast<int>(m_Cluster.size()) )
+		return -1;
+
+	return m_Cluster[static_cast<std::size_t>(iWpt)];
+}
+
+void CWaypointAreaGraph :: freeMemory ()
+{
+	m_bBuilt = false;
+	m_iNumClusters = 0;
+
+	std::vector<int>().swap(m_Cluster);
+	std::vector<int>().swap(m_PortalIndex);
+	std::vector<int>().swap(m_Portals);
+	std::vector<WaypointList>().swap(m_ClusterPortals);
+	std::vector<std::vector<area_edge_t>>().swap(m_InterEdges);
+	std::vector<std::vector<area_edge_t>>().swap(m_IntraEdges);
+	std::vector<bool>().swap(m_IntraEdgesSet);
+}
+
+void CWaypointAreaGraph :: checkBuilt ()
+{
+	if ( !m_bBuilt || m_iBuiltRevision != CWaypoints::getGraphRevision() )
+		build();
+}
+
+void CWaypointAreaGraph :: build ()
+{
+#ifdef RCBOT_VPROF_ENABLED
+	VPROF_BUDGET("CWaypointAreaGraph::build", "RCBot2")
+#endif // RCBOT_VPROF_ENABLED
+
+	freeMemory();
+
+	const CWaypointGraphSnapshot *pGraph = CWaypointGraphSnapshot::current();
+	const int iNumWaypoints = pGraph->numWaypoints();
+
+	m_Cluster.assign(static_cast<std::size_t>(iNumWaypoints), -1);
+	m_PortalIndex.assign(static_cast<std::size_t>(iNumWaypoints), -1);
+
+	// flood fill connected waypoints of the same area into clusters
+	WaypointList toVisit;
+
+	const auto canCluster = [pGraph](const int iWpt)
+	{
+		return pGraph->isUsed(iWpt) && !pGraph->hasSomeFlags(iWpt, CWaypointTypes::W_FL_UNREACHABLE);
+	};
+
+	for ( int i = 0; i < iNumWaypoints; i ++ )
+	{
+		if ( !canCluster(i) || m_Cluster[i] != -1 )
+			continue;
+
+		const int iArea = pGraph->getArea(i);
+		const int iTeamFlags = pGraph->getFlags(i) & CLUSTER_TEAM_FLAGS;
+
+		m_Cluster[i] = m_iNumClusters;
+		toVisit.emplace_back(i);
+
+		while ( !toVisit.empty() )
+		{
+			const int iCurr = toVisit.back();
+			toVisit.pop_back();
+
+			const int iNumPaths = pGraph->getPathsEnd(iCurr) - pGraph->getPathsBegin(iCurr);
+			const int iNumPathsTo = pGraph->getPathsFromEnd(iCurr) - pGraph->getPathsFromBegin(iCurr);
+
+			for ( int j = 0; j < iNumPaths + iNumPathsTo; j ++ )
+			{
+				const int iOther = j < iNumPaths ? pGraph->getPathTarget(pGraph->getPathsBegin(iCurr) + j) :
+					pGraph->getPathSource(pGraph->getPathFrom(pGraph->getPathsFromBegin(iCurr) + j - iNumPaths));
+
+				if ( !canCluster(iOther) || m_Cluster[iOther] != -1 || pGraph->getArea(iOther) != iArea ||
+					(pGraph->getFlags(iOther) & CLUSTER_TEAM_FLAGS) != iTeamFlags )
+					continue;
+
+				m_Cluster[iOther] = m_iNumClusters;
+				toVisit.emplace_back(iOther);
+			}
+		}
+
+		m_iNumClusters++;
+	}
+
+	m_ClusterPortals.resize(static_cast<std::size_t>(m_iNumClusters));
+
+	// waypoints with a path crossing clusters are portals
+	for ( int i = 0; i < iNumWaypoints; i ++ )
+	{
+		if ( m_Cluster[i] == -1 )
+			continue;
+
+		for ( int iPath = pGraph->getPathsBegin(i); iPath < pGraph->getPathsEnd(i); iPath ++ )
+		{
+			const int iOther = pGraph->getPathTarget(iPath);
+
+			if ( m_Cluster[iOther] == -1 || m_Cluster[iOther] == m_Cluster[i] )
+				continue;
+
+			for ( const int iPortal : { i, iOther } )
+			{
+				if ( m_PortalIndex[iPortal] == -1 )
+				{
+					m_PortalIndex[iPortal] = static_cast<int>(m_Portals.size());
+					m_Portals.emplace_back(iPortal);
+					m_ClusterPortals[m_Cluster[iPortal]].emplace_back(m_PortalIndex[iPortal]);
+				}
+			}
+		}
+	}
+
+	const std::size_t iNumPortals = m_Portals.size();
+
+	m_InterEdges.resize(iNumPortals);
+	m_IntraEdges.resize(iNumPortals);
+	m_IntraEdgesSet.assign(iNumPortals, false);
+
+	for ( std::size_t i = 0; i < iNumPortals; i ++ )
+	{
+		const int iWpt = m_Portals[i];
+
+		for ( int iPath = pGraph->getPathsBegin(iWpt); iPath < pGraph->getPathsEnd(iWpt); iPath ++ )
+		{
+			const int iOther = pGraph->getPathTarget(iPath);
+
+			if ( m_Cluster[iOther] == -1 || m_Cluster[iOther] == m_Cluster[iWpt] )
+				continue;
+
+			m_InterEdges[i].push_back({ m_PortalIndex[iOther], areaPathCost(pGraph, iPath) });
+		}
+	}
+
+	m_iBuiltRevision = CWaypoints::getGraphRevision();
+	m_bBuilt = true;
+}
+
+void CWaypointAreaGraph :: clusterCosts ( const int iSource, const bool bReverse, std::vector<float> *costs )
+{
+	const CWaypointGraphSnapshot *pGraph = CWaypointGraphSnapshot::current();
+	const int iCluster = m_Cluster[iSource];
+
+	costs->assign(m_Cluster.size(), -1.0f);
+
+	AreaQueue queue;
+
+	(*costs)[iSource] = 0.0f;
+	queue.emplace(0.0f, iSource);
+
+	while ( !queue.empty() )
+	{
+		const AreaQueueItem item = queue.top();
+		queue.pop();
+
+		if ( item.first > (*costs)[item.second] )
+			continue; // stale
+
+		const int iBegin = bReverse ? pGraph->getPathsFromBegin(item.second) : pGraph->getPathsBegin(item.second);
+		const int iEnd = bReverse ? pGraph->getPathsFromEnd(item.second) : pGraph->getPathsEnd(item.second);
+
+		for ( int j = iBegin; j < iEnd; j ++ )
+		{
+			const int iPath = bReverse ? pGraph->getPathFrom(j) : j;
+			const int iOther = bReverse ? pGraph->getPathSource(iPath) : pGraph->getPathTarget(iPath);
+
+			if ( m_Cluster[iOther] != iCluster )
+				continue;
+
+			const float fCost = item.first + areaPathCost(pGraph, iPath);
+
+			if ( (*costs)[iOther] < 0.0f || fCost < (*costs)[iOther] )
+			{
+				(*costs)[iOther] = fCost;
+				queue.emplace(fCost, iOther);
+			}
+		}
+	}
+}
+
+const std::vector<CWaypointAreaGraph::area_edge_t> &CWaypointAreaGraph :: getIntraEdges ( const int iPortal )
+{
+	if ( !m_IntraEdgesSet[iPortal] )
+	{
+		const int iWpt = m_Portals[iPortal];
+		std::vector<float> costs;
+
+		clusterCosts(iWpt, false, &costs);
+
+		for ( const int iOther : m_ClusterPortals[m_Cluster[iWpt]] )
+		{
+			const float fCost = costs[m_Portals[iOther]];
+
+			if ( iOther != iPortal && fCost >= 0.0f )
+				m_IntraEdges[iPortal].push_back({ iOther, fCost });
+		}
+
+		m_IntraEdgesSet[iPortal] = true;
+	}
+
+	return m_IntraEdges[iPortal];
+}
+
+bool CWaypointAreaGraph :: findRoute ( const int iFrom, const int iTo, const int iTeam, WaypointList *route )
+{
+#ifdef RCBOT_VPROF_ENABLED
+	VPROF_BUDGET("CWaypointAreaGraph::findRoute", "RCBot2")
+#endif // RCBOT_VPROF_ENABLED
+
+	route->clear();
+
+	const int iFromCluster = getCluster(iFrom);
+	const int iToCluster = getCluster(iTo);
+
+	if ( iFromCluster == -1 || iToCluster == -1 || iFromCluster == iToCluster )
+		return false;
+
+	// portals are nodes 0..n-1, then the start and goal waypoints
+	const int iNumPortals = static_cast<int>(m_Portals.size());
+	const int iStart = iNumPortals;
+	const int iGoal = iNumPortals + 1;
+
+	std::vector<float> startCosts;
+	std::vector<float> goalCosts;
+
+	clusterCosts(iFrom, false, &startCosts);
+	clusterCosts(iTo, true, &goalCosts);
+
+	std::vector<float> cost(static_cast<std::size_t>(iNumPortals + 2), -1.0f);
+	std::vector<int> parent(static_cast<std::size_t>(iNumPortals + 2), -1);
+	std::vector<bool> closed(static_cast<std::size_t>(iNumPortals + 2), false);
+
+	const CWaypointGraphSnapshot *pGraph = CWaypointGraphSnapshot::current();
+	const Vector vGoal = pGraph->getOrigin(iTo);
+
+	AreaQueue open;
+
+	// whole clusters share team flags, so checking the portal checks its cluster
+	const auto forTeam = [&](const int iPortal)
+	{
+		const int iCluster = m_Cluster[m_Portals[iPortal]];
+
+		if ( iCluster == iFromCluster || iCluster == iToCluster )
+			return true;
+
+		CWaypoint *pPortal = CWaypoints::getWaypoint(m_Portals[iPortal]);
+
+		return pPortal != nullptr && pPortal->forTeam(iTeam);
+	};
+
+	const auto relax = [&](const int iNode, const int iParent, const float fCost)
+	{
+		if ( closed[iNode] || (cost[iNode] >= 0.0f && cost[iNode] <= fCost) )
+			return;
+
+		if ( iNode != iGoal && !forTeam(iNode) )
+			return;
+
+		cost[iNode] = fCost;
+		parent[iNode] = iParent;
+
+		const float fHeuristic = iNode == iGoal ? 0.0f : (pGraph->getOrigin(m_Portals[iNode]) - vGoal).Length();
+
+		open.emplace(fCost + fHeuristic, iNode);
+	};
+
+	cost[iStart] = 0.0f;
+	open.emplace(0.0f, iStart);
+
+	while ( !open.empty() )
+	{
+		const int iNode = open.top().second;
+		open.pop();
+
+		if ( closed[iNode] )
+			continue;
+
+		closed[iNode] = true;
+
+		if ( iNode == iGoal )
+			break;
+
+		if ( iNode == iStart )
+		{
+			for ( const int iPortal : m_ClusterPortals[iFromCluster] )
+			{
+				if ( startCosts[m_Portals[iPortal]] >= 0.0f )
+					relax(iPortal, iStart, startCosts[m_Portals[iPortal]]);
+			}
+
+			continue;
+		}
+
+		const float fCost = cost[iNode];
+
+		for ( const area_edge_t &edge : m_InterEdges[iNode] )
+			relax(edge.iTo, iNode, fCost + edge.fCost);
+
+		for ( const area_edge_t &edge : getIntraEdges(iNode) )
+			relax(edge.iTo, iNode, fCost + edge.fCost);
+
+		if ( m_Cluster[m_Portals[iNode]] == iToCluster && goalCosts[m_Portals[iNode]] >= 0.0f )
+			relax(iGoal, iNode, fCost + goalCosts[m_Portals[iNode]]);
+	}
+
+	if ( !closed[iGoal] )
+		return false;
+
+	WaypointList portals;
+
+	for ( int iNode = parent[iGoal]; iNode != iStart && iNode != -1; iNode = parent[iNode] )
+		portals.emplace_back(m_Portals[iNode]);
+
+	// only keep the portals where the route enters a new cluster, the low level
+	// search from one entry to the next then stays close to a single cluster
+	int iPrevCluster = iFromCluster;
+
+	for ( auto it = portals.rbegin(); it != portals.rend(); ++it )
+	{
+		if ( m_Cluster[*it] != iPrevCluster && *it != iTo )
+			route->emplace_back(*it);
+
+		iPrevCluster = m_Cluster[*it];
+	}
+
+	route->emplace_back(iTo);
+
+	return route->size() > 1;
+}
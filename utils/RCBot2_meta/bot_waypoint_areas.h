@@ -0,0 +1,93 @@
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef __RCBOT_WAYPOINT_AREAS_H__
+#define __RCBOT_WAYPOINT_AREAS_H__
+
+#include "bot_waypoint.h"
+
+#include <vector>
+
+// Abstract graph over waypoint areas for hierarchical path finding.
+//
+// Waypoints are grouped into clusters: connected waypoints sharing the same
+// area (getArea) and team flags. Waypoints with a path into or out of another
+// cluster are portals. A long route is planned over portals first, then the
+// navigator only runs a full A* for the next segment between two portals.
+// Unreachable waypoints are left out, and routes only go through clusters
+// the team can use apart from the ones at either end.
+class CWaypointAreaGraph
+{
+public:
+	// fills route with the waypoints to pass through, in order, ending with
+	// iTo. returns false if both ends are in the same cluster or no route
+	static bool findRoute ( int iFrom, int iTo, int iTeam, WaypointList *route );
+
+	static int getCluster ( int iWpt );
+
+	static int numClusters () { checkBuilt(); return m_iNumClusters; }
+	static int numPortals () { checkBuilt(); return static_cast<int>(m_Portals.size()); }
+
+	static void freeMemory ();
+private:
+	typedef struct
+	{
+		int iTo; // portal index
+		float fCost;
+	}area_edge_t;
+
+	// flags waypoints of one cluster all have the same of
+	static constexpr int CLUSTER_TEAM_FLAGS = CWaypointTypes::W_FL_NOBLU | CWaypointTypes::W_FL_NORED;
+
+	// rebuild if waypoints have changed since last time
+	static void checkBuilt ();
+	static void build ();
+
+	// cached cost from a portal to the other portals in its cluster
+	static const std::vector<area_edge_t> &getIntraEdges ( int iPortal );
+
+	// dijkstra restricted to the cluster of iSource, following paths backwards if bReverse
+	static void clusterCosts ( int iSource, bool bReverse, std::vector<float> *costs );
+
+	static unsigned int m_iBuiltRevision;
+	static bool m_bBuilt;
+	static int m_iNumClusters;
+
+	static std::vector<int> m_Cluster; // cluster of each waypoint, -1 if deleted
+	static std::vector<int> m_PortalIndex; // portal index of each waypoint, -1 if not a portal
+	static std::vector<int> m_Portals; // waypoint of each portal
+	static std::vector<WaypointList> m_ClusterPortals; // portals in each cluster
+
+	static std::vector<std::vector<area_edge_t>> m_InterEdges; // portal to portal in another cluster
+	static std::vector<std::vector<area_edge_t>> m_IntraEdges; // portal to portal in same cluster
+	static std::vector<bool> m_IntraEdgesSet;
+};
+
+#endif
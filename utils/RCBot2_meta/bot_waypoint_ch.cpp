@@ -0,0 +1,675 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include "bot_waypoint_ch.h"
+#include "bot_compress.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+enum : std::uint8_t
+{
+	WPT_CH_VER = 0x01
+};
+
+typedef struct
+{
+	int version;
+	int numwaypoints;
+	int numhierarchies;
+	unsigned int checksum;
+}wpt_ch_hdr_t;
+
+static constexpr float CH_INFINITY = std::numeric_limits<float>::infinity();
+
+// paths while contracting, to and from waypoints not contracted yet
+typedef struct
+{
+	int iOther;
+	int iMiddle;
+	float fWeight;
+}ch_build_edge_t;
+
+static void addBuildEdge ( std::vector<ch_build_edge_t> &edges, const int iOther, const int iMiddle, const float fWeight )
+{
+	for ( ch_build_edge_t &edge : edges )
+	{
+		if ( edge.iOther == iOther )
+		{
+			// keep the shorter one
+			if ( fWeight < edge.fWeight )
+			{
+				edge.iMiddle = iMiddle;
+				edge.fWeight = fWeight;
+			}
+
+			return;
+		}
+	}
+
+	edges.push_back({iOther, iMiddle, fWeight});
+}
+
+void CContractionHierarchy :: build ( const ch_waypoints_t &waypoints, const int iExcludeFlags )
+{
+	const int iNumNodes = static_cast<int>(waypoints.bUsed.size());
+	const std::size_t iSize = static_cast<std::size_t>(iNumNodes);
+
+	m_iExcludeFlags = iExcludeFlags;
+	m_iShortcuts = 0;
+
+	std::vector<std::vector<ch_build_edge_t>> out(iSize);
+	std::vector<std::vector<ch_build_edge_t>> in(iSize);
+	std::vector<std::uint8_t> bUsable(iSize);
+
+	for ( int i = 0; i < iNumNodes; i ++ )
+		bUsable[i] = waypoints.bUsed[i] && !(waypoints.iFlags[i] & (CH_FL_UNREACHABLE | iExcludeFlags));
+
+	for ( int i = 0; i < iNumNodes; i ++ )
+	{
+		if ( !bUsable[i] )
+			continue;
+
+		for ( int iPath = waypoints.iPathOffsets[i]; iPath < waypoints.iPathOffsets[i + 1]; iPath ++ )
+		{
+			const int iTo = waypoints.iPathTargets[iPath];
+
+			if ( iTo == i || !bUsable[iTo] )
+				continue;
+
+			float fWeight = 0.0f;
+
+			// same path costs as CWaypointNavigator::searchRoute : taking a teleport costs nothing
+			if ( !(waypoints.iFlags[i] & CH_FL_TELEPORT) )
+			{
+				const float *vFrom = &waypoints.fOrigins[static_cast<std::size_t>(i) * 3];
+				const float *vTo = &waypoints.fOrigins[static_cast<std::size_t>(iTo) * 3];
+
+				fWeight = std::sqrt((vTo[0]-vFrom[0])*(vTo[0]-vFrom[0]) + (vTo[1]-vFrom[1])*(vTo[1]-vFrom[1]) + (vTo[2]-vFrom[2])*(vTo[2]-vFrom[2]));
+			}
+
+			addBuildEdge(out[i], iTo, -1, fWeight);
+			addBuildEdge(in[iTo], i, -1, fWeight);
+		}
+	}
+
+	std::vector<std::uint8_t> bContracted(iSize, 0);
+	std::vector<int> iContractedNeighbours(iSize, 0);
+
+	// witness search state, reset after each search
+	std::vector<float> fWitness(iSize, CH_INFINITY);
+	std::vector<int> iWitnessTouched;
+
+	typedef std::pair<float,int> ch_queue_item_t;
+
+	// are there shortcuts needed through iNode, add them if bAdd
+	const auto contract = [&](const int iNode, const bool bAdd) -> int
+	{
+		int iShortcuts = 0;
+
+		for ( const ch_build_edge_t &inEdge : in[iNode] )
+		{
+			const int iFrom = inEdge.iOther;
+
+			if ( bContracted[iFrom] )
+				continue;
+
+			float fMaxWeight = 0.0f;
+
+			for ( const ch_build_edge_t &outEdge : out[iNode] )
+			{
+				if ( !bContracted[outEdge.iOther] && outEdge.iOther != iFrom )
+					fMaxWeight = std::max(fMaxWeight, inEdge.fWeight + outEdge.fWeight);
+			}
+
+			if ( fMaxWeight == 0.0f && out[iNode].empty() )
+				continue;
+
+			// shortest routes from iFrom that don't go through iNode
+			std::priority_queue<ch_queue_item_t,std::vector<ch_queue_item_t>,std::greater<>> queue;
+			int iSettled = 0;
+
+			fWitness[iFrom] = 0.0f;
+			iWitnessTouched.push_back(iFrom);
+			queue.emplace(0.0f, iFrom);
+
+			while ( !queue.empty() && iSettled < MAX_WITNESS_SETTLED )
+			{
+				const ch_queue_item_t item = queue.top();
+				queue.pop();
+
+				if ( item.first > fWitness[item.second] )
+					continue;
+				if ( item.first > fMaxWeight )
+					break;
+
+				iSettled++;
+
+				for ( const ch_build_edge_t &edge : out[item.second] )
+				{
+					if ( edge.iOther == iNode || bContracted[edge.iOther] )
+						continue;
+
+					const float fDist = item.first + edge.fWeight;
+
+					if ( fDist < fWitness[edge.iOther] )
+					{
+						if ( fWitness[edge.iOther] == CH_INFINITY )
+							iWitnessTouched.push_back(edge.iOther);
+
+						fWitness[edge.iOther] = fDist;
+						queue.emplace(fDist, edge.iOther);
+					}
+				}
+			}
+
+			for ( const ch_build_edge_t &outEdge : out[iNode] )
+			{
+				const int iTo = outEdge.iOther;
+
+				if ( bContracted[iTo] || iTo == iFrom )
+					continue;
+
+				const float fShortcut = inEdge.fWeight + outEdge.fWeight;
+
+				if ( fWitness[iTo] <= fShortcut )
+					continue;
+
+				iShortcuts++;
+
+				if ( bAdd )
+				{
+					addBuildEdge(out[iFrom], iTo, iNode, fShortcut);
+					addBuildEdge(in[iTo], iFrom, iNode, fShortcut);
+					m_iShortcuts++;
+				}
+			}
+
+			for ( const int iTouched : iWitnessTouched )
+				fWitness[iTouched] = CH_INFINITY;
+
+			iWitnessTouched.clear();
+		}
+
+		return iShortcuts;
+	};
+
+	const auto priority = [&](const int iNode) -> int
+	{
+		int iEdges = 0;
+
+		for ( const ch_build_edge_t &edge : in[iNode] )
+			iEdges += bContracted[edge.iOther] ? 0 : 1;
+		for ( const ch_build_edge_t &edge : out[iNode] )
+			iEdges += bContracted[edge.iOther] ? 0 : 1;
+
+		// edge difference, spread out by contracted neighbours
+		return contract(iNode, false) - iEdges + iContractedNeighbours[iNode];
+	};
+
+	typedef std::pair<int,int> ch_order_item_t;
+	std::priority_queue<ch_order_item_t,std::vector<ch_order_item_t>,std::greater<>> order;
+
+	for ( int i = 0; i < iNumNodes; i ++ )
+		order.emplace(bUsable[i] ? priority(i) : std::numeric_limits<int>::min(), i);
+
+	m_iRank.assign(iSize, 0);
+	m_iUpOffsets.assign(iSize + 1, 0);
+	m_iDownOffsets.assign(iSize + 1, 0);
+
+	std::vector<std::vector<ch_edge_t>> up(iSize);
+	std::vector<std::vector<ch_edge_t>> down(iSize);
+
+	int iRank = 0;
+
+	while ( !order.empty() )
+	{
+		const ch_order_item_t item = order.top();
+		order.pop();
+
+		const int iNode = item.second;
+
+		// lazy update : if it got worse let the next one go first
+		if ( bUsable[iNode] && !order.empty() )
+		{
+			const int iPriority = priority(iNode);
+
+			if ( iPriority > order.top().first )
+			{
+				order.emplace(iPriority, iNode);
+				continue;
+			}
+		}
+
+		if ( bUsable[iNode] )
+			contract(iNode, true);
+
+		bContracted[iNode] = 1;
+		m_iRank[iNode] = iRank++;
+
+		// what is left connects to more important waypoints
+		for ( const ch_build_edge_t &edge : out[iNode] )
+		{
+			if ( bContracted[edge.iOther] )
+				continue;
+
+			up[iNode].push_back({edge.iOther, edge.iMiddle, edge.fWeight});
+			iContractedNeighbours[edge.iOther]++;
+		}
+
+		for ( const ch_build_edge_t &edge : in[iNode] )
+		{
+			if ( bContracted[edge.iOther] )
+				continue;
+
+			down[iNode].push_back({edge.iOther, edge.iMiddle, edge.fWeight});
+			iContractedNeighbours[edge.iOther]++;
+		}
+
+		out[iNode].clear();
+		out[iNode].shrink_to_fit();
+		in[iNode].clear();
+		in[iNode].shrink_to_fit();
+	}
+
+	m_UpEdges.clear();
+	m_DownEdges.clear();
+
+	for ( int i = 0; i < iNumNodes; i ++ )
+	{
+		m_iUpOffsets[i] = static_cast<int>(m_UpEdges.size());
+		m_UpEdges.insert(m_UpEdges.end(), up[i].begin(), up[i].end());
+
+		m_iDownOffsets[i] = static_cast<int>(m_DownEdges.size());
+		m_DownEdges.insert(m_DownEdges.end(), down[i].begin(), down[i].end());
+	}
+
+	m_iUpOffsets[iNumNodes] = static_cast<int>(m_UpEdges.size());
+	m_iDownOffsets[iNumNodes] = static_cast<int>(m_DownEdges.size());
+}
+
+bool CContractionHierarchy :: findRoute ( const int iStart, const int iGoal, std::vector<int> *route, float *fDistance, unsigned int *iExpanded ) const
+{
+	const int iNumNodes = numNodes();
+
+	if ( iStart < 0 || iGoal < 0 || iStart >= iNumNodes || iGoal >= iNumNodes )
+		return false;
+
+	route->clear();
+	*fDistance = 0.0f;
+
+	if ( iStart == iGoal )
+	{
+		route->push_back(iGoal);
+		return true;
+	}
+
+	typedef std::pair<float,int> ch_queue_item_t;
+	typedef std::priority_queue<ch_queue_item_t,std::vector<ch_queue_item_t>,std::greater<>> ch_queue_t;
+
+	// [0] forwards from the start, [1] backwards from the goal
+	std::vector<float> fDist[2] = { std::vector<float>(static_cast<std::size_t>(iNumNodes), CH_INFINITY),
+		std::vector<float>(static_cast<std::size_t>(iNumNodes), CH_INFINITY) };
+	std::vector<int> iParent[2] = { std::vector<int>(static_cast<std::size_t>(iNumNodes), -1),
+		std::vector<int>(static_cast<std::size_t>(iNumNodes), -1) };
+	ch_queue_t queue[2];
+
+	fDist[0][iStart] = 0.0f;
+	fDist[1][iGoal] = 0.0f;
+	queue[0].emplace(0.0f, iStart);
+	queue[1].emplace(0.0f, iGoal);
+
+	float fBest = CH_INFINITY;
+	int iMeet = -1;
+	int iSide = 0;
+
+	while ( !queue[0].empty() || !queue[1].empty() )
+	{
+		// alternate, unless one side is finished
+		if ( queue[iSide].empty() || queue[iSide].top().first >= fBest )
+		{
+			iSide = 1 - iSide;
+
+			if ( queue[iSide].empty() || queue[iSide].top().first >= fBest )
+				break;
+		}
+
+		const ch_queue_item_t item = queue[iSide].top();
+		queue[iSide].pop();
+
+		const int iNode = item.second;
+
+		if ( item.first > fDist[iSide][iNode] )
+			continue;
+
+		(*iExpanded)++;
+
+		const float fMeet = fDist[0][iNode] + fDist[1][iNode];
+
+		if ( fMeet < fBest )
+		{
+			fBest = fMeet;
+			iMeet = iNode;
+		}
+
+		const std::vector<int> &iOffsets = iSide == 0 ? m_iUpOffsets : m_iDownOffsets;
+		const std::vector<ch_edge_t> &edges = iSide == 0 ? m_UpEdges : m_DownEdges;
+
+		for ( int i = iOffsets[iNode]; i < iOffsets[iNode + 1]; i ++ )
+		{
+			const ch_edge_t &edge = edges[i];
+			const float fNew = item.first + edge.fWeight;
+
+			if ( fNew < fDist[iSide][edge.iTarget] )
+			{
+				fDist[iSide][edge.iTarget] = fNew;
+				iParent[iSide][edge.iTarget] = iNode;
+				queue[iSide].emplace(fNew, edge.iTarget);
+
+				const float fOther = fDist[1 - iSide][edge.iTarget];
+
+				if ( fNew + fOther < fBest )
+				{
+					fBest = fNew + fOther;
+					iMeet = edge.iTarget;
+				}
+			}
+		}
+
+		iSide = 1 - iSide;
+	}
+
+	if ( iMeet == -1 )
+		return false;
+
+	// start ... meet, then meet ... goal
+	std::vector<int> iUpward;
+
+	for ( int iNode = iMeet; iNode != -1; iNode = iParent[0][iNode] )
+		iUpward.push_back(iNode);
+
+	std::reverse(iUpward.begin(), iUpward.end());
+
+	for ( int iNode = iParent[1][iMeet]; iNode != -1; iNode = iParent[1][iNode] )
+		iUpward.push_back(iNode);
+
+	for ( std::size_t i = 0; i + 1 < iUpward.size(); i ++ )
+	{
+		if ( !unpackEdge(iUpward[i], iUpward[i + 1], route) )
+		{
+			route->clear();
+			return false;
+		}
+	}
+
+	*fDistance = fBest;
+
+	return !route->empty() && route->back() == iGoal;
+}
+
+const CContractionHierarchy::ch_edge_t *CContractionHierarchy :: findEdge ( const int iFrom, const int iTo ) const
+{
+	const ch_edge_t *pBest = nullptr;
+
+	// stored at the less important end
+	if ( m_iRank[iFrom] < m_iRank[iTo] )
+	{
+		for ( int i = m_iUpOffsets[iFrom]; i < m_iUpOffsets[iFrom + 1]; i ++ )
+		{
+			if ( m_UpEdges[i].iTarget == iTo && (pBest == nullptr || m_UpEdges[i].fWeight < pBest->fWeight) )
+				pBest = &m_UpEdges[i];
+		}
+	}
+	else
+	{
+		for ( int i = m_iDownOffsets[iTo]; i < m_iDownOffsets[iTo + 1]; i ++ )
+		{
+			if ( m_DownEdges[i].iTarget == iFrom && (pBest == nullptr || m_DownEdges[i].fWeight < pBest->fWeight) )
+				pBest = &m_DownEdges[i];
+		}
+	}
+
+	return pBest;
+}
+
+bool CContractionHierarchy :: unpackEdge ( const int iFrom, const int iTo, std::vector<int> *route ) const
+{
+	const ch_edge_t *pEdge = findEdge(iFrom, iTo);
+
+	if ( pEdge == nullptr )
+		return false;
+
+	if ( pEdge->iMiddle == -1 )
+	{
+		route->push_back(iTo);
+		return true;
+	}
+
+	// the middle is less important than both ends, so this ends
+	const int iMiddle = pEdge->iMiddle;
+
+	return unpackEdge(iFrom, iMiddle, route) && unpackEdge(iMiddle, iTo, route);
+}
+
+unsigned int CContractionHierarchy :: checksum ( const ch_waypoints_t &waypoints )
+{
+	// FNV-1a, origins rounded so the game and the tools agree
+	unsigned int iHash = 2166136261u;
+
+	const auto add = [&iHash](const int iValue)
+	{
+		const unsigned int iBits = static_cast<unsigned int>(iValue);
+
+		for ( int i = 0; i < 4; i ++ )
+		{
+			iHash ^= (iBits >> (i * 8)) & 0xFF;
+			iHash *= 16777619u;
+		}
+	};
+
+	const int iNumNodes = static_cast<int>(waypoints.bUsed.size());
+
+	add(iNumNodes);
+
+	for ( int i = 0; i < iNumNodes; i ++ )
+	{
+		add(waypoints.bUsed[i]);
+		add(waypoints.iFlags[i] & (CH_FL_UNREACHABLE | CH_FL_NOTEAM_A | CH_FL_NOTEAM_B | CH_FL_TELEPORT));
+
+		for ( int j = 0; j < 3; j ++ )
+			add(static_cast<int>(std::lround(waypoints.fOrigins[static_cast<std::size_t>(i) * 3 + j])));
+
+		add(waypoints.iPathOffsets[i + 1] - waypoints.iPathOffsets[i]);
+
+		for ( int iPath = waypoints.iPathOffsets[i]; iPath < waypoints.iPathOffsets[i + 1]; iPath ++ )
+			add(waypoints.iPathTargets[iPath]);
+	}
+
+	return iHash;
+}
+
+void CContractionHierarchy :: buildAll ( const ch_waypoints_t &waypoints, std::vector<CContractionHierarchy> *hierarchies )
+{
+	hierarchies->assign(NUM_TEAM_MASKS, CContractionHierarchy());
+
+	for ( int i = 0; i < NUM_TEAM_MASKS; i ++ )
+		(*hierarchies)[i].build(waypoints, TEAM_MASKS[i]);
+}
+
+template <typename T>
+static void appendData ( std::vector<unsigned char> *buffer, const T *pData, const std::size_t iCount )
+{
+	const unsigned char *pBytes = reinterpret_cast<const unsigned char*>(pData);
+
+	buffer->insert(buffer->end(), pBytes, pBytes + iCount * sizeof(T));
+}
+
+template <typename T>
+static bool readData ( const unsigned char **pData, const unsigned char *pEnd, T *pOut, const std::size_t iCount )
+{
+	const std::size_t iBytes = iCount * sizeof(T);
+
+	if ( static_cast<std::size_t>(pEnd - *pData) < iBytes )
+		return false;
+
+	if ( iBytes > 0 )
+		std::memcpy(pOut, *pData, iBytes);
+
+	*pData += iBytes;
+
+	return true;
+}
+
+void CContractionHierarchy :: serialise ( std::vector<unsigned char> *buffer ) const
+{
+	const int iInfo[4] = { m_iExcludeFlags, numNodes(), static_cast<int>(m_UpEdges.size()), static_cast<int>(m_DownEdges.size()) };
+
+	appendData(buffer, iInfo, 4);
+	appendData(buffer, m_iRank.data(), m_iRank.size());
+	appendData(buffer, m_iUpOffsets.data(), m_iUpOffsets.size());
+	appendData(buffer, m_UpEdges.data(), m_UpEdges.size());
+	appendData(buffer, m_iDownOffsets.data(), m_iDownOffsets.size());
+	appendData(buffer, m_DownEdges.data(), m_DownEdges.size());
+}
+
+bool CContractionHierarchy :: deserialise ( const unsigned char **pData, const unsigned char *pEnd )
+{
+	int iInfo[4];
+
+	if ( !readData(pData, pEnd, iInfo, 4) || iInfo[1] < 0 || iInfo[2] < 0 || iInfo[3] < 0 )
+		return false;
+
+	const std::size_t iNumNodes = static_cast<std::size_t>(iInfo[1]);
+
+	m_iExcludeFlags = iInfo[0];
+	m_iShortcuts = 0;
+
+	m_iRank.resize(iNumNodes);
+	m_iUpOffsets.resize(iNumNodes + 1);
+	m_UpEdges.resize(static_cast<std::size_t>(iInfo[2]));
+	m_iDownOffsets.resize(iNumNodes + 1);
+	m_DownEdges.resize(static_cast<std::size_t>(iInfo[3]));
+
+	if ( !readData(pData, pEnd, m_iRank.data(), m_iRank.size()) ||
+		!readData(pData, pEnd, m_iUpOffsets.data(), m_iUpOffsets.size()) ||
+		!readData(pData, pEnd, m_UpEdges.data(), m_UpEdges.size()) ||
+		!readData(pData, pEnd, m_iDownOffsets.data(), m_iDownOffsets.size()) ||
+		!readData(pData, pEnd, m_DownEdges.data(), m_DownEdges.size()) )
+		return false;
+
+	// don't trust offsets or targets from the file
+	if ( m_iUpOffsets[iNumNodes] != iInfo[2] || m_iDownOffsets[iNumNodes] != iInfo[3] )
+		return false;
+
+	for ( std::size_t i = 0; i < iNumNodes; i ++ )
+	{
+		if ( m_iUpOffsets[i] < 0 || m_iUpOffsets[i] > m_iUpOffsets[i + 1] || m_iDownOffsets[i] < 0 || m_iDownOffsets[i] > m_iDownOffsets[i + 1] )
+			return false;
+	}
+
+	const auto validEdges = [iNumNodes](const std::vector<ch_edge_t> &edges, int *iShortcuts)
+	{
+		for ( const ch_edge_t &edge : edges )
+		{
+			if ( edge.iTarget < 0 || static_cast<std::size_t>(edge.iTarget) >= iNumNodes || edge.iMiddle >= static_cast<int>(iNumNodes) )
+				return false;
+
+			if ( edge.iMiddle != -1 )
+				(*iShortcuts)++;
+		}
+
+		return true;
+	};
+
+	return validEdges(m_UpEdges, &m_iShortcuts) && validEdges(m_DownEdges, &m_iShortcuts);
+}
+
+bool CContractionHierarchy :: save ( const char *szFilename, const std::vector<CContractionHierarchy> &hierarchies, const unsigned int iChecksum, const int iNumWaypoints )
+{
+	wpt_ch_hdr_t hdr;
+
+	hdr.version = WPT_CH_VER;
+	hdr.numwaypoints = iNumWaypoints;
+	hdr.numhierarchies = static_cast<int>(hierarchies.size());
+	hdr.checksum = iChecksum;
+
+	std::vector<unsigned char> buffer;
+
+	appendData(&buffer, &hdr, 1);
+
+	for ( const CContractionHierarchy &hierarchy : hierarchies )
+		hierarchy.serialise(&buffer);
+
+	return RCBot_CompressedSave(szFilename, buffer.data(), buffer.size());
+}
+
+bool CContractionHierarchy :: load ( const char *szFilename, std::vector<CContractionHierarchy> *hierarchies, const unsigned int iChecksum, const int iNumWaypoints )
+{
+	std::size_t iSize;
+
+	if ( !RCBot_CompressedSize(szFilename, &iSize) || iSize < sizeof(wpt_ch_hdr_t) )
+		return false;
+
+	std::vector<unsigned char> buffer(iSize);
+
+	if ( !RCBot_CompressedLoad(szFilename, buffer.data(), iSize) )
+		return false;
+
+	const unsigned char *pData = buffer.data();
+	const unsigned char *pEnd = buffer.data() + buffer.size();
+
+	wpt_ch_hdr_t hdr;
+
+	readData(&pData, pEnd, &hdr, 1);
+
+	if ( hdr.version != WPT_CH_VER || hdr.numwaypoints != iNumWaypoints || hdr.checksum != iChecksum || hdr.numhierarchies != NUM_TEAM_MASKS )
+		return false;
+
+	hierarchies->assign(NUM_TEAM_MASKS, CContractionHierarchy());
+
+	for ( CContractionHierarchy &hierarchy : *hierarchies )
+	{
+		if ( !hierarchy.deserialise(&pData, pEnd) || hierarchy.numNodes() != iNumWaypoints )
+		{
+			hierarchies->clear();
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,123 @@
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef __RCBOT_WAYPOINT_CH_H__
+#define __RCBOT_WAYPOINT_CH_H__
+
+// This file doesn't use the engine or the SDK so that the standalone tools
+// (utils/rcbot_tools) can build hierarchies ahead of time too.
+
+#include <cstdint>
+#include <vector>
+
+constexpr const char* BOT_WAYPOINT_CH_EXTENSION = "rcch";
+
+// same bits as CWaypointTypes
+constexpr int CH_FL_UNREACHABLE = 1 << 2;
+constexpr int CH_FL_NOTEAM_A = 1 << 6; // W_FL_NOBLU, W_FL_NOAXIS, W_FL_NOTERRORIST
+constexpr int CH_FL_NOTEAM_B = 1 << 7; // W_FL_NORED, W_FL_NOALLIES, W_FL_NOCOUNTERTR
+constexpr int CH_FL_TELEPORT = 1 << 28;
+
+// waypoints as the hierarchy needs them, from the game or read from a .rcw file
+typedef struct
+{
+	std::vector<float> fOrigins; // x, y, z for each waypoint
+	std::vector<int> iFlags;
+	std::vector<std::uint8_t> bUsed;
+	std::vector<int> iPathOffsets; // paths of waypoint i are iPathOffsets[i] up to iPathOffsets[i+1]
+	std::vector<int> iPathTargets;
+}ch_waypoints_t;
+
+// Contraction hierarchy over the waypoint paths.
+//
+// Waypoints are taken out ("contracted") one at a time, least important
+// first, adding shortcut paths between their neighbours wherever the route
+// between them went through the contracted waypoint. A route query then
+// only ever climbs to more important waypoints from both ends (bidirectional
+// Dijkstra), which expands a few hundred waypoints on maps of thousands.
+//
+// Path costs are static (distance, nothing for leaving a teleport), so one
+// hierarchy is built for each set of team-only waypoints left out.
+class CContractionHierarchy
+{
+public:
+	// contract every waypoint usable without iExcludeFlags
+	void build ( const ch_waypoints_t &waypoints, int iExcludeFlags );
+
+	// waypoints after iStart, in order, ending with iGoal
+	bool findRoute ( int iStart, int iGoal, std::vector<int> *route, float *fDistance, unsigned int *iExpanded ) const;
+
+	int getExcludeFlags () const { return m_iExcludeFlags; }
+	int numNodes () const { return static_cast<int>(m_iRank.size()); }
+	int numEdges () const { return static_cast<int>(m_UpEdges.size() + m_DownEdges.size()); }
+	int numShortcuts () const { return m_iShortcuts; }
+
+	// changes when anything a hierarchy is built from changes
+	static unsigned int checksum ( const ch_waypoints_t &waypoints );
+
+	// a hierarchy for every team mask in one compressed file
+	static void buildAll ( const ch_waypoints_t &waypoints, std::vector<CContractionHierarchy> *hierarchies );
+	static bool save ( const char *szFilename, const std::vector<CContractionHierarchy> &hierarchies, unsigned int iChecksum, int iNumWaypoints );
+	static bool load ( const char *szFilename, std::vector<CContractionHierarchy> *hierarchies, unsigned int iChecksum, int iNumWaypoints );
+
+	static constexpr int NUM_TEAM_MASKS = 3;
+	static constexpr int TEAM_MASKS[NUM_TEAM_MASKS] = { 0, CH_FL_NOTEAM_A, CH_FL_NOTEAM_B };
+
+	// waypoints settled by each witness search while contracting
+	static constexpr int MAX_WITNESS_SETTLED = 500;
+private:
+	typedef struct
+	{
+		int iTarget;
+		int iMiddle; // contracted waypoint this shortcut goes through, -1 for a waypoint path
+		float fWeight;
+	}ch_edge_t;
+
+	// path from iFrom to iTo, one of them is the other's neighbour in the hierarchy
+	const ch_edge_t *findEdge ( int iFrom, int iTo ) const;
+	// false if an edge is missing, route is then left incomplete
+	bool unpackEdge ( int iFrom, int iTo, std::vector<int> *route ) const;
+
+	void serialise ( std::vector<unsigned char> *buffer ) const;
+	bool deserialise ( const unsigned char **pData, const unsigned char *pEnd );
+
+	int m_iExcludeFlags = 0;
+	int m_iShortcuts = 0;
+
+	std::vector<int> m_iRank;
+	// edges to more important waypoints, leaving waypoint i
+	std::vector<int> m_iUpOffsets;
+	std::vector<ch_edge_t> m_UpEdges;
+	// edges from more important waypoints, arriving at waypoint i (iTarget is where they come from)
+	std::vector<int> m_iDownOffsets;
+	std::vector<ch_edge_t> m_DownEdges;
+};
+
+#endif
@@ -0,0 +1,497 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include "bot.h"
+#include "bot_globals.h"
+#include "bot_waypoint.h"
+#include "bot_waypoint_flow.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#ifdef RCBOT_VPROF_ENABLED
+#include <tier0/vprof.h>
+#endif // RCBOT_VPROF_ENABLED
+
+std::vector<std::unique_ptr<CWaypointFlowField>> CWaypointFlowFields::m_Fields;
+std::unordered_map<std::uint32_t,CWaypointFlowFields::flow_demand_t> CWaypointFlowFields::m_Demand;
+
+std::vector<float> CWaypointFlowFields::m_fTeamBelief[MAX_FLOW_TEAMS];
+std::vector<int> CWaypointFlowFields::m_iBeliefDirty[MAX_FLOW_TEAMS];
+unsigned int CWaypointFlowFields::m_iBeliefRevision = 0;
+
+unsigned int CWaypointFlowFields::m_iOpensLaterEpoch = 0;
+unsigned int CWaypointFlowFields::m_iFieldsOpensLaterEpoch = 0;
+
+unsigned int CWaypointFlowFields::m_iRoutes = 0;
+unsigned int CWaypointFlowFields::m_iBuilt = 0;
+unsigned int CWaypointFlowFields::m_iExpanded = 0;
+
+static constexpr float FLOW_INFINITY = std::numeric_limits<float>::infinity();
+
+// waypoints only some bots of a team can use, depending on class or what
+// they are carrying, are left out of team routes
+static int flowConditionalFlags ()
+{
+	if ( CBotGlobals::isMod(MOD_TF2) )
+	{
+		return CWaypointTypes::W_FL_ROCKET_JUMP | CWaypointTypes::W_FL_DOUBLEJUMP | CWaypointTypes::W_FL_WAIT_GROUND |
+			CWaypointTypes::W_FL_NO_FLAG | CWaypointTypes::W_FL_FLAGONLY | CWaypointTypes::W_FL_OWNER_ONLY | CWaypointTypes::W_FL_AREAONLY;
+	}
+
+	if ( CBotGlobals::isMod(MOD_DOD) )
+		return CWaypointTypes::W_FL_BOMB_TO_OPEN | CWaypointTypes::W_FL_BREAKABLE;
+
+	return 0;
+}
+
+CWaypointFlowField :: CWaypointFlowField ( const int iTeam, const int iGoal ) : m_iTeam(iTeam), m_iGoal(iGoal)
+{
+	reset();
+}
+
+void CWaypointFlowField :: reset ()
+{
+	m_pGraph = CWaypointGraphSnapshot::get();
+
+	const int iNumWaypoints = m_pGraph->numWaypoints();
+	const std::size_t iSize = static_cast<std::size_t>(iNumWaypoints);
+	const int iConditionalFlags = flowConditionalFlags();
+
+	m_fG.assign(iSize, FLOW_INFINITY);
+	m_fRhs.assign(iSize, FLOW_INFINITY);
+	m_fNodeCost.assign(iSize, 0.0f);
+	m_fQueuedKey.assign(iSize, -1.0f);
+	m_bUsable.assign(iSize, 0);
+	m_bPathClosed.assign(static_cast<std::size_t>(m_pGraph->numPaths()), 0);
+	m_iOpensLaterPaths.clear();
+
+	m_Queue = decltype(m_Queue)();
+
+	for ( int i = 0; i < iNumWaypoints; i ++ )
+	{
+		CWaypoint *pWpt = CWaypoints::getWaypoint(i);
+
+		m_bUsable[i] = pWpt->isUsed() && !pWpt->hasFlag(CWaypointTypes::W_FL_UNREACHABLE) &&
+			!pWpt->hasSomeFlags(iConditionalFlags) && pWpt->forTeam(m_iTeam);
+
+		for ( int iPath = m_pGraph->getPathsBegin(i); iPath < m_pGraph->getPathsEnd(i); iPath ++ )
+		{
+			if ( m_pGraph->hasSomeFlags(m_pGraph->getPathTarget(iPath), CWaypointTypes::W_FL_OPENS_LATER) )
+				m_iOpensLaterPaths.emplace_back(iPath);
+		}
+	}
+
+	if ( m_iGoal < 0 || m_iGoal >= iNumWaypoints )
+		return;
+
+	updateOpensLater();
+
+	m_fRhs[m_iGoal] = 0.0f;
+	queue(m_iGoal);
+}
+
+void CWaypointFlowField :: updateOpensLater ()
+{
+	for ( const int iPath : m_iOpensLaterPaths )
+	{
+		const int iFrom = m_pGraph->getPathSource(iPath);
+		const int iTo = m_pGraph->getPathTarget(iPath);
+
+		const std::uint8_t bClosed = !CWaypoints::getWaypoint(iFrom)->isPathOpened(m_pGraph->getOrigin(iTo));
+
+		if ( bClosed != m_bPathClosed[iPath] )
+		{
+			m_bPathClosed[iPath] = bClosed;
+			updateVertex(iFrom);
+		}
+	}
+}
+
+void CWaypointFlowField :: setNodeCost ( const int iWpt, const float fCost )
+{
+	if ( iWpt < 0 || iWpt >= static_cast<int>(m_fNodeCost.size()) || m_fNodeCost[iWpt] == fCost )
+		return;
+
+	m_fNodeCost[iWpt] = fCost;
+
+	// costs of the paths into this waypoint changed
+	updatePredecessors(iWpt);
+}
+
+bool CWaypointFlowField :: compute ( const int iMaxLoops )
+{
+	int iLoops = 0;
+
+	while ( !m_Queue.empty() )
+	{
+		if ( iLoops++ >= iMaxLoops )
+			return false;
+
+		const flow_queue_item_t item = m_Queue.top();
+		m_Queue.pop();
+
+		const int iWpt = item.second;
+
+		// queued again since
+		if ( item.first != m_fQueuedKey[iWpt] )
+			continue;
+
+		m_fQueuedKey[iWpt] = -1.0f;
+
+		if ( m_fG[iWpt] == m_fRhs[iWpt] )
+			continue;
+
+		m_iNodesExpanded++;
+
+		if ( m_fG[iWpt] > m_fRhs[iWpt] )
+			m_fG[iWpt] = m_fRhs[iWpt];
+		else
+		{
+			m_fG[iWpt] = FLOW_INFINITY;
+			updateVertex(iWpt);
+		}
+
+		updatePredecessors(iWpt);
+	}
+
+	return true;
+}
+
+bool CWaypointFlowField :: getRoute ( const int iStart, WaypointList *route, float *fDistance ) const
+{
+	if ( iStart < 0 || iStart >= m_pGraph->numWaypoints() || m_fG[iStart] == FLOW_INFINITY )
+		return false;
+
+	const int iNumWaypoints = m_pGraph->numWaypoints();
+	int iCurrent = iStart;
+
+	route->clear();
+	*fDistance = 0.0f;
+
+	while ( iCurrent != m_iGoal )
+	{
+		if ( static_cast<int>(route->size()) > iNumWaypoints )
+			return false;
+
+		int iBestPath = -1;
+		float fBest = FLOW_INFINITY;
+
+		const int iPathsEnd = m_pGraph->getPathsEnd(iCurrent);
+
+		// downhill to the goal
+		for ( int iPath = m_pGraph->getPathsBegin(iCurrent); iPath < iPathsEnd; iPath ++ )
+		{
+			const float fCost = pathCost(iPath) + m_fG[m_pGraph->getPathTarget(iPath)];
+
+			if ( fCost < fBest )
+			{
+				fBest = fCost;
+				iBestPath = iPath;
+			}
+		}
+
+		if ( iBestPath == -1 )
+			return false;
+
+		*fDistance += m_pGraph->getPathLength(iBestPath);
+		iCurrent = m_pGraph->getPathTarget(iBestPath);
+		route->emplace_back(iCurrent);
+	}
+
+	return true;
+}
+
+// same path costs as CWaypointNavigator::searchRoute for a whole team
+float CWaypointFlowField :: pathCost ( const int iPath ) const
+{
+	const int iTo = m_pGraph->getPathTarget(iPath);
+
+	if ( m_bPathClosed[iPath] || (iTo != m_iGoal && !m_bUsable[iTo]) )
+		return FLOW_INFINITY;
+
+	if ( m_pGraph->getPathFlags(iPath) & CWaypointGraphSnapshot::PATH_FROM_TELEPORT )
+		return m_fNodeCost[iTo];
+
+	return m_pGraph->getPathLength(iPath) + m_fNodeCost[iTo];
+}
+
+void CWaypointFlowField :: updateVertex ( const int iWpt )
+{
+	if ( iWpt != m_iGoal )
+	{
+		const int iPathsEnd = m_pGraph->getPathsEnd(iWpt);
+		float fRhs = FLOW_INFINITY;
+
+		for ( int iPath = m_pGraph->getPathsBegin(iWpt); iPath < iPathsEnd; iPath ++ )
+		{
+			const int iSucc = m_pGraph->getPathTarget(iPath);
+
+			if ( m_fG[iSucc] == FLOW_INFINITY )
+				continue;
+
+			fRhs = std::min(fRhs, pathCost(iPath) + m_fG[iSucc]);
+		}
+
+		m_fRhs[iWpt] = fRhs;
+	}
+
+	if ( m_fG[iWpt] != m_fRhs[iWpt] )
+		queue(iWpt);
+}
+
+void CWaypointFlowField :: updatePredecessors ( const int iWpt )
+{
+	const int iEnd = m_pGraph->getPathsFromEnd(iWpt);
+
+	for ( int i = m_pGraph->getPathsFromBegin(iWpt); i < iEnd; i ++ )
+		updateVertex(m_pGraph->getPathSource(m_pGraph->getPathFrom(i)));
+}
+
+void CWaypointFlowField :: queue ( const int iWpt )
+{
+	const float fKey = std::min(m_fG[iWpt], m_fRhs[iWpt]);
+
+	if ( fKey == m_fQueuedKey[iWpt] )
+		return;
+
+	m_fQueuedKey[iWpt] = fKey;
+	m_Queue.emplace(fKey, iWpt);
+}
+
+CWaypointFlowField *CWaypointFlowFields :: findField ( const int iTeam, const int iGoal )
+{
+	for ( const std::unique_ptr<CWaypointFlowField> &pField : m_Fields )
+	{
+		if ( pField->getTeam() == iTeam && pField->getGoal() == iGoal )
+			return pField.get();
+	}
+
+	return nullptr;
+}
+
+void CWaypointFlowFields :: addField ( const int iTeam, const int iGoal )
+{
+	if ( static_cast<int>(m_Fields.size()) >= MAX_FLOW_FIELDS )
+	{
+		// make room : drop the one unused for longest
+		const auto it = std::min_element(m_Fields.begin(), m_Fields.end(),
+			[](const std::unique_ptr<CWaypointFlowField> &a, const std::unique_ptr<CWaypointFlowField> &b)
+			{
+				return a->m_fLastUsed < b->m_fLastUsed;
+			});
+
+		m_Fields.erase(it);
+	}
+
+	std::unique_ptr<CWaypointFlowField> pField = std::make_unique<CWaypointFlowField>(iTeam, iGoal);
+	const std::vector<float> &fBelief = m_fTeamBelief[iTeam];
+
+	for ( std::size_t i = 0; i < fBelief.size(); i ++ )
+		pField->setNodeCost(static_cast<int>(i), fBelief[i]);
+
+	pField->m_fLastUsed = engine->Time();
+
+	m_Fields.emplace_back(std::move(pField));
+	m_iBuilt++;
+}
+
+bool CWaypointFlowFields :: getRoute ( const int iTeam, const int iStart, const int iGoal, WaypointList *route, float *fDistance )
+{
+	if ( iTeam < 0 || iTeam >= MAX_FLOW_TEAMS || iGoal < 0 )
+		return false;
+
+	CWaypointFlowField *pField = findField(iTeam, iGoal);
+
+	if ( pField != nullptr )
+	{
+		pField->m_fLastUsed = engine->Time();
+
+		if ( !pField->isReady() || pField->isStale() || !pField->getRoute(iStart, route, fDistance) )
+			return false;
+
+		m_iRoutes++;
+
+		return true;
+	}
+
+	// enough bots going here to be worth a field
+	const float fTime = engine->Time();
+	flow_demand_t &demand = m_Demand[static_cast<std::uint32_t>(iTeam) << 16 | static_cast<std::uint32_t>(iGoal)];
+
+	if ( demand.iRequests == 0 || demand.fFirstRequest + FLOW_DEMAND_TIME < fTime )
+	{
+		demand.fFirstRequest = fTime;
+		demand.iRequests = 0;
+	}
+
+	if ( ++demand.iRequests >= FLOW_MIN_REQUESTS )
+	{
+		m_Demand.erase(static_cast<std::uint32_t>(iTeam) << 16 | static_cast<std::uint32_t>(iGoal));
+		addField(iTeam, iGoal);
+	}
+
+	return false;
+}
+
+void CWaypointFlowFields :: think ()
+{
+#ifdef RCBOT_VPROF_ENABLED
+	VPROF_BUDGET("CWaypointFlowFields::think", "RCBot2")
+#endif // RCBOT_VPROF_ENABLED
+
+	if ( m_Fields.empty() )
+	{
+		for ( std::vector<int> &dirty : m_iBeliefDirty )
+			dirty.clear();
+
+		return;
+	}
+
+	const float fTime = engine->Time();
+	const bool bOpensLaterChanged = m_iFieldsOpensLaterEpoch != m_iOpensLaterEpoch;
+
+	m_iFieldsOpensLaterEpoch = m_iOpensLaterEpoch;
+
+	m_Fields.erase(std::remove_if(m_Fields.begin(), m_Fields.end(), [fTime](const std::unique_ptr<CWaypointFlowField> &pField)
+	{
+		return pField->m_fLastUsed + FLOW_UNUSED_TIME < fTime;
+	}), m_Fields.end());
+
+	int iLoops = FLOW_LOOPS_PER_FRAME;
+
+	for ( const std::unique_ptr<CWaypointFlowField> &pField : m_Fields )
+	{
+		if ( pField->isStale() )
+		{
+			pField->reset();
+
+			const std::vector<float> &fBelief = m_fTeamBelief[pField->getTeam()];
+
+			for ( std::size_t i = 0; i < fBelief.size(); i ++ )
+				pField->setNodeCost(static_cast<int>(i), fBelief[i]);
+		}
+		else
+		{
+			if ( bOpensLaterChanged )
+				pField->updateOpensLater();
+
+			const std::vector<float> &fBelief = m_fTeamBelief[pField->getTeam()];
+
+			for ( const int iWpt : m_iBeliefDirty[pField->getTeam()] )
+				pField->setNodeCost(iWpt, fBelief[static_cast<std::size_t>(iWpt)]);
+		}
+
+		if ( iLoops > 0 )
+		{
+			const unsigned int iExpandedBefore = pField->getNodesExpanded();
+
+			pField->compute(iLoops);
+
+			const unsigned int iExpanded = pField->getNodesExpanded() - iExpandedBefore;
+
+			m_iExpanded += iExpanded;
+			iLoops -= static_cast<int>(iExpanded);
+		}
+	}
+
+	for ( std::vector<int> &dirty : m_iBeliefDirty )
+		dirty.clear();
+}
+
+void CWaypointFlowFields :: beliefChanged ( const int iTeam, const int iWpt, const float fBelief )
+{
+	if ( iTeam < 0 || iTeam >= MAX_FLOW_TEAMS || iWpt < 0 )
+		return;
+
+	// belief of other waypoints (or another map)
+	if ( m_iBeliefRevision != CWaypoints::getGraphRevision() )
+	{
+		m_iBeliefRevision = CWaypoints::getGraphRevision();
+
+		for ( int i = 0; i < MAX_FLOW_TEAMS; i ++ )
+		{
+			m_fTeamBelief[i].clear();
+			m_iBeliefDirty[i].clear();
+		}
+	}
+
+	std::vector<float> &fTeamBelief = m_fTeamBelief[iTeam];
+
+	if ( iWpt >= static_cast<int>(fTeamBelief.size()) )
+		fTeamBelief.resize(static_cast<std::size_t>(CWaypoints::numWaypoints()), 0.0f);
+	if ( iWpt >= static_cast<int>(fTeamBelief.size()) )
+		return;
+
+	// small changes aren't worth searching again for
+	if ( std::fabs(fTeamBelief[iWpt] - fBelief) < FLOW_BELIEF_STEP )
+		return;
+
+	fTeamBelief[iWpt] = fBelief;
+
+	if ( !m_Fields.empty() )
+		m_iBeliefDirty[iTeam].emplace_back(iWpt);
+}
+
+void CWaypointFlowFields :: beliefLoaded ( const int iTeam, const float *fBelief, const int iNumWaypoints )
+{
+	for ( int i = 0; i < iNumWaypoints; i ++ )
+		beliefChanged(iTeam, i, fBelief[i]);
+}
+
+void CWaypointFlowFields :: getStats ( unsigned int *iRoutes, unsigned int *iBuilt, unsigned int *iExpanded )
+{
+	*iRoutes = m_iRoutes;
+	*iBuilt = m_iBuilt;
+	*iExpanded = m_iExpanded;
+}
+
+void CWaypointFlowFields :: resetStats ()
+{
+	m_iRoutes = 0;
+	m_iBuilt = 0;
+	m_iExpanded = 0;
+}
+
+void CWaypointFlowFields :: freeMemory ()
+{
+	m_Fields.clear();
+	m_Demand.clear();
+
+	for ( int i = 0; i < MAX_FLOW_TEAMS; i ++ )
+	{
+		m_fTeamBelief[i].clear();
+		m_iBeliefDirty[i].clear();
+	}
+}
@@ -0,0 +1,167 @@
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef __RCBOT_WAYPOINT_FLOW_H__
+#define __RCBOT_WAYPOINT_FLOW_H__
+
+#include "bot_waypoint.h"
+#include "bot_waypoint_snapshot.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Cost to reach one goal from every waypoint, for one team.
+//
+// Searched backwards from the goal like Dijkstra, but kept up to date
+// incrementally (LPA*) : when a door opens or closes or the team's danger
+// belief changes only waypoints whose cost depends on it are searched again.
+// Bots read their next waypoint towards the goal straight from it.
+class CWaypointFlowField
+{
+public:
+	CWaypointFlowField ( int iTeam, int iGoal );
+
+	int getTeam () const { return m_iTeam; }
+	int getGoal () const { return m_iGoal; }
+
+	// carry on searching, returns false if there is still work to do
+	bool compute ( int iMaxLoops );
+
+	bool isReady () const { return m_Queue.empty(); }
+
+	// waypoints after iStart, in order, ending with the goal
+	bool getRoute ( int iStart, WaypointList *route, float *fDistance ) const;
+
+	// waypoints were edited, search from scratch
+	bool isStale () const { return m_pGraph->getRevision() != CWaypoints::getGraphRevision(); }
+	void reset ();
+
+	void setNodeCost ( int iWpt, float fCost );
+
+	// check doors and lifts again
+	void updateOpensLater ();
+
+	unsigned int getNodesExpanded () const { return m_iNodesExpanded; }
+
+	float m_fLastUsed = 0.0f;
+private:
+	float pathCost ( int iPath ) const;
+
+	void updateVertex ( int iWpt );
+	void updatePredecessors ( int iWpt );
+	void queue ( int iWpt );
+
+	typedef std::pair<float,int> flow_queue_item_t;
+
+	std::shared_ptr<const CWaypointGraphSnapshot> m_pGraph;
+
+	int m_iTeam;
+	int m_iGoal;
+	unsigned int m_iNodesExpanded = 0;
+
+	std::vector<float> m_fG;
+	std::vector<float> m_fRhs;
+	std::vector<float> m_fNodeCost;
+	std::vector<float> m_fQueuedKey; // -1 if not queued
+	std::vector<std::uint8_t> m_bUsable; // waypoint can be used by the whole team
+	std::vector<std::uint8_t> m_bPathClosed; // one for each snapshot path
+	std::vector<int> m_iOpensLaterPaths;
+
+	// entries whose key no longer matches m_fQueuedKey are skipped
+	std::priority_queue<flow_queue_item_t,std::vector<flow_queue_item_t>,std::greater<>> m_Queue;
+};
+
+// Flow fields for goals that many bots of a team go to at once (payload
+// cart, control points, flags), so one search serves all of them.
+//
+// A field is made once a few bots of a team have asked for routes to the
+// same goal, worked on a bit each frame and dropped when nobody has used it
+// for a while. Bots check every path of the route against their own class
+// and search themselves if they can't use it.
+class CWaypointFlowFields
+{
+public:
+	// route from iStart to the goal if a field is ready for it
+	static bool getRoute ( int iTeam, int iStart, int iGoal, WaypointList *route, float *fDistance );
+
+	// called from CBots::botThink
+	static void think ();
+
+	static void beliefChanged ( int iTeam, int iWpt, float fBelief );
+	static void beliefLoaded ( int iTeam, const float *fBelief, int iNumWaypoints );
+	static void opensLaterChanged () { m_iOpensLaterEpoch++; }
+
+	static int numFields () { return static_cast<int>(m_Fields.size()); }
+
+	static void getStats ( unsigned int *iRoutes, unsigned int *iBuilt, unsigned int *iExpanded );
+	static void resetStats ();
+
+	static void freeMemory ();
+
+	static constexpr int MAX_FLOW_FIELDS = 8;
+	static constexpr int MAX_FLOW_TEAMS = 8;
+	// bots asking for the same goal before a field is made for it
+	static constexpr int FLOW_MIN_REQUESTS = 3;
+	static constexpr float FLOW_DEMAND_TIME = 10.0f;
+	static constexpr float FLOW_UNUSED_TIME = 60.0f;
+	static constexpr int FLOW_LOOPS_PER_FRAME = 1000;
+	// danger belief is only passed on in steps this big
+	static constexpr float FLOW_BELIEF_STEP = 10.0f;
+private:
+	typedef struct
+	{
+		float fFirstRequest;
+		int iRequests;
+	}flow_demand_t;
+
+	static CWaypointFlowField *findField ( int iTeam, int iGoal );
+	static void addField ( int iTeam, int iGoal );
+
+	static std::vector<std::unique_ptr<CWaypointFlowField>> m_Fields;
+	static std::unordered_map<std::uint32_t,flow_demand_t> m_Demand;
+
+	static std::vector<float> m_fTeamBelief[MAX_FLOW_TEAMS];
+	static std::vector<int> m_iBeliefDirty[MAX_FLOW_TEAMS];
+	static unsigned int m_iBeliefRevision;
+
+	static unsigned int m_iOpensLaterEpoch;
+	static unsigned int m_iFieldsOpensLaterEpoch;
+
+	static unsigned int m_iRoutes;
+	static unsigned int m_iBuilt;
+	static unsigned int m_iExpanded;
+};
+
+#endif
@@ -0,0 +1,255 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include "bot.h"
+#include "bot_globals.h"
+#include "bot_waypoint.h"
+#include "bot_waypoint_hierarchy.h"
+#include "bot_waypoint_snapshot.h"
+
+#include "rcbot/logging.h"
+
+#include <chrono>
+
+#ifdef RCBOT_VPROF_ENABLED
+#include <tier0/vprof.h>
+#endif // RCBOT_VPROF_ENABLED
+
+std::vector<CContractionHierarchy> CWaypointHierarchies::m_Hierarchies;
+unsigned int CWaypointHierarchies::m_iRevision = 0;
+int CWaypointHierarchies::m_iTeamOnlyWaypoint[CContractionHierarchy::NUM_TEAM_MASKS] = { -1, -1, -1 };
+
+unsigned int CWaypointHierarchies::m_iRoutes = 0;
+unsigned int CWaypointHierarchies::m_iRejected = 0;
+unsigned int CWaypointHierarchies::m_iExpanded = 0;
+
+void CWaypointHierarchies :: getWaypoints ( const CWaypointGraphSnapshot *pGraph, ch_waypoints_t *waypoints )
+{
+	const int iNumWaypoints = pGraph->numWaypoints();
+
+	waypoints->fOrigins.resize(static_cast<std::size_t>(iNumWaypoints) * 3);
+	waypoints->iFlags.resize(static_cast<std::size_t>(iNumWaypoints));
+	waypoints->bUsed.resize(static_cast<std::size_t>(iNumWaypoints));
+	waypoints->iPathOffsets.resize(static_cast<std::size_t>(iNumWaypoints) + 1);
+	waypoints->iPathTargets.resize(static_cast<std::size_t>(pGraph->numPaths()));
+
+	for ( int i = 0; i < iNumWaypoints; i ++ )
+	{
+		const Vector &vOrigin = pGraph->getOrigin(i);
+
+		waypoints->fOrigins[static_cast<std::size_t>(i) * 3] = vOrigin.x;
+		waypoints->fOrigins[static_cast<std::size_t>(i) * 3 + 1] = vOrigin.y;
+		waypoints->fOrigins[static_cast<std::size_t>(i) * 3 + 2] = vOrigin.z;
+		waypoints->iFlags[i] = pGraph->getFlags(i);
+		waypoints->bUsed[i] = pGraph->isUsed(i) ? 1 : 0;
+		waypoints->iPathOffsets[i] = pGraph->getPathsBegin(i);
+	}
+
+	waypoints->iPathOffsets[iNumWaypoints] = pGraph->numPaths();
+
+	for ( int iPath = 0; iPath < pGraph->numPaths(); iPath ++ )
+		waypoints->iPathTargets[iPath] = pGraph->getPathTarget(iPath);
+}
+
+void CWaypointHierarchies :: findTeamOnlyWaypoints ( const CWaypointGraphSnapshot *pGraph )
+{
+	for ( int i = 0; i < CContractionHierarchy::NUM_TEAM_MASKS; i ++ )
+	{
+		m_iTeamOnlyWaypoint[i] = -1;
+
+		if ( CContractionHierarchy::TEAM_MASKS[i] == 0 )
+			continue;
+
+		for ( int iWpt = 0; iWpt < pGraph->numWaypoints(); iWpt ++ )
+		{
+			if ( pGraph->isUsed(iWpt) && pGraph->hasSomeFlags(iWpt,CContractionHierarchy::TEAM_MASKS[i]) )
+			{
+				m_iTeamOnlyWaypoint[i] = iWpt;
+				break;
+			}
+		}
+	}
+}
+
+void CWaypointHierarchies :: buildFileName ( char *szFilename )
+{
+	CBotGlobals::buildFileName(szFilename, CBotGlobals::getMapName(), BOT_AUXILERY_FOLDER, BOT_WAYPOINT_CH_EXTENSION, true);
+}
+
+void CWaypointHierarchies :: load ()
+{
+	freeMemory();
+
+	const char* szMapName = CBotGlobals::getMapName();
+
+	if ( szMapName == nullptr || *szMapName == 0 )
+		return;
+
+	char filename[1024];
+
+	buildFileName(filename);
+
+	const CWaypointGraphSnapshot *pGraph = CWaypointGraphSnapshot::current();
+	ch_waypoints_t waypoints;
+
+	getWaypoints(pGraph, &waypoints);
+
+	// no file is normal, they are only made on request
+	if ( !CContractionHierarchy::load(filename, &m_Hierarchies, CContractionHierarchy::checksum(waypoints), pGraph->numWaypoints()) )
+	{
+		m_Hierarchies.clear();
+		return;
+	}
+
+	m_iRevision = pGraph->getRevision();
+	findTeamOnlyWaypoints(pGraph);
+
+	logger->Log(LogLevel::INFO, "Loaded waypoint contraction hierarchies (%d shortcuts)", numShortcuts());
+}
+
+bool CWaypointHierarchies :: build ()
+{
+#ifdef RCBOT_VPROF_ENABLED
+	VPROF_BUDGET("CWaypointHierarchies::build", "RCBot2")
+#endif // RCBOT_VPROF_ENABLED
+
+	freeMemory();
+
+	const CWaypointGraphSnapshot *pGraph = CWaypointGraphSnapshot::current();
+	ch_waypoints_t waypoints;
+
+	getWaypoints(pGraph, &waypoints);
+
+	const auto start = std::chrono::steady_clock::now();
+
+	CContractionHierarchy::buildAll(waypoints, &m_Hierarchies);
+
+	m_iRevision = pGraph->getRevision();
+	findTeamOnlyWaypoints(pGraph);
+
+	logger->Log(LogLevel::INFO, "Built waypoint contraction hierarchies in %0.2fs (%d shortcuts)",
+		std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), numShortcuts());
+
+	const char* szMapName = CBotGlobals::getMapName();
+
+	if ( szMapName == nullptr || *szMapName == 0 )
+		return false;
+
+	char filename[1024];
+
+	buildFileName(filename);
+
+	CBotGlobals::makeFolders(filename);
+
+	return CContractionHierarchy::save(filename, m_Hierarchies, CContractionHierarchy::checksum(waypoints), pGraph->numWaypoints());
+}
+
+void CWaypointHierarchies :: freeMemory ()
+{
+	m_Hierarchies.clear();
+	m_Hierarchies.shrink_to_fit();
+
+	for ( int &iWpt : m_iTeamOnlyWaypoint )
+		iWpt = -1;
+}
+
+int CWaypointHierarchies :: numShortcuts ()
+{
+	int iShortcuts = 0;
+
+	for ( const CContractionHierarchy &hierarchy : m_Hierarchies )
+		iShortcuts += hierarchy.numShortcuts();
+
+	return iShortcuts;
+}
+
+const CContractionHierarchy *CWaypointHierarchies :: forTeam ( const int iTeam )
+{
+	int iExclude = 0;
+
+	for ( int i = 1; i < CContractionHierarchy::NUM_TEAM_MASKS; i ++ )
+	{
+		CWaypoint *pWpt = CWaypoints::getWaypoint(m_iTeamOnlyWaypoint[i]);
+
+		// the mod decides, e.g. TF2 lets everyone through once the round is over
+		if ( pWpt != nullptr && !pWpt->forTeam(iTeam) )
+			iExclude |= CContractionHierarchy::TEAM_MASKS[i];
+	}
+
+	for ( const CContractionHierarchy &hierarchy : m_Hierarchies )
+	{
+		if ( hierarchy.getExcludeFlags() == iExclude )
+			return &hierarchy;
+	}
+
+	return nullptr;
+}
+
+bool CWaypointHierarchies :: getRoute ( const int iTeam, const int iStart, const int iGoal, WaypointList *route, float *fDistance )
+{
+#ifdef RCBOT_VPROF_ENABLED
+	VPROF_BUDGET("CWaypointHierarchies::getRoute", "RCBot2")
+#endif // RCBOT_VPROF_ENABLED
+
+	if ( m_Hierarchies.empty() || isStale() )
+		return false;
+
+	const CContractionHierarchy *pHierarchy = forTeam(iTeam);
+
+	if ( pHierarchy == nullptr )
+		return false;
+
+	unsigned int iExpanded = 0;
+	const bool bFound = pHierarchy->findRoute(iStart, iGoal, route, fDistance, &iExpanded);
+
+	m_iExpanded += iExpanded;
+
+	if ( bFound )
+		m_iRoutes++;
+
+	return bFound;
+}
+
+void CWaypointHierarchies :: getStats ( unsigned int *iRoutes, unsigned int *iRejected, unsigned int *iExpanded )
+{
+	*iRoutes = m_iRoutes;
+	*iRejected = m_iRejected;
+	*iExpanded = m_iExpanded;
+}
+
+void CWaypointHierarchies :: resetStats ()
+{
+	m_iRoutes = 0;
+	m_iRejected = 0;
+	m_iExpanded = 0;
+}
@@ -0,0 +1,94 @@
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef __RCBOT_WAYPOINT_HIERARCHY_H__
+#define __RCBOT_WAYPOINT_HIERARCHY_H__
+
+#include "bot_waypoint.h"
+#include "bot_waypoint_ch.h"
+
+#include <vector>
+
+class CWaypointGraphSnapshot;
+
+// Contraction hierarchies of this map's waypoints, one for each set of
+// team-only waypoints. They take seconds to build so they are only made by
+// "rcbot waypoint buildch" or the rcbot_ch tool and saved in a .rcch aux
+// file, which is read with the waypoints if it still matches them.
+//
+// Routes from a hierarchy are the shortest by distance only, the navigator
+// checks them against its own danger costs before following one.
+class CWaypointHierarchies
+{
+public:
+	// read this map's hierarchy file, if it matches the waypoints
+	static void load ();
+
+	// contract the current waypoints and save the file, false if it couldn't be saved
+	static bool build ();
+
+	static void freeMemory ();
+
+	// shortest route from iStart to iGoal that iTeam can use, false if there is no up to date hierarchy
+	static bool getRoute ( int iTeam, int iStart, int iGoal, WaypointList *route, float *fDistance );
+
+	// the waypoints were edited since the hierarchies were built
+	static bool isStale () { return m_iRevision != CWaypoints::getGraphRevision(); }
+
+	static int numHierarchies () { return static_cast<int>(m_Hierarchies.size()); }
+	static int numShortcuts ();
+
+	static void routeRejected () { m_iRejected++; }
+
+	static void getStats ( unsigned int *iRoutes, unsigned int *iRejected, unsigned int *iExpanded );
+	static void resetStats ();
+
+	// waypoints the way CContractionHierarchy reads them
+	static void getWaypoints ( const CWaypointGraphSnapshot *pGraph, ch_waypoints_t *waypoints );
+private:
+	// hierarchy with the team-only waypoints iTeam can't use left out
+	static const CContractionHierarchy *forTeam ( int iTeam );
+
+	static void findTeamOnlyWaypoints ( const CWaypointGraphSnapshot *pGraph );
+
+	static void buildFileName ( char *szFilename );
+
+	static std::vector<CContractionHierarchy> m_Hierarchies;
+	static unsigned int m_iRevision;
+
+	// a waypoint with each team-only flag, to ask the mod who can use it
+	static int m_iTeamOnlyWaypoint[CContractionHierarchy::NUM_TEAM_MASKS];
+
+	static unsigned int m_iRoutes;
+	static unsigned int m_iRejected;
+	static unsigned int m_iExpanded;
+};
+
+#endif
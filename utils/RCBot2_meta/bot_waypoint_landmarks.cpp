@@ -0,0 +1,385 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include "bot.h"
+#include "bot_cvars.h"
+#include "bot_globals.h"
+#include "bot_compress.h"
+#include "bot_waypoint.h"
+#include "bot_waypoint_landmarks.h"
+#include "bot_waypoint_snapshot.h"
+
+#include "rcbot/logging.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+#ifdef RCBOT_VPROF_ENABLED
+#include <tier0/vprof.h>
+#endif // RCBOT_VPROF_ENABLED
+
+enum : std::uint8_t
+{
+	WPT_LANDMARK_VER = 0x01
+};
+
+typedef struct
+{
+	int version;
+	int numwaypoints;
+	int numlandmarks;
+	unsigned int checksum;
+}wpt_landmark_hdr_t;
+
+static constexpr float LANDMARK_UNREACHABLE = std::numeric_limits<float>::infinity();
+
+std::shared_ptr<const CWaypointLandmarks> CWaypointLandmarks::m_pCurrent;
+
+int CWaypointLandmarks :: wantedLandmarks ()
+{
+	return std::max(0, std::min(bot_path_landmarks.GetInt(), MAX_LANDMARKS));
+}
+
+std::shared_ptr<const CWaypointLandmarks> CWaypointLandmarks :: get ()
+{
+	if ( m_pCurrent == nullptr || m_pCurrent->getRevision() != CWaypoints::getGraphRevision() || m_pCurrent->m_iWanted != wantedLandmarks() )
+	{
+		const std::shared_ptr<CWaypointLandmarks> pLandmarks = std::make_shared<CWaypointLandmarks>();
+
+		pLandmarks->build(CWaypointGraphSnapshot::current(), wantedLandmarks());
+
+		m_pCurrent = pLandmarks;
+	}
+
+	return m_pCurrent;
+}
+
+const CWaypointLandmarks *CWaypointLandmarks :: current ()
+{
+	return get().get();
+}
+
+void CWaypointLandmarks :: load ()
+{
+	const CWaypointGraphSnapshot *pGraph = CWaypointGraphSnapshot::current();
+	const std::shared_ptr<CWaypointLandmarks> pLandmarks = std::make_shared<CWaypointLandmarks>();
+
+	if ( !pLandmarks->loadFile(pGraph, wantedLandmarks()) )
+	{
+		pLandmarks->build(pGraph, wantedLandmarks());
+		pLandmarks->saveFile(pGraph);
+	}
+
+	m_pCurrent = pLandmarks;
+}
+
+void CWaypointLandmarks :: freeMemory ()
+{
+	m_pCurrent.reset();
+}
+
+float CWaypointLandmarks :: heuristic ( const int iFrom, const int iTo ) const
+{
+	if ( iFrom < 0 || iTo < 0 || iFrom >= m_iNumWaypoints || iTo >= m_iNumWaypoints )
+		return 0.0f;
+
+	float fBest = 0.0f;
+
+	for ( std::size_t i = 0; i < m_iLandmarks.size(); i ++ )
+	{
+		const float *fFrom = &m_fFromLandmark[i * static_cast<std::size_t>(m_iNumWaypoints)];
+		const float *fTo = &m_fToLandmark[i * static_cast<std::size_t>(m_iNumWaypoints)];
+
+		// d(a,b) >= d(L,b) - d(L,a)
+		if ( fFrom[iFrom] != LANDMARK_UNREACHABLE && fFrom[iTo] != LANDMARK_UNREACHABLE )
+			fBest = std::max(fBest, fFrom[iTo] - fFrom[iFrom]);
+
+		// d(a,b) >= d(a,L) - d(b,L)
+		if ( fTo[iFrom] != LANDMARK_UNREACHABLE && fTo[iTo] != LANDMARK_UNREACHABLE )
+			fBest = std::max(fBest, fTo[iFrom] - fTo[iTo]);
+	}
+
+	return fBest;
+}
+
+void CWaypointLandmarks :: build ( const CWaypointGraphSnapshot *pGraph, const int iNumLandmarks )
+{
+#ifdef RCBOT_VPROF_ENABLED
+	VPROF_BUDGET("CWaypointLandmarks::build", "RCBot2")
+#endif // RCBOT_VPROF_ENABLED
+
+	const int iNumWaypoints = pGraph->numWaypoints();
+	const std::size_t iSize = static_cast<std::size_t>(iNumWaypoints);
+
+	m_iNumWaypoints = iNumWaypoints;
+	m_iWanted = iNumLandmarks;
+	m_iRevision = pGraph->getRevision();
+	m_iLandmarks.clear();
+	m_fFromLandmark.clear();
+	m_fToLandmark.clear();
+
+	// closest landmark to each waypoint so far
+	std::vector<float> fNearest(iSize, LANDMARK_UNREACHABLE);
+	int iFirst = -1;
+
+	for ( int i = 0; i < iNumWaypoints && iFirst == -1; i ++ )
+	{
+		if ( pGraph->isUsed(i) && pGraph->getPathsBegin(i) != pGraph->getPathsEnd(i) )
+			iFirst = i;
+	}
+
+	if ( iFirst == -1 || iNumLandmarks <= 0 )
+		return;
+
+	// start from the waypoint furthest from any waypoint, not the first one
+	std::vector<float> fDistances(iSize);
+
+	routeDistances(pGraph, iFirst, false, fDistances.data());
+	fNearest = fDistances;
+
+	while ( static_cast<int>(m_iLandmarks.size()) < iNumLandmarks )
+	{
+		// farthest point : the waypoint furthest from all landmarks so far,
+		// anything unreachable from them first
+		int iLandmark = -1;
+		float fFurthest = -1.0f;
+
+		for ( int i = 0; i < iNumWaypoints; i ++ )
+		{
+			if ( !pGraph->isUsed(i) || pGraph->getPathsBegin(i) == pGraph->getPathsEnd(i) )
+				continue;
+			if ( std::find(m_iLandmarks.begin(), m_iLandmarks.end(), i) != m_iLandmarks.end() )
+				continue;
+
+			if ( fNearest[i] > fFurthest )
+			{
+				fFurthest = fNearest[i];
+				iLandmark = i;
+			}
+		}
+
+		if ( iLandmark == -1 || (fFurthest <= 0.0f && !m_iLandmarks.empty()) )
+			break;
+
+		m_iLandmarks.emplace_back(iLandmark);
+
+		const std::size_t iOffset = m_fFromLandmark.size();
+
+		m_fFromLandmark.resize(iOffset + iSize);
+		m_fToLandmark.resize(iOffset + iSize);
+
+		routeDistances(pGraph, iLandmark, false, &m_fFromLandmark[iOffset]);
+		routeDistances(pGraph, iLandmark, true, &m_fToLandmark[iOffset]);
+
+		// the starting waypoint was only used to find the first landmark
+		if ( m_iLandmarks.size() == 1 )
+			fNearest.assign(m_fFromLandmark.begin() + static_cast<std::ptrdiff_t>(iOffset), m_fFromLandmark.end());
+		else
+		{
+			for ( std::size_t i = 0; i < iSize; i ++ )
+				fNearest[i] = std::min(fNearest[i], m_fFromLandmark[iOffset + i]);
+		}
+	}
+}
+
+void CWaypointLandmarks :: routeDistances ( const CWaypointGraphSnapshot *pGraph, const int iSource, const bool bReverse, float *fDistances )
+{
+	using LandmarkQueueItem = std::pair<float, int>;
+
+	std::priority_queue<LandmarkQueueItem, std::vector<LandmarkQueueItem>, std::greater<>> queue;
+
+	std::fill(fDistances, fDistances + pGraph->numWaypoints(), LANDMARK_UNREACHABLE);
+
+	fDistances[iSource] = 0.0f;
+	queue.emplace(0.0f, iSource);
+
+	while ( !queue.empty() )
+	{
+		const LandmarkQueueItem item = queue.top();
+		queue.pop();
+
+		if ( item.first > fDistances[item.second] )
+			continue; // stale
+
+		const int iBegin = bReverse ? pGraph->getPathsFromBegin(item.second) : pGraph->getPathsBegin(item.second);
+		const int iEnd = bReverse ? pGraph->getPathsFromEnd(item.second) : pGraph->getPathsEnd(item.second);
+
+		for ( int j = iBegin; j < iEnd; j ++ )
+		{
+			const int iPath = bReverse ? pGraph->getPathFrom(j) : j;
+			const int iOther = bReverse ? pGraph->getPathSource(iPath) : pGraph->getPathTarget(iPath);
+
+			// taking a teleport costs nothing
+			const float fPathCost = (pGraph->getPathFlags(iPath) & CWaypointGraphSnapshot::PATH_FROM_TELEPORT) ? 0.0f : pGraph->getPathLength(iPath);
+			const float fCost = item.first + fPathCost;
+
+			if ( fCost < fDistances[iOther] )
+			{
+				fDistances[iOther] = fCost;
+				queue.emplace(fCost, iOther);
+			}
+		}
+	}
+}
+
+unsigned int CWaypointLandmarks :: checksum ( const CWaypointGraphSnapshot *pGraph )
+{
+	// FNV-1a over waypoint positions and paths
+	unsigned int iHash = 2166136261u;
+
+	const auto add = [&iHash](const void *pData, const std::size_t iBytes)
+	{
+		const unsigned char *pByte = static_cast<const unsigned char*>(pData);
+
+		for ( std::size_t i = 0; i < iBytes; i ++ )
+		{
+			iHash ^= pByte[i];
+			iHash *= 16777619u;
+		}
+	};
+
+	for ( int i = 0; i < pGraph->numWaypoints(); i ++ )
+	{
+		const Vector &vOrigin = pGraph->getOrigin(i);
+		const int iFlags = pGraph->getFlags(i) & CWaypointTypes::W_FL_TELEPORT_CHEAT;
+
+		add(&vOrigin.x, sizeof(float));
+		add(&vOrigin.y, sizeof(float));
+		add(&vOrigin.z, sizeof(float));
+		add(&iFlags, sizeof(int));
+
+		for ( int iPath = pGraph->getPathsBegin(i); iPath < pGraph->getPathsEnd(i); iPath ++ )
+		{
+			const int iTo = pGraph->getPathTarget(iPath);
+
+			add(&iTo, sizeof(int));
+		}
+	}
+
+	return iHash;
+}
+
+bool CWaypointLandmarks :: loadFile ( const CWaypointGraphSnapshot *pGraph, const int iNumLandmarks )
+{
+	const char* szMapName = CBotGlobals::getMapName();
+
+	if ( szMapName == nullptr || *szMapName == 0 || iNumLandmarks <= 0 )
+		return false;
+
+	char filename[1024];
+
+	CBotGlobals::buildFileName(filename, szMapName, BOT_AUXILERY_FOLDER, BOT_WAYPOINT_LANDMARK_EXTENSION, true);
+
+	const std::size_t iNumWaypoints = static_cast<std::size_t>(pGraph->numWaypoints());
+	const std::size_t iTableSize = static_cast<std::size_t>(iNumLandmarks) * iNumWaypoints * sizeof(float);
+	const std::size_t iTotalSize = sizeof(wpt_landmark_hdr_t) + static_cast<std::size_t>(iNumLandmarks) * sizeof(int) + iTableSize * 2;
+
+	std::vector<unsigned char> buffer(iTotalSize);
+
+	if ( !RCBot_CompressedLoad(filename, buffer.data(), iTotalSize) )
+		return false;
+
+	wpt_landmark_hdr_t hdr;
+
+	std::memcpy(&hdr, buffer.data(), sizeof(wpt_landmark_hdr_t));
+
+	if ( hdr.version != WPT_LANDMARK_VER || hdr.numwaypoints != pGraph->numWaypoints() ||
+		hdr.numlandmarks != iNumLandmarks || hdr.checksum != checksum(pGraph) )
+	{
+		logger->Log(LogLevel::INFO, "Waypoint landmark file is out of date -- working out landmarks again");
+		return false;
+	}
+
+	const unsigned char *pData = buffer.data() + sizeof(wpt_landmark_hdr_t);
+
+	m_iLandmarks.resize(static_cast<std::size_t>(iNumLandmarks));
+	std::memcpy(m_iLandmarks.data(), pData, static_cast<std::size_t>(iNumLandmarks) * sizeof(int));
+	pData += static_cast<std::size_t>(iNumLandmarks) * sizeof(int);
+
+	m_fFromLandmark.resize(static_cast<std::size_t>(iNumLandmarks) * iNumWaypoints);
+	std::memcpy(m_fFromLandmark.data(), pData, iTableSize);
+	pData += iTableSize;
+
+	m_fToLandmark.resize(static_cast<std::size_t>(iNumLandmarks) * iNumWaypoints);
+	std::memcpy(m_fToLandmark.data(), pData, iTableSize);
+
+	m_iNumWaypoints = pGraph->numWaypoints();
+	m_iWanted = iNumLandmarks;
+	m_iRevision = pGraph->getRevision();
+
+	return true;
+}
+
+void CWaypointLandmarks :: saveFile ( const CWaypointGraphSnapshot *pGraph ) const
+{
+	const char* szMapName = CBotGlobals::getMapName();
+
+	// fewer landmarks than wanted (tiny map) : nothing worth saving
+	if ( szMapName == nullptr || *szMapName == 0 || m_iLandmarks.empty() || numLandmarks() != m_iWanted )
+		return;
+
+	char filename[1024];
+
+	CBotGlobals::buildFileName(filename, szMapName, BOT_AUXILERY_FOLDER, BOT_WAYPOINT_LANDMARK_EXTENSION, true);
+
+	wpt_landmark_hdr_t hdr;
+
+	hdr.version = WPT_LANDMARK_VER;
+	hdr.numwaypoints = m_iNumWaypoints;
+	hdr.numlandmarks = numLandmarks();
+	hdr.checksum = checksum(pGraph);
+
+	const std::size_t iTableSize = m_fFromLandmark.size() * sizeof(float);
+
+	std::vector<unsigned char> buffer;
+	buffer.reserve(sizeof(wpt_landmark_hdr_t) + m_iLandmarks.size() * sizeof(int) + iTableSize * 2);
+
+	const auto append = [&buffer](const void *pData, const std::size_t iBytes)
+	{
+		const unsigned char *pByte = static_cast<const unsigned char*>(pData);
+		buffer.insert(buffer.end(), pByte, pByte + iBytes);
+	};
+
+	append(&hdr, sizeof(wpt_landmark_hdr_t));
+	append(m_iLandmarks.data(), m_iLandmarks.size() * sizeof(int));
+	append(m_fFromLandmark.data(), iTableSize);
+	append(m_fToLandmark.data(), iTableSize);
+
+	CBotGlobals::makeFolders(filename);
+	RCBot_CompressedSave(filename, buffer.data(), buffer.size());
+}
@@ -0,0 +1,96 @@
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef __RCBOT_WAYPOINT_LANDMARKS_H__
+#define __RCBOT_WAYPOINT_LANDMARKS_H__
+
+#include "bot_waypoint.h"
+
+#include <memory>
+#include <vector>
+
+class CWaypointGraphSnapshot;
+
+constexpr const char* BOT_WAYPOINT_LANDMARK_EXTENSION = "rcl";
+
+// Route distances to and from a few landmark waypoints, for a better A*
+// heuristic than straight line distance (ALT). By the triangle inequality
+// the route from a to b is at least d(L,b) - d(L,a) and d(a,L) - d(b,L) for
+// any landmark L, which sees round detours, floors and teleports the straight
+// line can't. Landmarks are picked far from each other (farthest point) and
+// saved per map next to the other aux files.
+class CWaypointLandmarks
+{
+public:
+	static constexpr int MAX_LANDMARKS = 32;
+
+	// landmarks for the current waypoints, worked out again after edits
+	static std::shared_ptr<const CWaypointLandmarks> get ();
+
+	// same, for the game thread only, without holding a reference
+	static const CWaypointLandmarks *current ();
+
+	// read this map's landmark file, or work them out and save it
+	static void load ();
+
+	static void freeMemory ();
+
+	// lower bound of the route distance from iFrom to iTo, 0 if unknown
+	float heuristic ( int iFrom, int iTo ) const;
+
+	int numLandmarks () const { return static_cast<int>(m_iLandmarks.size()); }
+	int getLandmark ( const int i ) const { return m_iLandmarks[static_cast<std::size_t>(i)]; }
+
+	unsigned int getRevision () const { return m_iRevision; }
+private:
+	void build ( const CWaypointGraphSnapshot *pGraph, int iNumLandmarks );
+
+	bool loadFile ( const CWaypointGraphSnapshot *pGraph, int iNumLandmarks );
+	void saveFile ( const CWaypointGraphSnapshot *pGraph ) const;
+
+	// dijkstra over the snapshot from iSource, following paths backwards if bReverse
+	static void routeDistances ( const CWaypointGraphSnapshot *pGraph, int iSource, bool bReverse, float *fDistances );
+
+	// changes when any path or waypoint position changes
+	static unsigned int checksum ( const CWaypointGraphSnapshot *pGraph );
+
+	static int wantedLandmarks ();
+
+	std::vector<int> m_iLandmarks;
+	std::vector<float> m_fFromLandmark; // landmark * numWaypoints + waypoint
+	std::vector<float> m_fToLandmark;
+	int m_iNumWaypoints = 0;
+	int m_iWanted = 0;
+	unsigned int m_iRevision = 0;
+
+	static std::shared_ptr<const CWaypointLandmarks> m_pCurrent;
+};
+
+#endif
@@ -37,27 +37,41 @@
 #include "bot_globals.h"
 #include "bot_waypoint.h"
 #include "bot_waypoint_locations.h"
+#include "bot_waypoint_snapshot.h"
 #include "bot_waypoint_visibility.h"
 
 #include <algorithm>
 #include <vector>    //bir3yk
 #include <cmath>
+#include <utility>
 
 #ifdef RCBOT_VPROF_ENABLED
 #include <tier0/vprof.h>
 #endif // RCBOT_VPROF_ENABLED
 
-unsigned char CWaypointLocations :: g_iFailedWaypoints[CWaypoints::MAX_WAYPOINTS];
-WaypointList CWaypointLocations :: m_iLocations[MAX_WPT_BUCKETS][MAX_WPT_BUCKETS][MAX_WPT_BUCKETS];
-float CWaypointLocations :: m_fIgnoreSize = 0;
-Vector CWaypointLocations :: m_vIgnoreLoc = Vector(0,0,0);
-bool CWaypointLocations :: m_bIgnoreBox = false;
+std::vector<unsigned char> CWaypointLocations :: g_iFailedWaypoints;
+std::unordered_map<int, WaypointLocList> CWaypointLocations :: m_Buckets;
 
 #define READ_LOC(loc) std::abs((int)((int)((loc) + HALF_MAX_MAP_SIZE) / BUCKET_SPACING));
 
+const WaypointLocList *CWaypointLocations :: getBucket ( const int i, const int j, const int k )
+{
+	const auto it = m_Buckets.find(bucketKey(i,j,k));
+
+	if ( it == m_Buckets.end() )
+		return nullptr;
+
+	return &it->second;
+}
+
+void CWaypointLocations :: ResizeFailedWaypoints ( const int iMaxWaypoints )
+{
+	g_iFailedWaypoints.assign(static_cast<std::size_t>(iMaxWaypoints), 0);
+}
+
 unsigned char *CWaypointLocations :: resetFailedWaypoints (const WaypointList *iIgnoreWpts)
 {
-	Q_memset(g_iFailedWaypoints,0,sizeof(unsigned char)*CWaypoints::MAX_WAYPOINTS);
+	std::fill(g_iFailedWaypoints.begin(), g_iFailedWaypoints.end(), 0);
 	
 	if ( iIgnoreWpts )
 	{   
@@ -72,7 +86,7 @@ unsigned char *CWaypointLocations :: resetFailedWaypoints (const WaypointList *i
 		}
 	}
 
-	return g_iFailedWaypoints;
+	return g_iFailedWaypoints.data();
 }
 
 #define CLAMP_TO_ZERO(x) x=((x)<0)?0:x
@@ -157,9 +171,15 @@ void CWaypointLocations :: GetAllInArea (const Vector& vOrigin, WaypointList* pW
 		{
 			for (int k = iMinLock; k <= iMaxLock; k++ )
 			{
-				WaypointList loc = m_iLocations[i][j][k];
-				for (int iWpt : loc)
+				const WaypointLocList *pBucket = getBucket(i,j,k);
+
+				if ( pBucket == nullptr )
+					continue;
+
+				for (const wpt_loc_t& loc : *pBucket)
 				{
+					const int iWpt = loc.iIndex;
+
 					if ( iWpt == iVisibleTo )
 						continue;
 
@@ -188,6 +208,15 @@ void CWaypointLocations :: GetAllVisible (const int iFrom, int iOther, const Vec
 	if ( iFrom == -1 || !pTable)
 		return;
 
+	// what iFrom can see
+	const std::uint64_t *pFromRow = pTable->GetRow(iFrom);
+
+	if ( pFromRow == nullptr )
+		return;
+
+	// anything added here is visible, only what was listed before needs checking
+	const std::size_t iPrevVisible = iVisible->size();
+
 	getMinMaxs(iLoc,jLoc,kLoc,&iMinLoci,&iMinLocj,&iMinLock,&iMaxLoci,&iMaxLocj,&iMaxLock);
 
 	for ( int i = iMinLoci; i <= iMaxLoci; i++ )
@@ -196,26 +225,26 @@ void CWaypointLocations :: GetAllVisible (const int iFrom, int iOther, const Vec
 		{
 			for ( int k = iMinLock; k <= iMaxLock; k++ )
 			{
-				WaypointList& arr = m_iLocations[i][j][k];
-				for (std::size_t l = 0; l < m_iLocations[i][j][k].size(); l++)
-				{
-					int iWpt = arr[l];
-					const CWaypoint* pWpt = CWaypoints::getWaypoint(iWpt);
+				const WaypointLocList *pBucket = getBucket(i,j,k);
 
-					if (pWpt == nullptr)
-						continue;
+				if ( pBucket == nullptr )
+					continue;
+
+				for (const wpt_loc_t& loc : *pBucket)
+				{
+					const int iWpt = loc.iIndex;
 
 					//int iWpt = tempStack.ChooseFromStack();
 					
 					// within range only deal with these waypoints
-					if ( pWpt->distanceFrom(vOrigin) < fEDist && pWpt->distanceFrom(vOther) < fEDist )
+					if ( (loc.vOrigin - vOrigin).Length() < fEDist && (loc.vOrigin - vOther).Length() < fEDist )
 					{
 						// iFrom should be the enemy waypoint
-						if ( pTable->GetVisibilityFromTo(iFrom,iWpt) ) //|| pTable->GetVisibilityFromTo(iOther,iWpt) )
+						if ( CWaypointVisibilityTable::TestBit(pFromRow,iWpt) ) //|| pTable->GetVisibilityFromTo(iOther,iWpt) )
 						{   //CBotGlobals::isVisible(vVisibleFrom,CWaypoints::getWaypoint(iWpt)->getOrigin()) )
 							iVisible->emplace_back(iWpt);
 						}
-						else if (std::find(iVisible->begin(), iVisible->end(), iWpt) == iVisible->end())
+						else if (std::find(iVisible->begin(), iVisible->begin() + static_cast<std::ptrdiff_t>(iPrevVisible), iWpt) == iVisible->begin() + static_cast<std::ptrdiff_t>(iPrevVisible))
 							iInvisible->emplace_back(iWpt);
 					}
 				}
@@ -224,6 +253,38 @@ void CWaypointLocations :: GetAllVisible (const int iFrom, int iOther, const Vec
 	}
 }
 
+int CWaypointLocations :: NearestVisibleFrom ( const Vector &vOrigin, const float fRange, const int iVisibleFrom )
+{
+	const CWaypointVisibilityTable *pTable = CWaypoints::getVisiblity();
+	const CWaypointGraphSnapshot *pGraph = CWaypointGraphSnapshot::current();
+
+	if ( pTable == nullptr || !CWaypoints::validWaypointIndex(iVisibleFrom) )
+		return -1;
+
+	// a waypoint further from iVisibleFrom than this can't be nearer to vOrigin
+	const float fFromDist = (pGraph->getOrigin(iVisibleFrom) - vOrigin).Length();
+
+	float fNearestDist = fRange;
+	int iNearest = -1;
+
+	for ( int iEntry = pTable->GetVisibleBegin(iVisibleFrom); iEntry < pTable->GetVisibleEnd(iVisibleFrom); iEntry++ )
+	{
+		if ( pTable->GetVisibleDistance(iEntry) - fFromDist >= fNearestDist )
+			break;
+
+		const int iWpt = pTable->GetVisibleWaypoint(iEntry);
+		const float fDist = (pGraph->getOrigin(iWpt) - vOrigin).Length();
+
+		if ( fDist < fNearestDist )
+		{
+			fNearestDist = fDist;
+			iNearest = iWpt;
+		}
+	}
+
+	return iNearest;
+}
+
 void CWaypointLocations :: AutoPathInBucket ( edict_t *pPlayer, const int i, const int j, const int k, const int iWptFrom )
 {
 	CWaypoint *pWpt = CWaypoints::getWaypoint(iWptFrom);
@@ -239,12 +300,14 @@ void CWaypointLocations :: AutoPathInBucket ( edict_t *pPlayer, const int i, con
 
 	//CTraceFilterWorldOnly filter;
 
-	const WaypointList& arr = m_iLocations[i][j][k];
-	const std::size_t size = arr.size();
-	
-	for (std::size_t l = 0; l < size; l++)
+	const WaypointLocList *pBucket = getBucket(i,j,k);
+
+	if ( pBucket == nullptr )
+		return;
+
+	for (const wpt_loc_t& loc : *pBucket)
 	{
-		const int iWpt = arr[l];
+		const int iWpt = loc.iIndex;
 
 		//iWpt = tempStack.ChooseFromStack();
 
@@ -293,7 +356,12 @@ const int i = READ_LOC(fOrigin[0])
 const int j = READ_LOC(fOrigin[1])
 const int k = READ_LOC(fOrigin[2])
 
-m_iLocations[i][j][k].emplace_back(iIndex);
+wpt_loc_t loc;
+
+loc.vOrigin = Vector(fOrigin[0],fOrigin[1],fOrigin[2]);
+loc.iIndex = iIndex;
+
+m_Buckets[bucketKey(i,j,k)].emplace_back(loc);
 }
 
 void CWaypointLocations :: DeleteWptLocation (const int iIndex, const float *fOrigin )
@@ -304,8 +372,16 @@ void CWaypointLocations :: DeleteWptLocation (const int iIndex, const float *fOr
 	const int j = READ_LOC(fOrigin[1])
 	const int k = READ_LOC(fOrigin[2])
 
-	WaypointList& vec = m_iLocations[i][j][k];
-	vec.erase(std::remove(vec.begin(), vec.end(), iIndex), vec.end());
+	const auto it = m_Buckets.find(bucketKey(i,j,k));
+
+	if ( it == m_Buckets.end() )
+		return;
+
+	WaypointLocList& vec = it->second;
+	vec.erase(std::remove_if(vec.begin(), vec.end(), [iIndex](const wpt_loc_t& loc) { return loc.iIndex == iIndex; }), vec.end());
+
+	if ( vec.empty() )
+		m_Buckets.erase(it);
 }
 
 ///////////////
@@ -314,8 +390,16 @@ int CWaypointLocations :: GetCoverWaypoint (const Vector& vPlayerOrigin, const V
 											WaypointList *iIgnoreWpts, const Vector *vGoalOrigin,
 											const int iTeam, const float fMinDist, const float fMaxDist)
 {
-	const int iWaypoint = NearestWaypoint(vCoverFrom, REACHABLE_RANGE, -1, true, true, false, nullptr, false,
-										  0, false, true, vPlayerOrigin);
+	int iWaypoint;
+
+	CWaypointVisibilityTable *pTable = CWaypoints::getVisiblity();
+
+	// nearest to vCoverFrom that the player can see
+	if ( pTable != nullptr && pTable->UpdateVisibleLists() )
+		iWaypoint = NearestVisibleFrom(vCoverFrom, REACHABLE_RANGE, NearestWaypoint(vPlayerOrigin, REACHABLE_RANGE, -1, false, true));
+	else
+		iWaypoint = NearestWaypoint(vCoverFrom, REACHABLE_RANGE, -1, true, true, false, nullptr, false,
+									0, false, true, vPlayerOrigin);
 
 	if ( iWaypoint == -1 )
 		return -1;
@@ -332,7 +416,7 @@ int CWaypointLocations :: GetCoverWaypoint (const Vector& vPlayerOrigin, const V
 
 	getMinMaxs(iLoc,jLoc,kLoc,&iMinLoci,&iMinLocj,&iMinLock,&iMaxLoci,&iMaxLocj,&iMaxLock);
 
-	Q_memset(g_iFailedWaypoints,0,sizeof(unsigned char)*CWaypoints::MAX_WAYPOINTS);
+	std::fill(g_iFailedWaypoints.begin(), g_iFailedWaypoints.end(), 0);
 	
 	if ( iIgnoreWpts )
 	{   
@@ -376,14 +460,17 @@ void CWaypointLocations :: FindNearestCoverWaypointInBucket (const int i, const
 {
 	//dataStack <int> tempStack = m_iLocations[i][j][k];
 
-	const WaypointList &arr = m_iLocations[i][j][k];
-	const std::size_t size = arr.size();
+	const WaypointLocList *pBucket = getBucket(i,j,k);
+
+	if ( pBucket == nullptr )
+		return;
+
 	//CBotMod *curmod = CBotGlobals::getCurrentMod();
 
-	for (std::size_t l = 0; l < size; l++)
+	for (const wpt_loc_t& loc : *pBucket)
 	//while ( !tempStack.IsEmpty() )
 	{
-		const int iSelectedIndex = arr[l];//tempStack.ChooseFromStack();
+		const int iSelectedIndex = loc.iIndex;//tempStack.ChooseFromStack();
 
 		if ( iCoverFromWpt == iSelectedIndex )
 			continue;
@@ -406,11 +493,11 @@ void CWaypointLocations :: FindNearestCoverWaypointInBucket (const int i, const
 		if ( CWaypoints::getVisiblity()->GetVisibilityFromTo(iCoverFromWpt,iSelectedIndex) )
 			continue;
 
-		float fDist = curr_wpt->distanceFrom(vOrigin);
+		float fDist = (loc.vOrigin - vOrigin).Length();
 
 		if ( vGoalOrigin != nullptr)
 		{
-			fDist += curr_wpt->distanceFrom(*vGoalOrigin);
+			fDist += (loc.vOrigin - *vGoalOrigin).Length();
 		}
 
 		if ( fDist > fMinDist && fDist < *pfMinDist )
@@ -480,17 +567,26 @@ void CWaypointLocations :: FindNearestBlastInBucket (const int i, const int j, c
 
 	//trace_t tr; //tr not used? [APG]RoboCop[CL]
 
-	const WaypointList &arr = m_iLocations[i][j][k];
-	const std::size_t size = arr.size();
+	const WaypointLocList *pBucket = getBucket(i,j,k);
+
+	if ( pBucket == nullptr )
+		return;
+
 	CBotMod *curmod = CBotGlobals::getCurrentMod();
 
-	for (std::size_t l = 0; l < size; l ++ )
+	for (const wpt_loc_t& loc : *pBucket)
 	{
-		const int iSelectedIndex = arr[l];//tempStack.ChooseFromStack();
+		const int iSelectedIndex = loc.iIndex;//tempStack.ChooseFromStack();
 
 		if ( iSelectedIndex == iIgnoreWpt )
 			continue;
 
+		// too far away, before looking at the waypoint itself
+		if ( (loc.vOrigin - vOrigin).Length() >= fBlastRadius*2 )
+			continue;
+		if ( (fDist = (loc.vOrigin - vSrc).Length()+(loc.vOrigin - vOrigin).Length()) >= *pfMinDist )
+			continue;
+
 		CWaypoint* curr_wpt = CWaypoints::getWaypoint(iSelectedIndex);
 
 		if ( curr_wpt == nullptr )
@@ -516,25 +612,19 @@ void CWaypointLocations :: FindNearestBlastInBucket (const int i, const int j, c
 				continue;
 		}
 
-		if ( curr_wpt->distanceFrom(vOrigin) < fBlastRadius*2 )
+		bool bAdd;
+		
+		if ( bGetVisible == false )
+			bAdd = true;
+		else
 		{
-			if ( (fDist = curr_wpt->distanceFrom(vSrc)+curr_wpt->distanceFrom(vOrigin)) < *pfMinDist )
-			{
-				bool bAdd;
-				
-				if ( bGetVisible == false )
-					bAdd = true;
-				else
-				{
-					bAdd = CBotGlobals::isVisible(vSrc,curr_wpt->getOrigin()) && CBotGlobals::isVisible(vOrigin,curr_wpt->getOrigin());
-				}
-				
-				if ( bAdd )
-				{
-					*piIndex = iSelectedIndex;
-					*pfMinDist = fDist;
-				}
-			}
+			bAdd = CBotGlobals::isVisible(vSrc,loc.vOrigin) && CBotGlobals::isVisible(vOrigin,loc.vOrigin);
+		}
+		
+		if ( bAdd )
+		{
+			*piIndex = iSelectedIndex;
+			*pfMinDist = fDist;
 		}
 	}
 }
@@ -553,12 +643,8 @@ void CWaypointLocations::FindNearestGrenadeWptInBucket(int i, int j, int k, cons
 ///////////////////////////////////////////////
 //
 
-void CWaypointLocations :: FindNearestInBucket (const int i, const int j, const int k, const Vector &vOrigin,
-												float *pfMinDist, int *piIndex, const int iIgnoreWpt,
-												const bool bGetVisible, const bool bGetUnreachable, const bool bIsBot, 
-												WaypointList *iFailedWpts, bool bNearestAimingOnly,
-												const int iTeam, const bool bCheckArea, const bool bGetVisibleFromOther,
-												const Vector& vOther, const int iFlagsOnly, edict_t *pPlayer)
+void CWaypointLocations :: FindNearestInBucket ( const WaypointLocList &bucket, const CNearestWaypointQuery &query,
+												float *pfMinDist, int *piIndex )
 // Search for the nearest waypoint : I.e.
 // Find the waypoint that is closest to vOrigin from the distance pfMinDist
 // And set the piIndex to the waypoint index if closer.
@@ -572,15 +658,16 @@ void CWaypointLocations :: FindNearestInBucket (const int i, const int j, const
 
 	CBotMod *curmod = CBotGlobals::getCurrentMod();
 
-	const WaypointList &arr = m_iLocations[i][j][k];
-	const std::size_t size = arr.size();
-	
-	for (std::size_t l = 0; l < size; l++)
+	const Vector &vOrigin = query.m_vOrigin;
+	const Vector &vOther = query.m_vOther;
+	const int iTeam = query.m_iTeam;
+
+	for (const wpt_loc_t& loc : bucket)
 	//while ( !tempStack.IsEmpty() )
 	{
-		const int iSelectedIndex = arr[l];//tempStack.ChooseFromStack();
+		const int iSelectedIndex = loc.iIndex;//tempStack.ChooseFromStack();
 
-		if ( iSelectedIndex == iIgnoreWpt )
+		if ( iSelectedIndex == query.m_iIgnoreWpt )
 			continue;
 		if ( g_iFailedWaypoints[iSelectedIndex] == 1 )
 		{
@@ -588,18 +675,22 @@ void CWaypointLocations :: FindNearestInBucket (const int i, const int j, const
 			continue;
 		}
 
+		// no nearer than what's been found, before looking at the waypoint itself
+		if ( (fDist = (loc.vOrigin - vOrigin).Length()) >= *pfMinDist )
+			continue;
+
 		CWaypoint* curr_wpt = CWaypoints::getWaypoint(iSelectedIndex);
 
 		if ( curr_wpt == nullptr )
 			continue;
 
-		if ( !bGetUnreachable && curr_wpt->hasFlag(CWaypointTypes::W_FL_UNREACHABLE) )
+		if ( !query.m_bGetUnreachable && curr_wpt->hasFlag(CWaypointTypes::W_FL_UNREACHABLE) )
 			continue;
 
 		if ( !curr_wpt->isUsed() )
 			continue;
 
-		if ( bIsBot )
+		if ( query.m_bIsBot )
 		{
 			if ( curr_wpt->hasFlag(CWaypointTypes::W_FL_OWNER_ONLY) )
 			{
@@ -612,137 +703,194 @@ void CWaypointLocations :: FindNearestInBucket (const int i, const int j, const
 			}
 		}
 		// DOD:S compatibility
-		if (bCheckArea && !curmod->isWaypointAreaValid(curr_wpt->getArea(), curr_wpt->getFlags()))
+		if (query.m_bCheckArea && !curmod->isWaypointAreaValid(curr_wpt->getArea(), curr_wpt->getFlags()))
 			continue;
 
-		if ( iFlagsOnly != 0 )
+		if ( query.m_iFlagsOnly != 0 )
 		{
-			if ( !curr_wpt->getFlags() || !curr_wpt->hasSomeFlags(iFlagsOnly) )
+			if ( !curr_wpt->getFlags() || !curr_wpt->hasSomeFlags(query.m_iFlagsOnly) )
 				continue;
 		}
 
-		if ( bIsBot )
+		if ( query.m_bIsBot )
 		{
 			if ( curr_wpt->getFlags() & (CWaypointTypes::W_FL_DOUBLEJUMP | CWaypointTypes::W_FL_ROCKET_JUMP | CWaypointTypes::W_FL_JUMP | CWaypointTypes::W_FL_OPENS_LATER) ) // fix : bit OR
 				continue;
 		}
 
 		// Used to ignore waypoints where objects are e.g. Sentry guns
-		if ( m_bIgnoreBox )
+		if ( query.m_bIgnorevOther )
 		{
-			Vector vcomp = curr_wpt->getOrigin() - vOrigin;
+			Vector vcomp = loc.vOrigin - vOrigin;
 			vcomp = vcomp / vcomp.Length();
 			
-			if ( curr_wpt->distanceFrom(m_vIgnoreLoc) < m_fIgnoreSize )
+			if ( (loc.vOrigin - vOther).Length() < query.m_fIgnoreSize )
 				continue;
-			if ( (vOrigin + vcomp*(vOther-vOrigin).Length() - vOther).Length() < m_fIgnoreSize )
+			if ( (vOrigin + vcomp*(vOther-vOrigin).Length() - vOther).Length() < query.m_fIgnoreSize )
 				continue;
 		}
 
-		if ( (fDist = curr_wpt->distanceFrom(vOrigin)) < *pfMinDist )
+		bool bAdd;
+		
+		if ( query.m_bGetVisible == false )
+			bAdd = true;
+		else
 		{
-			bool bAdd;
-			
-			if ( bGetVisible == false )
-				bAdd = true;
+			if ( query.m_bGetVisibleFromOther )
+				bAdd = CBotGlobals::isVisible(vOther,loc.vOrigin);
 			else
 			{
-				if ( bGetVisibleFromOther )
-					bAdd = CBotGlobals::isVisible(vOther,curr_wpt->getOrigin());
-				else
+				if ( query.m_pPlayer != nullptr)
 				{
-					if ( pPlayer != nullptr)
-					{
-						CBotGlobals::quickTraceline(pPlayer,vOrigin,curr_wpt->getOrigin());
-						bAdd = CBotGlobals::getTraceResult()->fraction>=1.0f;
-					}
-					else
-						bAdd = CBotGlobals::isVisible(vOrigin,curr_wpt->getOrigin());
+					CBotGlobals::quickTraceline(query.m_pPlayer,vOrigin,loc.vOrigin);
+					bAdd = CBotGlobals::getTraceResult()->fraction>=1.0f;
 				}
+				else
+					bAdd = CBotGlobals::isVisible(vOrigin,loc.vOrigin);
 			}
-			
-			if ( bAdd )
-			{
-				*piIndex = iSelectedIndex;
-				*pfMinDist = fDist;
-			}
+		}
+		
+		if ( bAdd )
+		{
+			*piIndex = iSelectedIndex;
+			*pfMinDist = fDist;
 		}
 	}
 }
 
 /////////////////////////////
 // get the nearest waypoint INDEX from an origin
-int CWaypointLocations :: NearestWaypoint (const Vector &vOrigin, float fNearestDist,
+int CWaypointLocations :: NearestWaypoint (const Vector &vOrigin, const float fNearestDist,
 										   const int iIgnoreWpt, const bool bGetVisible, const bool bGetUnreachable,
 										   const bool bIsBot, WaypointList *iFailedWpts,
 										   const bool bNearestAimingOnly, const int iTeam, const bool bCheckArea,
 										   const bool bGetVisibleFromOther, const Vector& vOther, const int iFlagsOnly, 
 										   edict_t *pPlayer, const bool bIgnorevOther, const float fIgnoreSize)
+{
+	CNearestWaypointQuery query(vOrigin, fNearestDist, iIgnoreWpt);
+
+	query.m_bGetVisible = bGetVisible;
+	query.m_bGetUnreachable = bGetUnreachable;
+	query.m_bIsBot = bIsBot;
+	query.m_pFailedWpts = iFailedWpts;
+	query.m_bNearestAimingOnly = bNearestAimingOnly;
+	query.m_iTeam = iTeam;
+	query.m_bCheckArea = bCheckArea;
+	query.m_bGetVisibleFromOther = bGetVisibleFromOther;
+	query.m_vOther = vOther;
+	query.m_iFlagsOnly = iFlagsOnly;
+	query.m_pPlayer = pPlayer;
+	query.m_bIgnorevOther = bIgnorevOther;
+	query.m_fIgnoreSize = fIgnoreSize;
+
+	NearestWaypoints(&query, 1);
+
+	return query.m_iNearest;
+}
+
+void CWaypointLocations :: NearestWaypoints ( CNearestWaypointQuery *pQueries, const int iNumQueries )
 {
 #ifdef RCBOT_VPROF_ENABLED
-	VPROF_BUDGET("CWaypointLocations::NearestWaypoint", "RCBot2")
+	VPROF_BUDGET("CWaypointLocations::NearestWaypoints", "RCBot2")
 #endif // RCBOT_VPROF_ENABLED
 
-	int iNearestIndex = -1;
+	// bucket of each query, searched in bucket order
+	std::vector<std::pair<int, int>> order;
 
-	const int iLoc = READ_LOC(vOrigin.x)
-	const int jLoc = READ_LOC(vOrigin.y)
-	const int kLoc = READ_LOC(vOrigin.z)
+	order.reserve(static_cast<std::size_t>(iNumQueries));
 
-	int iMinLoci,iMaxLoci,iMinLocj,iMaxLocj,iMinLock,iMaxLock;
+	for ( int q = 0; q < iNumQueries; q++ )
+	{
+		const Vector &vOrigin = pQueries[q].m_vOrigin;
 
-	getMinMaxs(iLoc,jLoc,kLoc,&iMinLoci,&iMinLocj,&iMinLock,&iMaxLoci,&iMaxLocj,&iMaxLock);
+		const int iLoc = READ_LOC(vOrigin.x)
+		const int jLoc = READ_LOC(vOrigin.y)
+		const int kLoc = READ_LOC(vOrigin.z)
+
+		order.emplace_back(bucketKey(iLoc,jLoc,kLoc), q);
+	}
 
-	m_bIgnoreBox = bIgnorevOther;
-	m_vIgnoreLoc = vOther;
-	m_fIgnoreSize = fIgnoreSize;
+	std::sort(order.begin(), order.end());
 
-	if ( !bNearestAimingOnly )
+	// the buckets around the last bucket searched from
+	const WaypointLocList *pNearBuckets[27];
+	int iNumNearBuckets = 0;
+	int iNearKey = -1;
+
+	for ( const std::pair<int, int> &entry : order )
 	{
-		Q_memset(g_iFailedWaypoints,0,sizeof(unsigned char)*CWaypoints::MAX_WAYPOINTS);
-		
-		if ( iFailedWpts )
-		{   
-			int iWpt;
-			
-			for (const int iFailedWpt : *iFailedWpts)
+		CNearestWaypointQuery &query = pQueries[entry.second];
+
+		if ( entry.first != iNearKey )
+		{
+			const int iLoc = READ_LOC(query.m_vOrigin.x)
+			const int jLoc = READ_LOC(query.m_vOrigin.y)
+			const int kLoc = READ_LOC(query.m_vOrigin.z)
+
+			int iMinLoci,iMaxLoci,iMinLocj,iMaxLocj,iMinLock,iMaxLock;
+
+			getMinMaxs(iLoc,jLoc,kLoc,&iMinLoci,&iMinLocj,&iMinLock,&iMaxLoci,&iMaxLocj,&iMaxLock);
+
+			iNumNearBuckets = 0;
+			iNearKey = entry.first;
+
+			for ( int i = iMinLoci; i <= iMaxLoci; i++ )
 			{
-				if ( (iWpt= iFailedWpt) != -1 )
-					g_iFailedWaypoints[iWpt] = 1;
+				for ( int j = iMinLocj; j <= iMaxLocj; j++ )
+				{
+					for ( int k = iMinLock; k <= iMaxLock; k++ )
+					{
+						const WaypointLocList *pBucket = getBucket(i,j,k);
+
+						if ( pBucket != nullptr )
+							pNearBuckets[iNumNearBuckets++] = pBucket;
+					}
+				}
 			}
 		}
-	}
 
-	for ( int i = iMinLoci; i <= iMaxLoci; i++ )
-	{
-		for ( int j = iMinLocj; j <= iMaxLocj; j++ )
+		WaypointList *iFailedWpts = query.m_pFailedWpts;
+
+		if ( !query.m_bNearestAimingOnly )
 		{
-			for ( int k = iMinLock; k <= iMaxLock; k++ )
-			{
-				FindNearestInBucket(i,j,k,vOrigin,&fNearestDist,&iNearestIndex,iIgnoreWpt,bGetVisible,bGetUnreachable,bIsBot,iFailedWpts,bNearestAimingOnly,iTeam,bCheckArea,bGetVisibleFromOther,vOther,iFlagsOnly,pPlayer);
+			std::fill(g_iFailedWaypoints.begin(), g_iFailedWaypoints.end(), 0);
+			
+			if ( iFailedWpts )
+			{   
+				int iWpt;
+				
+				for (const int iFailedWpt : *iFailedWpts)
+				{
+					if ( (iWpt= iFailedWpt) != -1 )
+						g_iFailedWaypoints[iWpt] = 1;
+				}
 			}
 		}
-	}
 
-	if ( iFailedWpts )
-	{
-		int iWpt;
-		
-		for (std::size_t l = 0; l < iFailedWpts->size(); l++)
+		float fNearestDist = query.m_fNearestDist;
+		int iNearestIndex = -1;
+
+		for ( int b = 0; b < iNumNearBuckets; b++ )
+			FindNearestInBucket(*pNearBuckets[b],query,&fNearestDist,&iNearestIndex);
+
+		if ( iFailedWpts )
 		{
-			if ( (iWpt=(*iFailedWpts)[l]) != -1 ) //( (iWpt = tempStack.ChooseFromStack()) != -1 )
+			int iWpt;
+			
+			for (std::size_t l = 0; l < iFailedWpts->size(); l++)
 			{
-				if ( g_iFailedWaypoints[iWpt] == 2 )
+				if ( (iWpt=(*iFailedWpts)[l]) != -1 ) //( (iWpt = tempStack.ChooseFromStack()) != -1 )
 				{
-					iFailedWpts->erase(std::remove(iFailedWpts->begin(), iFailedWpts->end(), iWpt), iFailedWpts->end());
+					if ( g_iFailedWaypoints[iWpt] == 2 )
+					{
+						iFailedWpts->erase(std::remove(iFailedWpts->begin(), iFailedWpts->end(), iWpt), iFailedWpts->end());
+					}
 				}
 			}
 		}
-	}
-
-	m_bIgnoreBox = false;
 
-	return iNearestIndex;
+		query.m_iNearest = iNearestIndex;
+	}
 }
 
 //////////////////////////////////
@@ -759,15 +907,15 @@ void CWaypointLocations :: DrawWaypoints (const CClient *pClient, float fDist)
 	static Vector vOrigin;
 	static edict_t *pEntity;
 
-	const int iLoc = READ_LOC(vOrigin.x)
-	const int jLoc = READ_LOC(vOrigin.y)
-	const int kLoc = READ_LOC(vOrigin.z)
-
 	pEntity = pClient->getPlayer();
 	vOrigin = pClient->getOrigin();
 	//bDrawPaths = false;
 	iDrawType = pClient->getDrawType();
 
+	const int iLoc = READ_LOC(vOrigin.x)
+	const int jLoc = READ_LOC(vOrigin.y)
+	const int kLoc = READ_LOC(vOrigin.z)
+
 	int iMinLoci,iMaxLoci,iMinLocj,iMaxLocj,iMinLock,iMaxLock;
 	getMinMaxs(iLoc,jLoc,kLoc,&iMinLoci,&iMinLocj,&iMinLock,&iMaxLoci,&iMaxLocj,&iMaxLock);
 
@@ -777,11 +925,17 @@ void CWaypointLocations :: DrawWaypoints (const CClient *pClient, float fDist)
 		{
 			for (int k = iMinLock; k <= iMaxLock; k++)
 			{
-				// TODO use a type alias for this
-				WaypointList &arr = m_iLocations[i][j][k];
-				for (const int l : arr)
+				const WaypointLocList *pBucket = getBucket(i,j,k);
+
+				if ( pBucket == nullptr )
+					continue;
+
+				for (const wpt_loc_t& loc : *pBucket)
 				{
-					iWpt = l;
+					iWpt = loc.iIndex;
+
+					if ( std::fabs(loc.vOrigin.z - vOrigin.z) > 256.0f ) // not in z range
+						continue;
 
 					pWpt = CWaypoints::getWaypoint(iWpt);//tempStack.ChooseFromStack());
 
@@ -33,6 +33,9 @@
 
 #include "bot_waypoint.h"
 
+#include <unordered_map>
+#include <vector>
+
 /*#define WAYPOINT_LOC(x)\
 	{\
 	m_iLocations[i][j][k].x;\
@@ -56,10 +59,51 @@
 
 class CWaypoint;
 
+// a waypoint in a location bucket, with its origin so searches
+// needn't look up every waypoint they pass over
+typedef struct
+{
+	Vector vOrigin;
+	int iIndex;
+}wpt_loc_t;
+
+using WaypointLocList = std::vector<wpt_loc_t>;
+
+// One NearestWaypoint search for CWaypointLocations::NearestWaypoints,
+// the options are NearestWaypoint's arguments with the same defaults
+class CNearestWaypointQuery
+{
+public:
+	CNearestWaypointQuery ( const Vector &vOrigin, const float fNearestDist, const int iIgnoreWpt = -1 ) :
+		m_vOrigin(vOrigin), m_fNearestDist(fNearestDist), m_iIgnoreWpt(iIgnoreWpt) {}
+
+	// input
+	Vector m_vOrigin;
+	float m_fNearestDist;
+	int m_iIgnoreWpt;
+	bool m_bGetVisible = true;
+	bool m_bGetUnreachable = false;
+	bool m_bIsBot = false;
+	WaypointList *m_pFailedWpts = nullptr; // failed waypoints the search comes across are taken out
+	bool m_bNearestAimingOnly = false;
+	int m_iTeam = 0;
+	bool m_bCheckArea = false;
+	bool m_bGetVisibleFromOther = false;
+	Vector m_vOther = Vector(0,0,0);
+	int m_iFlagsOnly = 0;
+	edict_t *m_pPlayer = nullptr;
+	bool m_bIgnorevOther = false; // leave out waypoints within m_fIgnoreSize of m_vOther or the line to it
+	float m_fIgnoreSize = 0.0f;
+
+	// output, -1 if nothing was found
+	int m_iNearest = -1;
+};
+
 class CWaypointLocations
 // Hash table of waypoint indexes accross certian
 // buckets in the map on X/Y Co-ords for quicker
 // nearest waypoint finding and waypoint displaying.
+// Empty buckets aren't stored, so clearing is cheap.
 {
 public:
 
@@ -76,7 +120,10 @@ public:
 
 	static constexpr int BUCKET_SPACING = HALF_MAX_MAP_SIZE*2/MAX_WPT_BUCKETS;
 
-	static unsigned char g_iFailedWaypoints [ CWaypoints::MAX_WAYPOINTS ];
+	// one flag per waypoint, sized to the waypoint capacity
+	static std::vector<unsigned char> g_iFailedWaypoints;
+
+	static void ResizeFailedWaypoints ( int iMaxWaypoints );
 	
 	static void AddWptLocation ( CWaypoint *pWaypoint, int iIndex );
 
@@ -94,16 +141,7 @@ public:
 
 	static void Clear ()
 	{
-		for (WaypointList (&m_iLocation)[64][64] : m_iLocations)
-		{
-			for (WaypointList (&j)[64] : m_iLocation)
-			{
-				for (WaypointList& k : j)
-				{
-					k.clear();
-				}
-			}
-		}
+		m_Buckets.clear();
 	}
 
 	static void GetAllInArea (const Vector& vOrigin, WaypointList* pWaypointList, int iVisibleTo);
@@ -118,7 +156,6 @@ public:
 
 	static void AddWptLocation ( int iIndex, const float *fOrigin );
 
-	static void FindNearestInBucket ( int i, int j, int k, const Vector &vOrigin, float *pfMinDist, int *piIndex,int iIgnoreWpt, bool bGetVisible = true, bool bGetUnreachable = false, bool bIsBot = false, WaypointList *iFailedWpts = nullptr, bool bNearestAimingOnly = false, int iTeam = 0, bool bCheckArea = false, bool bGetVisibleFromOther = false, const Vector& vOther = Vector(0,0,0), int iFlagsOnly = 0, edict_t *pPlayer = nullptr);
 	static void DrawWaypoints (const CClient *pClient, float fDist);
 	
 	static void DeleteWptLocation ( int iIndex, const float *fOrigin );
@@ -129,9 +166,17 @@ public:
 		bool bGetVisibleFromOther = false, const Vector& vOther = Vector(0,0,0), int iFlagsOnly = 0, 
 		edict_t *pPlayer = nullptr, bool bIgnorevOther = false, float fIgnoreSize = 0.0f );
 
+	// answers all the queries, queries from the same bucket share the buckets around them
+	static void NearestWaypoints ( CNearestWaypointQuery *pQueries, int iNumQueries );
+
 	static void GetAllVisible(int iFrom, int iOther, const Vector& vOrigin, const Vector& vOther, float fEDist, WaypointList* iVisible, WaypointList*
 	                          iInvisible);
 
+	// nearest waypoint to vOrigin within fRange that iVisibleFrom can see, from the
+	// visibility table's visible lists, no traces. Check the lists are up to date
+	// with CWaypointVisibilityTable::UpdateVisibleLists first
+	static int NearestVisibleFrom ( const Vector &vOrigin, float fRange, int iVisibleFrom );
+
 	///////////
 
 	static void AutoPath ( edict_t *pPlayer, int iWpt );
@@ -148,10 +193,15 @@ public:
 
 private:
 	
+	static int bucketKey ( const int i, const int j, const int k ) { return (i * MAX_WPT_BUCKETS + j) * MAX_WPT_BUCKETS + k; }
+
+	// NULL if nothing is in the bucket
+	static const WaypointLocList *getBucket ( int i, int j, int k );
+
+	static void FindNearestInBucket ( const WaypointLocList &bucket, const CNearestWaypointQuery &query, float *pfMinDist, int *piIndex );
+
 	//static dataStack<int> m_iLocations[MAX_WPT_BUCKETS][MAX_WPT_BUCKETS][MAX_WPT_BUCKETS];
-	static WaypointList m_iLocations[MAX_WPT_BUCKETS][MAX_WPT_BUCKETS][MAX_WPT_BUCKETS];
-	static float m_fIgnoreSize;
-	static Vector m_vIgnoreLoc;
-	static bool m_bIgnoreBox;
+	// only buckets with waypoints in them are kept
+	static std::unordered_map<int, WaypointLocList> m_Buckets;
 };
 #endif
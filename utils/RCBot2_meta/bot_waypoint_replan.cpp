@@ -0,0 +1,350 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include "bot.h"
+#include "bot_navigator.h"
+#include "bot_waypoint.h"
+#include "bot_waypoint_replan.h"
+
+#include <algorithm>
+#include <limits>
+
+unsigned int CWaypointReplanner::m_iRepairs = 0;
+
+static constexpr float REPLAN_INFINITY = std::numeric_limits<float>::infinity();
+
+bool CWaypointReplanner :: canRepair ( const int iGoal, const int iConditions, const int iDangerId ) const
+{
+	return m_iGoal != -1 && m_iGoal == iGoal && m_iConditions == iConditions && m_iDangerId == iDangerId &&
+		m_pGraph != nullptr && m_pGraph->getRevision() == CWaypoints::getGraphRevision();
+}
+
+void CWaypointReplanner :: reset ( const int iGoal, const int iConditions, const int iDangerId, const std::vector<float> &fNodeCost )
+{
+	m_pGraph = CWaypointGraphSnapshot::get();
+
+	const std::size_t iNumWaypoints = static_cast<std::size_t>(m_pGraph->numWaypoints());
+
+	m_iGoal = iGoal;
+	m_iStart = -1;
+	m_iLastStart = -1;
+	m_iConditions = iConditions;
+	m_iDangerId = iDangerId;
+	m_fKeyModifier = 0.0f;
+
+	m_fG.assign(iNumWaypoints, REPLAN_INFINITY);
+	m_fRhs.assign(iNumWaypoints, REPLAN_INFINITY);
+	m_Key.assign(iNumWaypoints, replan_key_t(REPLAN_INFINITY,REPLAN_INFINITY));
+	m_iHeapIndex.assign(iNumWaypoints, -1);
+	m_Heap.clear();
+	m_BlockedPaths.clear();
+	m_fNodeCost = fNodeCost;
+
+	m_fRhs[iGoal] = 0.0f;
+}
+
+void CWaypointReplanner :: setNodeCosts ( const std::vector<float> &fNodeCost )
+{
+	m_iRepairs++;
+
+	for ( std::size_t i = 0; i < fNodeCost.size() && i < m_fNodeCost.size(); i ++ )
+	{
+		if ( m_fNodeCost[i] != fNodeCost[i] )
+		{
+			m_fNodeCost[i] = fNodeCost[i];
+			updatePredecessors(static_cast<int>(i));
+		}
+	}
+}
+
+void CWaypointReplanner :: blockPath ( const int iFrom, const int iTo )
+{
+	if ( m_pGraph == nullptr || iFrom < 0 || iTo < 0 || iFrom >= m_pGraph->numWaypoints() || iTo >= m_pGraph->numWaypoints() )
+		return;
+
+	const std::pair<int,int> path(iFrom,iTo);
+
+	if ( std::find(m_BlockedPaths.begin(), m_BlockedPaths.end(), path) != m_BlockedPaths.end() )
+		return;
+
+	m_BlockedPaths.emplace_back(path);
+
+	// only the cost from iFrom has changed
+	updateVertex(iFrom);
+}
+
+void CWaypointReplanner :: setStart ( const int iStart )
+{
+	// keys already queued were worked out from the last start
+	if ( m_iLastStart != -1 && m_iLastStart != iStart )
+		m_fKeyModifier += heuristic(m_iLastStart,iStart);
+
+	m_iStart = iStart;
+	m_iLastStart = iStart;
+	m_iNodesExpanded = 0;
+
+	if ( m_Heap.empty() && m_fG[m_iGoal] == REPLAN_INFINITY )
+		heapInsert(m_iGoal, calculateKey(m_iGoal));
+}
+
+int CWaypointReplanner :: compute ( const int iMaxLoops )
+{
+	int iLoops = 0;
+
+	while ( !m_Heap.empty() && 
+		(m_Key[m_Heap[0]] < calculateKey(m_iStart) || m_fRhs[m_iStart] != m_fG[m_iStart]) )
+	{
+		if ( iLoops++ >= iMaxLoops )
+			return ROUTE_SEARCHING;
+
+		m_iNodesExpanded++;
+
+		const int iWpt = m_Heap[0];
+		const replan_key_t oldKey = m_Key[iWpt];
+		const replan_key_t newKey = calculateKey(iWpt);
+
+		if ( oldKey < newKey )
+		{
+			// start has moved since this was queued
+			heapRemove(iWpt);
+			heapInsert(iWpt, newKey);
+		}
+		else if ( m_fG[iWpt] > m_fRhs[iWpt] )
+		{
+			m_fG[iWpt] = m_fRhs[iWpt];
+			heapRemove(iWpt);
+			updatePredecessors(iWpt);
+		}
+		else
+		{
+			m_fG[iWpt] = REPLAN_INFINITY;
+			updateVertex(iWpt);
+			updatePredecessors(iWpt);
+		}
+	}
+
+	return m_fRhs[m_iStart] < REPLAN_INFINITY ? ROUTE_FOUND : ROUTE_FAILED;
+}
+
+bool CWaypointReplanner :: getRoute ( WaypointList *route, float *fDistance ) const
+{
+	WaypointList forward;
+	int iCurrent = m_iStart;
+	float fDistanceSoFar = 0.0f;
+
+	const int iNumWaypoints = m_pGraph->numWaypoints();
+
+	// take the cheapest path towards the goal each time
+	while ( iCurrent != m_iGoal )
+	{
+		if ( static_cast<int>(forward.size()) > iNumWaypoints )
+			return false;
+
+		int iBestPath = -1;
+		float fBest = REPLAN_INFINITY;
+
+		const int iPathsEnd = m_pGraph->getPathsEnd(iCurrent);
+
+		for ( int iPath = m_pGraph->getPathsBegin(iCurrent); iPath < iPathsEnd; iPath ++ )
+		{
+			const float fCost = pathCost(iPath) + m_fG[m_pGraph->getPathTarget(iPath)];
+
+			if ( fCost < fBest )
+			{
+				fBest = fCost;
+				iBestPath = iPath;
+			}
+		}
+
+		if ( iBestPath == -1 )
+			return false;
+
+		fDistanceSoFar += m_pGraph->getPathLength(iBestPath);
+		iCurrent = m_pGraph->getPathTarget(iBestPath);
+		forward.emplace_back(iCurrent);
+	}
+
+	route->assign(forward.rbegin(), forward.rend());
+	*fDistance = fDistanceSoFar;
+
+	return true;
+}
+
+// same path costs as CWaypointNavigator::searchRoute
+float CWaypointReplanner :: pathCost ( const int iPath ) const
+{
+	const int iFrom = m_pGraph->getPathSource(iPath);
+	const int iTo = m_pGraph->getPathTarget(iPath);
+
+	if ( std::find(m_BlockedPaths.begin(), m_BlockedPaths.end(), std::pair<int,int>(iFrom,iTo)) != m_BlockedPaths.end() )
+		return REPLAN_INFINITY;
+
+	if ( iTo != m_iGoal && !m_pBot->canGotoWaypoint(m_pGraph->getOrigin(iFrom),CWaypoints::getWaypoint(iTo),CWaypoints::getWaypoint(iFrom)) )
+		return REPLAN_INFINITY;
+
+	const float fNodeCost = m_fNodeCost[static_cast<std::size_t>(iTo)];
+
+	if ( m_pGraph->getPathFlags(iPath) & CWaypointGraphSnapshot::PATH_FROM_TELEPORT )
+		return fNodeCost;
+
+	return m_pGraph->getPathLength(iPath) + fNodeCost;
+}
+
+float CWaypointReplanner :: heuristic ( const int iFrom, const int iTo ) const
+{
+	return (m_pGraph->getOrigin(iFrom) - m_pGraph->getOrigin(iTo)).Length();
+}
+
+CWaypointReplanner::replan_key_t CWaypointReplanner :: calculateKey ( const int iWpt ) const
+{
+	const float fMin = std::min(m_fG[iWpt], m_fRhs[iWpt]);
+
+	return replan_key_t(fMin + heuristic(m_iStart,iWpt) + m_fKeyModifier, fMin);
+}
+
+void CWaypointReplanner :: updateVertex ( const int iWpt )
+{
+	if ( iWpt != m_iGoal )
+	{
+		const int iPathsEnd = m_pGraph->getPathsEnd(iWpt);
+		float fRhs = REPLAN_INFINITY;
+
+		for ( int iPath = m_pGraph->getPathsBegin(iWpt); iPath < iPathsEnd; iPath ++ )
+		{
+			const int iSucc = m_pGraph->getPathTarget(iPath);
+
+			if ( m_fG[iSucc] == REPLAN_INFINITY )
+				continue;
+
+			fRhs = std::min(fRhs, pathCost(iPath) + m_fG[iSucc]);
+		}
+
+		m_fRhs[iWpt] = fRhs;
+	}
+
+	if ( m_iHeapIndex[iWpt] != -1 )
+		heapRemove(iWpt);
+
+	if ( m_fG[iWpt] != m_fRhs[iWpt] )
+		heapInsert(iWpt, calculateKey(iWpt));
+}
+
+void CWaypointReplanner :: updatePredecessors ( const int iWpt )
+{
+	const int iEnd = m_pGraph->getPathsFromEnd(iWpt);
+
+	for ( int i = m_pGraph->getPathsFromBegin(iWpt); i < iEnd; i ++ )
+		updateVertex(m_pGraph->getPathSource(m_pGraph->getPathFrom(i)));
+}
+
+void CWaypointReplanner :: heapInsert ( const int iWpt, const replan_key_t &key )
+{
+	m_Key[iWpt] = key;
+	m_Heap.emplace_back(iWpt);
+	heapPlace(static_cast<int>(m_Heap.size()) - 1, iWpt);
+	heapSiftUp(static_cast<int>(m_Heap.size()) - 1);
+}
+
+void CWaypointReplanner :: heapRemove ( const int iWpt )
+{
+	const int iIndex = m_iHeapIndex[iWpt];
+
+	if ( iIndex == -1 )
+		return;
+
+	m_iHeapIndex[iWpt] = -1;
+
+	const int iLast = m_Heap.back();
+	m_Heap.pop_back();
+
+	if ( iIndex < static_cast<int>(m_Heap.size()) )
+	{
+		heapPlace(iIndex, iLast);
+		heapSiftUp(iIndex);
+		heapSiftDown(m_iHeapIndex[iLast]);
+	}
+}
+
+void CWaypointReplanner :: heapSiftUp ( int iIndex )
+{
+	const int iWpt = m_Heap[iIndex];
+
+	while ( iIndex > 0 )
+	{
+		const int iParent = (iIndex - 1) / 2;
+
+		if ( !heapPrecedes(iWpt, m_Heap[iParent]) )
+			break;
+
+		heapPlace(iIndex, m_Heap[iParent]);
+		iIndex = iParent;
+	}
+
+	heapPlace(iIndex, iWpt);
+}
+
+void CWaypointReplanner :: heapSiftDown ( int iIndex )
+{
+	const int iWpt = m_Heap[iIndex];
+	const int iSize = static_cast<int>(m_Heap.size());
+
+	for (;;)
+	{
+		int iChild = iIndex * 2 + 1;
+
+		if ( iChild >= iSize )
+			break;
+
+		if ( iChild + 1 < iSize && heapPrecedes(m_Heap[iChild + 1], m_Heap[iChild]) )
+			iChild++;
+
+		if ( !heapPrecedes(m_Heap[iChild], iWpt) )
+			break;
+
+		heapPlace(iIndex, m_Heap[iChild]);
+		iIndex = iChild;
+	}
+
+	heapPlace(iIndex, iWpt);
+}
+
+void CWaypointReplanner :: heapPlace ( const int iIndex, const int iWpt )
+{
+	m_Heap[iIndex] = iWpt;
+	m_iHeapIndex[iWpt] = iIndex;
+}
+
+bool CWaypointReplanner :: heapPrecedes ( const int iWptA, const int iWptB ) const
+{
+	return m_Key[iWptA] < m_Key[iWptB];
+}
@@ -0,0 +1,124 @@
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef __RCBOT_WAYPOINT_REPLAN_H__
+#define __RCBOT_WAYPOINT_REPLAN_H__
+
+#include "bot_waypoint.h"
+#include "bot_waypoint_snapshot.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+class CBot;
+
+// Incremental route repair (D* Lite) for a bot that keeps getting blocked on
+// the way to the same goal.
+//
+// The search runs backwards from the goal and is kept between routes. When a
+// path fails or the bot's belief changes only the waypoints whose cost to the
+// goal depends on it are searched again, the bot's new start waypoint just
+// shifts the priority of what is already queued.
+class CWaypointReplanner
+{
+public:
+	explicit CWaypointReplanner ( CBot *pBot ) : m_pBot(pBot) {}
+
+	// can the last search be repaired for this goal
+	bool canRepair ( int iGoal, int iConditions, int iDangerId ) const;
+
+	// throw away the last search and start again towards iGoal
+	void reset ( int iGoal, int iConditions, int iDangerId, const std::vector<float> &fNodeCost );
+
+	// belief changed, repair waypoints whose cost is different
+	void setNodeCosts ( const std::vector<float> &fNodeCost );
+
+	// bot can't use the path from iFrom to iTo any more
+	void blockPath ( int iFrom, int iTo );
+
+	void setStart ( int iStart );
+
+	// returns ROUTE_SEARCHING if it needs more than iMaxLoops
+	int compute ( int iMaxLoops );
+
+	// goal first, not including the start
+	bool getRoute ( WaypointList *route, float *fDistance ) const;
+
+	// search can't be repaired, next replan starts again
+	void invalidate () { m_iGoal = -1; }
+
+	unsigned int getNodesExpanded () const { return m_iNodesExpanded; }
+
+	static unsigned int numRepairs () { return m_iRepairs; }
+	static void resetStats () { m_iRepairs = 0; }
+private:
+	typedef std::pair<float,float> replan_key_t;
+
+	// iPath is a path of the snapshot
+	float pathCost ( int iPath ) const;
+	float heuristic ( int iFrom, int iTo ) const;
+
+	replan_key_t calculateKey ( int iWpt ) const;
+
+	void updateVertex ( int iWpt );
+	void updatePredecessors ( int iWpt );
+
+	// indexed binary heap of waypoints on their key
+	void heapInsert ( int iWpt, const replan_key_t &key );
+	void heapRemove ( int iWpt );
+	void heapSiftUp ( int iIndex );
+	void heapSiftDown ( int iIndex );
+	void heapPlace ( int iIndex, int iWpt );
+	bool heapPrecedes ( int iWptA, int iWptB ) const;
+
+	CBot *m_pBot;
+	std::shared_ptr<const CWaypointGraphSnapshot> m_pGraph;
+
+	int m_iGoal = -1;
+	int m_iStart = -1;
+	int m_iLastStart = -1;
+	int m_iConditions = 0;
+	int m_iDangerId = -1;
+	float m_fKeyModifier = 0.0f;
+	unsigned int m_iNodesExpanded = 0;
+
+	std::vector<float> m_fG;
+	std::vector<float> m_fRhs;
+	std::vector<float> m_fNodeCost;
+	std::vector<replan_key_t> m_Key;
+	std::vector<int> m_iHeapIndex; // -1 if not queued
+	std::vector<int> m_Heap;
+	std::vector<std::pair<int,int>> m_BlockedPaths;
+
+	static unsigned int m_iRepairs;
+};
+
+#endif
@@ -0,0 +1,162 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include "bot.h"
+#include "bot_waypoint.h"
+#include "bot_waypoint_snapshot.h"
+
+#ifdef RCBOT_VPROF_ENABLED
+#include <tier0/vprof.h>
+#endif // RCBOT_VPROF_ENABLED
+
+std::shared_ptr<const CWaypointGraphSnapshot> CWaypointGraphSnapshot::m_pCurrent;
+
+std::shared_ptr<const CWaypointGraphSnapshot> CWaypointGraphSnapshot :: get ()
+{
+	if ( m_pCurrent == nullptr || m_pCurrent->getRevision() != CWaypoints::getGraphRevision() )
+	{
+		const std::shared_ptr<CWaypointGraphSnapshot> pSnapshot = std::make_shared<CWaypointGraphSnapshot>();
+
+		pSnapshot->build();
+
+		m_pCurrent = pSnapshot;
+	}
+
+	return m_pCurrent;
+}
+
+const CWaypointGraphSnapshot *CWaypointGraphSnapshot :: current ()
+{
+	if ( m_pCurrent == nullptr || m_pCurrent->getRevision() != CWaypoints::getGraphRevision() )
+		get();
+
+	return m_pCurrent.get();
+}
+
+void CWaypointGraphSnapshot :: build ()
+{
+#ifdef RCBOT_VPROF_ENABLED
+	VPROF_BUDGET("CWaypointGraphSnapshot::build", "RCBot2")
+#endif // RCBOT_VPROF_ENABLED
+
+	const int iNumWaypoints = CWaypoints::numWaypoints();
+	const std::size_t iSize = static_cast<std::size_t>(iNumWaypoints);
+
+	m_iRevision = CWaypoints::getGraphRevision();
+
+	m_vOrigins.resize(iSize);
+	m_iFlags.resize(iSize);
+	m_iAreas.resize(iSize);
+	m_bUsed.resize(iSize);
+	m_iPathOffsets.resize(iSize + 1);
+
+	m_iUsed.clear();
+
+	for ( std::vector<int> &flagged : m_iFlagged )
+		flagged.clear();
+
+	m_iPathTargets.clear();
+	m_iPathSources.clear();
+	m_fPathLengths.clear();
+	m_iPathFlags.clear();
+
+	for ( int i = 0; i < iNumWaypoints; i ++ )
+	{
+		CWaypoint *pWpt = CWaypoints::getWaypoint(i);
+
+		m_vOrigins[i] = pWpt->getOrigin();
+		m_iFlags[i] = pWpt->getFlags();
+		m_iAreas[i] = pWpt->getArea();
+		m_bUsed[i] = pWpt->isUsed() ? 1 : 0;
+
+		if ( !m_bUsed[i] )
+			continue;
+
+		m_iUsed.emplace_back(i);
+
+		for ( int iBit = 0; iBit < 32; iBit ++ )
+		{
+			if ( static_cast<unsigned>(m_iFlags[i]) & (1u << iBit) )
+				m_iFlagged[iBit].emplace_back(i);
+		}
+	}
+
+	for ( int i = 0; i < iNumWaypoints; i ++ )
+	{
+		const CWaypoint *pWpt = CWaypoints::getWaypoint(i);
+
+		m_iPathOffsets[i] = static_cast<int>(m_iPathTargets.size());
+
+		for ( int iPath = 0; iPath < pWpt->numPaths(); iPath ++ )
+		{
+			const int iTo = pWpt->getPath(iPath);
+
+			if ( !CWaypoints::validWaypointIndex(iTo) )
+				continue;
+
+			std::uint8_t iFlags = 0;
+
+			if ( isTeleport(i) )
+				iFlags |= PATH_FROM_TELEPORT;
+			if ( isTeleport(iTo) )
+				iFlags |= PATH_TO_TELEPORT;
+
+			m_iPathTargets.emplace_back(iTo);
+			m_iPathSources.emplace_back(i);
+			m_fPathLengths.emplace_back((m_vOrigins[iTo] - m_vOrigins[i]).Length());
+			m_iPathFlags.emplace_back(iFlags);
+		}
+	}
+
+	m_iPathOffsets[iNumWaypoints] = static_cast<int>(m_iPathTargets.size());
+
+	// paths into each waypoint : count, then place
+	m_iPathFromOffsets.assign(iSize + 1, 0);
+	m_iPathsFrom.resize(m_iPathTargets.size());
+
+	for ( const int iTo : m_iPathTargets )
+		m_iPathFromOffsets[static_cast<std::size_t>(iTo) + 1]++;
+
+	for ( std::size_t i = 0; i < iSize; i ++ )
+		m_iPathFromOffsets[i + 1] += m_iPathFromOffsets[i];
+
+	std::vector<int> iNext(m_iPathFromOffsets.begin(), m_iPathFromOffsets.end() - 1);
+
+	for ( int iPath = 0; iPath < numPaths(); iPath ++ )
+		m_iPathsFrom[static_cast<std::size_t>(iNext[static_cast<std::size_t>(m_iPathTargets[iPath])]++)] = iPath;
+}
+
+void CWaypointGraphSnapshot :: freeMemory ()
+{
+	m_pCurrent.reset();
+}
@@ -0,0 +1,225 @@
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+#ifndef __RCBOT_WAYPOINT_SNAPSHOT_H__
+#define __RCBOT_WAYPOINT_SNAPSHOT_H__
+
+#include "bot_waypoint.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Read only copy of the waypoint graph. A new one is made when the waypoints
+// change, anything still using the old one keeps it alive, so it can be read
+// away from the game thread.
+//
+// Waypoint data is kept in one array per field and paths are stored together
+// in one array (compressed sparse rows), so searches read memory in order
+// instead of following a pointer per waypoint and per path list. The paths of
+// waypoint i are getPathsBegin(i) up to getPathsEnd(i), in the same order as
+// CWaypoint::getPath with paths to invalid waypoints left out. Paths into
+// waypoint i are listed the same way with getPathsFromBegin/End.
+//
+// Used waypoints are also listed by flag, one list per flag bit, so goal
+// searches only visit waypoints that have the flags they are looking for.
+class CWaypointGraphSnapshot
+{
+public:
+	// current snapshot, rebuilt if the waypoints changed
+	static std::shared_ptr<const CWaypointGraphSnapshot> get ();
+
+	// same, for the game thread only, without holding a reference
+	static const CWaypointGraphSnapshot *current ();
+
+	static void freeMemory ();
+
+	int numWaypoints () const { return static_cast<int>(m_vOrigins.size()); }
+
+	const Vector &getOrigin ( const int iWpt ) const { return m_vOrigins[static_cast<std::size_t>(iWpt)]; }
+	int getFlags ( const int iWpt ) const { return m_iFlags[static_cast<std::size_t>(iWpt)]; }
+	int getArea ( const int iWpt ) const { return m_iAreas[static_cast<std::size_t>(iWpt)]; }
+	bool isUsed ( const int iWpt ) const { return m_bUsed[static_cast<std::size_t>(iWpt)] != 0; }
+	bool isTeleport ( const int iWpt ) const { return (getFlags(iWpt) & CWaypointTypes::W_FL_TELEPORT_CHEAT) != 0; }
+
+	bool hasSomeFlags ( const int iWpt, const int iFlags ) const { return (getFlags(iWpt) & iFlags) != 0; }
+
+	// used waypoints, and used waypoints with flag bit iBit, in index order
+	const std::vector<int> &getUsed () const { return m_iUsed; }
+	const std::vector<int> &getFlagged ( const int iBit ) const { return m_iFlagged[iBit]; }
+
+	// calls fn(iWpt) in index order for each used waypoint with some of iFlags,
+	// or every used waypoint if iFlags is -1
+	template <typename FN>
+	void forEachWithSomeFlags ( int iFlags, FN fn ) const;
+
+	// same, for used waypoints with all of iFlags (every one if iFlags is 0)
+	template <typename FN>
+	void forEachWithFlags ( int iFlags, FN fn ) const;
+
+	int getPathsBegin ( const int iWpt ) const { return m_iPathOffsets[static_cast<std::size_t>(iWpt)]; }
+	int getPathsEnd ( const int iWpt ) const { return m_iPathOffsets[static_cast<std::size_t>(iWpt) + 1]; }
+	int getPathTarget ( const int iPath ) const { return m_iPathTargets[static_cast<std::size_t>(iPath)]; }
+	float getPathLength ( const int iPath ) const { return m_fPathLengths[static_cast<std::size_t>(iPath)]; }
+	int getPathFlags ( const int iPath ) const { return m_iPathFlags[static_cast<std::size_t>(iPath)]; }
+	int numPaths () const { return static_cast<int>(m_iPathTargets.size()); }
+
+	// paths into a waypoint, each one is the index of the path above
+	int getPathsFromBegin ( const int iWpt ) const { return m_iPathFromOffsets[static_cast<std::size_t>(iWpt)]; }
+	int getPathsFromEnd ( const int iWpt ) const { return m_iPathFromOffsets[static_cast<std::size_t>(iWpt) + 1]; }
+	int getPathFrom ( const int iIndex ) const { return m_iPathsFrom[static_cast<std::size_t>(iIndex)]; }
+	int getPathSource ( const int iPath ) const { return m_iPathSources[static_cast<std::size_t>(iPath)]; }
+
+	unsigned int getRevision () const { return m_iRevision; }
+
+	enum : std::uint8_t
+	{
+		PATH_FROM_TELEPORT = 1, // costs nothing to take
+		PATH_TO_TELEPORT = 2
+	};
+private:
+	void build ();
+
+	// waypoints
+	std::vector<Vector> m_vOrigins;
+	std::vector<int> m_iFlags;
+	std::vector<int> m_iAreas;
+	std::vector<std::uint8_t> m_bUsed;
+
+	// used waypoints : all of them, then by flag bit
+	std::vector<int> m_iUsed;
+	std::vector<int> m_iFlagged[32];
+
+	// paths
+	std::vector<int> m_iPathOffsets; // numWaypoints + 1
+	std::vector<int> m_iPathTargets;
+	std::vector<int> m_iPathSources;
+	std::vector<float> m_fPathLengths;
+	std::vector<std::uint8_t> m_iPathFlags;
+
+	// paths into each waypoint
+	std::vector<int> m_iPathFromOffsets; // numWaypoints + 1
+	std::vector<int> m_iPathsFrom;
+
+	unsigned int m_iRevision = 0;
+
+	static std::shared_ptr<const CWaypointGraphSnapshot> m_pCurrent;
+};
+
+template <typename FN>
+void CWaypointGraphSnapshot :: forEachWithSomeFlags ( const int iFlags, FN fn ) const
+{
+	if ( iFlags == -1 )
+	{
+		for ( const int iWpt : m_iUsed )
+			fn(iWpt);
+
+		return;
+	}
+
+	// one list per bit, merged in index order, a waypoint in more than one
+	// list is visited once
+	const std::vector<int> *pLists[32];
+	std::size_t iPos[32];
+	int iNumLists = 0;
+
+	for ( int iBit = 0; iBit < 32; iBit ++ )
+	{
+		if ( (static_cast<unsigned>(iFlags) & (1u << iBit)) && !m_iFlagged[iBit].empty() )
+		{
+			pLists[iNumLists] = &m_iFlagged[iBit];
+			iPos[iNumLists] = 0;
+			iNumLists++;
+		}
+	}
+
+	if ( iNumLists == 1 )
+	{
+		for ( const int iWpt : *pLists[0] )
+			fn(iWpt);
+
+		return;
+	}
+
+	while ( iNumLists > 0 )
+	{
+		int iLowest = (*pLists[0])[iPos[0]];
+
+		for ( int i = 1; i < iNumLists; i ++ )
+		{
+			if ( (*pLists[i])[iPos[i]] < iLowest )
+				iLowest = (*pLists[i])[iPos[i]];
+		}
+
+		fn(iLowest);
+
+		for ( int i = 0; i < iNumLists; )
+		{
+			if ( (*pLists[i])[iPos[i]] == iLowest && ++iPos[i] == pLists[i]->size() )
+			{
+				// list finished
+				iNumLists--;
+				pLists[i] = pLists[iNumLists];
+				iPos[i] = iPos[iNumLists];
+			}
+			else
+				i++;
+		}
+	}
+}
+
+template <typename FN>
+void CWaypointGraphSnapshot :: forEachWithFlags ( const int iFlags, FN fn ) const
+{
+	if ( iFlags == 0 )
+	{
+		for ( const int iWpt : m_iUsed )
+			fn(iWpt);
+
+		return;
+	}
+
+	// walk the shortest list of the flags wanted
+	const std::vector<int> *pList = nullptr;
+
+	for ( int iBit = 0; iBit < 32; iBit ++ )
+	{
+		if ( (static_cast<unsigned>(iFlags) & (1u << iBit)) && (pList == nullptr || m_iFlagged[iBit].size() < pList->size()) )
+			pList = &m_iFlagged[iBit];
+	}
+
+	for ( const int iWpt : *pList )
+	{
+		if ( (getFlags(iWpt) & iFlags) == iFlags )
+			fn(iWpt);
+	}
+}
+
+#endif
@@ -35,14 +35,25 @@
 #include "bot.h"
 #include "bot_waypoint.h"
 #include "bot_waypoint_visibility.h"
+#include "bot_waypoint_snapshot.h"
 #include "bot_globals.h"
 #include "bot_compress.h"
+#include "bot_save_queue.h"
+#include "bot_trace_budget.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
+#include <utility>
 
 #include "rcbot/logging.h"
 
+// files saved before the table was sized to the map have a shorter header
+// and rows of 2048 bits
+constexpr int LEGACY_VIS_MAX_WAYPOINTS = 2048;
+constexpr std::size_t LEGACY_VIS_HEADER_SIZE = sizeof(int) * 2 + 64;
+constexpr std::size_t LEGACY_VIS_FILE_SIZE = LEGACY_VIS_HEADER_SIZE + LEGACY_VIS_MAX_WAYPOINTS * LEGACY_VIS_MAX_WAYPOINTS / 8;
+
  /*unsigned char *CWaypointVisibilityTable :: m_VisTable = NULL;
  bool CWaypointVisibilityTable :: bWorkVisibility = false;
  int CWaypointVisibilityTable :: iCurFrom = 0;
@@ -53,6 +64,14 @@ void CWaypointVisibilityTable::workVisibility()
 	int iTicks = 0;
 	const unsigned short int iSize = static_cast<unsigned short int>(CWaypoints::numWaypoints());
 
+	// bots come first when tracelines are short this frame
+	if (!CTraceBudget::request(CTraceBudget::TRACE_VIS_TABLE, m_fLastWorkTime + CTraceBudget::VIS_TABLE_DEADLINE))
+		return;
+
+	m_fLastWorkTime = engine->Time();
+
+	CTraceCategory traceCategory(CTraceBudget::TRACE_VIS_TABLE);
+
 	for (/*iCurFrom = iCurFrom*/; iCurFrom < iSize; iCurFrom++)
 	{
 		for (/*iCurTo = iCurTo*/; iCurTo < iSize; iCurTo++)
@@ -112,7 +131,7 @@ void CWaypointVisibilityTable::workVisibility()
 	}
 }
 
-void CWaypointVisibilityTable::workVisibilityForWaypoint(const int i, const int iNumWaypoints, const bool bTwoway) const
+void CWaypointVisibilityTable::workVisibilityForWaypoint(const int i, const int iNumWaypoints, const bool bTwoway)
 {
 	static CWaypoint* Waypoint1;
 	static CWaypoint* Waypoint2;
@@ -168,32 +187,24 @@ bool CWaypointVisibilityTable::SaveToFile() const
 	header.numwaypoints = CWaypoints::numWaypoints();
 	std::strncpy(header.szMapName, CBotGlobals::getMapName(), 63);
 	header.waypoint_version = CWaypoints::WAYPOINT_VERSION;
+	header.maxwaypoints = m_iMaxWaypoints;
 
 	// Build a combined buffer: header + vis table data
-	constexpr std::size_t totalSize = sizeof(wpt_vis_header_t) + sizeof(byte) * g_iMaxVisibilityByte;
-	unsigned char* pBuf = static_cast<unsigned char*>(std::malloc(totalSize));
-
-	if (!pBuf)
-	{
-		logger->Log(LogLevel::ERROR, "Can't allocate buffer for Waypoint Visibility save!");
-		return false;
-	}
+	const std::size_t tableSize = m_VisTable.size() * sizeof(std::uint64_t);
+	std::vector<unsigned char> data(sizeof(wpt_vis_header_t) + tableSize);
 
-	std::memcpy(pBuf, &header, sizeof(wpt_vis_header_t));
-	std::memcpy(pBuf + sizeof(wpt_vis_header_t), m_VisTable, sizeof(byte) * g_iMaxVisibilityByte);
+	std::memcpy(data.data(), &header, sizeof(wpt_vis_header_t));
+	std::memcpy(data.data() + sizeof(wpt_vis_header_t), m_VisTable.data(), tableSize);
 
 	CBotGlobals::makeFolders(filename);
-	const bool bResult = RCBot_CompressedSave(filename, pBuf, totalSize);
 
-	std::free(pBuf);
+	// compressed and written by the save thread, which logs if it fails
+	CSaveQueue::save(filename, std::move(data));
 
-	if (!bResult)
-		logger->Log(LogLevel::ERROR, "Can't save Waypoint Visibility table!");
-
-	return bResult;
+	return true;
 }
 
-bool CWaypointVisibilityTable::ReadFromFile(const int numwaypoints) const
+bool CWaypointVisibilityTable::ReadFromFile(const int numwaypoints)
 {
 	char filename[1024];
 
@@ -201,7 +212,19 @@ bool CWaypointVisibilityTable::ReadFromFile(const int numwaypoints) const
 
 	CBotGlobals::buildFileName(filename, CBotGlobals::getMapName(), BOT_AUXILERY_FOLDER, BOT_VISIBILITY_EXTENSION, true);
 
-	constexpr std::size_t totalSize = sizeof(wpt_vis_header_t) + sizeof(byte) * g_iMaxVisibilityByte;
+	CSaveQueue::waitFor(filename);
+
+	std::size_t totalSize = 0;
+
+	if (!RCBot_CompressedSize(filename, &totalSize) || totalSize < LEGACY_VIS_HEADER_SIZE)
+		return false;
+
+	const bool bLegacy = totalSize == LEGACY_VIS_FILE_SIZE;
+	const std::size_t headerSize = bLegacy ? LEGACY_VIS_HEADER_SIZE : sizeof(wpt_vis_header_t);
+
+	if (totalSize < headerSize)
+		return false;
+
 	unsigned char* pBuf = static_cast<unsigned char*>(std::malloc(totalSize));
 
 	if (!pBuf)
@@ -216,20 +239,125 @@ bool CWaypointVisibilityTable::ReadFromFile(const int numwaypoints) const
 		return false;
 	}
 
-	// pBuf is malloc'd as totalSize = sizeof(wpt_vis_header_t) + the visibility payload, so copying
-	// out just the header is in-bounds. V1086's "underflow" is a false positive. [APG]RoboCop[CL]
-	std::memcpy(&header, pBuf, sizeof(wpt_vis_header_t)); //-V1086
+	// pBuf holds at least headerSize bytes, so copying out just the header is in-bounds.
+	// V1086's "underflow" is a false positive. [APG]RoboCop[CL]
+	header.maxwaypoints = LEGACY_VIS_MAX_WAYPOINTS;
+	std::memcpy(&header, pBuf, headerSize); //-V1086
+
+	const int iFileMaxWaypoints = header.maxwaypoints;
 
 	if (header.numwaypoints != numwaypoints ||
-		header.waypoint_version != CWaypoints::WAYPOINT_VERSION ||
-		std::strncmp(header.szMapName, CBotGlobals::getMapName(), 63) != 0)
+		header.waypoint_version < 5 || header.waypoint_version > CWaypoints::WAYPOINT_VERSION || // visibility is unchanged since 5
+		std::strncmp(header.szMapName, CBotGlobals::getMapName(), 63) != 0 ||
+		iFileMaxWaypoints <= 0 || iFileMaxWaypoints % 8 != 0 || numwaypoints > iFileMaxWaypoints ||
+		numwaypoints > m_iMaxWaypoints ||
+		totalSize != headerSize + static_cast<std::size_t>(iFileMaxWaypoints) * iFileMaxWaypoints / 8)
 	{
 		std::free(pBuf);
 		return false;
 	}
 
-	std::memcpy(m_VisTable, pBuf + sizeof(wpt_vis_header_t), sizeof(byte) * g_iMaxVisibilityByte);
+	// only the rows and columns of real waypoints are copied, rows may be a different length
+	const std::size_t fileRowBytes = static_cast<std::size_t>(iFileMaxWaypoints) / 8;
+	const std::size_t rowBytes = static_cast<std::size_t>(m_iRowWords) * sizeof(std::uint64_t);
+	const std::size_t copyBytes = std::min<std::size_t>((static_cast<std::size_t>(numwaypoints) + 7) / 8, std::min(fileRowBytes, rowBytes));
+
+	std::fill(m_VisTable.begin(), m_VisTable.end(), 0);
+	m_bListsDirty = true;
+
+	unsigned char* pTable = reinterpret_cast<unsigned char*>(m_VisTable.data());
+
+	for (int i = 0; i < numwaypoints; i++)
+	{
+		std::memcpy(pTable + rowBytes * i, pBuf + headerSize + fileRowBytes * i, copyBytes);
+	}
 
 	std::free(pBuf);
 	return true;
-}
\ No newline at end of file
+}
+
+void CWaypointVisibilityTable::ResizeVisibilityTable(const int iMaxWaypoints)
+{
+	const int iRowWords = (iMaxWaypoints + 63) / 64;
+
+	if (iMaxWaypoints == m_iMaxWaypoints && !m_VisTable.empty())
+		return;
+
+	std::vector<std::uint64_t> newTable(static_cast<std::size_t>(iMaxWaypoints) * iRowWords, 0);
+
+	const int iRows = std::min(m_iMaxWaypoints, iMaxWaypoints);
+	const int iCopyWords = std::min(m_iRowWords, iRowWords);
+
+	for (int i = 0; i < iRows; i++)
+	{
+		std::copy_n(m_VisTable.begin() + static_cast<std::size_t>(i) * m_iRowWords, iCopyWords,
+			newTable.begin() + static_cast<std::size_t>(i) * iRowWords);
+	}
+
+	m_VisTable.swap(newTable);
+	m_iMaxWaypoints = iMaxWaypoints;
+	m_iRowWords = iRowWords;
+	m_bListsDirty = true;
+}
+
+bool CWaypointVisibilityTable::UpdateVisibleLists()
+{
+	if (bWorkVisibility)
+		return false;
+
+	if (!m_bListsDirty && m_iListsRevision == CWaypoints::getGraphRevision())
+		return true;
+
+	const CWaypointGraphSnapshot* pGraph = CWaypointGraphSnapshot::current();
+	const int iNumWaypoints = std::min(pGraph->numWaypoints(), m_iMaxWaypoints);
+
+	m_iVisibleOffsets.assign(static_cast<std::size_t>(iNumWaypoints) + 1, 0);
+	m_iVisibleWpts.clear();
+	m_fVisibleDists.clear();
+
+	std::vector<std::pair<float, int>> row;
+
+	for (int i = 0; i < iNumWaypoints; i++)
+	{
+		m_iVisibleOffsets[i] = static_cast<int>(m_iVisibleWpts.size());
+
+		if (!pGraph->isUsed(i))
+			continue;
+
+		const Vector& vFrom = pGraph->getOrigin(i);
+
+		row.clear();
+
+		ForEachBit(GetRow(i), iNumWaypoints, [&](const int j)
+		{
+			if (!pGraph->isUsed(j))
+				return;
+
+			const float fDist = (pGraph->getOrigin(j) - vFrom).Length();
+
+			if (fDist <= VISIBLE_LIST_RANGE)
+				row.emplace_back(fDist, j);
+		});
+
+		if (row.size() > static_cast<std::size_t>(MAX_VISIBLE_LIST))
+		{
+			std::nth_element(row.begin(), row.begin() + MAX_VISIBLE_LIST, row.end());
+			row.resize(MAX_VISIBLE_LIST);
+		}
+
+		std::sort(row.begin(), row.end());
+
+		for (const std::pair<float, int>& entry : row)
+		{
+			m_fVisibleDists.emplace_back(entry.first);
+			m_iVisibleWpts.emplace_back(entry.second);
+		}
+	}
+
+	m_iVisibleOffsets[iNumWaypoints] = static_cast<int>(m_iVisibleWpts.size());
+
+	m_bListsDirty = false;
+	m_iListsRevision = CWaypoints::getGraphRevision();
+
+	return true;
+}
@@ -33,14 +33,19 @@
 
 #include "bot_waypoint.h"
 
-constexpr int g_iMaxVisibilityByte =
-(CWaypoints::MAX_WAYPOINTS * CWaypoints::MAX_WAYPOINTS) / 8; // divide by 8 bits, need byte number
+#include <algorithm>
+#include <cstdint>
+#include <vector>
 
+// the table is one row of bits per waypoint, rows are as long as the waypoint
+// capacity, which is always a multiple of 64 so each row is whole 64 bit words
+// (saved as the same bytes on little endian, which is all the game runs on)
 typedef struct
 {
 	int numwaypoints;
 	int waypoint_version;
 	char szMapName[64];
+	int maxwaypoints; // row length, files without this use 2048
 }wpt_vis_header_t;
 
 class CWaypointVisibilityTable
@@ -48,64 +53,75 @@ class CWaypointVisibilityTable
 public:
 	CWaypointVisibilityTable()
 	{
-		m_VisTable = nullptr;
+		m_iMaxWaypoints = 0;
+		m_iRowWords = 0;
+		m_bListsDirty = true;
+		m_iListsRevision = 0;
 		bWorkVisibility = false;
 		iCurFrom = 0;
 		iCurTo = 0;
 		m_iPrevPercent = 0;
 		m_fNextShowMessageTime = 0;
+		m_fLastWorkTime = 0;
 	}
 
 	void workVisibility();
 
 	void init()
 	{
-		constexpr int iSize = g_iMaxVisibilityByte;
-
 		/////////////////////////////
 		// for "concurrent" reading of
 		// visibility throughout frames
 		bWorkVisibility = false;
 		m_fNextShowMessageTime = 0;
+		m_fLastWorkTime = 0;
 		iCurFrom = 0;
 		iCurTo = 0;
 		////////////////////////////
 
-		//create a heap...
-		m_VisTable = new unsigned char[iSize];
-
 		m_iPrevPercent = 0;
-		memset(m_VisTable, 0, iSize);
+
+		ResizeVisibilityTable(CWaypoints::getMaxWaypoints());
+		ClearVisibilityTable();
 	}
 
 	bool SaveToFile() const;
 
-	bool ReadFromFile(int numwaypoints) const;
+	bool ReadFromFile(int numwaypoints);
 
-	void workVisibilityForWaypoint(int i, int iNumWaypoints, bool bTwoway = false) const;
+	// keeps the visibility between waypoints that fit in the new size
+	void ResizeVisibilityTable(int iMaxWaypoints);
+
+	void workVisibilityForWaypoint(int i, int iNumWaypoints, bool bTwoway = false);
 
 	bool GetVisibilityFromTo(const int iFrom, const int iTo) const
 	{
-		// work out the position
-		const int iPosition = (iFrom * CWaypoints::MAX_WAYPOINTS) + iTo;
+		const std::uint64_t* pRow = GetRow(iFrom);
 
-		const int iByte = iPosition / 8;
-		const int iBit = iPosition % 8;
+		if (pRow == nullptr || iTo < 0 || iTo >= m_iMaxWaypoints)
+			return false;
 
-		if (iByte < g_iMaxVisibilityByte)
-		{
-			const unsigned char* ToReturn = (m_VisTable + iByte);
+		return TestBit(pRow, iTo);
+	}
 
-			return ((*ToReturn & (1 << iBit)) > 0);
-		}
+	// waypoints iFrom can see, GetRowWords() words long, or nullptr
+	const std::uint64_t* GetRow(const int iFrom) const
+	{
+		if (iFrom < 0 || iFrom >= m_iMaxWaypoints)
+			return nullptr;
 
-		return false;
+		return m_VisTable.data() + static_cast<std::size_t>(iFrom) * m_iRowWords;
+	}
+
+	int GetRowWords() const
+	{
+		return m_iRowWords;
 	}
 
 	void ClearVisibilityTable()
 	{
-		if (m_VisTable)
-			memset(m_VisTable, 0, g_iMaxVisibilityByte);
+		std::fill(m_VisTable.begin(), m_VisTable.end(), 0);
+		m_bListsDirty = true;
 
 		/////////////////////////////
 		// for "concurrent" reading of
@@ -118,11 +134,16 @@ public:
 
 	void FreeVisibilityTable()
 	{
-		if (m_VisTable != nullptr)
-		{
-			delete[] m_VisTable;
-			m_VisTable = nullptr;
-		}
+		m_VisTable.clear();
+		m_VisTable.shrink_to_fit();
+
+		m_iMaxWaypoints = 0;
+		m_iRowWords = 0;
+
+		m_iVisibleOffsets.clear();
+		m_iVisibleWpts.clear();
+		m_fVisibleDists.clear();
+		m_bListsDirty = true;
 
 		/////////////////////////////
 		// for "concurrent" reading of
@@ -133,26 +154,59 @@ public:
 		////////////////////////////
 	}
 
-	void SetVisibilityFromTo(const int iFrom, const int iTo, const bool bVisible) const
+	void SetVisibilityFromTo(const int iFrom, const int iTo, const bool bVisible)
 	{
-		const int iPosition = (iFrom * CWaypoints::MAX_WAYPOINTS) + iTo;
+		if (iFrom < 0 || iFrom >= m_iMaxWaypoints || iTo < 0 || iTo >= m_iMaxWaypoints)
+			return;
 
-		const int iByte = iPosition / 8;
-		const int iBit = iPosition % 8;
+		std::uint64_t& word = m_VisTable[static_cast<std::size_t>(iFrom) * m_iRowWords + iTo / 64];
+		const std::uint64_t bit = static_cast<std::uint64_t>(1) << (iTo % 64);
 
-		if (iByte < g_iMaxVisibilityByte)
-		{
-			unsigned char* ToChange = (m_VisTable + iByte);
+		if (bVisible)
+			word |= bit;
+		else
+			word &= ~bit;
 
-			if (bVisible)
-				*ToChange |= (1 << iBit);
-			else
-				*ToChange &= ~(1 << iBit);
-		}
+		m_bListsDirty = true;
 	}
 
 	void WorkOutVisibilityTable();
 
+	////////////////////////////
+	// waypoints each used waypoint can see within VISIBLE_LIST_RANGE, nearest
+	// first, all in one array (compressed sparse rows) so finding a visible
+	// waypoint is a walk along a list instead of traces
+
+	// rebuilds the lists if the waypoints or visibility changed since, false
+	// while visibility is still being worked out
+	bool UpdateVisibleLists();
+
+	// entries for iFrom are GetVisibleBegin(iFrom) up to GetVisibleEnd(iFrom)
+	int GetVisibleBegin(const int iFrom) const
+	{
+		return iFrom >= 0 && iFrom + 1 < static_cast<int>(m_iVisibleOffsets.size()) ? m_iVisibleOffsets[static_cast<std::size_t>(iFrom)] : 0;
+	}
+
+	int GetVisibleEnd(const int iFrom) const
+	{
+		return iFrom >= 0 && iFrom + 1 < static_cast<int>(m_iVisibleOffsets.size()) ? m_iVisibleOffsets[static_cast<std::size_t>(iFrom) + 1] : 0;
+	}
+
+	int GetVisibleWaypoint(const int iEntry) const
+	{
+		return m_iVisibleWpts[static_cast<std::size_t>(iEntry)];
+	}
+
+	// from the waypoint whose list it is
+	float GetVisibleDistance(const int iEntry) const
+	{
+		return m_fVisibleDists[static_cast<std::size_t>(iEntry)];
+	}
+
+	static constexpr float VISIBLE_LIST_RANGE = 2048.0f;
+	// nearest ones kept for waypoints seeing more than this
+	static constexpr int MAX_VISIBLE_LIST = 256;
+
 	bool needToWorkVisibility() const
 	{
 		return bWorkVisibility;
@@ -163,15 +217,108 @@ public:
 		bWorkVisibility = bSet;
 	}
 
+	////////////////////////////
+	// operations on whole rows, for asking which of many waypoints can see something
+	// without testing them one at a time
+
+	static bool TestBit(const std::uint64_t* pRow, const int iBit)
+	{
+		return (pRow[iBit / 64] >> (iBit % 64) & 1) != 0;
+	}
+
+	// pDest = pDest & pRow
+	static void AndRow(std::uint64_t* pDest, const std::uint64_t* pRow, const int iWords)
+	{
+		for (int i = 0; i < iWords; i++)
+			pDest[i] &= pRow[i];
+	}
+
+	// pDest = pDest & ~pRow
+	static void AndNotRow(std::uint64_t* pDest, const std::uint64_t* pRow, const int iWords)
+	{
+		for (int i = 0; i < iWords; i++)
+			pDest[i] &= ~pRow[i];
+	}
+
+	// pDest = pDest | pRow
+	static void OrRow(std::uint64_t* pDest, const std::uint64_t* pRow, const int iWords)
+	{
+		for (int i = 0; i < iWords; i++)
+			pDest[i] |= pRow[i];
+	}
+
+	static int CountBits(const std::uint64_t* pRow, const int iWords)
+	{
+		int iCount = 0;
+
+		for (int i = 0; i < iWords; i++)
+			iCount += popCount(pRow[i]);
+
+		return iCount;
+	}
+
+	// calls fn(iWaypoint) for each set bit below iNumBits, lowest first
+	template <typename F>
+	static void ForEachBit(const std::uint64_t* pRow, const int iNumBits, F fn)
+	{
+		const int iWords = (iNumBits + 63) / 64;
+
+		for (int i = 0; i < iWords; i++)
+		{
+			std::uint64_t word = pRow[i];
+
+			while (word != 0)
+			{
+				const int iBit = i * 64 + lowestBit(word);
+
+				if (iBit >= iNumBits)
+					return;
+
+				fn(iBit);
+
+				word &= word - 1;
+			}
+		}
+	}
+
 private:
+	static int popCount(std::uint64_t x)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_popcountll(x);
+#else
+		x = x - (x >> 1 & 0x5555555555555555ULL);
+		x = (x & 0x3333333333333333ULL) + (x >> 2 & 0x3333333333333333ULL);
+		x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+		return static_cast<int>(x * 0x0101010101010101ULL >> 56);
+#endif
+	}
+
+	// x must not be 0
+	static int lowestBit(const std::uint64_t x)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_ctzll(x);
+#else
+		return popCount((x & (~x + 1)) - 1);
+#endif
+	}
 
 	bool bWorkVisibility;
 	unsigned short int iCurFrom;
 	unsigned short int iCurTo;
 	static constexpr int WAYPOINT_VIS_TICKS = 64;
-	unsigned char* m_VisTable;
+	std::vector<std::uint64_t> m_VisTable;
+	int m_iMaxWaypoints;
+	int m_iRowWords;
 	float m_fNextShowMessageTime;
+	float m_fLastWorkTime;
 	int m_iPrevPercent;
-	// use a heap of 1 byte * size to keep things simple.
+
+	std::vector<int> m_iVisibleOffsets; // numWaypoints + 1
+	std::vector<int> m_iVisibleWpts;
+	std::vector<float> m_fVisibleDists;
+	bool m_bListsDirty;
+	unsigned int m_iListsRevision; // graph revision they were built for
 };
 #endif
\ No newline at end of file
@@ -5,32 +5,120 @@
 #include "bot_wpt_dist.h"
 #include "bot_globals.h"
 #include "bot_waypoint.h"
+#include "bot_waypoint_snapshot.h"
 #include "bot_compress.h"
+#include "bot_save_queue.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
 #include <cstring>
+#include <utility>
 
 typedef struct
 {
 	int version;
 	int numwaypoints;
-	int maxwaypoints;
+	int numrows;
 }wpt_dist_hdr_t;
 
-int CWaypointDistances::m_Distances[CWaypoints::MAX_WAYPOINTS][CWaypoints::MAX_WAYPOINTS];
+// each row in the file is its waypoint index then numwaypoints distances
+
+std::vector<CWaypointDistances::wpt_dist_row_t> CWaypointDistances::m_Rows;
+int CWaypointDistances::m_iMaxWaypoints = 0;
+int CWaypointDistances::m_iNumRows = 0;
+int CWaypointDistances::m_iNumDirtyRows = 0;
 float CWaypointDistances::m_fSaveTime = 0.0f;
 
+void CWaypointDistances::reset()
+{
+	for (wpt_dist_row_t& row : m_Rows)
+	{
+		row.distances.clear();
+		row.distances.shrink_to_fit();
+		row.bDirty = false;
+	}
+
+	m_iNumRows = 0;
+	m_iNumDirtyRows = 0;
+}
+
+void CWaypointDistances::resize(const int iMaxWaypoints)
+{
+	m_iMaxWaypoints = iMaxWaypoints;
+	m_Rows.resize(static_cast<std::size_t>(iMaxWaypoints), wpt_dist_row_t{ {}, false });
+
+	m_iNumRows = 0;
+	m_iNumDirtyRows = 0;
+
+	for (wpt_dist_row_t& row : m_Rows)
+	{
+		if (row.distances.empty())
+			continue;
+
+		row.distances.resize(static_cast<std::size_t>(iMaxWaypoints), 0);
+
+		m_iNumRows++;
+
+		if (row.bDirty)
+			m_iNumDirtyRows++;
+	}
+}
+
+void CWaypointDistances::setDistance(const int iFrom, const int iTo, const float fDist)
+{
+	if (iFrom < 0 || iTo < 0 || iFrom >= static_cast<int>(m_Rows.size()) || iTo >= m_iMaxWaypoints)
+		return;
+
+	wpt_dist_row_t& row = m_Rows[iFrom];
+
+	if (row.distances.empty())
+	{
+		const std::size_t rowBytes = static_cast<std::size_t>(m_iMaxWaypoints) * sizeof(std::uint16_t);
+
+		if (static_cast<std::size_t>(m_iNumRows + 1) * rowBytes > MAX_DISTANCE_BYTES)
+			return;
+
+		row.distances.assign(static_cast<std::size_t>(m_iMaxWaypoints), 0);
+		m_iNumRows++;
+	}
+
+	// 0 is kept for "not set"
+	const long iSteps = std::lround(std::max(fDist, 0.0f) / DISTANCE_UNIT) + 1;
+	const std::uint16_t iStored = static_cast<std::uint16_t>(std::min(iSteps, 0xFFFFL));
+
+	if (row.distances[iTo] == iStored)
+		return;
+
+	row.distances[iTo] = iStored;
+
+	if (!row.bDirty)
+	{
+		row.bDirty = true;
+		m_iNumDirtyRows++;
+	}
+}
+
 void CWaypointDistances::load()
 {
 	wpt_dist_hdr_t hdr;
 	const char* szMapName = CBotGlobals::getMapName();
 
+	reset();
+
 	if (szMapName && *szMapName)
 	{
 		char filename[1024];
 		CBotGlobals::buildFileName(filename, szMapName, BOT_AUXILERY_FOLDER, BOT_WAYPOINT_DST_EXTENSION, true);
 
-		constexpr std::size_t totalSize = sizeof(wpt_dist_hdr_t) + sizeof(m_Distances);
+		// saved at the end of the last map if it was this one
+		CSaveQueue::waitFor(filename);
+
+		std::size_t totalSize = 0;
+
+		if (!RCBot_CompressedSize(filename, &totalSize) || totalSize < sizeof(wpt_dist_hdr_t))
+			return;
+
 		unsigned char* pBuf = static_cast<unsigned char*>(std::malloc(totalSize));
 
 		if (!pBuf)
@@ -42,13 +130,33 @@ void CWaypointDistances::load()
 			return;
 		}
 
-		// pBuf is malloc'd as totalSize = sizeof(wpt_dist_hdr_t) + sizeof(m_Distances), so copying
-		// out just the header is in-bounds. V1086's "underflow" is a false positive. [APG]RoboCop[CL]
-		std::memcpy(&hdr, pBuf, sizeof(wpt_dist_hdr_t)); //-V1086
+		std::memcpy(&hdr, pBuf, sizeof(wpt_dist_hdr_t));
 
-		if ((hdr.maxwaypoints == CWaypoints::MAX_WAYPOINTS) && (hdr.numwaypoints == CWaypoints::numWaypoints()) && (hdr.version == WPT_DIST_VER))
+		const int iNumWaypoints = CWaypoints::numWaypoints();
+		const std::size_t recordSize = sizeof(int) + static_cast<std::size_t>(iNumWaypoints) * sizeof(std::uint16_t);
+
+		if ((hdr.version == WPT_DIST_VER) && (hdr.numwaypoints == iNumWaypoints) && (iNumWaypoints <= m_iMaxWaypoints) &&
+			(hdr.numrows >= 0) && (totalSize == sizeof(wpt_dist_hdr_t) + static_cast<std::size_t>(hdr.numrows) * recordSize))
 		{
-			std::memcpy(m_Distances, pBuf + sizeof(wpt_dist_hdr_t), sizeof(m_Distances));
+			const unsigned char* pRecord = pBuf + sizeof(wpt_dist_hdr_t);
+
+			for (int i = 0; i < hdr.numrows; i++, pRecord += recordSize)
+			{
+				int iRow;
+
+				std::memcpy(&iRow, pRecord, sizeof(int));
+
+				if (iRow < 0 || iRow >= iNumWaypoints)
+					continue;
+
+				wpt_dist_row_t& row = m_Rows[iRow];
+
+				if (row.distances.empty())
+					m_iNumRows++;
+
+				row.distances.assign(static_cast<std::size_t>(m_iMaxWaypoints), 0);
+				std::memcpy(row.distances.data(), pRecord + sizeof(int), static_cast<std::size_t>(iNumWaypoints) * sizeof(std::uint16_t));
+			}
 		}
 
 		std::free(pBuf);
@@ -60,6 +168,10 @@ void CWaypointDistances::save()
 {
 	const char* szMapName = CBotGlobals::getMapName();
 
+	// nothing learnt since the last load or save
+	if (m_iNumDirtyRows == 0)
+		return;
+
 	if (szMapName && *szMapName)
 	{
 		char filename[1024];
@@ -67,44 +179,62 @@ void CWaypointDistances::save()
 
 		CBotGlobals::buildFileName(filename, szMapName, BOT_AUXILERY_FOLDER, BOT_WAYPOINT_DST_EXTENSION, true);
 
-		hdr.maxwaypoints = CWaypoints::MAX_WAYPOINTS;
-		hdr.numwaypoints = CWaypoints::numWaypoints();
-		hdr.version = WPT_DIST_VER;
+		const int iNumWaypoints = std::min(CWaypoints::numWaypoints(), m_iMaxWaypoints);
+		const std::size_t recordSize = sizeof(int) + static_cast<std::size_t>(iNumWaypoints) * sizeof(std::uint16_t);
 
-		constexpr std::size_t totalSize = sizeof(wpt_dist_hdr_t) + sizeof(m_Distances);
-		unsigned char* pBuf = static_cast<unsigned char*>(std::malloc(totalSize));
+		hdr.numwaypoints = iNumWaypoints;
+		hdr.numrows = 0;
+		hdr.version = WPT_DIST_VER;
 
-		if (!pBuf)
+		for (int i = 0; i < iNumWaypoints; i++)
 		{
-			m_fSaveTime = engine->Time() + 100.0f;
-			return;
+			if (!m_Rows[i].distances.empty())
+				hdr.numrows++;
 		}
 
-		std::memcpy(pBuf, &hdr, sizeof(wpt_dist_hdr_t));
-		std::memcpy(pBuf + sizeof(wpt_dist_hdr_t), m_Distances, sizeof(m_Distances));
+		std::vector<unsigned char> data(sizeof(wpt_dist_hdr_t) + static_cast<std::size_t>(hdr.numrows) * recordSize);
+
+		std::memcpy(data.data(), &hdr, sizeof(wpt_dist_hdr_t));
+
+		unsigned char* pRecord = data.data() + sizeof(wpt_dist_hdr_t);
+
+		for (int i = 0; i < iNumWaypoints; i++)
+		{
+			if (m_Rows[i].distances.empty())
+				continue;
+
+			std::memcpy(pRecord, &i, sizeof(int));
+			std::memcpy(pRecord + sizeof(int), m_Rows[i].distances.data(), static_cast<std::size_t>(iNumWaypoints) * sizeof(std::uint16_t));
+			pRecord += recordSize;
+		}
 
 		CBotGlobals::makeFolders(filename);
-		RCBot_CompressedSave(filename, pBuf, totalSize);
 
-		std::free(pBuf);
+		// compressed and written by the save thread, which logs if it fails
+		CSaveQueue::save(filename, std::move(data));
+
+		for (wpt_dist_row_t& row : m_Rows)
+			row.bDirty = false;
+
+		m_iNumDirtyRows = 0;
 		m_fSaveTime = engine->Time() + 100.0f;
 	}
-	//}
 }
 
 float CWaypointDistances::getDistance(const int iFrom, const int iTo)
 {
-	if (m_Distances[iFrom][iTo] == -1)
-	{
-		CWaypoint* waypointFrom = CWaypoints::getWaypoint(iFrom);
-		CWaypoint* waypointTo = CWaypoints::getWaypoint(iTo);
+	const std::uint16_t iStored = getStored(iFrom, iTo);
 
-		if (waypointFrom == nullptr || waypointTo == nullptr)
+	if (iStored == 0)
+	{
+		if (!CWaypoints::validWaypointIndex(iFrom) || !CWaypoints::validWaypointIndex(iTo))
 		{
 			return -1.0f;
 		}
 
-		return (waypointFrom->getOrigin() - waypointTo->getOrigin()).Length();
+		const CWaypointGraphSnapshot* pGraph = CWaypointGraphSnapshot::current();
+
+		return (pGraph->getOrigin(iFrom) - pGraph->getOrigin(iTo)).Length();
 	}
-	return static_cast<float>(m_Distances[iFrom][iTo]);
-}
\ No newline at end of file
+	return static_cast<float>(iStored - 1) * DISTANCE_UNIT;
+}
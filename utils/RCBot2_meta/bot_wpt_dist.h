@@ -3,13 +3,20 @@
 
 #include "bot_waypoint.h"
 
+#include <cstdint>
+#include <vector>
+
 enum : std::uint8_t
 {
-	WPT_DIST_VER = 0x03
+	WPT_DIST_VER = 0x05
 };
 
 constexpr const char* BOT_WAYPOINT_DST_EXTENSION = "rcd";
 
+// Route distances between waypoints, learnt from searches. A row is only
+// made the first time a search from that waypoint sets a distance, and the
+// distances are kept as 16 bit steps of DISTANCE_UNIT (0 means not set).
+// Rows remember if they changed so the file is only written when needed.
 class CWaypointDistances
 {
 public:
@@ -22,24 +29,47 @@ public:
 
 	static bool isSet (const int iFrom, const int iTo)
 	{
-		return m_Distances[iFrom][iTo] >= 0;
+		return getStored(iFrom,iTo) != 0;
 	}
 
-	static void setDistance (const int iFrom, const int iTo, const float fDist)
-	{
-		m_Distances[iFrom][iTo] = static_cast<int>(fDist);
-	}
+	static void setDistance ( int iFrom, int iTo, float fDist );
 
 	static void load ();
 
 	static void save ();
 
-	static void reset ()
+	static void reset ();
+
+	// keeps the distances, rows just get longer or shorter
+	static void resize ( int iMaxWaypoints );
+
+	static int numRows () { return m_iNumRows; }
+	static bool isDirty () { return m_iNumDirtyRows > 0; }
+
+	static constexpr float DISTANCE_UNIT = 4.0f;
+	// no new rows once they would use more than this
+	static constexpr std::size_t MAX_DISTANCE_BYTES = 64 * 1024 * 1024;
+private:
+	static std::uint16_t getStored ( const int iFrom, const int iTo )
 	{
-		std::memset(m_Distances,0xFF,sizeof(int)*CWaypoints::MAX_WAYPOINTS*CWaypoints::MAX_WAYPOINTS);
+		if ( iFrom < 0 || iTo < 0 || iFrom >= static_cast<int>(m_Rows.size()) || iTo >= m_iMaxWaypoints )
+			return 0;
+
+		const std::vector<std::uint16_t> &row = m_Rows[iFrom].distances;
+
+		return row.empty() ? 0 : row[iTo];
 	}
-private:
-	static int m_Distances [CWaypoints::MAX_WAYPOINTS][CWaypoints::MAX_WAYPOINTS];
+
+	typedef struct
+	{
+		std::vector<std::uint16_t> distances; // empty until something is set
+		bool bDirty;
+	}wpt_dist_row_t;
+
+	static std::vector<wpt_dist_row_t> m_Rows;
+	static int m_iMaxWaypoints;
+	static int m_iNumRows;
+	static int m_iNumDirtyRows;
 	static float m_fSaveTime;
 
 };
@@ -0,0 +1,665 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include "rcbot_bsp.h"
+#include "rcbot/logging.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+// file layout, see bspfile.h in the SDK
+enum : std::uint8_t
+{
+	LUMP_PLANES = 1,
+	LUMP_VERTEXES = 3,
+	LUMP_NODES = 5,
+	LUMP_FACES = 7,
+	LUMP_LEAFS = 10,
+	LUMP_EDGES = 12,
+	LUMP_SURFEDGES = 13,
+	LUMP_MODELS = 14,
+	LUMP_LEAFBRUSHES = 17,
+	LUMP_BRUSHES = 18,
+	LUMP_BRUSHSIDES = 19,
+	LUMP_DISPINFO = 26,
+	LUMP_DISP_VERTS = 33,
+	HEADER_LUMPS = 64
+};
+
+static constexpr int BSP_IDENT = 'V' | 'B' << 8 | 'S' << 16 | 'P' << 24;
+static constexpr int BSP_MIN_VERSION = 19;
+static constexpr int BSP_MAX_VERSION = 21;
+
+static constexpr std::size_t PLANE_SIZE = 20;
+static constexpr std::size_t NODE_SIZE = 32;
+static constexpr std::size_t LEAF_SIZE_V0 = 56;	// with ambient lighting
+static constexpr std::size_t LEAF_SIZE_V1 = 32;
+static constexpr std::size_t MODEL_SIZE = 48;
+static constexpr std::size_t BRUSH_SIZE = 12;
+static constexpr std::size_t BRUSHSIDE_SIZE = 8;
+static constexpr std::size_t FACE_SIZE = 56;
+static constexpr std::size_t DISPINFO_SIZE = 176;
+static constexpr std::size_t DISPVERT_SIZE = 20;
+
+// MASK_SOLID_BRUSHONLY|CONTENTS_OPAQUE, as CBotGlobals::isVisible traces with
+static constexpr int VISIBLE_MASK = 0x1 | 0x2 | 0x8 | 0x80 | 0x4000 | 0x2000000;
+
+// same as the engine's collision code
+static constexpr float DIST_EPSILON = 0.03125f;
+
+static constexpr int BVH_LEAF_SIZE = 4;
+static constexpr float WORLD_SIZE = 65536.0f;
+
+typedef struct
+{
+	int fileofs;
+	int filelen;
+	int version;
+	char fourCC[4];
+}bsp_lump_t;
+
+static float dot ( const bsp_vec_t &a, const bsp_vec_t &b )
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static bsp_vec_t sub ( const bsp_vec_t &a, const bsp_vec_t &b )
+{
+	return { a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+static bsp_vec_t cross ( const bsp_vec_t &a, const bsp_vec_t &b )
+{
+	return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+static bsp_vec_t lerp ( const bsp_vec_t &a, const bsp_vec_t &b, const float f )
+{
+	return { a.x + (b.x - a.x) * f, a.y + (b.y - a.y) * f, a.z + (b.z - a.z) * f };
+}
+
+static float axis ( const bsp_vec_t &v, const int i )
+{
+	return i == 0 ? v.x : i == 1 ? v.y : v.z;
+}
+
+static float &axis ( bsp_vec_t &v, const int i )
+{
+	return i == 0 ? v.x : i == 1 ? v.y : v.z;
+}
+
+// a lump as an array of fixed size records
+class CBspLump
+{
+public:
+	CBspLump ( const std::vector<unsigned char> &file, const bsp_lump_t &lump, const std::size_t recordSize ) :
+		m_pData(file.data() + lump.fileofs), m_iCount(static_cast<int>(lump.filelen / recordSize)), m_RecordSize(recordSize) {}
+
+	int size () const { return m_iCount; }
+
+	template <typename T>
+	T get ( const int iRecord, const std::size_t offset ) const
+	{
+		T value;
+		std::memcpy(&value, m_pData + m_RecordSize * iRecord + offset, sizeof(T));
+		return value;
+	}
+
+	bsp_vec_t getVec ( const int iRecord, const std::size_t offset ) const
+	{
+		return { get<float>(iRecord, offset), get<float>(iRecord, offset + 4), get<float>(iRecord, offset + 8) };
+	}
+private:
+	const unsigned char *m_pData;
+	int m_iCount;
+	std::size_t m_RecordSize;
+};
+
+bool CBspWorld :: load ( const char *szFilename )
+{
+	std::FILE *fp = std::fopen(szFilename, "rb");
+
+	if ( fp == nullptr )
+	{
+		logger->Log(LogLevel::ERROR, "can't open %s", szFilename);
+		return false;
+	}
+
+	std::fseek(fp, 0, SEEK_END);
+	const long fileSize = std::ftell(fp);
+	std::fseek(fp, 0, SEEK_SET);
+
+	std::vector<unsigned char> file(fileSize > 0 ? static_cast<std::size_t>(fileSize) : 0);
+
+	const bool bRead = !file.empty() && std::fread(file.data(), 1, file.size(), fp) == file.size();
+
+	std::fclose(fp);
+
+	int ident = 0;
+	int version = 0;
+	bsp_lump_t lumps[HEADER_LUMPS];
+
+	if ( !bRead || file.size() < sizeof(int) * 2 + sizeof(lumps) )
+	{
+		logger->Log(LogLevel::ERROR, "%s is too short to be a map", szFilename);
+		return false;
+	}
+
+	std::memcpy(&ident, file.data(), sizeof(int));
+	std::memcpy(&version, file.data() + sizeof(int), sizeof(int));
+	std::memcpy(lumps, file.data() + sizeof(int) * 2, sizeof(lumps));
+
+	if ( ident != BSP_IDENT || version < BSP_MIN_VERSION || version > BSP_MAX_VERSION )
+	{
+		logger->Log(LogLevel::ERROR, "%s isn't a Source map this can read (version %d)", szFilename, version);
+		return false;
+	}
+
+	for ( const int iLump : { LUMP_PLANES, LUMP_VERTEXES, LUMP_NODES, LUMP_FACES, LUMP_LEAFS, LUMP_EDGES, LUMP_SURFEDGES,
+		LUMP_MODELS, LUMP_LEAFBRUSHES, LUMP_BRUSHES, LUMP_BRUSHSIDES, LUMP_DISPINFO, LUMP_DISP_VERTS } )
+	{
+		const bsp_lump_t &lump = lumps[iLump];
+
+		if ( lump.fileofs < 0 || lump.filelen < 0 || static_cast<std::size_t>(lump.fileofs) + lump.filelen > file.size() )
+		{
+			logger->Log(LogLevel::ERROR, "%s : lump %d is outside the file", szFilename, iLump);
+			return false;
+		}
+
+		if ( lump.filelen >= 4 && std::memcmp(file.data() + lump.fileofs, "LZMA", 4) == 0 )
+		{
+			logger->Log(LogLevel::ERROR, "%s : compressed lumps aren't supported, decompress the map first", szFilename);
+			return false;
+		}
+	}
+
+	const CBspLump planes(file, lumps[LUMP_PLANES], PLANE_SIZE);
+	const CBspLump vertexes(file, lumps[LUMP_VERTEXES], sizeof(float) * 3);
+	const CBspLump nodes(file, lumps[LUMP_NODES], NODE_SIZE);
+	const CBspLump faces(file, lumps[LUMP_FACES], FACE_SIZE);
+	const CBspLump leafs(file, lumps[LUMP_LEAFS], lumps[LUMP_LEAFS].version == 0 ? LEAF_SIZE_V0 : LEAF_SIZE_V1);
+	const CBspLump edges(file, lumps[LUMP_EDGES], sizeof(std::uint16_t) * 2);
+	const CBspLump surfedges(file, lumps[LUMP_SURFEDGES], sizeof(int));
+	const CBspLump models(file, lumps[LUMP_MODELS], MODEL_SIZE);
+	const CBspLump leafbrushes(file, lumps[LUMP_LEAFBRUSHES], sizeof(std::uint16_t));
+	const CBspLump brushes(file, lumps[LUMP_BRUSHES], BRUSH_SIZE);
+	const CBspLump brushsides(file, lumps[LUMP_BRUSHSIDES], BRUSHSIDE_SIZE);
+	const CBspLump dispinfos(file, lumps[LUMP_DISPINFO], DISPINFO_SIZE);
+	const CBspLump dispverts(file, lumps[LUMP_DISP_VERTS], DISPVERT_SIZE);
+
+	if ( models.size() == 0 )
+	{
+		logger->Log(LogLevel::ERROR, "%s has no world model", szFilename);
+		return false;
+	}
+
+	////////////////////////////
+	// brushes in the world model's leaves, brush entities have their own trees
+	std::vector<char> bWorldBrush(static_cast<std::size_t>(brushes.size()), 0);
+	std::vector<int> stack;
+
+	stack.push_back(models.get<int>(0, 36)); // headnode
+
+	while ( !stack.empty() )
+	{
+		const int iNode = stack.back();
+		stack.pop_back();
+
+		if ( iNode < 0 )
+		{
+			const int iLeaf = -1 - iNode;
+
+			if ( iLeaf >= leafs.size() )
+				continue;
+
+			const int iFirst = leafs.get<std::uint16_t>(iLeaf, 24);
+			const int iNum = leafs.get<std::uint16_t>(iLeaf, 26);
+
+			for ( int i = iFirst; i < iFirst + iNum && i < leafbrushes.size(); i ++ )
+			{
+				const int iBrush = leafbrushes.get<std::uint16_t>(i, 0);
+
+				if ( iBrush < brushes.size() )
+					bWorldBrush[iBrush] = 1;
+			}
+		}
+		else if ( iNode < nodes.size() )
+		{
+			stack.push_back(nodes.get<int>(iNode, 4));
+			stack.push_back(nodes.get<int>(iNode, 8));
+		}
+	}
+
+	std::vector<bsp_vec_t> mins;
+	std::vector<bsp_vec_t> maxs;
+
+	for ( int i = 0; i < brushes.size(); i ++ )
+	{
+		const int iFirstSide = brushes.get<int>(i, 0);
+		const int iNumSides = brushes.get<int>(i, 4);
+		const int iContents = brushes.get<int>(i, 8);
+
+		if ( !bWorldBrush[i] || (iContents & VISIBLE_MASK) == 0 || iFirstSide < 0 || iFirstSide + iNumSides > brushsides.size() )
+			continue;
+
+		brush_t brush;
+		bsp_vec_t vMins = { -WORLD_SIZE, -WORLD_SIZE, -WORLD_SIZE };
+		bsp_vec_t vMaxs = { WORLD_SIZE, WORLD_SIZE, WORLD_SIZE };
+
+		brush.iFirstPlane = static_cast<int>(m_Planes.size());
+		brush.iNumPlanes = 0;
+
+		for ( int s = iFirstSide; s < iFirstSide + iNumSides; s ++ )
+		{
+			const int iPlane = brushsides.get<std::uint16_t>(s, 0);
+
+			if ( iPlane >= planes.size() )
+				continue;
+
+			plane_t plane;
+
+			plane.normal = planes.getVec(iPlane, 0);
+			plane.dist = planes.get<float>(iPlane, 12);
+
+			// vbsp adds axial planes to every brush, they make the bounding box
+			for ( int a = 0; a < 3; a ++ )
+			{
+				if ( axis(plane.normal, a) == 1.0f )
+					axis(vMaxs, a) = plane.dist;
+				else if ( axis(plane.normal, a) == -1.0f )
+					axis(vMins, a) = -plane.dist;
+			}
+
+			m_Planes.push_back(plane);
+			brush.iNumPlanes++;
+		}
+
+		if ( brush.iNumPlanes == 0 )
+			continue;
+
+		m_Brushes.push_back(brush);
+		mins.push_back(vMins);
+		maxs.push_back(vMaxs);
+	}
+
+	////////////////////////////
+	// displacements, all belong to the world
+	for ( int i = 0; i < dispinfos.size(); i ++ )
+	{
+		const bsp_vec_t vStart = dispinfos.getVec(i, 0);
+		const int iVertStart = dispinfos.get<int>(i, 12);
+		const int iPower = dispinfos.get<int>(i, 20);
+		const int iFace = dispinfos.get<std::uint16_t>(i, 36);
+
+		if ( iFace >= faces.size() || iPower < 2 || iPower > 4 )
+			continue;
+
+		const int iFirstEdge = faces.get<int>(iFace, 4);
+		const int iNumEdges = faces.get<short>(iFace, 8);
+
+		if ( iNumEdges != 4 || iFirstEdge < 0 || iFirstEdge + 4 > surfedges.size() )
+			continue;
+
+		bsp_vec_t corners[4];
+		int iStartCorner = 0;
+		float fNearest = 0.0f;
+
+		for ( int c = 0; c < 4; c ++ )
+		{
+			const int iSurfEdge = surfedges.get<int>(iFirstEdge + c, 0);
+			const int iEdge = std::abs(iSurfEdge);
+
+			if ( iEdge >= edges.size() )
+				break;
+
+			const int iVertex = edges.get<std::uint16_t>(iEdge, iSurfEdge >= 0 ? 0 : 2);
+
+			if ( iVertex >= vertexes.size() )
+				break;
+
+			corners[c] = vertexes.getVec(iVertex, 0);
+
+			const bsp_vec_t vDiff = sub(corners[c], vStart);
+			const float fDist = dot(vDiff, vDiff);
+
+			if ( c == 0 || fDist < fNearest )
+			{
+				fNearest = fDist;
+				iStartCorner = c;
+			}
+		}
+
+		// the displacement starts at the corner nearest its start position
+		std::rotate(corners, corners + iStartCorner, corners + 4);
+
+		const int iSize = (1 << iPower) + 1;
+
+		if ( iVertStart < 0 || iVertStart + iSize * iSize > dispverts.size() )
+			continue;
+
+		std::vector<bsp_vec_t> verts(static_cast<std::size_t>(iSize) * iSize);
+
+		// as CCoreDispInfo lays out its surface
+		for ( int v = 0; v < iSize; v ++ )
+		{
+			const float fV = static_cast<float>(v) / (iSize - 1);
+			const bsp_vec_t vEnd0 = lerp(corners[0], corners[1], fV);
+			const bsp_vec_t vEnd1 = lerp(corners[3], corners[2], fV);
+
+			for ( int u = 0; u < iSize; u ++ )
+			{
+				const int iVert = v * iSize + u;
+				const bsp_vec_t vOffset = dispverts.getVec(iVertStart + iVert, 0);
+				const float fDist = dispverts.get<float>(iVertStart + iVert, 12);
+				const bsp_vec_t vFlat = lerp(vEnd0, vEnd1, static_cast<float>(u) / (iSize - 1));
+
+				verts[iVert] = { vFlat.x + vOffset.x * fDist, vFlat.y + vOffset.y * fDist, vFlat.z + vOffset.z * fDist };
+			}
+		}
+
+		for ( int v = 0; v < iSize - 1; v ++ )
+		{
+			for ( int u = 0; u < iSize - 1; u ++ )
+			{
+				const bsp_vec_t &v00 = verts[v * iSize + u];
+				const bsp_vec_t &v01 = verts[v * iSize + u + 1];
+				const bsp_vec_t &v10 = verts[(v + 1) * iSize + u];
+				const bsp_vec_t &v11 = verts[(v + 1) * iSize + u + 1];
+
+				triangle_t tris[2];
+
+				// the diagonal alternates like the engine's
+				if ( (u + v) % 2 == 0 )
+				{
+					tris[0] = { { v00, v10, v11 } };
+					tris[1] = { { v00, v11, v01 } };
+				}
+				else
+				{
+					tris[0] = { { v00, v10, v01 } };
+					tris[1] = { { v01, v10, v11 } };
+				}
+
+				for ( const triangle_t &tri : tris )
+				{
+					bsp_vec_t vMins = tri.v[0];
+					bsp_vec_t vMaxs = tri.v[0];
+
+					for ( int p = 1; p < 3; p ++ )
+					{
+						for ( int a = 0; a < 3; a ++ )
+						{
+							axis(vMins, a) = std::min(axis(vMins, a), axis(tri.v[p], a));
+							axis(vMaxs, a) = std::max(axis(vMaxs, a), axis(tri.v[p], a));
+						}
+					}
+
+					m_Triangles.push_back(tri);
+					mins.push_back(vMins);
+					maxs.push_back(vMaxs);
+				}
+			}
+		}
+	}
+
+	buildBVH(mins, maxs);
+
+	return true;
+}
+
+void CBspWorld :: buildBVH ( const std::vector<bsp_vec_t> &mins, const std::vector<bsp_vec_t> &maxs )
+{
+	const int iNumPrimitives = static_cast<int>(mins.size());
+
+	m_Primitives.resize(static_cast<std::size_t>(iNumPrimitives));
+
+	for ( int i = 0; i < iNumPrimitives; i ++ )
+		m_Primitives[i] = i;
+
+	m_Nodes.clear();
+	m_Nodes.push_back(bvh_node_t());
+
+	buildNode(0, 0, iNumPrimitives, mins, maxs);
+}
+
+void CBspWorld :: buildNode ( const int iNode, const int iFirst, const int iCount, const std::vector<bsp_vec_t> &mins, const std::vector<bsp_vec_t> &maxs )
+{
+	bsp_vec_t vMins = { WORLD_SIZE, WORLD_SIZE, WORLD_SIZE };
+	bsp_vec_t vMaxs = { -WORLD_SIZE, -WORLD_SIZE, -WORLD_SIZE };
+	bsp_vec_t vCentreMins = vMins;
+	bsp_vec_t vCentreMaxs = vMaxs;
+
+	for ( int i = iFirst; i < iFirst + iCount; i ++ )
+	{
+		const int iPrimitive = m_Primitives[i];
+
+		for ( int a = 0; a < 3; a ++ )
+		{
+			const float fCentre = (axis(mins[iPrimitive], a) + axis(maxs[iPrimitive], a)) * 0.5f;
+
+			axis(vMins, a) = std::min(axis(vMins, a), axis(mins[iPrimitive], a));
+			axis(vMaxs, a) = std::max(axis(vMaxs, a), axis(maxs[iPrimitive], a));
+			axis(vCentreMins, a) = std::min(axis(vCentreMins, a), fCentre);
+			axis(vCentreMaxs, a) = std::max(axis(vCentreMaxs, a), fCentre);
+		}
+	}
+
+	m_Nodes[iNode].mins = vMins;
+	m_Nodes[iNode].maxs = vMaxs;
+
+	if ( iCount <= BVH_LEAF_SIZE )
+	{
+		m_Nodes[iNode].iFirst = iFirst;
+		m_Nodes[iNode].iCount = iCount;
+		return;
+	}
+
+	// split at the median along the widest spread of centres
+	int iAxis = 0;
+
+	for ( int a = 1; a < 3; a ++ )
+	{
+		if ( axis(vCentreMaxs, a) - axis(vCentreMins, a) > axis(vCentreMaxs, iAxis) - axis(vCentreMins, iAxis) )
+			iAxis = a;
+	}
+
+	const int iHalf = iCount / 2;
+
+	std::nth_element(m_Primitives.begin() + iFirst, m_Primitives.begin() + iFirst + iHalf, m_Primitives.begin() + iFirst + iCount,
+		[&]( const int a, const int b )
+		{
+			return axis(mins[a], iAxis) + axis(maxs[a], iAxis) < axis(mins[b], iAxis) + axis(maxs[b], iAxis);
+		});
+
+	const int iLeft = static_cast<int>(m_Nodes.size());
+
+	m_Nodes.push_back(bvh_node_t());
+	m_Nodes.push_back(bvh_node_t());
+
+	m_Nodes[iNode].iFirst = iLeft;
+	m_Nodes[iNode].iCount = 0;
+
+	buildNode(iLeft, iFirst, iHalf, mins, maxs);
+	buildNode(iLeft + 1, iFirst + iHalf, iCount - iHalf, mins, maxs);
+}
+
+// segment against box, a little bigger than the box to not miss touching hits
+static bool segmentHitsBox ( const bsp_vec_t &vFrom, const bsp_vec_t &vDir, const bsp_vec_t &vMins, const bsp_vec_t &vMaxs )
+{
+	float fEnter = 0.0f;
+	float fLeave = 1.0f;
+
+	for ( int a = 0; a < 3; a ++ )
+	{
+		const float fFrom = axis(vFrom, a);
+		const float fDir = axis(vDir, a);
+		const float fMin = axis(vMins, a) - DIST_EPSILON;
+		const float fMax = axis(vMaxs, a) + DIST_EPSILON;
+
+		if ( std::fabs(fDir) < 1e-6f )
+		{
+			if ( fFrom < fMin || fFrom > fMax )
+				return false;
+
+			continue;
+		}
+
+		float t1 = (fMin - fFrom) / fDir;
+		float t2 = (fMax - fFrom) / fDir;
+
+		if ( t1 > t2 )
+			std::swap(t1, t2);
+
+		fEnter = std::max(fEnter, t1);
+		fLeave = std::min(fLeave, t2);
+
+		if ( fEnter > fLeave )
+			return false;
+	}
+
+	return true;
+}
+
+bool CBspWorld :: isVisible ( const bsp_vec_t &vFrom, const bsp_vec_t &vTo ) const
+{
+	if ( m_Nodes.empty() || m_Primitives.empty() )
+		return true;
+
+	const bsp_vec_t vDir = sub(vTo, vFrom);
+
+	int stack[64];
+	int iStackSize = 0;
+
+	stack[iStackSize++] = 0;
+
+	while ( iStackSize > 0 )
+	{
+		const bvh_node_t &node = m_Nodes[stack[--iStackSize]];
+
+		if ( !segmentHitsBox(vFrom, vDir, node.mins, node.maxs) )
+			continue;
+
+		if ( node.iCount > 0 )
+		{
+			for ( int i = node.iFirst; i < node.iFirst + node.iCount; i ++ )
+			{
+				if ( hitsPrimitive(m_Primitives[i], vFrom, vTo) )
+					return false;
+			}
+		}
+		else if ( iStackSize + 2 <= 64 )
+		{
+			stack[iStackSize++] = node.iFirst;
+			stack[iStackSize++] = node.iFirst + 1;
+		}
+	}
+
+	return true;
+}
+
+bool CBspWorld :: hitsPrimitive ( const int iPrimitive, const bsp_vec_t &vFrom, const bsp_vec_t &vTo ) const
+{
+	const int iNumBrushes = static_cast<int>(m_Brushes.size());
+
+	if ( iPrimitive < iNumBrushes )
+		return hitsBrush(m_Brushes[iPrimitive], vFrom, vTo);
+
+	return hitsTriangle(m_Triangles[iPrimitive - iNumBrushes], vFrom, vTo);
+}
+
+// as the engine clips a ray to a brush : a start inside the brush is a hit
+bool CBspWorld :: hitsBrush ( const brush_t &brush, const bsp_vec_t &vFrom, const bsp_vec_t &vTo ) const
+{
+	float fEnter = -1.0f;
+	float fLeave = 1.0f;
+	bool bStartOut = false;
+
+	for ( int i = brush.iFirstPlane; i < brush.iFirstPlane + brush.iNumPlanes; i ++ )
+	{
+		const plane_t &plane = m_Planes[i];
+
+		const float d1 = dot(plane.normal, vFrom) - plane.dist;
+		const float d2 = dot(plane.normal, vTo) - plane.dist;
+
+		if ( d1 > 0.0f )
+			bStartOut = true;
+
+		// completely in front of this side
+		if ( d1 > 0.0f && (d2 >= DIST_EPSILON || d2 >= d1) )
+			return false;
+
+		if ( d1 <= 0.0f && d2 <= 0.0f )
+			continue;
+
+		if ( d1 > d2 )
+			fEnter = std::max(fEnter, std::max((d1 - DIST_EPSILON) / (d1 - d2), 0.0f));
+		else
+			fLeave = std::min(fLeave, std::min((d1 + DIST_EPSILON) / (d1 - d2), 1.0f));
+	}
+
+	if ( !bStartOut )
+		return true;
+
+	return fEnter < fLeave && fEnter > -1.0f && fEnter < 1.0f;
+}
+
+bool CBspWorld :: hitsTriangle ( const triangle_t &tri, const bsp_vec_t &vFrom, const bsp_vec_t &vTo )
+{
+	const bsp_vec_t vDir = sub(vTo, vFrom);
+	const bsp_vec_t vEdge1 = sub(tri.v[1], tri.v[0]);
+	const bsp_vec_t vEdge2 = sub(tri.v[2], tri.v[0]);
+	const bsp_vec_t vP = cross(vDir, vEdge2);
+	const float fDet = dot(vEdge1, vP);
+
+	if ( std::fabs(fDet) < 1e-8f )
+		return false;
+
+	const float fInvDet = 1.0f / fDet;
+	const bsp_vec_t vT = sub(vFrom, tri.v[0]);
+	const float u = dot(vT, vP) * fInvDet;
+
+	if ( u < 0.0f || u > 1.0f )
+		return false;
+
+	const bsp_vec_t vQ = cross(vT, vEdge1);
+	const float v = dot(vDir, vQ) * fInvDet;
+
+	if ( v < 0.0f || u + v > 1.0f )
+		return false;
+
+	const float t = dot(vEdge2, vQ) * fInvDet;
+
+	return t > 0.0f && t < 1.0f;
+}
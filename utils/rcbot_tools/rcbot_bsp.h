@@ -0,0 +1,102 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+// World geometry from a Source .bsp file for tracing lines without the
+// engine : the solid brushes of the world model and displacement triangles,
+// in a bounding volume hierarchy. Brush entities and props aren't loaded,
+// the same as the CTraceFilterWorldAndPropsOnly traces the game uses for
+// waypoint visibility.
+#ifndef __RCBOT_BSP_H__
+#define __RCBOT_BSP_H__
+
+#include <cstdint>
+#include <vector>
+
+typedef struct
+{
+	float x, y, z;
+}bsp_vec_t;
+
+class CBspWorld
+{
+public:
+	bool load ( const char *szFilename );
+
+	// true if nothing solid is between vFrom and vTo, safe to call from many threads
+	bool isVisible ( const bsp_vec_t &vFrom, const bsp_vec_t &vTo ) const;
+
+	int numBrushes () const { return static_cast<int>(m_Brushes.size()); }
+	int numTriangles () const { return static_cast<int>(m_Triangles.size()); }
+private:
+	typedef struct
+	{
+		bsp_vec_t normal;
+		float dist;
+	}plane_t;
+
+	typedef struct
+	{
+		int iFirstPlane;
+		int iNumPlanes;
+	}brush_t;
+
+	typedef struct
+	{
+		bsp_vec_t v[3];
+	}triangle_t;
+
+	typedef struct
+	{
+		bsp_vec_t mins;
+		bsp_vec_t maxs;
+		int iFirst;		// first child node, or first primitive for leaves
+		int iCount;		// number of primitives, 0 for inner nodes
+	}bvh_node_t;
+
+	// primitives are brushes then triangles
+	bool hitsPrimitive ( int iPrimitive, const bsp_vec_t &vFrom, const bsp_vec_t &vTo ) const;
+	bool hitsBrush ( const brush_t &brush, const bsp_vec_t &vFrom, const bsp_vec_t &vTo ) const;
+	static bool hitsTriangle ( const triangle_t &tri, const bsp_vec_t &vFrom, const bsp_vec_t &vTo );
+
+	void buildBVH ( const std::vector<bsp_vec_t> &mins, const std::vector<bsp_vec_t> &maxs );
+	void buildNode ( int iNode, int iFirst, int iCount, const std::vector<bsp_vec_t> &mins, const std::vector<bsp_vec_t> &maxs );
+
+	std::vector<plane_t> m_Planes;		// brush sides, brushes index into this
+	std::vector<brush_t> m_Brushes;
+	std::vector<triangle_t> m_Triangles;
+
+	std::vector<bvh_node_t> m_Nodes;
+	std::vector<int> m_Primitives;		// leaves index into this
+};
+
+#endif
@@ -0,0 +1,82 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+// rcbot_ch : builds the contraction hierarchy (.rcch) aux file for a
+// waypoint file without running a server, e.g. for every map at once
+//
+// usage : rcbot_ch <map.rcw> [map.rcch]
+
+#include "bot_waypoint_ch.h"
+#include "rcbot_tools.h"
+#include "rcbot/logging.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+int main ( int argc, char **argv )
+{
+	if ( argc < 2 )
+	{
+		std::printf("usage : %s <map.rcw> [map.rcch]\n", argv[0]);
+		std::printf("copy the .rcch file into rcbot2/aux_data/<mod folder> next to the map's other aux files\n");
+		return 1;
+	}
+
+	const std::string output = argc > 2 ? std::string(argv[2]) : swapExtension(argv[1], BOT_WAYPOINT_CH_EXTENSION);
+
+	ch_waypoints_t waypoints;
+
+	if ( !readWaypoints(argv[1], &waypoints) )
+		return 1;
+
+	const int iNumWaypoints = static_cast<int>(waypoints.bUsed.size());
+	const auto start = std::chrono::steady_clock::now();
+
+	std::vector<CContractionHierarchy> hierarchies;
+
+	CContractionHierarchy::buildAll(waypoints, &hierarchies);
+
+	for ( const CContractionHierarchy &hierarchy : hierarchies )
+		std::printf("team mask %d : %d edges, %d shortcuts\n", hierarchy.getExcludeFlags(), hierarchy.numEdges(), hierarchy.numShortcuts());
+
+	std::printf("%d waypoints contracted in %0.2fs\n", iNumWaypoints, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+	if ( !CContractionHierarchy::save(output.c_str(), hierarchies, CContractionHierarchy::checksum(waypoints), iNumWaypoints) )
+	{
+		logger->Log(LogLevel::ERROR, "can't save %s", output.c_str());
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,250 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+#include "rcbot_tools.h"
+#include "rcbot/logging.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+void CBotLogger::Log(const LogLevel level, const char *fmt, ...)
+{
+	va_list argptr;
+	va_start(argptr, fmt);
+	std::vfprintf(level <= LogLevel::WARN ? stderr : stdout, fmt, argptr);
+	va_end(argptr);
+
+	std::fputc('\n', level <= LogLevel::WARN ? stderr : stdout);
+}
+
+static CBotLogger s_Logger;
+CBotLogger *logger = &s_Logger;
+
+template <typename T>
+static bool readValue ( std::FILE *fp, T *pValue )
+{
+	return std::fread(pValue, sizeof(T), 1, fp) == 1;
+}
+
+// versions 1 to 5 : one record per waypoint
+static bool readWaypointRecords ( std::FILE *fp, const int iVersion, const int iNumWaypoints, ch_waypoints_t *waypoints, std::vector<std::vector<int>> *pPaths )
+{
+	bool bOk = true;
+
+	for ( int i = 0; i < iNumWaypoints && bOk; i ++ )
+	{
+		int iAimYaw;
+		bool bUsed;
+		int iNumPaths;
+
+		bOk = std::fread(&waypoints->fOrigins[static_cast<std::size_t>(i) * 3], sizeof(float), 3, fp) == 3 &&
+			readValue(fp, &iAimYaw) && readValue(fp, &waypoints->iFlags[i]) &&
+			readValue(fp, &bUsed) && readValue(fp, &iNumPaths);
+
+		waypoints->bUsed[i] = bUsed ? 1 : 0;
+
+		for ( int n = 0; bOk && n < iNumPaths; n ++ )
+		{
+			int iPath;
+
+			bOk = readValue(fp, &iPath);
+
+			// CWaypoint::addPathTo leaves out bad, repeated and looping paths
+			if ( bOk && iPath >= 0 && iPath < iNumWaypoints && iPath != i &&
+				std::find((*pPaths)[i].begin(), (*pPaths)[i].end(), iPath) == (*pPaths)[i].end() )
+				(*pPaths)[i].push_back(iPath);
+		}
+
+		int iArea;
+		float fRadius;
+
+		if ( bOk && iVersion >= 2 )
+			bOk = readValue(fp, &iArea);
+
+		if ( bOk && iVersion >= 3 )
+			bOk = readValue(fp, &fRadius);
+	}
+
+	return bOk;
+}
+
+// version 6 : one block of arrays, see CWaypoints::saveWaypointData
+static bool readWaypointData ( std::FILE *fp, const int iNumWaypoints, ch_waypoints_t *waypoints, std::vector<std::vector<int>> *pPaths )
+{
+	rcw_data_header_t dataHeader;
+
+	if ( !readValue(fp, &dataHeader) || dataHeader.iDataSize < 0 || dataHeader.iNumPaths < 0 ||
+		dataHeader.iNumPaths > dataHeader.iDataSize / static_cast<int>(sizeof(int)) )
+		return false;
+
+	const std::size_t iWaypoints = static_cast<std::size_t>(iNumWaypoints);
+	const std::size_t iPathStarts = iWaypoints * 7 * sizeof(int);
+	const std::size_t iPaths = iPathStarts + (iWaypoints + 1) * sizeof(int);
+	const std::size_t iUsed = iPaths + static_cast<std::size_t>(dataHeader.iNumPaths) * sizeof(int);
+
+	if ( static_cast<std::size_t>(dataHeader.iDataSize) != iUsed + iWaypoints )
+		return false;
+
+	std::vector<unsigned char> data(static_cast<std::size_t>(dataHeader.iDataSize));
+
+	if ( std::fread(data.data(), 1, data.size(), fp) != data.size() )
+		return false;
+
+	// FNV-1a
+	unsigned int iHash = 2166136261u;
+
+	for ( const unsigned char iByte : data )
+	{
+		iHash ^= iByte;
+		iHash *= 16777619u;
+	}
+
+	if ( iHash != dataHeader.iChecksum )
+		return false;
+
+	// origins first, then aim yaws and flags
+	const int *pFlags = reinterpret_cast<const int*>(data.data() + iWaypoints * 4 * sizeof(int));
+	const int *pPathStarts = reinterpret_cast<const int*>(data.data() + iPathStarts);
+	const int *pPathTargets = reinterpret_cast<const int*>(data.data() + iPaths);
+
+	std::memcpy(waypoints->fOrigins.data(), data.data(), iWaypoints * 3 * sizeof(float));
+
+	for ( int i = 0; i < iNumWaypoints; i ++ )
+	{
+		waypoints->iFlags[i] = pFlags[i];
+		waypoints->bUsed[i] = data[iUsed + i] != 0 ? 1 : 0;
+
+		if ( pPathStarts[i] < 0 || pPathStarts[i] > pPathStarts[i + 1] || pPathStarts[i + 1] > dataHeader.iNumPaths )
+			return false;
+
+		for ( int j = pPathStarts[i]; j < pPathStarts[i + 1]; j ++ )
+		{
+			if ( pPathTargets[j] < 0 || pPathTargets[j] >= iNumWaypoints || pPathTargets[j] == i )
+				return false;
+
+			(*pPaths)[i].push_back(pPathTargets[j]);
+		}
+	}
+
+	return true;
+}
+
+bool readWaypoints ( const char *szFilename, ch_waypoints_t *waypoints, rcw_header_t *pHeader )
+{
+	std::FILE *fp = std::fopen(szFilename, "rb");
+
+	if ( fp == nullptr )
+	{
+		logger->Log(LogLevel::ERROR, "can't open %s", szFilename);
+		return false;
+	}
+
+	rcw_header_t header;
+
+	if ( !readValue(fp, &header) || std::strncmp(header.szFileType, RCW_FILE_TYPE, sizeof(header.szFileType)) != 0 )
+	{
+		logger->Log(LogLevel::ERROR, "%s is not a waypoint file", szFilename);
+		std::fclose(fp);
+		return false;
+	}
+
+	if ( header.iVersion > RCW_MAX_VERSION || header.iNumWaypoints < 0 )
+	{
+		logger->Log(LogLevel::ERROR, "%s : waypoint version too new", szFilename);
+		std::fclose(fp);
+		return false;
+	}
+
+	if ( pHeader != nullptr )
+		*pHeader = header;
+
+	if ( header.iVersion > 3 )
+	{
+		rcw_author_t author;
+
+		if ( !readValue(fp, &author) )
+		{
+			std::fclose(fp);
+			return false;
+		}
+	}
+
+	const int iNumWaypoints = header.iNumWaypoints;
+	std::vector<std::vector<int>> paths(static_cast<std::size_t>(iNumWaypoints));
+
+	waypoints->fOrigins.resize(static_cast<std::size_t>(iNumWaypoints) * 3);
+	waypoints->iFlags.resize(static_cast<std::size_t>(iNumWaypoints));
+	waypoints->bUsed.resize(static_cast<std::size_t>(iNumWaypoints));
+
+	const bool bOk = header.iVersion >= 6 ? readWaypointData(fp, iNumWaypoints, waypoints, &paths) :
+		readWaypointRecords(fp, header.iVersion, iNumWaypoints, waypoints, &paths);
+
+	std::fclose(fp);
+
+	if ( !bOk )
+	{
+		logger->Log(LogLevel::ERROR, "%s is cut short or damaged", szFilename);
+		return false;
+	}
+
+	waypoints->iPathOffsets.resize(static_cast<std::size_t>(iNumWaypoints) + 1);
+	waypoints->iPathTargets.clear();
+
+	for ( int i = 0; i < iNumWaypoints; i ++ )
+	{
+		waypoints->iPathOffsets[i] = static_cast<int>(waypoints->iPathTargets.size());
+		waypoints->iPathTargets.insert(waypoints->iPathTargets.end(), paths[i].begin(), paths[i].end());
+	}
+
+	waypoints->iPathOffsets[iNumWaypoints] = static_cast<int>(waypoints->iPathTargets.size());
+
+	return true;
+}
+
+std::string swapExtension ( const char *szFilename, const char *szExtension )
+{
+	std::string output = szFilename;
+
+	const std::size_t iDot = output.find_last_of('.');
+
+	if ( iDot != std::string::npos && output.find_first_of("/\\", iDot) == std::string::npos )
+		output.erase(iDot);
+
+	output += '.';
+	output += szExtension;
+
+	return output;
+}
@@ -0,0 +1,75 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+// shared by the standalone tools : reading waypoint files without the engine
+#ifndef __RCBOT_TOOLS_H__
+#define __RCBOT_TOOLS_H__
+
+#include "bot_waypoint_ch.h"
+
+#include <string>
+
+// same layout as CWaypointHeader and CWaypointAuthorInfo in bot_waypoint.h
+typedef struct
+{
+	char szFileType[16];
+	char szMapName[64];
+	int iVersion;
+	int iNumWaypoints;
+	int iFlags;
+}rcw_header_t;
+
+typedef struct
+{
+	char szAuthor[32];
+	char szModifiedBy[32];
+}rcw_author_t;
+
+// CWaypointDataHeader, version 6 files
+typedef struct
+{
+	unsigned int iChecksum;
+	int iNumPaths;
+	int iDataSize;
+}rcw_data_header_t;
+
+static constexpr const char* RCW_FILE_TYPE = "RCBot2";
+static constexpr int RCW_MAX_VERSION = 6;
+
+// reads waypoints the same way CWaypoints::load and CWaypoint::load do
+bool readWaypoints ( const char *szFilename, ch_waypoints_t *waypoints, rcw_header_t *pHeader = nullptr );
+
+// szFilename with its extension swapped for szExtension
+std::string swapExtension ( const char *szFilename, const char *szExtension );
+
+#endif
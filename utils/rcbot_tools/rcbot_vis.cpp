@@ -0,0 +1,229 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+ *    This file is part of RCBot.
+ *
+ *    RCBot by Paul Murphy adapted from Botman's HPB Bot 2 template.
+ *
+ *    RCBot is free software; you can redistribute it and/or modify it
+ *    under the terms of the GNU General Public License as published by the
+ *    Free Software Foundation; either version 2 of the License, or (at
+ *    your option) any later version.
+ *
+ *    RCBot is distributed in the hope that it will be useful, but
+ *    WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *    General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with RCBot; if not, write to the Free Software Foundation,
+ *    Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *    In addition, as a special exception, the author gives permission to
+ *    link the code of this program with the Half-Life Game Engine ("HL
+ *    Engine") and Modified Game Libraries ("MODs") developed by Valve,
+ *    L.L.C ("Valve").  You must obey the GNU General Public License in all
+ *    respects for all of the code used other than the HL Engine and MODs
+ *    from Valve.  If you modify this file, you may extend this exception
+ *    to your version of the file, but you are not obligated to do so.  If
+ *    you do not wish to do so, delete this exception statement from your
+ *    version.
+ *
+ */
+
+// rcbot_vis : works out the waypoint visibility (.rcv) aux file from the
+// map's geometry without running a server, using every core
+//
+// usage : rcbot_vis <map.bsp> <map.rcw> [map.rcv]
+//
+// The .rcw is marked as having visibility so the game loads the .rcv
+// instead of working it out again a few traces per frame.
+
+#include "rcbot_bsp.h"
+#include "rcbot_tools.h"
+#include "bot_compress.h"
+#include "rcbot/logging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// same layout as wpt_vis_header_t in bot_waypoint_visibility.h
+typedef struct
+{
+	int numwaypoints;
+	int waypoint_version;
+	char szMapName[64];
+	int maxwaypoints;
+}rcv_header_t;
+
+static constexpr const char* VISIBILITY_EXTENSION = "rcv";	// BOT_VISIBILITY_EXTENSION
+static constexpr int VISIBILITY_WAYPOINT_VERSION = 6;		// CWaypoints::WAYPOINT_VERSION
+static constexpr int RCW_FLAG_VISIBILITY = 1;				// CWaypoints::W_FILE_FL_VISIBILITY
+
+// same as CWaypoints::capacityFor so rows are as long as the game's
+static int capacityFor ( const int iNumWaypoints )
+{
+	int iCapacity = 512;
+
+	while ( iCapacity < iNumWaypoints + 128 && iCapacity < 16384 )
+		iCapacity *= 2;
+
+	return iCapacity;
+}
+
+// set the visibility flag in the waypoint file's header
+static bool markWaypoints ( const char *szFilename, rcw_header_t header )
+{
+	std::FILE *fp = std::fopen(szFilename, "r+b");
+
+	if ( fp == nullptr )
+		return false;
+
+	header.iFlags |= RCW_FLAG_VISIBILITY;
+
+	const bool bOk = std::fwrite(&header, sizeof(header), 1, fp) == 1;
+
+	std::fclose(fp);
+
+	return bOk;
+}
+
+int main ( int argc, char **argv )
+{
+	if ( argc < 3 )
+	{
+		std::printf("usage : %s <map.bsp> <map.rcw> [map.rcv]\n", argv[0]);
+		std::printf("copy the .rcv file into rcbot2/aux_data/<mod folder> next to the map's other aux files\n");
+		return 1;
+	}
+
+	const std::string output = argc > 3 ? std::string(argv[3]) : swapExtension(argv[2], VISIBILITY_EXTENSION);
+
+	CBspWorld world;
+
+	if ( !world.load(argv[1]) )
+		return 1;
+
+	ch_waypoints_t waypoints;
+	rcw_header_t header;
+
+	if ( !readWaypoints(argv[2], &waypoints, &header) )
+		return 1;
+
+	const int iNumWaypoints = static_cast<int>(waypoints.bUsed.size());
+	const int iMaxWaypoints = capacityFor(iNumWaypoints);
+	const int iRowWords = (iMaxWaypoints + 63) / 64;
+
+	if ( iNumWaypoints > iMaxWaypoints )
+	{
+		logger->Log(LogLevel::ERROR, "%s has too many waypoints (%d)", argv[2], iNumWaypoints);
+		return 1;
+	}
+
+	std::printf("%d brushes, %d displacement triangles, %d waypoints\n", world.numBrushes(), world.numTriangles(), iNumWaypoints);
+
+	std::vector<std::uint64_t> table(static_cast<std::size_t>(iMaxWaypoints) * iRowWords, 0);
+
+	const auto getOrigin = [&]( const int i ) -> bsp_vec_t
+	{
+		return { waypoints.fOrigins[i * 3], waypoints.fOrigins[i * 3 + 1], waypoints.fOrigins[i * 3 + 2] };
+	};
+
+	const auto setVisible = [&]( const int iFrom, const int iTo )
+	{
+		table[static_cast<std::size_t>(iFrom) * iRowWords + iTo / 64] |= static_cast<std::uint64_t>(1) << (iTo % 64);
+	};
+
+	// each thread takes the next row and only writes that row, the other
+	// half of the table is mirrored once they are all done
+	std::atomic<int> iNextRow(0);
+	std::atomic<int> iRowsDone(0);
+
+	const auto work = [&]()
+	{
+		for ( int i = iNextRow++; i < iNumWaypoints; i = iNextRow++ )
+		{
+			if ( waypoints.bUsed[i] )
+			{
+				const bsp_vec_t vFrom = getOrigin(i);
+
+				setVisible(i, i);
+
+				for ( int j = i + 1; j < iNumWaypoints; j ++ )
+				{
+					if ( waypoints.bUsed[j] && world.isVisible(vFrom, getOrigin(j)) )
+						setVisible(i, j);
+				}
+			}
+
+			iRowsDone++;
+		}
+	};
+
+	const auto start = std::chrono::steady_clock::now();
+	const unsigned int iNumThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	std::vector<std::thread> threads;
+
+	for ( unsigned int t = 0; t < iNumThreads; t ++ )
+		threads.emplace_back(work);
+
+	// rows near the start have the most pairs, so this is a rough guide
+	while ( iRowsDone < iNumWaypoints )
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(250));
+		std::printf("\r%d / %d waypoints", iRowsDone.load(), iNumWaypoints);
+		std::fflush(stdout);
+	}
+
+	for ( std::thread &thread : threads )
+		thread.join();
+
+	for ( int i = 0; i < iNumWaypoints; i ++ )
+	{
+		for ( int j = i + 1; j < iNumWaypoints; j ++ )
+		{
+			if ( table[static_cast<std::size_t>(i) * iRowWords + j / 64] >> (j % 64) & 1 )
+				setVisible(j, i);
+		}
+	}
+
+	std::printf("\rvisibility for %d waypoints worked out in %0.2fs on %u threads\n", iNumWaypoints,
+		std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), iNumThreads);
+
+	rcv_header_t visHeader;
+
+	std::memset(&visHeader, 0, sizeof(visHeader));
+	visHeader.numwaypoints = iNumWaypoints;
+	visHeader.waypoint_version = VISIBILITY_WAYPOINT_VERSION;
+	// the name read from the file might not be terminated
+	std::snprintf(visHeader.szMapName, sizeof(visHeader.szMapName), "%.*s",
+		static_cast<int>(sizeof(header.szMapName)), header.szMapName);
+	visHeader.maxwaypoints = iMaxWaypoints;
+
+	// the table is saved as the bytes of its words, little endian like the game
+	std::vector<unsigned char> buffer(sizeof(visHeader) + table.size() * sizeof(std::uint64_t));
+
+	std::memcpy(buffer.data(), &visHeader, sizeof(visHeader));
+	std::memcpy(buffer.data() + sizeof(visHeader), table.data(), table.size() * sizeof(std::uint64_t));
+
+	if ( !RCBot_CompressedSave(output.c_str(), buffer.data(), buffer.size()) )
+	{
+		logger->Log(LogLevel::ERROR, "can't save %s", output.c_str());
+		return 1;
+	}
+
+	if ( !(header.iFlags & RCW_FLAG_VISIBILITY) && !markWaypoints(argv[2], header) )
+	{
+		logger->Log(LogLevel::ERROR, "can't mark %s as having visibility", argv[2]);
+		return 1;
+	}
+
+	return 0;
+}